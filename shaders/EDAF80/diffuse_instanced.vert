@@ -0,0 +1,42 @@
+#version 410
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+
+// Per-instance data streamed by `bonobo::instanced_renderer`, at the
+// locations listed in `bonobo::instance_bindings`: unlike the attributes
+// above, these advance once per instance rather than once per vertex.
+layout (location = 5) in mat4 instance_model_to_world;
+layout (location = 9) in mat3 instance_normal_model_to_world;
+layout (location = 12) in vec4 instance_colour;
+
+uniform mat4 vertex_world_to_clip;
+uniform bool compact_vertices;
+
+out VS_OUT {
+	vec3 vertex;
+	vec3 normal;
+	vec4 colour;
+} vs_out;
+
+// Inverse of the octahedral mapping used by compact vertices for normals.
+vec3 decode_octahedral(vec2 encoded)
+{
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (direction.z < 0.0)
+		direction.xy = (1.0 - abs(direction.yx)) * vec2(direction.x >= 0.0 ? 1.0 : -1.0,
+		                                                direction.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(direction);
+}
+
+void main()
+{
+	// Compact positions are dequantised by the instance matrix already.
+	vec3 model_normal = compact_vertices ? decode_octahedral(normal.xy) : normal;
+
+	vs_out.vertex = vec3(instance_model_to_world * vec4(vertex, 1.0));
+	vs_out.normal = instance_normal_model_to_world * model_normal;
+	vs_out.colour = instance_colour;
+
+	gl_Position = vertex_world_to_clip * vec4(vs_out.vertex, 1.0);
+}
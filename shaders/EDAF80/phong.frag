@@ -34,7 +34,11 @@ void main()
 
     // 2) ѡͼ
     if (use_normal_mapping == 1) {
-        vec3 n_t = texture(normal_texture, fs_in.uv).xyz * 2.0 - 1.0; // [-1,1]
+        // Only X and Y are read: compressed normal maps (BC5) do not
+        // store Z, which is reconstructed from the unit length instead.
+        vec3 n_t;
+        n_t.xy = texture(normal_texture, fs_in.uv).xy * 2.0 - 1.0; // [-1,1]
+        n_t.z = sqrt(max(1.0 - dot(n_t.xy, n_t.xy), 0.0));
         N = normalize(fs_in.TBN * n_t);
     }
 
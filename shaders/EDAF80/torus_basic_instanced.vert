@@ -0,0 +1,49 @@
+#version 410 core
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 texcoord;
+
+// Per-instance data streamed by bonobo::instanced_renderer
+layout (location = 5) in mat4 instance_model_to_world;
+layout (location = 9) in mat3 instance_normal_model_to_world;
+
+out VS_OUT {
+    vec2 texcoord;
+    vec3 world_pos;
+    vec3 world_normal;
+} vs_out;
+
+uniform mat4 vertex_world_to_clip;
+uniform bool compact_vertices;
+
+// Inverse of the octahedral mapping used by compact vertices for normals.
+vec3 decode_octahedral(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0)
+        direction.xy = (1.0 - abs(direction.yx)) * vec2(direction.x >= 0.0 ? 1.0 : -1.0,
+                                                        direction.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(direction);
+}
+
+void main()
+{
+    // Compact positions are dequantised by the instance matrix already,
+    // and compact texture coordinates are normalised by the attribute
+    // format, but normals are stored octahedrally.
+    vec3 model_normal = compact_vertices ? decode_octahedral(normal.xy) : normal;
+
+    // Transform vertex to world space
+    vec4 world_pos = instance_model_to_world * vec4(vertex, 1.0);
+    vs_out.world_pos = world_pos.xyz;
+
+    // Transform normal to world space
+    vs_out.world_normal = normalize(instance_normal_model_to_world * model_normal);
+
+    // Pass texture coordinates
+    vs_out.texcoord = texcoord.xy;
+
+    // Transform to clip space
+    gl_Position = vertex_world_to_clip * world_pos;
+}
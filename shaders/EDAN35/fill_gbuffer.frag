@@ -38,5 +38,7 @@ void main()
 		geometry_specular = texture(specular_texture, fs_in.texcoord);
 
 	// Worldspace normal
+	// (Compressed normal maps only store X and Y: rebuild Z as
+	//  sqrt(1.0 - dot(xy, xy)) rather than reading it.)
 	geometry_normal.xyz = vec3(0.0);
 }
@@ -12,6 +12,7 @@ layout (std140) uniform CameraViewProjTransforms
 };
 
 uniform mat4 vertex_model_to_world;
+uniform bool compact_vertices;
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
@@ -26,12 +27,30 @@ out VS_OUT {
 	vec3 binormal;
 } vs_out;
 
+// Inverse of the octahedral mapping used by compact vertices for normals
+// and tangents.
+vec3 decode_octahedral(vec2 encoded)
+{
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (direction.z < 0.0)
+		direction.xy = (1.0 - abs(direction.yx)) * vec2(direction.x >= 0.0 ? 1.0 : -1.0,
+		                                                direction.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(direction);
+}
 
 void main() {
-	vs_out.normal   = normalize(normal);
+	if (compact_vertices) {
+		// The tangent stores the sign of the binormal in its third
+		// component, as the binormal itself is not stored.
+		vs_out.normal   = decode_octahedral(normal.xy);
+		vs_out.tangent  = decode_octahedral(tangent.xy);
+		vs_out.binormal = cross(vs_out.normal, vs_out.tangent) * tangent.z;
+	} else {
+		vs_out.normal   = normalize(normal);
+		vs_out.tangent  = normalize(tangent);
+		vs_out.binormal = normalize(binormal);
+	}
 	vs_out.texcoord = texcoord.xy;
-	vs_out.tangent  = normalize(tangent);
-	vs_out.binormal = normalize(binormal);
 
 	gl_Position = camera.view_projection * vertex_model_to_world * vec4(vertex, 1.0);
 }
@@ -405,16 +405,16 @@ int main()
 		glfwSwapBuffers(window);
 	}
 
-	glDeleteTextures(1, &neptune_texture);
-	glDeleteTextures(1, &uranus_texture);
-	glDeleteTextures(1, &saturn_ring_texture);
-	glDeleteTextures(1, &saturn_texture);
-	glDeleteTextures(1, &jupiter_texture);
-	glDeleteTextures(1, &mars_texture);
-	glDeleteTextures(1, &moon_texture);
-	glDeleteTextures(1, &earth_texture);
-	glDeleteTextures(1, &venus_texture);
-	glDeleteTextures(1, &sun_texture);
+	bonobo::releaseTexture(neptune_texture);
+	bonobo::releaseTexture(uranus_texture);
+	bonobo::releaseTexture(saturn_ring_texture);
+	bonobo::releaseTexture(saturn_texture);
+	bonobo::releaseTexture(jupiter_texture);
+	bonobo::releaseTexture(mars_texture);
+	bonobo::releaseTexture(moon_texture);
+	bonobo::releaseTexture(earth_texture);
+	bonobo::releaseTexture(venus_texture);
+	bonobo::releaseTexture(sun_texture);
 
 	bonobo::deinit();
 
@@ -4,14 +4,18 @@
 
 #include "config.hpp"
 #include "core/Bonobo.h"
+#include "core/bvh.hpp"
 #include "core/FPSCamera.h"
+#include "core/instanced_renderer.hpp"
 #include "core/node.hpp"
+#include "core/render_queue.hpp"
 #include "core/ShaderProgramManager.hpp"
 #include <imgui.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <tinyfiledialogs.h>
 
 #include <array>
 #include <clocale>
@@ -111,6 +115,17 @@ edaf80::Assignment2::run()
 	if (texcoord_shader == 0u)
 		LogError("Failed to load texcoord shader");
 
+	// Instanced programs only work through `bonobo::instanced_renderer`;
+	// they are registered with the others so that they get reloaded along
+	// with them, but cannot be selected for the circle rings.
+	GLuint diffuse_instanced_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Diffuse (instanced)",
+	                                         { { ShaderType::vertex, "EDAF80/diffuse_instanced.vert" },
+	                                           { ShaderType::fragment, "EDAF80/diffuse_instanced.frag" } },
+	                                         diffuse_instanced_shader);
+	if (diffuse_instanced_shader == 0u)
+		LogError("Failed to load instanced diffuse shader");
+
 	auto const light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
 	auto const set_uniforms = [&light_position](GLuint program){
 		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr (light_position));
@@ -162,7 +177,7 @@ edaf80::Assignment2::run()
 	for (std::size_t i = 0; i < control_point_locations.size(); ++i) {
 		auto& control_point = control_points[i];
 		control_point.set_geometry(control_point_sphere);
-		control_point.set_program(&diffuse_shader, set_uniforms);
+		control_point.set_program(&diffuse_instanced_shader, set_uniforms);
 		control_point.get_transform().SetTranslate(control_point_locations[i]);
 	}
 
@@ -175,10 +190,28 @@ edaf80::Assignment2::run()
 	auto polygon_mode = bonobo::polygon_mode_t::fill;
 	bool show_logs = true;
 	bool show_gui = true;
+	bool shader_reload_failed = false;
 	bool show_basis = false;
 	float basis_thickness_scale = 1.0f;
 	float basis_length_scale = 1.0f;
 
+	bonobo::render_queue render_queue;
+	// Control points share their sphere, program and material, so they all
+	// get drawn with a single instanced call.
+	bonobo::instanced_renderer control_points_renderer;
+
+	// The rings move along the path while the control points stay put;
+	// the tree refers to each by its index in `scene_nodes`.
+	std::vector<Node const*> scene_nodes;
+	bonobo::dynamic_bvh scene_bvh;
+	auto const circle_rings_proxy = scene_bvh.insert(circle_rings.get_world_bounding_box(), 0u);
+	scene_nodes.push_back(&circle_rings);
+	for (auto const& control_point : control_points) {
+		scene_bvh.insert(control_point.get_world_bounding_box(), static_cast<std::uint32_t>(scene_nodes.size()));
+		scene_nodes.push_back(&control_point);
+	}
+	std::vector<std::uint32_t> visible_nodes;
+
 	changeCullMode(cull_mode);
 
 	while (!glfwWindowShouldClose(window)) {
@@ -194,6 +227,14 @@ edaf80::Assignment2::run()
 		mCamera.Update(deltaTimeUs, inputHandler);
 		elapsed_time_s += std::chrono::duration<float>(deltaTimeUs).count();
 
+		if (inputHandler.GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
+			shader_reload_failed = !program_manager.ReloadAllPrograms();
+			if (shader_reload_failed)
+				tinyfd_notifyPopup("Shader Program Reload Error",
+				                   "An error occurred while reloading shader programs; see the logs for details.\n"
+				                   "Rendering is suspended until the issue is solved. Once fixed, just reload the shaders again.",
+				                   "error");
+		}
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F3) & JUST_RELEASED)
 			show_logs = !show_logs;
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F2) & JUST_RELEASED)
@@ -277,12 +318,17 @@ edaf80::Assignment2::run()
 			circle_rings.get_transform().SetTranslate(pos);
 		}
 
-		circle_rings.render(mCamera.GetWorldToClipMatrix());
-		if (show_control_points) {
-			for (auto const& control_point : control_points) {
-				control_point.render(mCamera.GetWorldToClipMatrix());
+		scene_bvh.update(circle_rings_proxy, circle_rings.get_world_bounding_box());
+		scene_bvh.cull(bonobo::bounds::extractFrustum(mCamera.GetWorldToClipMatrix()), visible_nodes);
+		for (auto const index : visible_nodes) {
+			if (scene_nodes[index] == &circle_rings) {
+				render_queue.add(circle_rings);
+			} else if (show_control_points) {
+				control_points_renderer.add(*scene_nodes[index]);
 			}
 		}
+		render_queue.flush(mCamera.GetWorldToClipMatrix());
+		control_points_renderer.flush(mCamera.GetWorldToClipMatrix());
 
 		bool const opened = ImGui::Begin("Scene Controls", nullptr, ImGuiWindowFlags_None);
 		if (opened) {
@@ -291,9 +337,18 @@ edaf80::Assignment2::run()
 				changeCullMode(cull_mode);
 			}
 			bonobo::uiSelectPolygonMode("Polygon mode", polygon_mode);
+			auto const previous_program_index = program_index;
 			auto selection_result = program_manager.SelectProgram("Shader", program_index);
 			if (selection_result.was_selection_changed) {
-				circle_rings.set_program(selection_result.program, set_uniforms);
+				// Instanced programs read their transforms from
+				// per-instance attributes, which only
+				// `bonobo::instanced_renderer` provides.
+				if (selection_result.program == &diffuse_instanced_shader) {
+					LogWarning("\"%s\" can only be used for instanced draws.", selection_result.name);
+					program_index = previous_program_index;
+				} else {
+					circle_rings.set_program(selection_result.program, set_uniforms);
+				}
 			}
 			ImGui::Separator();
 			ImGui::Checkbox("Show control points", &show_control_points);
@@ -304,6 +359,16 @@ edaf80::Assignment2::run()
 			ImGui::Checkbox("Show basis", &show_basis);
 			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
 			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
+			ImGui::Separator();
+			auto const& culling_statistics = scene_bvh.getCullStatistics();
+			ImGui::Text("Nodes in view: %zu visible, %zu culled", culling_statistics.visible_nb, culling_statistics.culled_nb);
+			auto const& queue_statistics = render_queue.getStatistics();
+			ImGui::Text("Draws: %zu", queue_statistics.draws_nb);
+			ImGui::Text("Program switches: %zu", queue_statistics.program_switches_nb);
+			ImGui::Text("Texture binds: %zu", queue_statistics.texture_binds_nb);
+			ImGui::Text("VAO binds: %zu", queue_statistics.vao_binds_nb);
+			auto const& instancing_statistics = control_points_renderer.getStatistics();
+			ImGui::Text("Control points: %zu instances in %zu draws", instancing_statistics.instances_nb, instancing_statistics.batches_nb);
 		}
 		ImGui::End();
 
@@ -87,7 +87,7 @@ edaf80::Assignment4::run()
 	// Todo: Load your geometry
 	//
 	bonobo::mesh_data water_mesh =
-		parametric_shapes::createQuad(100.0f, 100.0f, 1000u, 1000u);
+		parametric_shapes::createQuad(100.0f, 100.0f, 1000u, 1000u, /*optimise=*/true);
 
 	GLuint waves_normal = bonobo::loadTexture2D(
 		config::resources_path("textures/waves.png"), /*generate_mipmap=*/true);
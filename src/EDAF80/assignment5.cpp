@@ -28,7 +28,7 @@
 edaf80::TorusRideGame::TorusRideGame(WindowManager& windowManager, InputHandler& inputHandler, FPSCameraf& camera)
     : windowManager(windowManager), inputHandler(inputHandler), camera(camera),
       currentState(GameStateEnum::NEW_GAME),
-      fallbackShader(0u), torusBasicShader(0u), skyboxShader(0u), skyboxTexture(0u),
+      fallbackShader(0u), torusBasicShader(0u), torusBasicInstancedShader(0u), skyboxShader(0u), skyboxTexture(0u),
       showDebugInfo(true)
 {
     initializeShaders();
@@ -64,6 +64,17 @@ void edaf80::TorusRideGame::initializeShaders()
         LogError("Failed to load torus basic shader");
         return;
     }
+
+    // Same shading, with per-instance transforms for drawing all rings at once
+    programManager.CreateAndRegisterProgram("Torus Basic Instanced",
+        { { ShaderType::vertex, "EDAF80/torus_basic_instanced.vert" },
+          { ShaderType::fragment, "EDAF80/torus_basic.frag" } },
+        torusBasicInstancedShader);
+
+    if (torusBasicInstancedShader == 0u) {
+        LogError("Failed to load instanced torus basic shader");
+        return;
+    }
     
     // Register skybox shader like assignment 4
     programManager.CreateAndRegisterProgram("Skybox",
@@ -142,6 +153,29 @@ void edaf80::TorusRideGame::initializeGeometry()
     } else {
         LogInfo("Skybox texture loaded successfully");
     }
+
+    // Rings share their mesh, textures and material, so they are all
+    // instances of one node
+    ringNode.set_geometry(torusMesh);
+    ringNode.set_program(&torusBasicInstancedShader, [this](GLuint program) {
+        glm::vec3 lightPos = glm::vec3(10.0f, 10.0f, 10.0f);
+        glm::vec3 lightColor = glm::vec3(1.0f);
+        glm::vec3 cameraPos = camera.mWorld.GetTranslation();
+        glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(lightPos));
+        glUniform3fv(glGetUniformLocation(program, "light_color"), 1, glm::value_ptr(lightColor));
+        glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(cameraPos));
+        // Overridden by the node when it has a diffuse texture
+        glUniform1i(glGetUniformLocation(program, "has_diffuse_texture"), 0);
+
+        glUniform3f(glGetUniformLocation(program, "diffuse_color"), 1.0f, 1.0f, 1.0f); // White to show texture
+        glUniform3f(glGetUniformLocation(program, "specular_color"), 1.0f, 1.0f, 1.0f); // stronger specular for visible env reflection
+        glUniform1f(glGetUniformLocation(program, "shininess"), 64.0f); // sharper highlight
+        glUniform3f(glGetUniformLocation(program, "emissive_color"), 0.0f, 0.0f, 0.0f); // remove emissive to not wash out reflection
+    });
+    if (ringTexture != 0u)
+        ringNode.add_texture("diffuse_texture", ringTexture, GL_TEXTURE_2D);
+    if (skyboxTexture != 0u)
+        ringNode.add_texture("environment_map", skyboxTexture, GL_TEXTURE_CUBE_MAP);
     
     // Initialize some test rings for demonstration
     initializeTestRings();
@@ -572,73 +606,12 @@ void edaf80::TorusRideGame::render(glm::mat4 const& view_projection)
     glm::vec3 lightColor = glm::vec3(1.0f);
     glm::vec3 cameraPos = camera.mWorld.GetTranslation();
     
-    // Render game objects using mesh data if available
-    if (torusMesh.vao != 0u && torusBasicShader != 0u) {
-        glUseProgram(torusBasicShader);
-        
-        // Set lighting uniforms
-        GLint light_pos_loc = glGetUniformLocation(torusBasicShader, "light_position");
-        GLint light_color_loc = glGetUniformLocation(torusBasicShader, "light_color");
-        GLint camera_pos_loc = glGetUniformLocation(torusBasicShader, "camera_position");
-        GLint env_map_loc = glGetUniformLocation(torusBasicShader, "environment_map");
-        GLint has_diffuse_tex_loc = glGetUniformLocation(torusBasicShader, "has_diffuse_texture");
-        
-        if (light_pos_loc >= 0) glUniform3fv(light_pos_loc, 1, glm::value_ptr(lightPos));
-        if (light_color_loc >= 0) glUniform3fv(light_color_loc, 1, glm::value_ptr(lightColor));
-        if (camera_pos_loc >= 0) glUniform3fv(camera_pos_loc, 1, glm::value_ptr(cameraPos));
-        if (has_diffuse_tex_loc >= 0) glUniform1i(has_diffuse_tex_loc, 1); // rings: use diffuse texture
-        if (env_map_loc >= 0) {
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-            glUniform1i(env_map_loc, 1);
-        }
-        
-        // Bind ring texture
-        GLint diffuse_tex_loc = glGetUniformLocation(torusBasicShader, "diffuse_texture");
-        if (diffuse_tex_loc >= 0 && ringTexture != 0u) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ringTexture);
-            glUniform1i(diffuse_tex_loc, 0);
-        }
-        
-        // Render rings using the torus mesh
+    // Render all rings through the instanced ring node, in a single draw
+    if (torusMesh.vao != 0u && torusBasicInstancedShader != 0u) {
         for (const auto& ring : rings) {
-            // Set up transformation matrix
-            glm::mat4 model = ring.world;
-            glm::mat4 mvp = view_projection * model;
-            
-            // Set uniforms for the shader
-            GLint mvp_location = glGetUniformLocation(torusBasicShader, "vertex_world_to_clip");
-            GLint model_location = glGetUniformLocation(torusBasicShader, "vertex_model_to_world");
-            GLint normal_location = glGetUniformLocation(torusBasicShader, "normal_model_to_world");
-            
-            if (mvp_location >= 0) {
-                glUniformMatrix4fv(mvp_location, 1, GL_FALSE, glm::value_ptr(view_projection));
-            }
-            if (model_location >= 0) {
-                glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-            }
-            if (normal_location >= 0) {
-                glm::mat4 normal_matrix = glm::transpose(glm::inverse(model));
-                glUniformMatrix4fv(normal_location, 1, GL_FALSE, glm::value_ptr(normal_matrix));
-            }
-            
-            // Set material properties for rings (green)
-            GLint diffuse_loc = glGetUniformLocation(torusBasicShader, "diffuse_color");
-            GLint specular_loc = glGetUniformLocation(torusBasicShader, "specular_color");
-            GLint shininess_loc = glGetUniformLocation(torusBasicShader, "shininess");
-            GLint emissive_loc = glGetUniformLocation(torusBasicShader, "emissive_color");
-            
-            if (diffuse_loc >= 0) glUniform3f(diffuse_loc, 1.0f, 1.0f, 1.0f); // White to show texture
-            if (specular_loc >= 0) glUniform3f(specular_loc, 1.0f, 1.0f, 1.0f); // stronger specular for visible env reflection
-            if (shininess_loc >= 0) glUniform1f(shininess_loc, 64.0f); // sharper highlight
-            if (emissive_loc >= 0) glUniform3f(emissive_loc, 0.0f, 0.0f, 0.0f); // remove emissive to not wash out reflection
-            
-            // Draw the torus
-            glBindVertexArray(torusMesh.vao);
-            glDrawElements(GL_TRIANGLES, torusMesh.indices_nb, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0u);
+            ringRenderer.add(ringNode, ring.world);
         }
+        ringRenderer.flush(view_projection);
     }
     
     if (shipMesh.vao != 0u && torusBasicShader != 0u) {
@@ -734,6 +707,8 @@ void edaf80::TorusRideGame::renderUI()
                 ImGui::Text("Position: (%.1f, %.1f, %.1f)", ship.position.x, ship.position.y, ship.position.z);
                 ImGui::Text("Speed: %.1f", ship.speed_current);
                 ImGui::Text("Rings: %zu", rings.size());
+                ImGui::Text("Ring draw calls: %zu (%zu instances)", ringRenderer.getStatistics().batches_nb,
+                            ringRenderer.getStatistics().instances_nb);
             }
             
             // Collapsible Graphics Info
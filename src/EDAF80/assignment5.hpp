@@ -5,6 +5,7 @@
 #include "core/WindowManager.hpp"
 #include "core/ShaderProgramManager.hpp"
 #include "core/helpers.hpp"
+#include "core/instanced_renderer.hpp"
 #include "core/Bonobo.h"
 #include "core/node.hpp"
 #include "torus_game_data.hpp"
@@ -65,6 +66,7 @@ namespace edaf80
         ShaderProgramManager programManager;
         GLuint fallbackShader;
         GLuint torusBasicShader;
+        GLuint torusBasicInstancedShader;
         GLuint skyboxShader;
         GLuint skyboxTexture;
         GLuint ringTexture;
@@ -74,6 +76,10 @@ namespace edaf80
         bonobo::mesh_data shipMesh;
         bonobo::mesh_data pathLineMesh;
         bonobo::mesh_data skyboxMesh;
+
+        // All rings are instances of this node, drawn in one call
+        Node ringNode;
+        bonobo::instanced_renderer ringRenderer;
 		
 		// Simple rendering - no complex node system for now
 		// bonobo::Node torusNode;
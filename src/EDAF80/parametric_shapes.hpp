@@ -17,11 +17,16 @@ namespace parametric_shapes
 	//!                             should be split: 0 means each vertical
 	//!                             line consist of a single edge, 1 gives
 	//!                             you two edges, and so on.
+	//! @param optimise whether to reorder triangles and vertices for
+	//!                 better use of the vertex cache, which speeds up
+	//!                 drawing finely tessellated shapes but takes a
+	//!                 while (about half a second for a 1000×1000 grid).
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createQuad(float const width, float const height,
 	                             unsigned int const horizontal_split_count = 0u,
-	                             unsigned int const vertical_split_count = 0u);
+	                             unsigned int const vertical_split_count = 0u,
+	                             bool const optimise = false);
 
 	//! \brief Create a sphere for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -40,11 +45,16 @@ namespace parametric_shapes
 	//!                             edge spanning the full 180°, with 1 you
 	//!                             get two edges (each spanning 90°); 1 is
 	//!                             the minimum for getting a 3-D shape.
+	//! @param optimise whether to reorder triangles and vertices for
+	//!                 better use of the vertex cache, which speeds up
+	//!                 drawing finely tessellated shapes but takes a
+	//!                 while (about half a second for a 1000×1000 grid).
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createSphere(float const radius,
 	                               unsigned int const longitude_split_count,
-	                               unsigned int const latitude_split_count);
+	                               unsigned int const latitude_split_count,
+	                               bool const optimise = false);
 
 	//! \brief Create a torus for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -67,12 +77,17 @@ namespace parametric_shapes
 	//!                          with 1 you get two edges (each spanning
 	//!                          180°); 2 is the minimum for getting a 3-D
 	//!                          shape.
+	//! @param optimise whether to reorder triangles and vertices for
+	//!                 better use of the vertex cache, which speeds up
+	//!                 drawing finely tessellated shapes but takes a
+	//!                 while (about half a second for a 1000×1000 grid).
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createTorus(float const major_radius,
 	                              float const minor_radius,
 	                              unsigned int const major_split_count,
-	                              unsigned int const minor_split_count);
+	                              unsigned int const minor_split_count,
+	                              bool const optimise = false);
 
 	//! \brief Create a circle ring for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -93,10 +108,15 @@ namespace parametric_shapes
 	//!                           single edge spanning the full spread,
 	//!                           with 1 you get two edges (each spanning
 	//!                           half the spread).
+	//! @param optimise whether to reorder triangles and vertices for
+	//!                 better use of the vertex cache, which speeds up
+	//!                 drawing finely tessellated shapes but takes a
+	//!                 while (about half a second for a 1000×1000 grid).
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createCircleRing(float const radius,
 	                                   float const spread_length,
 	                                   unsigned int const circle_split_count,
-	                                   unsigned int const spread_split_count);
+	                                   unsigned int const spread_split_count,
+	                                   bool const optimise = false);
 }
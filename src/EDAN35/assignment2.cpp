@@ -6,11 +6,13 @@
 
 #include "config.hpp"
 #include "core/Bonobo.h"
+#include "core/bvh.hpp"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
 #include "core/ShaderProgramManager.hpp"
+#include "core/staging_ring.hpp"
 
 #include <imgui.h>
 #include <glm/glm.hpp>
@@ -18,9 +20,11 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <tinyfiledialogs.h>
 
+#include <algorithm>
 #include <array>
 #include <clocale>
 #include <cstdlib>
+#include <numeric>
 #include <stdexcept>
 
 namespace constant
@@ -116,6 +120,7 @@ namespace
 		GLuint ubo_CameraViewProjTransforms{ 0u };
 		GLuint vertex_model_to_world{ 0u };
 		GLuint normal_model_to_world{ 0u };
+		GLuint compact_vertices{ 0u };
 		GLuint diffuse_texture{ 0u };
 		GLuint specular_texture{ 0u };
 		GLuint normals_texture{ 0u };
@@ -185,39 +190,63 @@ edan35::Assignment2::~Assignment2()
 void
 edan35::Assignment2::run()
 {
-	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects(config::resources_path("sponza/sponza.obj"));
-	if (sponza_geometry.empty()) {
-		LogError("Failed to load the Sponza model");
-		return;
-	}
+	// Load Sponza in the background: its meshes show up with placeholder
+	// textures once imported, and the actual textures get swapped in as
+	// they finish loading.
+	bonobo::load_options sponza_options;
+	sponza_options.pack_meshes = true;
+	sponza_options.compact_vertices = true;
+	sponza_options.optimise_meshes = true;
+	sponza_options.lods_nb = 3u;
+	// Sponza's few hundred meshes only use a couple dozen materials;
+	// merging them within cells of 5 m (the model is in centimetres)
+	// divides the number of draw calls per pass, while keeping meshes
+	// small enough to pick their level of detail individually.
+	sponza_options.merge_meshes = true;
+	sponza_options.merge_cell_size = 500.0f;
+	auto sponza_scene = bonobo::loadObjectsAsync(config::resources_path("sponza/sponza.obj"), sponza_options,
+	                                             [](std::vector<bonobo::mesh_data> const& objects){
+		if (objects.empty())
+			LogError("Failed to load the Sponza model");
+	});
+	auto const& sponza_geometry = sponza_scene.getObjects();
 	std::vector<GeometryTextureData> sponza_geometry_texture_data;
-	sponza_geometry_texture_data.reserve(sponza_geometry.size());
-	for (auto const& geometry : sponza_geometry) {
-		auto const diffuse_texture = geometry.bindings.find("diffuse_texture");
-		auto const specular_texture = geometry.bindings.find("specular_texture");
-		auto const normals_texture = geometry.bindings.find("normals_texture");
-		auto const opacity_texture = geometry.bindings.find("opacity_texture");
-
-		GeometryTextureData data;
-		if (diffuse_texture != geometry.bindings.end())
-		{
-			data.diffuse_texture_id = diffuse_texture->second;
-		}
-		if (specular_texture != geometry.bindings.end())
-		{
-			data.specular_texture_id = specular_texture->second;
-		}
-		if (normals_texture != geometry.bindings.end())
-		{
-			data.normals_texture_id = normals_texture->second;
-		}
-		if (opacity_texture != geometry.bindings.end())
-		{
-			data.opacity_texture_id = opacity_texture->second;
+	// Sponza does not move, but its meshes only show up as they get
+	// loaded, so the tree is rebuilt whenever they change.
+	bonobo::dynamic_bvh sponza_bvh;
+	auto const update_sponza_geometry_texture_data = [&sponza_geometry,&sponza_geometry_texture_data,&sponza_bvh](){
+		sponza_geometry_texture_data.clear();
+		sponza_geometry_texture_data.reserve(sponza_geometry.size());
+		for (auto const& geometry : sponza_geometry) {
+			auto const diffuse_texture = geometry.bindings.find("diffuse_texture");
+			auto const specular_texture = geometry.bindings.find("specular_texture");
+			auto const normals_texture = geometry.bindings.find("normals_texture");
+			auto const opacity_texture = geometry.bindings.find("opacity_texture");
+
+			GeometryTextureData data;
+			if (diffuse_texture != geometry.bindings.end())
+			{
+				data.diffuse_texture_id = diffuse_texture->second;
+			}
+			if (specular_texture != geometry.bindings.end())
+			{
+				data.specular_texture_id = specular_texture->second;
+			}
+			if (normals_texture != geometry.bindings.end())
+			{
+				data.normals_texture_id = normals_texture->second;
+			}
+			if (opacity_texture != geometry.bindings.end())
+			{
+				data.opacity_texture_id = opacity_texture->second;
+			}
+			sponza_geometry_texture_data.emplace_back(std::move(data));
 		}
-		sponza_geometry_texture_data.emplace_back(std::move(data));
-	}
+
+		sponza_bvh.clear();
+		for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
+			sponza_bvh.insert(sponza_geometry[i].bounding_box, static_cast<std::uint32_t>(i));
+	};
 
 	auto const cone_geometry = loadCone();
 	Node cone;
@@ -379,6 +408,26 @@ edan35::Assignment2::run()
 	bool show_basis = false;
 	float basis_thickness_scale = 40.0f;
 	float basis_length_scale = 400.0f;
+	float lod_max_error_in_pixels = 1.0f;
+	bool use_frustum_culling = true;
+
+	// Find the Sponza meshes within the frustum of a view-projection
+	// matrix, sorted back in loading order, in which meshes sharing a VAO
+	// follow each other.
+	auto const find_sponza_meshes_in_view = [&](glm::mat4 const& world_to_clip, std::vector<std::uint32_t>& meshes){
+		bonobo::dynamic_bvh::cull_statistics statistics;
+		if (use_frustum_culling) {
+			statistics = sponza_bvh.cull(bonobo::bounds::extractFrustum(world_to_clip), meshes);
+		} else {
+			meshes.resize(sponza_geometry.size());
+			std::iota(meshes.begin(), meshes.end(), 0u);
+			statistics.visible_nb = meshes.size();
+		}
+		std::sort(meshes.begin(), meshes.end());
+		return statistics;
+	};
+	std::vector<std::uint32_t> sponza_visible_meshes;
+	std::vector<std::uint32_t> sponza_shadow_casting_meshes;
 
 	while (!glfwWindowShouldClose(window)) {
 		auto const nowTime = std::chrono::high_resolution_clock::now();
@@ -394,11 +443,20 @@ edan35::Assignment2::run()
 		inputHandler.Advance();
 		mCamera.Update(deltaTimeUs, inputHandler);
 
+		// Spend at most a few milliseconds per frame on uploading Sponza,
+		// refining first the textures closest to the camera.
+		sponza_scene.setViewpoint(mCamera, glm::mat4(1.0f), static_cast<float>(framebuffer_height));
+		if (sponza_scene.update(std::chrono::milliseconds(4)))
+			update_sponza_geometry_texture_data();
+
 		camera_view_proj_transforms.view_projection = mCamera.GetWorldToClipMatrix();
 		camera_view_proj_transforms.view_projection_inverse = mCamera.GetClipToWorldMatrix();
 
 		auto const view_projection = camera_view_proj_transforms.view_projection;
 
+		auto const sponza_camera_culling = find_sponza_meshes_in_view(view_projection, sponza_visible_meshes);
+		bonobo::dynamic_bvh::cull_statistics sponza_shadow_culling;
+
 		if (inputHandler.GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
 			shader_reload_failed = !program_manager.ReloadAllPrograms();
 			if (shader_reload_failed)
@@ -470,18 +528,22 @@ edan35::Assignment2::run()
 			glUniform1i(fill_gbuffer_shader_locations.specular_texture, 1);
 			glUniform1i(fill_gbuffer_shader_locations.normals_texture, 2);
 			glUniform1i(fill_gbuffer_shader_locations.opacity_texture, 3);
-			for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
+			GLuint bound_vao = 0u;
+			for (auto const i : sponza_visible_meshes)
 			{
 				auto const& geometry = sponza_geometry[i];
 				auto const& texture_data = sponza_geometry_texture_data[i];
 
 				utils::opengl::debug::beginDebugGroup(geometry.name);
 
-				auto const vertex_model_to_world = glm::mat4(1.0f);
+				// Sponza is already in world space, but compact positions
+				// first need to be brought back to model space.
+				auto const vertex_model_to_world = glm::mat4(1.0f) * geometry.position_dequantization;
 				auto const normal_model_to_world = glm::mat4(1.0f);
 
 				glUniformMatrix4fv(fill_gbuffer_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
 				glUniformMatrix4fv(fill_gbuffer_shader_locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+				glUniform1i(fill_gbuffer_shader_locations.compact_vertices, geometry.compact_vertices ? 1 : 0);
 
 				auto const default_sampler = samplers[toU(Sampler::Nearest)];
 				auto const mipmap_sampler = samplers[toU(Sampler::Mipmaps)];
@@ -506,11 +568,20 @@ edan35::Assignment2::run()
 				glActiveTexture(GL_TEXTURE3);
 				glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
 
-				glBindVertexArray(geometry.vao);
-				if (geometry.ibo != 0u)
-					glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-				else
-					glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
+				// Meshes are packed in shared buffers, so the VAO only needs
+				// binding when it differs from the previous mesh's.
+				if (geometry.vao != bound_vao) {
+					glBindVertexArray(geometry.vao);
+					bound_vao = geometry.vao;
+				}
+				if (geometry.ibo != 0u) {
+					auto const lod = bonobo::selectLevelOfDetail(geometry, mCamera, glm::mat4(1.0f),
+					                                             static_cast<float>(framebuffer_height), lod_max_error_in_pixels);
+					glDrawElementsBaseVertex(geometry.drawing_mode, lod.indices_nb, geometry.index_type,
+					                         bonobo::getFirstIndexOffset(geometry, lod), geometry.base_vertex);
+				} else {
+					glDrawArrays(geometry.drawing_mode, geometry.base_vertex, geometry.vertices_nb);
+				}
 
 
 				utils::opengl::debug::endDebugGroup();
@@ -549,14 +620,19 @@ edan35::Assignment2::run()
 				glUseProgram(fill_shadowmap_shader);
 				glUniform1i(fill_shadowmap_shader_locations.light_index, static_cast<int>(i));
 				glUniform1i(fill_shadowmap_shader_locations.opacity_texture, 0);
-				for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
+				auto const light_culling = find_sponza_meshes_in_view(light_world_to_clip_matrix, sponza_shadow_casting_meshes);
+				sponza_shadow_culling.visible_nb += light_culling.visible_nb;
+				sponza_shadow_culling.culled_nb += light_culling.culled_nb;
+
+				GLuint bound_vao = 0u;
+				for (auto const i : sponza_shadow_casting_meshes)
 				{
 					auto const& geometry = sponza_geometry[i];
 					auto const& texture_data = sponza_geometry_texture_data[i];
 
 					utils::opengl::debug::beginDebugGroup(geometry.name);
 
-					auto const vertex_model_to_world = glm::mat4(1.0f);
+					auto const vertex_model_to_world = glm::mat4(1.0f) * geometry.position_dequantization;
 					glUniformMatrix4fv(fill_shadowmap_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
 
 					glUniform1i(fill_shadowmap_shader_locations.has_opacity_texture, texture_data.opacity_texture_id != 0u ? 1 : 0);
@@ -564,11 +640,17 @@ edan35::Assignment2::run()
 					glActiveTexture(GL_TEXTURE0);
 					glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
 
-					glBindVertexArray(geometry.vao);
+					// Meshes are packed in shared buffers, so the VAO only needs
+					// binding when it differs from the previous mesh's.
+					if (geometry.vao != bound_vao) {
+						glBindVertexArray(geometry.vao);
+						bound_vao = geometry.vao;
+					}
 					if (geometry.ibo != 0u)
-						glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+						glDrawElementsBaseVertex(geometry.drawing_mode, geometry.indices_nb, geometry.index_type,
+						                         bonobo::getFirstIndexOffset(geometry), geometry.base_vertex);
 					else
-						glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
+						glDrawArrays(geometry.drawing_mode, geometry.base_vertex, geometry.vertices_nb);
 
 
 					utils::opengl::debug::endDebugGroup();
@@ -733,9 +815,15 @@ edan35::Assignment2::run()
 		//
 		glViewport(0, 0, framebuffer_width, framebuffer_height);
 
+		bonobo::uiShowLoadProgress("Sponza", sponza_scene.getProgress());
+
 		bool opened = ImGui::Begin("Render Time", nullptr, ImGuiWindowFlags_None);
 		if (opened) {
 			ImGui::Text("Frame CPU time: %.3f ms", std::chrono::duration<float, std::milli>(deltaTimeUs).count());
+			auto const staging_statistics = bonobo::staging_ring::getStatistics();
+			ImGui::Text("Staging ring: %.1f MB copied, %zu direct uploads, %zu stalls (%.3f ms)",
+			            static_cast<float>(staging_statistics.copied_bytes) / (1024.0f * 1024.0f),
+			            staging_statistics.direct_uploads_nb, staging_statistics.stalls_nb, staging_statistics.stalled_ms);
 
 			ImGui::Checkbox("Copy elapsed times back to CPU", &copy_elapsed_times);
 
@@ -798,6 +886,12 @@ edan35::Assignment2::run()
 			ImGui::SliderInt("Number of lights", &lights_nb, 1, static_cast<int>(constant::lights_nb));
 			ImGui::Checkbox("Show textures", &show_textures);
 			ImGui::Checkbox("Show light cones wireframe", &show_cone_wireframe);
+			ImGui::SliderFloat("Max LOD error (px)", &lod_max_error_in_pixels, 0.0f, 16.0f);
+			ImGui::Separator();
+			ImGui::Checkbox("Frustum culling", &use_frustum_culling);
+			ImGui::Text("Meshes in view: %zu visible, %zu culled", sponza_camera_culling.visible_nb, sponza_camera_culling.culled_nb);
+			ImGui::Text("Shadow casters, all lights: %zu visible, %zu culled", sponza_shadow_culling.visible_nb, sponza_shadow_culling.culled_nb);
+			ImGui::Text("BVH height: %zu", sponza_bvh.getHeight());
 			ImGui::Separator();
 			ImGui::Checkbox("Show basis", &show_basis);
 			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
@@ -1060,6 +1154,7 @@ void fillGBufferShaderLocations(GLuint gbuffer_shader, GBufferShaderLocations& l
 	locations.ubo_CameraViewProjTransforms = glGetUniformBlockIndex(gbuffer_shader, "CameraViewProjTransforms");
 	locations.vertex_model_to_world = glGetUniformLocation(gbuffer_shader, "vertex_model_to_world");
 	locations.normal_model_to_world = glGetUniformLocation(gbuffer_shader, "normal_model_to_world");
+	locations.compact_vertices = glGetUniformLocation(gbuffer_shader, "compact_vertices");
 	locations.diffuse_texture = glGetUniformLocation(gbuffer_shader, "diffuse_texture");
 	locations.specular_texture = glGetUniformLocation(gbuffer_shader, "specular_texture");
 	locations.normals_texture = glGetUniformLocation(gbuffer_shader, "normals_texture");
@@ -1180,6 +1275,8 @@ loadCone()
 		0.f, 1.f, -1.f,
 		0.f, 0.f, -1.f
 	};
+	bonobo::bounds::compute(reinterpret_cast<glm::vec3 const*>(vertexArrayData), 3u * sizeof(float), static_cast<size_t>(cone.vertices_nb),
+	                        cone.bounding_box, cone.bounding_sphere);
 
 	glGenVertexArrays(1, &cone.vao);
 	assert(cone.vao != 0u);
@@ -0,0 +1,374 @@
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BONOBO_USE_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+namespace
+{
+	//! \brief Matrix with what transforming bounds needs precomputed.
+	struct prepared_matrix {
+#if defined(BONOBO_USE_SSE2)
+		__m128 columns[4];
+		__m128 absolute_columns[3];
+#else
+		glm::mat4 matrix;
+		glm::mat3 absolute_matrix;
+#endif
+		float max_scale;
+	};
+
+	prepared_matrix prepare(glm::mat4 const& m)
+	{
+		prepared_matrix prepared;
+#if defined(BONOBO_USE_SSE2)
+		auto const sign_mask = _mm_set1_ps(-0.0f);
+		for (int i = 0; i < 4; ++i)
+			prepared.columns[i] = _mm_loadu_ps(&m[i][0]);
+		for (int i = 0; i < 3; ++i)
+			prepared.absolute_columns[i] = _mm_andnot_ps(sign_mask, prepared.columns[i]);
+#else
+		prepared.matrix = m;
+		prepared.absolute_matrix = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+#endif
+		auto const squared_scale = std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+		                                    std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))));
+		prepared.max_scale = std::sqrt(squared_scale);
+		return prepared;
+	}
+
+	//! \brief Transform a box using the centre and half-extent form: the
+	//!        half-extent of the result is that of the box transformed by
+	//!        the absolute value of the matrix.
+	bonobo::bounds::box transformBox(prepared_matrix const& m, bonobo::bounds::box const& b)
+	{
+		auto const centre = 0.5f * (b.min + b.max);
+		auto const extent = 0.5f * (b.max - b.min);
+#if defined(BONOBO_USE_SSE2)
+		auto const c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.columns[0], _mm_set1_ps(centre.x)), _mm_mul_ps(m.columns[1], _mm_set1_ps(centre.y))),
+		                          _mm_add_ps(_mm_mul_ps(m.columns[2], _mm_set1_ps(centre.z)), m.columns[3]));
+		auto const e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.absolute_columns[0], _mm_set1_ps(extent.x)),
+		                                     _mm_mul_ps(m.absolute_columns[1], _mm_set1_ps(extent.y))),
+		                          _mm_mul_ps(m.absolute_columns[2], _mm_set1_ps(extent.z)));
+		alignas(16) float low[4], high[4];
+		_mm_store_ps(low, _mm_sub_ps(c, e));
+		_mm_store_ps(high, _mm_add_ps(c, e));
+		bonobo::bounds::box result;
+		result.min = glm::vec3(low[0], low[1], low[2]);
+		result.max = glm::vec3(high[0], high[1], high[2]);
+		return result;
+#else
+		auto const c = glm::vec3(m.matrix * glm::vec4(centre, 1.0f));
+		auto const e = m.absolute_matrix * extent;
+		bonobo::bounds::box result;
+		result.min = c - e;
+		result.max = c + e;
+		return result;
+#endif
+	}
+
+	bonobo::bounds::sphere transformSphere(prepared_matrix const& m, bonobo::bounds::sphere const& s)
+	{
+		bonobo::bounds::sphere result;
+#if defined(BONOBO_USE_SSE2)
+		auto const c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.columns[0], _mm_set1_ps(s.centre.x)), _mm_mul_ps(m.columns[1], _mm_set1_ps(s.centre.y))),
+		                          _mm_add_ps(_mm_mul_ps(m.columns[2], _mm_set1_ps(s.centre.z)), m.columns[3]));
+		alignas(16) float centre[4];
+		_mm_store_ps(centre, c);
+		result.centre = glm::vec3(centre[0], centre[1], centre[2]);
+#else
+		result.centre = glm::vec3(m.matrix * glm::vec4(s.centre, 1.0f));
+#endif
+		result.radius = s.radius * m.max_scale;
+		return result;
+	}
+
+	bool isBoxVisible(bonobo::bounds::frustum const& view_frustum, bonobo::bounds::box const& b)
+	{
+		auto const centre = 0.5f * (b.min + b.max);
+		auto const extent = 0.5f * (b.max - b.min);
+		for (auto const& plane : view_frustum.planes) {
+			auto const normal = glm::vec3(plane);
+			if (glm::dot(normal, centre) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	bonobo::bounds::containment classifyBox(bonobo::bounds::frustum const& view_frustum, bonobo::bounds::box const& b)
+	{
+		auto const centre = 0.5f * (b.min + b.max);
+		auto const extent = 0.5f * (b.max - b.min);
+		auto result = bonobo::bounds::containment::inside;
+		for (auto const& plane : view_frustum.planes) {
+			auto const normal = glm::vec3(plane);
+			auto const distance = glm::dot(normal, centre) + plane.w;
+			auto const radius = glm::dot(glm::abs(normal), extent);
+			if (distance + radius < 0.0f)
+				return bonobo::bounds::containment::outside;
+			if (distance - radius < 0.0f)
+				result = bonobo::bounds::containment::intersecting;
+		}
+		return result;
+	}
+
+	bool isSphereVisible(bonobo::bounds::frustum const& view_frustum, bonobo::bounds::sphere const& s)
+	{
+		for (auto const& plane : view_frustum.planes)
+			if (glm::dot(glm::vec3(plane), s.centre) + plane.w + s.radius < 0.0f)
+				return false;
+		return true;
+	}
+
+#if defined(BONOBO_USE_SSE2)
+	//! \brief Frustum planes with each coefficient broadcast, to test four
+	//!        volumes against a plane at once.
+	struct broadcast_frustum {
+		__m128 x[6], y[6], z[6], w[6];
+		__m128 abs_x[6], abs_y[6], abs_z[6];
+
+		explicit broadcast_frustum(bonobo::bounds::frustum const& view_frustum)
+		{
+			for (size_t i = 0u; i < 6u; ++i) {
+				auto const& plane = view_frustum.planes[i];
+				x[i] = _mm_set1_ps(plane.x);
+				y[i] = _mm_set1_ps(plane.y);
+				z[i] = _mm_set1_ps(plane.z);
+				w[i] = _mm_set1_ps(plane.w);
+				abs_x[i] = _mm_set1_ps(std::abs(plane.x));
+				abs_y[i] = _mm_set1_ps(std::abs(plane.y));
+				abs_z[i] = _mm_set1_ps(std::abs(plane.z));
+			}
+		}
+	};
+
+	//! \brief Write the visibility of four volumes from a lane mask.
+	std::size_t storeVisibility(int mask, std::uint8_t* visible)
+	{
+		std::size_t visible_nb = 0u;
+		for (int lane = 0; lane < 4; ++lane) {
+			visible[lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+			visible_nb += visible[lane];
+		}
+		return visible_nb;
+	}
+#endif
+}
+
+void
+bonobo::bounds::compute(glm::vec3 const* positions, std::size_t positions_stride, std::size_t positions_nb,
+                        box& bounding_box, sphere& bounding_sphere)
+{
+	bounding_box = box();
+	bounding_sphere = sphere();
+	if (positions == nullptr || positions_nb == 0u)
+		return;
+
+	auto const position = [positions, positions_stride](std::size_t i){
+		return *reinterpret_cast<glm::vec3 const*>(reinterpret_cast<std::uint8_t const*>(positions) + i * positions_stride);
+	};
+
+	glm::vec3 min_position(std::numeric_limits<float>::max()), max_position(std::numeric_limits<float>::lowest());
+	for (std::size_t i = 0u; i < positions_nb; ++i) {
+		min_position = glm::min(min_position, position(i));
+		max_position = glm::max(max_position, position(i));
+	}
+	bounding_box.min = min_position;
+	bounding_box.max = max_position;
+
+	bounding_sphere.centre = 0.5f * (min_position + max_position);
+	auto squared_radius = 0.0f;
+	for (std::size_t i = 0u; i < positions_nb; ++i) {
+		auto const offset = position(i) - bounding_sphere.centre;
+		squared_radius = std::max(squared_radius, glm::dot(offset, offset));
+	}
+	bounding_sphere.radius = std::sqrt(squared_radius);
+}
+
+bonobo::bounds::frustum
+bonobo::bounds::extractFrustum(glm::mat4 const& view_projection)
+{
+	// Each plane is a sum or difference of the last row of the matrix and
+	// one of the others: a point is inside when its clip-space x, y and z
+	// lie within [-w, w].
+	auto const row = [&view_projection](int i){
+		return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+	};
+
+	frustum result;
+	result.planes[0] = row(3) + row(0);
+	result.planes[1] = row(3) - row(0);
+	result.planes[2] = row(3) + row(1);
+	result.planes[3] = row(3) - row(1);
+	result.planes[4] = row(3) + row(2);
+	result.planes[5] = row(3) - row(2);
+	for (auto& plane : result.planes) {
+		auto const length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane = plane * (1.0f / length);
+	}
+	return result;
+}
+
+void
+bonobo::bounds::transform(glm::mat4 const& world, box const* boxes, std::size_t count, box* transformed)
+{
+	auto const prepared = prepare(world);
+	for (std::size_t i = 0u; i < count; ++i)
+		transformed[i] = transformBox(prepared, boxes[i]);
+}
+
+void
+bonobo::bounds::transform(glm::mat4 const* worlds, box const* boxes, std::size_t count, box* transformed)
+{
+	for (std::size_t i = 0u; i < count; ++i)
+		transformed[i] = transformBox(prepare(worlds[i]), boxes[i]);
+}
+
+void
+bonobo::bounds::transform(glm::mat4 const& world, sphere const* spheres, std::size_t count, sphere* transformed)
+{
+	auto const prepared = prepare(world);
+	for (std::size_t i = 0u; i < count; ++i)
+		transformed[i] = transformSphere(prepared, spheres[i]);
+}
+
+void
+bonobo::bounds::transform(glm::mat4 const* worlds, sphere const* spheres, std::size_t count, sphere* transformed)
+{
+	for (std::size_t i = 0u; i < count; ++i)
+		transformed[i] = transformSphere(prepare(worlds[i]), spheres[i]);
+}
+
+std::size_t
+bonobo::bounds::cull(frustum const& view_frustum, box const* boxes, std::size_t count, std::uint8_t* visible)
+{
+	std::size_t visible_nb = 0u;
+	std::size_t i = 0u;
+#if defined(BONOBO_USE_SSE2)
+	broadcast_frustum const planes(view_frustum);
+	auto const half = _mm_set1_ps(0.5f);
+	for (; i + 4u <= count; i += 4u) {
+		auto const* b = boxes + i;
+		auto const min_x = _mm_set_ps(b[3].min.x, b[2].min.x, b[1].min.x, b[0].min.x);
+		auto const min_y = _mm_set_ps(b[3].min.y, b[2].min.y, b[1].min.y, b[0].min.y);
+		auto const min_z = _mm_set_ps(b[3].min.z, b[2].min.z, b[1].min.z, b[0].min.z);
+		auto const max_x = _mm_set_ps(b[3].max.x, b[2].max.x, b[1].max.x, b[0].max.x);
+		auto const max_y = _mm_set_ps(b[3].max.y, b[2].max.y, b[1].max.y, b[0].max.y);
+		auto const max_z = _mm_set_ps(b[3].max.z, b[2].max.z, b[1].max.z, b[0].max.z);
+		auto const centre_x = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+		auto const centre_y = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+		auto const centre_z = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+		auto const extent_x = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+		auto const extent_y = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+		auto const extent_z = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (size_t p = 0u; p < 6u; ++p) {
+			auto const distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.x[p], centre_x), _mm_mul_ps(planes.y[p], centre_y)),
+			                                  _mm_add_ps(_mm_mul_ps(planes.z[p], centre_z), planes.w[p]));
+			auto const radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.abs_x[p], extent_x), _mm_mul_ps(planes.abs_y[p], extent_y)),
+			                                _mm_mul_ps(planes.abs_z[p], extent_z));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		visible_nb += storeVisibility(_mm_movemask_ps(inside), visible + i);
+	}
+#endif
+	for (; i < count; ++i) {
+		visible[i] = isBoxVisible(view_frustum, boxes[i]) ? 1u : 0u;
+		visible_nb += visible[i];
+	}
+	return visible_nb;
+}
+
+std::size_t
+bonobo::bounds::cull(frustum const& view_frustum, sphere const* spheres, std::size_t count, std::uint8_t* visible)
+{
+	std::size_t visible_nb = 0u;
+	std::size_t i = 0u;
+#if defined(BONOBO_USE_SSE2)
+	broadcast_frustum const planes(view_frustum);
+	for (; i + 4u <= count; i += 4u) {
+		auto const* s = spheres + i;
+		auto const centre_x = _mm_set_ps(s[3].centre.x, s[2].centre.x, s[1].centre.x, s[0].centre.x);
+		auto const centre_y = _mm_set_ps(s[3].centre.y, s[2].centre.y, s[1].centre.y, s[0].centre.y);
+		auto const centre_z = _mm_set_ps(s[3].centre.z, s[2].centre.z, s[1].centre.z, s[0].centre.z);
+		auto const radius = _mm_set_ps(s[3].radius, s[2].radius, s[1].radius, s[0].radius);
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (size_t p = 0u; p < 6u; ++p) {
+			auto const distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.x[p], centre_x), _mm_mul_ps(planes.y[p], centre_y)),
+			                                  _mm_add_ps(_mm_mul_ps(planes.z[p], centre_z), planes.w[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		visible_nb += storeVisibility(_mm_movemask_ps(inside), visible + i);
+	}
+#endif
+	for (; i < count; ++i) {
+		visible[i] = isSphereVisible(view_frustum, spheres[i]) ? 1u : 0u;
+		visible_nb += visible[i];
+	}
+	return visible_nb;
+}
+
+std::size_t
+bonobo::bounds::classify(frustum const& view_frustum, box const* boxes, std::size_t count, containment* results)
+{
+	std::size_t visible_nb = 0u;
+	std::size_t i = 0u;
+#if defined(BONOBO_USE_SSE2)
+	broadcast_frustum const planes(view_frustum);
+	auto const half = _mm_set1_ps(0.5f);
+	for (; i + 4u <= count; i += 4u) {
+		auto const* b = boxes + i;
+		auto const min_x = _mm_set_ps(b[3].min.x, b[2].min.x, b[1].min.x, b[0].min.x);
+		auto const min_y = _mm_set_ps(b[3].min.y, b[2].min.y, b[1].min.y, b[0].min.y);
+		auto const min_z = _mm_set_ps(b[3].min.z, b[2].min.z, b[1].min.z, b[0].min.z);
+		auto const max_x = _mm_set_ps(b[3].max.x, b[2].max.x, b[1].max.x, b[0].max.x);
+		auto const max_y = _mm_set_ps(b[3].max.y, b[2].max.y, b[1].max.y, b[0].max.y);
+		auto const max_z = _mm_set_ps(b[3].max.z, b[2].max.z, b[1].max.z, b[0].max.z);
+		auto const centre_x = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+		auto const centre_y = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+		auto const centre_z = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+		auto const extent_x = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+		auto const extent_y = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+		auto const extent_z = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+		// Not outside if in front of or across every plane, and inside if
+		// entirely in front of every plane.
+		auto not_outside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		auto inside = not_outside;
+		for (size_t p = 0u; p < 6u; ++p) {
+			auto const distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.x[p], centre_x), _mm_mul_ps(planes.y[p], centre_y)),
+			                                  _mm_add_ps(_mm_mul_ps(planes.z[p], centre_z), planes.w[p]));
+			auto const radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.abs_x[p], extent_x), _mm_mul_ps(planes.abs_y[p], extent_y)),
+			                                _mm_mul_ps(planes.abs_z[p], extent_z));
+			not_outside = _mm_and_ps(not_outside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps()));
+		}
+		auto const not_outside_mask = _mm_movemask_ps(not_outside);
+		auto const inside_mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane) {
+			if (((not_outside_mask >> lane) & 1) == 0)
+				results[i + lane] = containment::outside;
+			else if (((inside_mask >> lane) & 1) == 0)
+				results[i + lane] = containment::intersecting;
+			else
+				results[i + lane] = containment::inside;
+		}
+		visible_nb += static_cast<std::size_t>(((not_outside_mask >> 0) & 1) + ((not_outside_mask >> 1) & 1)
+		                                       + ((not_outside_mask >> 2) & 1) + ((not_outside_mask >> 3) & 1));
+	}
+#endif
+	for (; i < count; ++i) {
+		results[i] = classifyBox(view_frustum, boxes[i]);
+		if (results[i] != containment::outside)
+			++visible_nb;
+	}
+	return visible_nb;
+}
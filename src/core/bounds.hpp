@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace bonobo
+{
+	//! \brief Bounding volumes, and batched operations on them for
+	//!        culling and sorting.
+	//!
+	//! Batched functions use SSE2 when available, and fall back to scalar
+	//! code otherwise: frustum tests process four volumes at a time, and
+	//! transforms one volume at a time, all of its components at once.
+	//! World matrices are expected to be affine. Input and output arrays
+	//! may be the same.
+	namespace bounds
+	{
+		//! \brief Axis-aligned bounding box.
+		struct box {
+			glm::vec3 min{ 0.0f };
+			glm::vec3 max{ 0.0f };
+		};
+
+		struct sphere {
+			glm::vec3 centre{ 0.0f };
+			float radius{ 0.0f };
+		};
+
+		//! \brief Six planes (left, right, bottom, top, near, far) as
+		//!        (normal, distance), with normals of unit length pointing
+		//!        inside the frustum.
+		struct frustum {
+			std::array<glm::vec4, 6> planes;
+		};
+
+		//! \brief Compute the box and sphere enclosing a set of positions;
+		//!        the sphere is centred on the box.
+		//!
+		//! @param [in] positions first position
+		//! @param [in] positions_stride number of bytes from one position
+		//!             to the next, so that interleaved vertices can be
+		//!             passed as is
+		//! @param [in] positions_nb number of positions; both volumes are
+		//!             left empty and centred on the origin if 0
+		void compute(glm::vec3 const* positions, std::size_t positions_stride, std::size_t positions_nb,
+		             box& bounding_box, sphere& bounding_sphere);
+
+		//! \brief Extract the planes of the frustum defined by a
+		//!        view-projection matrix; with a projection matrix only,
+		//!        the planes are in view space.
+		frustum extractFrustum(glm::mat4 const& view_projection);
+
+		//! \brief Transform boxes by a single matrix, giving the
+		//!        axis-aligned boxes enclosing the transformed ones.
+		void transform(glm::mat4 const& world, box const* boxes, std::size_t count, box* transformed);
+
+		//! \brief Transform each box by its own matrix.
+		void transform(glm::mat4 const* worlds, box const* boxes, std::size_t count, box* transformed);
+
+		//! \brief Transform spheres by a single matrix; radii are scaled
+		//!        by the largest scaling of the matrix, so that the spheres
+		//!        stay conservative under non-uniform scaling.
+		void transform(glm::mat4 const& world, sphere const* spheres, std::size_t count, sphere* transformed);
+
+		//! \brief Transform each sphere by its own matrix.
+		void transform(glm::mat4 const* worlds, sphere const* spheres, std::size_t count, sphere* transformed);
+
+		//! \brief Test boxes against a frustum.
+		//!
+		//! The test is conservative: a box intersecting none of the planes
+		//! but lying outside a corner of the frustum is reported visible.
+		//!
+		//! @param [out] visible for each box, 1 if it may be visible, and 0
+		//!              if it definitely is not
+		//! @return the number of boxes that may be visible
+		std::size_t cull(frustum const& view_frustum, box const* boxes, std::size_t count, std::uint8_t* visible);
+
+		//! \brief Test spheres against a frustum; see the box version.
+		std::size_t cull(frustum const& view_frustum, sphere const* spheres, std::size_t count, std::uint8_t* visible);
+
+		//! \brief How a volume lies relative to a frustum.
+		enum class containment : std::uint8_t {
+			outside,      //!< definitely outside of the frustum
+			intersecting, //!< may be partly or entirely inside
+			inside        //!< entirely inside
+		};
+
+		//! \brief Test boxes against a frustum, telling apart those
+		//!        entirely inside it, so that whatever they enclose needs no
+		//!        further test.
+		//!
+		//! As with `cull()`, a box outside a corner of the frustum is
+		//! reported as intersecting it.
+		//!
+		//! @return the number of boxes not outside the frustum
+		std::size_t classify(frustum const& view_frustum, box const* boxes, std::size_t count, containment* results);
+	}
+}
@@ -0,0 +1,359 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr bonobo::dynamic_bvh::proxy_id bonobo::dynamic_bvh::invalid_proxy;
+constexpr bonobo::dynamic_bvh::node_index bonobo::dynamic_bvh::no_node;
+
+namespace
+{
+	bonobo::bounds::box merge(bonobo::bounds::box const& a, bonobo::bounds::box const& b)
+	{
+		bonobo::bounds::box result;
+		result.min = glm::min(a.min, b.min);
+		result.max = glm::max(a.max, b.max);
+		return result;
+	}
+
+	float surfaceArea(bonobo::bounds::box const& box)
+	{
+		auto const size = box.max - box.min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool contains(bonobo::bounds::box const& outer, bonobo::bounds::box const& inner)
+	{
+		return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+	}
+
+	bool overlaps(bonobo::bounds::box const& a, bonobo::bounds::box const& b)
+	{
+		return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+	}
+}
+
+bonobo::dynamic_bvh::dynamic_bvh(float margin) : _margin(margin)
+{
+}
+
+bonobo::dynamic_bvh::proxy_id
+bonobo::dynamic_bvh::insert(bounds::box const& box, std::uint32_t user_data)
+{
+	auto const leaf = allocateNode();
+	_nodes[leaf].box = enlarge(box);
+	_nodes[leaf].user_data = user_data;
+	insertLeaf(leaf);
+	++_proxies_nb;
+
+	return leaf;
+}
+
+bool
+bonobo::dynamic_bvh::update(proxy_id proxy, bounds::box const& box)
+{
+	assert(proxy < _nodes.size() && _nodes[proxy].height == 0);
+
+	if (contains(_nodes[proxy].box, box))
+		return false;
+
+	auto const enlarged = enlarge(box);
+	if (overlaps(_nodes[proxy].box, enlarged)) {
+		_nodes[proxy].box = enlarged;
+		refit(_nodes[proxy].parent, false);
+		return true;
+	}
+
+	removeLeaf(proxy);
+	_nodes[proxy].box = enlarged;
+	insertLeaf(proxy);
+	return true;
+}
+
+void
+bonobo::dynamic_bvh::remove(proxy_id proxy)
+{
+	assert(proxy < _nodes.size() && _nodes[proxy].height == 0);
+
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--_proxies_nb;
+}
+
+void
+bonobo::dynamic_bvh::clear()
+{
+	_nodes.clear();
+	_root = no_node;
+	_free_list = no_node;
+	_proxies_nb = 0u;
+}
+
+std::uint32_t
+bonobo::dynamic_bvh::getUserData(proxy_id proxy) const
+{
+	return _nodes[proxy].user_data;
+}
+
+bonobo::bounds::box const&
+bonobo::dynamic_bvh::getEnlargedBox(proxy_id proxy) const
+{
+	return _nodes[proxy].box;
+}
+
+std::size_t
+bonobo::dynamic_bvh::getProxiesNb() const
+{
+	return _proxies_nb;
+}
+
+std::size_t
+bonobo::dynamic_bvh::getHeight() const
+{
+	return _root != no_node ? static_cast<std::size_t>(_nodes[_root].height) : 0u;
+}
+
+bonobo::dynamic_bvh::cull_statistics const&
+bonobo::dynamic_bvh::cull(bounds::frustum const& view_frustum, std::vector<std::uint32_t>& visible)
+{
+	visible.clear();
+	_cull_statistics = cull_statistics();
+	if (_root == no_node)
+		return _cull_statistics;
+
+	_current_level.assign(1u, _root);
+	while (!_current_level.empty()) {
+		auto const nodes_nb = _current_level.size();
+		_level_boxes.resize(nodes_nb);
+		_level_results.resize(nodes_nb);
+		for (std::size_t i = 0u; i < nodes_nb; ++i)
+			_level_boxes[i] = _nodes[_current_level[i]].box;
+		bounds::classify(view_frustum, _level_boxes.data(), nodes_nb, _level_results.data());
+		_cull_statistics.tested_nb += nodes_nb;
+
+		_next_level.clear();
+		for (std::size_t i = 0u; i < nodes_nb; ++i) {
+			auto const& current = _nodes[_current_level[i]];
+			switch (_level_results[i]) {
+			case bounds::containment::outside:
+				break;
+			case bounds::containment::inside:
+				collectLeaves(_current_level[i], visible);
+				break;
+			case bounds::containment::intersecting:
+				if (current.isLeaf()) {
+					visible.push_back(current.user_data);
+				} else {
+					_next_level.push_back(current.children[0]);
+					_next_level.push_back(current.children[1]);
+				}
+				break;
+			}
+		}
+		_current_level.swap(_next_level);
+	}
+
+	_cull_statistics.visible_nb = visible.size();
+	_cull_statistics.culled_nb = _proxies_nb - visible.size();
+	return _cull_statistics;
+}
+
+bonobo::dynamic_bvh::cull_statistics const&
+bonobo::dynamic_bvh::getCullStatistics() const
+{
+	return _cull_statistics;
+}
+
+bonobo::dynamic_bvh::node_index
+bonobo::dynamic_bvh::allocateNode()
+{
+	if (_free_list == no_node) {
+		_nodes.emplace_back();
+		return static_cast<node_index>(_nodes.size() - 1u);
+	}
+
+	auto const index = _free_list;
+	_free_list = _nodes[index].parent;
+	_nodes[index] = node();
+	return index;
+}
+
+void
+bonobo::dynamic_bvh::freeNode(node_index index)
+{
+	_nodes[index].parent = _free_list;
+	_nodes[index].height = -1;
+	_free_list = index;
+}
+
+void
+bonobo::dynamic_bvh::insertLeaf(node_index leaf)
+{
+	if (_root == no_node) {
+		_root = leaf;
+		_nodes[leaf].parent = no_node;
+		return;
+	}
+
+	// Walk down towards the sibling that least increases the surface of
+	// the tree: pairing the leaf with a node grows that node's box and
+	// those of all its ancestors.
+	auto const leaf_box = _nodes[leaf].box;
+	auto index = _root;
+	while (!_nodes[index].isLeaf()) {
+		auto const& current = _nodes[index];
+		auto const area = surfaceArea(current.box);
+		auto const combined_area = surfaceArea(merge(current.box, leaf_box));
+
+		auto const pairing_cost = 2.0f * combined_area;
+		auto const inheritance_cost = 2.0f * (combined_area - area);
+		float descent_costs[2];
+		for (int i = 0; i < 2; ++i) {
+			auto const& child = _nodes[current.children[i]];
+			auto const merged_area = surfaceArea(merge(child.box, leaf_box));
+			descent_costs[i] = (child.isLeaf() ? merged_area : merged_area - surfaceArea(child.box)) + inheritance_cost;
+		}
+
+		if (pairing_cost < descent_costs[0] && pairing_cost < descent_costs[1])
+			break;
+		index = descent_costs[0] < descent_costs[1] ? current.children[0] : current.children[1];
+	}
+
+	auto const sibling = index;
+	auto const old_parent = _nodes[sibling].parent;
+	auto const new_parent = allocateNode();
+	_nodes[new_parent].parent = old_parent;
+	_nodes[new_parent].box = merge(leaf_box, _nodes[sibling].box);
+	_nodes[new_parent].height = _nodes[sibling].height + 1;
+	_nodes[new_parent].children[0] = sibling;
+	_nodes[new_parent].children[1] = leaf;
+	_nodes[sibling].parent = new_parent;
+	_nodes[leaf].parent = new_parent;
+
+	if (old_parent == no_node)
+		_root = new_parent;
+	else if (_nodes[old_parent].children[0] == sibling)
+		_nodes[old_parent].children[0] = new_parent;
+	else
+		_nodes[old_parent].children[1] = new_parent;
+
+	refit(old_parent, true);
+}
+
+void
+bonobo::dynamic_bvh::removeLeaf(node_index leaf)
+{
+	if (leaf == _root) {
+		_root = no_node;
+		return;
+	}
+
+	// The parent goes away, and the sibling takes its place.
+	auto const parent = _nodes[leaf].parent;
+	auto const grand_parent = _nodes[parent].parent;
+	auto const sibling = _nodes[parent].children[0] == leaf ? _nodes[parent].children[1] : _nodes[parent].children[0];
+	freeNode(parent);
+
+	_nodes[sibling].parent = grand_parent;
+	if (grand_parent == no_node) {
+		_root = sibling;
+		return;
+	}
+	if (_nodes[grand_parent].children[0] == parent)
+		_nodes[grand_parent].children[0] = sibling;
+	else
+		_nodes[grand_parent].children[1] = sibling;
+	refit(grand_parent, true);
+}
+
+void
+bonobo::dynamic_bvh::refit(node_index index, bool balance)
+{
+	while (index != no_node) {
+		if (balance)
+			index = rotate(index);
+
+		auto& current = _nodes[index];
+		auto const& first = _nodes[current.children[0]];
+		auto const& second = _nodes[current.children[1]];
+		current.box = merge(first.box, second.box);
+		current.height = 1 + std::max(first.height, second.height);
+		index = current.parent;
+	}
+}
+
+bonobo::dynamic_bvh::node_index
+bonobo::dynamic_bvh::rotate(node_index a)
+{
+	// With b and c the children of a, when one of them is more than one
+	// level taller than the other, it takes the place of a, and a takes
+	// the place of its shorter child, keeping its taller one.
+	if (_nodes[a].isLeaf() || _nodes[a].height < 2)
+		return a;
+
+	auto const b = _nodes[a].children[0];
+	auto const c = _nodes[a].children[1];
+	auto const balance = _nodes[c].height - _nodes[b].height;
+	if (balance >= -1 && balance <= 1)
+		return a;
+
+	// `raised` is the taller child, taking the place of a, and `kept` the
+	// child of a staying in place.
+	int const raised_side = balance > 1 ? 1 : 0;
+	auto const raised = _nodes[a].children[raised_side];
+	auto const kept = _nodes[a].children[1 - raised_side];
+
+	auto const a_parent = _nodes[a].parent;
+	_nodes[raised].parent = a_parent;
+	_nodes[a].parent = raised;
+	if (a_parent == no_node)
+		_root = raised;
+	else if (_nodes[a_parent].children[0] == a)
+		_nodes[a_parent].children[0] = raised;
+	else
+		_nodes[a_parent].children[1] = raised;
+
+	// The taller grandchild stays below `raised`, next to a, while the
+	// shorter one moves below a, where `raised` was.
+	auto const f = _nodes[raised].children[0];
+	auto const g = _nodes[raised].children[1];
+	auto const taller = _nodes[f].height > _nodes[g].height ? f : g;
+	auto const shorter = taller == f ? g : f;
+	_nodes[raised].children[0] = a;
+	_nodes[raised].children[1] = taller;
+	_nodes[a].children[raised_side] = shorter;
+	_nodes[shorter].parent = a;
+
+	_nodes[a].box = merge(_nodes[kept].box, _nodes[shorter].box);
+	_nodes[a].height = 1 + std::max(_nodes[kept].height, _nodes[shorter].height);
+	_nodes[raised].box = merge(_nodes[a].box, _nodes[taller].box);
+	_nodes[raised].height = 1 + std::max(_nodes[a].height, _nodes[taller].height);
+
+	return raised;
+}
+
+bonobo::bounds::box
+bonobo::dynamic_bvh::enlarge(bounds::box const& box) const
+{
+	auto const margin = _margin * (box.max - box.min);
+	bounds::box result;
+	result.min = box.min - margin;
+	result.max = box.max + margin;
+	return result;
+}
+
+void
+bonobo::dynamic_bvh::collectLeaves(node_index index, std::vector<std::uint32_t>& visible)
+{
+	_stack.assign(1u, index);
+	while (!_stack.empty()) {
+		auto const& current = _nodes[_stack.back()];
+		_stack.pop_back();
+		if (current.isLeaf()) {
+			visible.push_back(current.user_data);
+		} else {
+			_stack.push_back(current.children[0]);
+			_stack.push_back(current.children[1]);
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Tree of axis-aligned boxes over objects that can be added,
+	//!        moved and removed, to find the objects in view without
+	//!        testing each of them.
+	//!
+	//! Each object is a leaf, holding its world-space box enlarged by a
+	//! margin, and each internal node holds the box enclosing its two
+	//! children. New leaves are paired with the sibling that least grows
+	//! the total surface of the tree, and rotations keep it balanced.
+	//!
+	//! When an object moves, nothing changes as long as it stays within its
+	//! enlarged box; otherwise the leaf gets a new box, and the boxes of
+	//! its ancestors are refitted around it. An object moving so far that
+	//! its new box does not overlap its old one is re-inserted instead, as
+	//! its place in the tree no longer makes sense.
+	class dynamic_bvh {
+	public:
+		//! \brief Handle to an object in the tree.
+		using proxy_id = std::uint32_t;
+		static constexpr proxy_id invalid_proxy = std::numeric_limits<proxy_id>::max();
+
+		//! \brief Outcome of the last `cull()`.
+		struct cull_statistics {
+			std::size_t visible_nb{ 0u }; //!< objects possibly in view
+			std::size_t culled_nb{ 0u };  //!< objects definitely out of view
+			std::size_t tested_nb{ 0u };  //!< boxes tested against the frustum
+		};
+
+		//! \brief Create an empty tree.
+		//!
+		//! @param [in] margin by how much to enlarge the box of each
+		//!             object on each side, relative to its size along
+		//!             that axis
+		explicit dynamic_bvh(float margin = 0.1f);
+
+		//! \brief Add an object.
+		//!
+		//! @param [in] box world-space box of the object
+		//! @param [in] user_data value returned by `cull()` when the
+		//!             object may be in view, such as an index into the
+		//!             caller's array of objects
+		//! @return a handle to the object, valid until it is removed
+		proxy_id insert(bounds::box const& box, std::uint32_t user_data);
+
+		//! \brief Tell the tree an object moved.
+		//!
+		//! @param [in] proxy the object
+		//! @param [in] box new world-space box of the object
+		//! @return whether the tree had to change
+		bool update(proxy_id proxy, bounds::box const& box);
+
+		//! \brief Remove an object.
+		void remove(proxy_id proxy);
+
+		//! \brief Remove all objects.
+		void clear();
+
+		std::uint32_t getUserData(proxy_id proxy) const;
+
+		//! \brief Box of an object, as enlarged by the margin.
+		bounds::box const& getEnlargedBox(proxy_id proxy) const;
+
+		std::size_t getProxiesNb() const;
+
+		//! @return the number of edges from the root to the deepest leaf
+		std::size_t getHeight() const;
+
+		//! \brief Find the objects that may be in view.
+		//!
+		//! Nodes are tested level by level, four boxes at a time: the
+		//! children of nodes intersecting the frustum are tested next,
+		//! while all the objects below a node entirely inside it are
+		//! visible without further test.
+		//!
+		//! @param [in] view_frustum frustum, as extracted by
+		//!             `bounds::extractFrustum()`
+		//! @param [out] visible user data of the objects that may be in
+		//!              view, in no particular order
+		cull_statistics const& cull(bounds::frustum const& view_frustum, std::vector<std::uint32_t>& visible);
+
+		cull_statistics const& getCullStatistics() const;
+
+	private:
+		using node_index = std::uint32_t;
+		static constexpr node_index no_node = std::numeric_limits<node_index>::max();
+
+		struct node {
+			bounds::box box;
+			node_index parent{ no_node };     //!< next free node, for nodes in the free list
+			node_index children[2]{ no_node, no_node };
+			std::int32_t height{ 0 };         //!< 0 for leaves, -1 for free nodes
+			std::uint32_t user_data{ 0u };
+
+			bool isLeaf() const { return children[0] == no_node; }
+		};
+
+		node_index allocateNode();
+		void freeNode(node_index index);
+		void insertLeaf(node_index leaf);
+		void removeLeaf(node_index leaf);
+		//! \brief Recompute the boxes and heights of a node and all its
+		//!        ancestors, rotating them where unbalanced.
+		void refit(node_index index, bool balance);
+		node_index rotate(node_index index);
+		bounds::box enlarge(bounds::box const& box) const;
+		void collectLeaves(node_index index, std::vector<std::uint32_t>& visible);
+
+		std::vector<node> _nodes;
+		node_index _root{ no_node };
+		node_index _free_list{ no_node };
+		std::size_t _proxies_nb{ 0u };
+		float _margin;
+
+		// Scratch buffers for `cull()`
+		std::vector<node_index> _current_level;
+		std::vector<node_index> _next_level;
+		std::vector<bounds::box> _level_boxes;
+		std::vector<bounds::containment> _level_results;
+		std::vector<node_index> _stack;
+		cull_statistics _cull_statistics;
+	};
+}
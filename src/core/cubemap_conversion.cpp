@@ -0,0 +1,322 @@
+#include "cubemap_conversion.hpp"
+
+#include "config.hpp"
+#include "core/mapped_file.hpp"
+#include "core/parallel.hpp"
+#include "core/various.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BONOBO_USE_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+namespace
+{
+	//! \brief Bump whenever the resampling changes, so that stale cache
+	//!        entries get ignored.
+	std::uint32_t const cache_version = 1u;
+
+	std::array<char, 8> const cache_magic = {{ 'B', 'O', 'N', 'O', 'C', 'U', 'B', 'E' }};
+
+	struct cache_header {
+		std::array<char, 8> magic;
+		std::uint32_t version;
+		std::uint32_t face_size;
+		std::uint32_t is_hdr;
+		std::uint32_t reserved;
+		std::uint64_t face_bytes;
+	};
+	static_assert(sizeof(cache_header) == 32u, "Cube map cache headers are 32 bytes long.");
+
+	float const pi = 3.14159265358979f;
+
+	//! \brief Where a face sits: the direction through texel (s, t), with
+	//!        s and t in [-1, 1], is `normal + s * s_axis + t * t_axis`.
+	struct face_basis {
+		float normal[3];
+		float s_axis[3];
+		float t_axis[3];
+	};
+
+	std::array<face_basis, 6> const face_bases = {{
+		{ {  1.0f,  0.0f,  0.0f }, {  0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f,  0.0f } }, // +X
+		{ { -1.0f,  0.0f,  0.0f }, {  0.0f, 0.0f,  1.0f }, { 0.0f, -1.0f,  0.0f } }, // -X
+		{ {  0.0f,  1.0f,  0.0f }, {  1.0f, 0.0f,  0.0f }, { 0.0f,  0.0f,  1.0f } }, // +Y
+		{ {  0.0f, -1.0f,  0.0f }, {  1.0f, 0.0f,  0.0f }, { 0.0f,  0.0f, -1.0f } }, // -Y
+		{ {  0.0f,  0.0f,  1.0f }, {  1.0f, 0.0f,  0.0f }, { 0.0f, -1.0f,  0.0f } }, // +Z
+		{ {  0.0f,  0.0f, -1.0f }, { -1.0f, 0.0f,  0.0f }, { 0.0f, -1.0f,  0.0f } }  // -Z
+	}};
+
+	struct panorama {
+		std::uint8_t const* rgba;  //!< set for 8-bit panoramas
+		float const* rgb;          //!< set for HDR panoramas
+		std::uint32_t width;
+		std::uint32_t height;
+	};
+
+	//! \brief Bilinearly filter the panorama at (u, v), wrapping around
+	//!        horizontally and clamping vertically.
+	//!
+	//! @param [out] out the four channels of the result, in the range of
+	//!              the source texels
+	template<typename T, unsigned int channels_nb>
+	void sampleBilinear(T const* texels, std::uint32_t width, std::uint32_t height, float u, float v, float* out)
+	{
+		auto const x = u * static_cast<float>(width) - 0.5f;
+		auto const y = std::min(std::max(v * static_cast<float>(height) - 0.5f, 0.0f), static_cast<float>(height - 1u));
+		auto const x_floor = std::floor(x);
+		auto const y_floor = std::floor(y);
+		auto const fx = x - x_floor;
+		auto const fy = y - y_floor;
+
+		auto x0 = static_cast<std::int64_t>(x_floor) % static_cast<std::int64_t>(width);
+		if (x0 < 0)
+			x0 += width;
+		auto const x1 = (static_cast<std::uint32_t>(x0) + 1u) % width;
+		auto const y0 = static_cast<std::uint32_t>(y_floor);
+		auto const y1 = std::min(y0 + 1u, height - 1u);
+
+		auto const row0 = texels + static_cast<std::size_t>(y0) * width * channels_nb;
+		auto const row1 = texels + static_cast<std::size_t>(y1) * width * channels_nb;
+		auto const a = row0 + static_cast<std::size_t>(x0) * channels_nb;
+		auto const b = row0 + static_cast<std::size_t>(x1) * channels_nb;
+		auto const c = row1 + static_cast<std::size_t>(x0) * channels_nb;
+		auto const d = row1 + static_cast<std::size_t>(x1) * channels_nb;
+		for (unsigned int i = 0u; i < channels_nb; ++i) {
+			auto const top = static_cast<float>(a[i]) + (static_cast<float>(b[i]) - static_cast<float>(a[i])) * fx;
+			auto const bottom = static_cast<float>(c[i]) + (static_cast<float>(d[i]) - static_cast<float>(c[i])) * fx;
+			out[i] = top + (bottom - top) * fy;
+		}
+		for (unsigned int i = channels_nb; i < 4u; ++i)
+			out[i] = 1.0f;
+	}
+
+	void sample(panorama const& source, float u, float v, float* out)
+	{
+		if (source.rgb != nullptr)
+			sampleBilinear<float, 3u>(source.rgb, source.width, source.height, u, v, out);
+		else
+			sampleBilinear<std::uint8_t, 4u>(source.rgba, source.width, source.height, u, v, out);
+	}
+
+#if defined(BONOBO_USE_SSE2)
+	inline __m128 select(__m128 mask, __m128 if_set, __m128 if_unset)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, if_set), _mm_andnot_ps(mask, if_unset));
+	}
+
+	//! \brief Four-wide `atan2()`, accurate to about 1e-5 radians.
+	__m128 atan2Approximation(__m128 y, __m128 x)
+	{
+		auto const sign_mask = _mm_set1_ps(-0.0f);
+		auto const abs_y = _mm_andnot_ps(sign_mask, y);
+		auto const abs_x = _mm_andnot_ps(sign_mask, x);
+		auto const numerator = _mm_min_ps(abs_x, abs_y);
+		auto const denominator = _mm_max_ps(_mm_max_ps(abs_x, abs_y), _mm_set1_ps(1e-30f));
+		auto const a = _mm_div_ps(numerator, denominator);
+		auto const a2 = _mm_mul_ps(a, a);
+
+		// Minimax polynomial of atan() over [0, 1].
+		auto r = _mm_set1_ps(-0.01172120f);
+		r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.05265332f));
+		r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(-0.11643287f));
+		r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.19354346f));
+		r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(-0.33262347f));
+		r = _mm_add_ps(_mm_mul_ps(r, a2), _mm_set1_ps(0.99997726f));
+		r = _mm_mul_ps(r, a);
+
+		// Unfold the result from the first octant.
+		r = select(_mm_cmpgt_ps(abs_y, abs_x), _mm_sub_ps(_mm_set1_ps(0.5f * pi), r), r);
+		r = select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(pi), r), r);
+		return _mm_or_ps(r, _mm_and_ps(y, sign_mask));
+	}
+#endif
+
+	//! \brief Resample one row of a face.
+	//!
+	//! @param [out] out four floats per texel of the row
+	void resampleRow(panorama const& source, unsigned int face, std::uint32_t row, std::uint32_t face_size, float* out)
+	{
+		auto const& basis = face_bases[face];
+		auto const scale = 2.0f / static_cast<float>(face_size);
+		auto const t = (static_cast<float>(row) + 0.5f) * scale - 1.0f;
+		float const origin[3] = {
+			basis.normal[0] + t * basis.t_axis[0],
+			basis.normal[1] + t * basis.t_axis[1],
+			basis.normal[2] + t * basis.t_axis[2]
+		};
+
+		std::uint32_t x = 0u;
+#if defined(BONOBO_USE_SSE2)
+		// Going from directions to panorama coordinates takes two
+		// arctangents per texel, which is where most of the time goes when
+		// done one texel at a time.
+		auto const offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		auto const one = _mm_set1_ps(1.0f);
+		auto const half = _mm_set1_ps(0.5f);
+		alignas(16) float us[4], vs[4];
+		for (; x + 4u <= face_size; x += 4u) {
+			auto const s = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets), _mm_set1_ps(scale)), one);
+			auto const dx = _mm_add_ps(_mm_set1_ps(origin[0]), _mm_mul_ps(s, _mm_set1_ps(basis.s_axis[0])));
+			auto const dy = _mm_add_ps(_mm_set1_ps(origin[1]), _mm_mul_ps(s, _mm_set1_ps(basis.s_axis[1])));
+			auto const dz = _mm_add_ps(_mm_set1_ps(origin[2]), _mm_mul_ps(s, _mm_set1_ps(basis.s_axis[2])));
+
+			auto const longitude = atan2Approximation(dx, _mm_sub_ps(_mm_setzero_ps(), dz));
+			auto const horizontal_length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+			auto const latitude = atan2Approximation(dy, horizontal_length);
+			_mm_store_ps(us, _mm_add_ps(_mm_mul_ps(longitude, _mm_set1_ps(0.5f / pi)), half));
+			_mm_store_ps(vs, _mm_sub_ps(half, _mm_mul_ps(latitude, _mm_set1_ps(1.0f / pi))));
+
+			for (unsigned int i = 0u; i < 4u; ++i)
+				sample(source, us[i], vs[i], out + (x + i) * 4u);
+		}
+#endif
+		for (; x < face_size; ++x) {
+			auto const s = (static_cast<float>(x) + 0.5f) * scale - 1.0f;
+			auto const dx = origin[0] + s * basis.s_axis[0];
+			auto const dy = origin[1] + s * basis.s_axis[1];
+			auto const dz = origin[2] + s * basis.s_axis[2];
+			auto const u = 0.5f + std::atan2(dx, -dz) * (0.5f / pi);
+			auto const v = 0.5f - std::atan2(dy, std::sqrt(dx * dx + dz * dz)) * (1.0f / pi);
+			sample(source, u, v, out + x * 4u);
+		}
+	}
+
+	bonobo::cubemap_conversion::cube_faces resample(panorama const& source, std::uint32_t face_size)
+	{
+		bonobo::cubemap_conversion::cube_faces faces;
+		if (source.width == 0u || source.height == 0u || face_size == 0u)
+			return faces;
+
+		bool const is_hdr = source.rgb != nullptr;
+		std::size_t const texel_size = is_hdr ? 3u * sizeof(std::uint16_t) : 4u;
+		faces.face_size = face_size;
+		faces.is_hdr = is_hdr;
+		faces.face_bytes = static_cast<std::size_t>(face_size) * face_size * texel_size;
+		faces.data.resize(faces.face_bytes * 6u);
+
+		utils::parallel::for_each_index(6u * static_cast<std::size_t>(face_size), [&](std::size_t job){
+			thread_local std::vector<float> filtered;
+			filtered.resize(static_cast<std::size_t>(face_size) * 4u);
+
+			auto const face = static_cast<unsigned int>(job / face_size);
+			auto const row = static_cast<std::uint32_t>(job % face_size);
+			resampleRow(source, face, row, face_size, filtered.data());
+
+			auto const destination = faces.data.data() + face * faces.face_bytes + row * face_size * texel_size;
+			if (is_hdr) {
+				auto texels = reinterpret_cast<std::uint16_t*>(destination);
+				for (std::uint32_t x = 0u; x < face_size; ++x)
+					for (unsigned int i = 0u; i < 3u; ++i)
+						*texels++ = glm::packHalf1x16(filtered[x * 4u + i]);
+			} else {
+				for (std::size_t i = 0u; i < static_cast<std::size_t>(face_size) * 4u; ++i)
+					destination[i] = static_cast<std::uint8_t>(std::min(std::max(filtered[i] + 0.5f, 0.0f), 255.0f));
+			}
+		});
+
+		return faces;
+	}
+}
+
+std::string
+bonobo::cubemap_conversion::getCacheFilename(utils::vfs::file_view const& source, std::uint32_t face_size)
+{
+	if (source.data() == nullptr)
+		return "";
+
+	char filename[64];
+	std::snprintf(filename, sizeof(filename), "%016llx.cubemap%u.v%u.bin",
+	              static_cast<unsigned long long>(utils::hash_fnv1a(source.data(), source.size())),
+	              face_size, cache_version);
+	return config::cache_path(filename);
+}
+
+bonobo::cubemap_conversion::cube_faces
+bonobo::cubemap_conversion::convert(std::uint8_t const* rgba, std::uint32_t width, std::uint32_t height, std::uint32_t face_size)
+{
+	if (rgba == nullptr)
+		return cube_faces();
+	return resample(panorama{ rgba, nullptr, width, height }, face_size);
+}
+
+bonobo::cubemap_conversion::cube_faces
+bonobo::cubemap_conversion::convert(float const* rgb, std::uint32_t width, std::uint32_t height, std::uint32_t face_size)
+{
+	if (rgb == nullptr)
+		return cube_faces();
+	return resample(panorama{ nullptr, rgb, width, height }, face_size);
+}
+
+bool
+bonobo::cubemap_conversion::writeCache(std::string const& filename, cube_faces const& faces)
+{
+	if (faces.data.empty())
+		return false;
+
+	cache_header header;
+	header.magic = cache_magic;
+	header.version = cache_version;
+	header.face_size = faces.face_size;
+	header.is_hdr = faces.is_hdr ? 1u : 0u;
+	header.reserved = 0u;
+	header.face_bytes = faces.face_bytes;
+
+	// Write to a temporary file first, so that a concurrent reader never
+	// sees a partially written file.
+	auto const temporary_filename = filename + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_filename), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(reinterpret_cast<char const*>(faces.data.data()), static_cast<std::streamsize>(faces.data.size()));
+		if (!file.good()) {
+			file.close();
+			std::remove(temporary_filename.c_str());
+			return false;
+		}
+	}
+	std::remove(filename.c_str());
+	if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+		std::remove(temporary_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool
+bonobo::cubemap_conversion::readCache(std::string const& filename, cube_faces& faces)
+{
+	utils::mapped_file file;
+	if (!file.open(filename) || file.size() < sizeof(cache_header))
+		return false;
+
+	cache_header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != cache_magic || header.version != cache_version || header.face_size == 0u)
+		return false;
+	std::size_t const texel_size = header.is_hdr != 0u ? 3u * sizeof(std::uint16_t) : 4u;
+	if (header.face_bytes != static_cast<std::uint64_t>(header.face_size) * header.face_size * texel_size
+	    || file.size() - sizeof(cache_header) < header.face_bytes * 6u)
+		return false;
+
+	cube_faces result;
+	result.face_size = header.face_size;
+	result.is_hdr = header.is_hdr != 0u;
+	result.face_bytes = static_cast<std::size_t>(header.face_bytes);
+	auto const data = file.data() + sizeof(cache_header);
+	result.data.assign(data, data + result.face_bytes * 6u);
+	faces = std::move(result);
+
+	return true;
+}
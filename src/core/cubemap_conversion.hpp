@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/vfs.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief CPU resampling of equirectangular panoramas into the six
+	//!        faces of a cube map, and their on-disk cache.
+	//!
+	//! The centre of the panorama looks towards -Z, with +Y up, and its
+	//! left edge towards +Z; faces follow the OpenGL cube map conventions,
+	//! so they can be uploaded as is.
+	//!
+	//! None of these functions need an OpenGL context, and all can be
+	//! called from any thread.
+	namespace cubemap_conversion
+	{
+		//! \brief Six faces of identical size, stored one after the other
+		//!        in the order of `GL_TEXTURE_CUBE_MAP_POSITIVE_X + i`.
+		struct cube_faces {
+			std::uint32_t face_size{ 0u };  //!< width and height of each face
+			bool is_hdr{ false };           //!< whether texels are RGB half-floats rather than RGBA8
+			std::size_t face_bytes{ 0u };   //!< size in bytes of each face
+			std::vector<std::uint8_t> data;
+
+			std::uint8_t const* face(unsigned int i) const { return data.data() + i * face_bytes; }
+		};
+
+		//! \brief Path to the cache file for a given panorama.
+		//!
+		//! The name is derived from a hash of the content of the panorama,
+		//! so that an edited panorama gets a new cache entry.
+		//!
+		//! @param [in] source content of the panorama file
+		//! @param [in] face_size width and height of each face
+		//! @return the path, or an empty string if `source` is invalid
+		std::string getCacheFilename(utils::vfs::file_view const& source, std::uint32_t face_size);
+
+		//! \brief Resample an 8-bit panorama, using bilinear filtering.
+		//!
+		//! Rows of all faces are spread over the worker pool.
+		//!
+		//! @param [in] rgba texels of the panorama, 4 bytes per texel, top
+		//!             row first
+		//! @param [in] width width of the panorama
+		//! @param [in] height height of the panorama
+		//! @param [in] face_size width and height of each face
+		cube_faces convert(std::uint8_t const* rgba, std::uint32_t width, std::uint32_t height, std::uint32_t face_size);
+
+		//! \brief Resample an HDR panorama, using bilinear filtering.
+		//!
+		//! @param [in] rgb texels of the panorama, 3 floats per texel, top
+		//!             row first
+		cube_faces convert(float const* rgb, std::uint32_t width, std::uint32_t height, std::uint32_t face_size);
+
+		bool writeCache(std::string const& filename, cube_faces const& faces);
+		bool readCache(std::string const& filename, cube_faces& faces);
+	}
+}
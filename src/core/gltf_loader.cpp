@@ -0,0 +1,811 @@
+#include "gltf_loader.hpp"
+
+#include "core/Log.h"
+#include "core/parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+
+namespace
+{
+	//! \brief Document object model of a JSON value.
+	struct json_value {
+		enum class kind : std::uint8_t { null, boolean, number, string, array, object };
+
+		kind type{ kind::null };
+		bool boolean{ false };
+		double number{ 0.0 };
+		std::string string;
+		std::vector<json_value> elements;
+		std::vector<std::pair<std::string, json_value>> members;
+
+		//! \brief Member of an object, or null if there is no such member
+		//!        or this is not an object.
+		json_value const* find(char const* key) const
+		{
+			for (auto const& member : members)
+				if (member.first == key)
+					return &member.second;
+			return nullptr;
+		}
+	};
+
+	//! \brief Recursive descent parser, following RFC 8259.
+	class json_parser {
+	public:
+		json_parser(char const* begin, char const* end) : _p(begin), _end(end) {}
+
+		bool parse(json_value& value)
+		{
+			return parseValue(value, 0u) && (skipSpaces(), _p == _end);
+		}
+
+	private:
+		//! \brief Nesting deeper than this is rejected, to bound the
+		//!        recursion.
+		static constexpr unsigned int max_depth = 64u;
+
+		void skipSpaces()
+		{
+			while (_p != _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r'))
+				++_p;
+		}
+
+		bool consume(char const* literal)
+		{
+			auto const length = std::strlen(literal);
+			if (static_cast<std::size_t>(_end - _p) < length || std::memcmp(_p, literal, length) != 0)
+				return false;
+			_p += length;
+			return true;
+		}
+
+		bool parseValue(json_value& value, unsigned int depth)
+		{
+			skipSpaces();
+			if (_p == _end || depth > max_depth)
+				return false;
+			switch (*_p) {
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value.type = json_value::kind::string;
+				return parseString(value.string);
+			case 't':
+				value.type = json_value::kind::boolean;
+				value.boolean = true;
+				return consume("true");
+			case 'f':
+				value.type = json_value::kind::boolean;
+				value.boolean = false;
+				return consume("false");
+			case 'n':
+				value.type = json_value::kind::null;
+				return consume("null");
+			default:
+				value.type = json_value::kind::number;
+				return parseNumber(value.number);
+			}
+		}
+
+		bool parseObject(json_value& value, unsigned int depth)
+		{
+			value.type = json_value::kind::object;
+			++_p;
+			skipSpaces();
+			if (_p != _end && *_p == '}') {
+				++_p;
+				return true;
+			}
+			while (true) {
+				skipSpaces();
+				std::pair<std::string, json_value> member;
+				if (_p == _end || *_p != '"' || !parseString(member.first))
+					return false;
+				skipSpaces();
+				if (_p == _end || *_p != ':')
+					return false;
+				++_p;
+				if (!parseValue(member.second, depth + 1u))
+					return false;
+				value.members.push_back(std::move(member));
+				skipSpaces();
+				if (_p == _end)
+					return false;
+				if (*_p++ == '}')
+					return true;
+				if (*(_p - 1) != ',')
+					return false;
+			}
+		}
+
+		bool parseArray(json_value& value, unsigned int depth)
+		{
+			value.type = json_value::kind::array;
+			++_p;
+			skipSpaces();
+			if (_p != _end && *_p == ']') {
+				++_p;
+				return true;
+			}
+			while (true) {
+				value.elements.emplace_back();
+				if (!parseValue(value.elements.back(), depth + 1u))
+					return false;
+				skipSpaces();
+				if (_p == _end)
+					return false;
+				if (*_p++ == ']')
+					return true;
+				if (*(_p - 1) != ',')
+					return false;
+			}
+		}
+
+		bool parseHexadecimal(std::uint32_t& code_unit)
+		{
+			if (_end - _p < 4)
+				return false;
+			code_unit = 0u;
+			for (int i = 0; i < 4; ++i, ++_p) {
+				auto const c = *_p;
+				code_unit <<= 4;
+				if (c >= '0' && c <= '9')
+					code_unit |= static_cast<std::uint32_t>(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					code_unit |= static_cast<std::uint32_t>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					code_unit |= static_cast<std::uint32_t>(c - 'A' + 10);
+				else
+					return false;
+			}
+			return true;
+		}
+
+		bool parseString(std::string& result)
+		{
+			++_p;
+			while (_p != _end && *_p != '"') {
+				if (static_cast<unsigned char>(*_p) < 0x20u)
+					return false;
+				if (*_p != '\\') {
+					result += *_p++;
+					continue;
+				}
+				if (++_p == _end)
+					return false;
+				auto const escaped = *_p++;
+				switch (escaped) {
+				case '"': case '\\': case '/':
+					result += escaped; break;
+				case 'b': result += '\b'; break;
+				case 'f': result += '\f'; break;
+				case 'n': result += '\n'; break;
+				case 'r': result += '\r'; break;
+				case 't': result += '\t'; break;
+				case 'u': {
+					std::uint32_t code_point = 0u;
+					if (!parseHexadecimal(code_point))
+						return false;
+					if (code_point >= 0xd800u && code_point < 0xdc00u) {
+						std::uint32_t low_surrogate = 0u;
+						if (!consume("\\u") || !parseHexadecimal(low_surrogate) || low_surrogate < 0xdc00u || low_surrogate >= 0xe000u)
+							return false;
+						code_point = 0x10000u + ((code_point - 0xd800u) << 10) + (low_surrogate - 0xdc00u);
+					}
+					// Encode as UTF-8.
+					if (code_point < 0x80u) {
+						result += static_cast<char>(code_point);
+					} else if (code_point < 0x800u) {
+						result += static_cast<char>(0xc0u | (code_point >> 6));
+						result += static_cast<char>(0x80u | (code_point & 0x3fu));
+					} else if (code_point < 0x10000u) {
+						result += static_cast<char>(0xe0u | (code_point >> 12));
+						result += static_cast<char>(0x80u | ((code_point >> 6) & 0x3fu));
+						result += static_cast<char>(0x80u | (code_point & 0x3fu));
+					} else {
+						result += static_cast<char>(0xf0u | (code_point >> 18));
+						result += static_cast<char>(0x80u | ((code_point >> 12) & 0x3fu));
+						result += static_cast<char>(0x80u | ((code_point >> 6) & 0x3fu));
+						result += static_cast<char>(0x80u | (code_point & 0x3fu));
+					}
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			if (_p == _end)
+				return false;
+			++_p;
+			return true;
+		}
+
+		bool parseNumber(double& number)
+		{
+			// Copy the number, as the document is not null-terminated.
+			auto const start = _p;
+			while (_p != _end && (std::isdigit(static_cast<unsigned char>(*_p)) || *_p == '-' || *_p == '+'
+			                      || *_p == '.' || *_p == 'e' || *_p == 'E'))
+				++_p;
+			auto const length = static_cast<std::size_t>(_p - start);
+			if (length == 0u || length >= 64u)
+				return false;
+			char buffer[64];
+			std::memcpy(buffer, start, length);
+			buffer[length] = '\0';
+			char* parsed_end = nullptr;
+			number = std::strtod(buffer, &parsed_end);
+			return parsed_end == buffer + length;
+		}
+
+		char const* _p;
+		char const* _end;
+	};
+
+	std::uint32_t readUint32(std::uint8_t const* data)
+	{
+		return static_cast<std::uint32_t>(data[0]) | (static_cast<std::uint32_t>(data[1]) << 8)
+		     | (static_cast<std::uint32_t>(data[2]) << 16) | (static_cast<std::uint32_t>(data[3]) << 24);
+	}
+
+	double getNumber(json_value const* object, char const* key, double fallback)
+	{
+		auto const value = object != nullptr ? object->find(key) : nullptr;
+		return value != nullptr && value->type == json_value::kind::number ? value->number : fallback;
+	}
+
+	//! \brief Non-negative integer member of an object.
+	//!
+	//! @return the integer, or -1 if absent or invalid
+	std::int64_t getIndex(json_value const* object, char const* key)
+	{
+		auto const number = getNumber(object, key, -1.0);
+		if (number < 0.0 || number > 4294967295.0 || number != std::floor(number))
+			return -1;
+		return static_cast<std::int64_t>(number);
+	}
+
+	std::string getString(json_value const* object, char const* key)
+	{
+		auto const value = object != nullptr ? object->find(key) : nullptr;
+		return value != nullptr && value->type == json_value::kind::string ? value->string : std::string();
+	}
+
+	//! \brief Elements of an array member, or an empty list.
+	std::vector<json_value> const& getArray(json_value const* object, char const* key)
+	{
+		static std::vector<json_value> const empty;
+		auto const value = object != nullptr ? object->find(key) : nullptr;
+		return value != nullptr && value->type == json_value::kind::array ? value->elements : empty;
+	}
+
+	template<std::size_t N>
+	std::array<float, N> getFloats(json_value const* object, char const* key, std::array<float, N> fallback)
+	{
+		auto const& elements = getArray(object, key);
+		if (elements.size() != N)
+			return fallback;
+		for (std::size_t i = 0u; i < N; ++i)
+			if (elements[i].type == json_value::kind::number)
+				fallback[i] = static_cast<float>(elements[i].number);
+		return fallback;
+	}
+
+	//! \brief Decode the base64 payload of a data URI.
+	bool decodeDataURI(std::string const& uri, std::vector<std::uint8_t>& data)
+	{
+		auto const payload_start = uri.find(";base64,");
+		if (uri.compare(0u, 5u, "data:") != 0 || payload_start == std::string::npos)
+			return false;
+
+		data.clear();
+		data.reserve((uri.size() - payload_start) / 4u * 3u);
+		std::uint32_t accumulator = 0u;
+		int bits_nb = 0;
+		for (auto i = payload_start + 8u; i < uri.size() && uri[i] != '='; ++i) {
+			auto const c = uri[i];
+			std::uint32_t value = 0u;
+			if (c >= 'A' && c <= 'Z')
+				value = static_cast<std::uint32_t>(c - 'A');
+			else if (c >= 'a' && c <= 'z')
+				value = static_cast<std::uint32_t>(c - 'a' + 26);
+			else if (c >= '0' && c <= '9')
+				value = static_cast<std::uint32_t>(c - '0' + 52);
+			else if (c == '+')
+				value = 62u;
+			else if (c == '/')
+				value = 63u;
+			else
+				return false;
+			accumulator = (accumulator << 6) | value;
+			bits_nb += 6;
+			if (bits_nb >= 8) {
+				bits_nb -= 8;
+				data.push_back(static_cast<std::uint8_t>(accumulator >> bits_nb));
+			}
+		}
+		return true;
+	}
+
+	struct buffer_view_record {
+		std::size_t buffer;
+		std::size_t offset;
+		std::size_t size;
+		std::size_t stride; //!< 0 if tightly packed
+	};
+
+	GLint getComponentsNb(std::string const& type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+		return 0;
+	}
+
+	std::size_t getComponentSize(GLenum type)
+	{
+		switch (type) {
+		case GL_BYTE: case GL_UNSIGNED_BYTE:
+			return 1u;
+		case GL_SHORT: case GL_UNSIGNED_SHORT:
+			return 2u;
+		case GL_UNSIGNED_INT: case GL_FLOAT:
+			return 4u;
+		default:
+			return 0u;
+		}
+	}
+
+	//! \brief Accessor once checked against its buffer view, pointing into
+	//!        the source data.
+	struct source_accessor {
+		std::int64_t buffer_view{ -1 };
+		std::size_t view_offset{ 0u }; //!< offset within the buffer view
+		std::uint8_t const* data{ nullptr };
+		std::size_t stride{ 0u };      //!< actual distance between elements
+		GLint components_nb{ 0 };
+		GLenum component_type{ GL_FLOAT };
+		bool is_normalised{ false };
+		std::uint32_t count{ 0u };
+		json_value const* description{ nullptr };
+	};
+
+	//! \brief Alignment of each buffer view within the uploaded buffer.
+	std::size_t const upload_alignment = 16u;
+}
+
+bool
+bonobo::gltf_loader::isGltfFile(std::string const& filename)
+{
+	auto const extension_start = filename.find_last_of('.');
+	if (extension_start == std::string::npos)
+		return false;
+	auto extension = filename.substr(extension_start + 1u);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+	               [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+	return extension == "glb" || extension == "gltf";
+}
+
+bool
+bonobo::gltf_loader::load(std::string const& filename, asset& result)
+{
+	result = asset();
+	result.file = utils::vfs::read(filename);
+	if (!result.file.is_valid()) {
+		LogError("Failed to open \"%s\"", filename.c_str());
+		return false;
+	}
+	auto const end_of_basedir = filename.find_last_of("/\\");
+	auto const parent_folder = end_of_basedir != std::string::npos ? filename.substr(0u, end_of_basedir + 1u) : std::string();
+
+	// A binary file is a header followed by a JSON chunk, and optionally a
+	// binary chunk; anything else is taken as JSON.
+	auto const file_data = result.file.data();
+	auto const file_size = result.file.size();
+	char const* json_begin = reinterpret_cast<char const*>(file_data);
+	char const* json_end = json_begin + file_size;
+	std::uint8_t const* binary_chunk = nullptr;
+	std::size_t binary_chunk_size = 0u;
+	if (file_size >= 12u && std::memcmp(file_data, "glTF", 4u) == 0) {
+		auto const version = readUint32(file_data + 4u);
+		auto const length = std::min<std::size_t>(readUint32(file_data + 8u), file_size);
+		if (version != 2u || length < 20u || readUint32(file_data + 16u) != 0x4e4f534au) {
+			LogError("\"%s\" is not a valid glTF 2.0 binary file", filename.c_str());
+			return false;
+		}
+		auto const json_size = readUint32(file_data + 12u);
+		if (json_size > length - 20u) {
+			LogError("\"%s\" is truncated", filename.c_str());
+			return false;
+		}
+		json_begin = reinterpret_cast<char const*>(file_data + 20u);
+		json_end = json_begin + json_size;
+		auto const binary_header = 20u + static_cast<std::size_t>(json_size);
+		if (binary_header + 8u <= length && readUint32(file_data + binary_header + 4u) == 0x004e4942u) {
+			binary_chunk = file_data + binary_header + 8u;
+			binary_chunk_size = std::min<std::size_t>(readUint32(file_data + binary_header), length - binary_header - 8u);
+		}
+	}
+
+	json_value document;
+	if (!json_parser(json_begin, json_end).parse(document) || document.type != json_value::kind::object) {
+		LogError("Failed to parse the JSON content of \"%s\"", filename.c_str());
+		return false;
+	}
+	auto const asset_description = document.find("asset");
+	if (getString(asset_description, "version").compare(0u, 2u, "2.") != 0) {
+		LogError("\"%s\" is not a glTF 2.0 file", filename.c_str());
+		return false;
+	}
+	for (auto const& extension : getArray(&document, "extensionsRequired"))
+		if (extension.type == json_value::kind::string) {
+			LogError("\"%s\" requires the unsupported extension %s", filename.c_str(), extension.string.c_str());
+			return false;
+		}
+
+	// Buffers: the binary chunk, data URIs, or external files.
+	auto const& buffer_descriptions = getArray(&document, "buffers");
+	std::vector<std::pair<std::uint8_t const*, std::size_t>> buffers(buffer_descriptions.size(), { nullptr, 0u });
+	for (std::size_t i = 0u; i < buffer_descriptions.size(); ++i) {
+		auto const& description = buffer_descriptions[i];
+		auto const uri = getString(&description, "uri");
+		auto const declared_size = getIndex(&description, "byteLength");
+		if (uri.empty()) {
+			if (i == 0u && binary_chunk != nullptr)
+				buffers[i] = { binary_chunk, binary_chunk_size };
+		} else if (uri.compare(0u, 5u, "data:") == 0) {
+			std::vector<std::uint8_t> data;
+			if (decodeDataURI(uri, data)) {
+				result.owned_data.push_back(std::move(data));
+				buffers[i] = { result.owned_data.back().data(), result.owned_data.back().size() };
+			}
+		} else {
+			auto file = utils::vfs::read(parent_folder + uri);
+			if (file.is_valid()) {
+				buffers[i] = { file.data(), file.size() };
+				result.external_files.push_back(std::move(file));
+			}
+		}
+		if (buffers[i].first == nullptr && declared_size != 0)
+			LogWarning("Buffer %zu of \"%s\" could not be read.", i, filename.c_str());
+		else if (declared_size >= 0)
+			buffers[i].second = std::min(buffers[i].second, static_cast<std::size_t>(declared_size));
+	}
+
+	std::vector<buffer_view_record> buffer_views;
+	for (auto const& description : getArray(&document, "bufferViews")) {
+		auto const buffer = getIndex(&description, "buffer");
+		auto const offset = std::max<std::int64_t>(getIndex(&description, "byteOffset"), 0);
+		auto const size = getIndex(&description, "byteLength");
+		auto const stride = std::max<std::int64_t>(getIndex(&description, "byteStride"), 0);
+		if (buffer < 0 || static_cast<std::size_t>(buffer) >= buffers.size() || size < 0
+		 || static_cast<std::size_t>(offset) > buffers[static_cast<std::size_t>(buffer)].second
+		 || static_cast<std::size_t>(size) > buffers[static_cast<std::size_t>(buffer)].second - static_cast<std::size_t>(offset)) {
+			// Marked as empty, so that accessors into it fail validation.
+			buffer_views.push_back({ 0u, 0u, 0u, 0u });
+			continue;
+		}
+		buffer_views.push_back({ static_cast<std::size_t>(buffer), static_cast<std::size_t>(offset),
+		                         static_cast<std::size_t>(size), static_cast<std::size_t>(stride) });
+	}
+
+	auto const& accessor_descriptions = getArray(&document, "accessors");
+	auto const get_accessor = [&](std::int64_t index, source_accessor& accessor){
+		if (index < 0 || static_cast<std::size_t>(index) >= accessor_descriptions.size())
+			return false;
+		auto const& description = accessor_descriptions[static_cast<std::size_t>(index)];
+		if (description.find("sparse") != nullptr)
+			return false;
+		accessor.description = &description;
+		accessor.buffer_view = getIndex(&description, "bufferView");
+		accessor.view_offset = static_cast<std::size_t>(std::max<std::int64_t>(getIndex(&description, "byteOffset"), 0));
+		accessor.components_nb = getComponentsNb(getString(&description, "type"));
+		accessor.component_type = static_cast<GLenum>(getIndex(&description, "componentType"));
+		auto const is_normalised = description.find("normalized");
+		accessor.is_normalised = is_normalised != nullptr && is_normalised->type == json_value::kind::boolean && is_normalised->boolean;
+		auto const count = getIndex(&description, "count");
+		auto const component_size = getComponentSize(accessor.component_type);
+		if (accessor.buffer_view < 0 || static_cast<std::size_t>(accessor.buffer_view) >= buffer_views.size()
+		 || accessor.components_nb == 0 || component_size == 0u || count <= 0
+		 || accessor.view_offset % component_size != 0u)
+			return false;
+
+		auto const& view = buffer_views[static_cast<std::size_t>(accessor.buffer_view)];
+		auto const element_size = component_size * static_cast<std::size_t>(accessor.components_nb);
+		accessor.stride = view.stride != 0u ? view.stride : element_size;
+		accessor.count = static_cast<std::uint32_t>(count);
+		if (accessor.stride < element_size || accessor.stride % component_size != 0u || accessor.stride > 252u
+		 || view.offset % component_size != 0u || accessor.view_offset > view.size
+		 || (static_cast<std::size_t>(count) - 1u) * accessor.stride + element_size > view.size - accessor.view_offset)
+			return false;
+		accessor.data = buffers[view.buffer].first + view.offset + accessor.view_offset;
+		return buffers[view.buffer].first != nullptr;
+	};
+
+	// Buffer views get uploaded once, in the order primitives use them.
+	std::map<std::int64_t, std::size_t> view_upload_offsets;
+	auto const upload_view = [&](std::int64_t buffer_view, bool is_index_data){
+		auto const found = view_upload_offsets.find(buffer_view);
+		if (found != view_upload_offsets.end())
+			return found->second;
+		auto const& view = buffer_views[static_cast<std::size_t>(buffer_view)];
+		auto const offset = (result.upload_size + upload_alignment - 1u) / upload_alignment * upload_alignment;
+		result.uploads.push_back({ buffers[view.buffer].first + view.offset, view.size, offset, is_index_data });
+		result.upload_size = offset + view.size;
+		view_upload_offsets.emplace(buffer_view, offset);
+		return offset;
+	};
+	auto const make_record = [&](source_accessor const& accessor, bool is_index_data){
+		accessor_record record;
+		record.offset = upload_view(accessor.buffer_view, is_index_data) + accessor.view_offset;
+		record.components_nb = accessor.components_nb;
+		record.component_type = accessor.component_type;
+		record.is_normalised = accessor.is_normalised ? GL_TRUE : GL_FALSE;
+		record.stride = buffer_views[static_cast<std::size_t>(accessor.buffer_view)].stride != 0u ? static_cast<GLsizei>(accessor.stride) : 0;
+		record.count = accessor.count;
+		return record;
+	};
+
+	// Images and materials.
+	for (auto const& description : getArray(&document, "images")) {
+		image_record image;
+		auto const uri = getString(&description, "uri");
+		auto const buffer_view = getIndex(&description, "bufferView");
+		if (buffer_view >= 0 && static_cast<std::size_t>(buffer_view) < buffer_views.size()) {
+			// Views that failed validation are left empty, and may refer to
+			// a buffer that does not exist.
+			auto const& view = buffer_views[static_cast<std::size_t>(buffer_view)];
+			if (view.size != 0u && view.buffer < buffers.size() && buffers[view.buffer].first != nullptr)
+				image = { buffers[view.buffer].first + view.offset, view.size };
+		} else if (uri.compare(0u, 5u, "data:") == 0) {
+			std::vector<std::uint8_t> data;
+			if (decodeDataURI(uri, data)) {
+				result.owned_data.push_back(std::move(data));
+				image = { result.owned_data.back().data(), result.owned_data.back().size() };
+			}
+		} else if (!uri.empty()) {
+			auto file = utils::vfs::read(parent_folder + uri);
+			if (file.is_valid()) {
+				image = { file.data(), file.size() };
+				result.external_files.push_back(std::move(file));
+			}
+		}
+		if (image.data == nullptr)
+			LogWarning("Image %zu of \"%s\" could not be read.", result.images.size(), filename.c_str());
+		result.images.push_back(image);
+	}
+
+	auto const& texture_descriptions = getArray(&document, "textures");
+	for (auto const& description : getArray(&document, "materials")) {
+		material_record material;
+		material.name = getString(&description, "name");
+		auto const pbr = description.find("pbrMetallicRoughness");
+		auto const base_colour = getFloats<4>(pbr, "baseColorFactor", {{ 1.0f, 1.0f, 1.0f, 1.0f }});
+		auto const metallic = glm::clamp(static_cast<float>(getNumber(pbr, "metallicFactor", 1.0)), 0.0f, 1.0f);
+		auto const roughness = glm::clamp(static_cast<float>(getNumber(pbr, "roughnessFactor", 1.0)), 0.0f, 1.0f);
+		auto const emissive = getFloats<3>(&description, "emissiveFactor", {{ 0.0f, 0.0f, 0.0f }});
+
+		// Approximate the metallic-roughness model with the Blinn-Phong
+		// one of `material_data`: metals tint their specular reflection,
+		// and the shininess matches the width of the GGX lobe.
+		auto& constants = material.constants;
+		constants.diffuse = glm::vec3(base_colour[0], base_colour[1], base_colour[2]) * (1.0f - metallic);
+		constants.specular = glm::mix(glm::vec3(0.04f), glm::vec3(base_colour[0], base_colour[1], base_colour[2]), metallic);
+		constants.emissive = glm::vec3(emissive[0], emissive[1], emissive[2]);
+		auto const alpha = std::max(roughness * roughness, 0.03f);
+		constants.shininess = 2.0f / (alpha * alpha) - 2.0f;
+		constants.indexOfRefraction = 1.5f;
+		constants.opacity = getString(&description, "alphaMode") == "BLEND" ? base_colour[3] : 1.0f;
+
+		auto const add_texture = [&](json_value const* texture_info, char const* binding_name){
+			auto const texture = getIndex(texture_info, "index");
+			if (texture < 0 || static_cast<std::size_t>(texture) >= texture_descriptions.size())
+				return;
+			auto const source = getIndex(&texture_descriptions[static_cast<std::size_t>(texture)], "source");
+			if (source < 0 || static_cast<std::size_t>(source) >= result.images.size() || result.images[static_cast<std::size_t>(source)].data == nullptr)
+				return;
+			if (getIndex(texture_info, "texCoord") > 0)
+				LogWarning("Material \"%s\" samples %s with a second set of texture coordinates, which is not supported.",
+				           material.name.c_str(), binding_name);
+			material.textures.emplace_back(binding_name, static_cast<std::uint32_t>(source));
+		};
+		add_texture(pbr != nullptr ? pbr->find("baseColorTexture") : nullptr, "diffuse_texture");
+		add_texture(description.find("normalTexture"), "normals_texture");
+
+		result.materials.push_back(std::move(material));
+	}
+
+	// Primitives; binormals are generated for those with tangents once all
+	// have been validated.
+	struct binormal_job {
+		source_accessor normals;
+		source_accessor tangents;
+		std::size_t primitive;
+	};
+	std::vector<binormal_job> binormal_jobs;
+	std::vector<source_accessor> index_sources;
+	auto const& mesh_descriptions = getArray(&document, "meshes");
+	for (std::size_t m = 0u; m < mesh_descriptions.size(); ++m) {
+		auto const& mesh_description = mesh_descriptions[m];
+		auto mesh_name = getString(&mesh_description, "name");
+		if (mesh_name.empty())
+			mesh_name = "mesh " + std::to_string(m);
+		auto const& primitive_descriptions = getArray(&mesh_description, "primitives");
+		for (std::size_t p = 0u; p < primitive_descriptions.size(); ++p) {
+			auto const& description = primitive_descriptions[p];
+			auto const name = primitive_descriptions.size() > 1u ? mesh_name + " #" + std::to_string(p) : mesh_name;
+			auto const attributes = description.find("attributes");
+			auto const mode = getIndex(&description, "mode");
+			auto const fail = [&name](char const* reason){
+				LogError("Unsupported primitive \"%s\": %s", name.c_str(), reason);
+			};
+			if (mode > 6) {
+				fail("unknown drawing mode");
+				continue;
+			}
+
+			source_accessor positions, normals, texcoords, tangents, indices;
+			if (!get_accessor(getIndex(attributes, "POSITION"), positions)
+			 || positions.components_nb != 3 || positions.component_type != GL_FLOAT) {
+				fail("positions are missing, invalid, or not made of three floats");
+				continue;
+			}
+			auto const has_normals = getIndex(attributes, "NORMAL") >= 0;
+			auto const has_texcoords = getIndex(attributes, "TEXCOORD_0") >= 0;
+			auto const has_tangents = getIndex(attributes, "TANGENT") >= 0;
+			auto const has_indices = getIndex(&description, "indices") >= 0;
+			if (has_normals && (!get_accessor(getIndex(attributes, "NORMAL"), normals)
+			                    || normals.components_nb != 3 || normals.component_type != GL_FLOAT
+			                    || normals.count != positions.count)) {
+				fail("invalid normals");
+				continue;
+			}
+			if (has_texcoords && (!get_accessor(getIndex(attributes, "TEXCOORD_0"), texcoords) || texcoords.components_nb != 2
+			                      || texcoords.count != positions.count
+			                      || (texcoords.component_type != GL_FLOAT
+			                          && !((texcoords.component_type == GL_UNSIGNED_BYTE || texcoords.component_type == GL_UNSIGNED_SHORT)
+			                               && texcoords.is_normalised)))) {
+				fail("invalid texture coordinates");
+				continue;
+			}
+			if (has_tangents && (!get_accessor(getIndex(attributes, "TANGENT"), tangents)
+			                     || tangents.components_nb != 4 || tangents.component_type != GL_FLOAT
+			                     || tangents.count != positions.count)) {
+				fail("invalid tangents");
+				continue;
+			}
+			if (has_indices && (!get_accessor(getIndex(&description, "indices"), indices) || indices.components_nb != 1
+			                    || (indices.component_type != GL_UNSIGNED_BYTE && indices.component_type != GL_UNSIGNED_SHORT
+			                        && indices.component_type != GL_UNSIGNED_INT)
+			                    || indices.stride != getComponentSize(indices.component_type))) {
+				fail("invalid indices");
+				continue;
+			}
+
+			primitive_record primitive;
+			primitive.name = name;
+			primitive.drawing_mode = mode < 0 ? GL_TRIANGLES : static_cast<GLenum>(mode);
+			primitive.vertices_nb = positions.count;
+			auto const material = getIndex(&description, "material");
+			primitive.material_id = material >= 0 && static_cast<std::size_t>(material) < result.materials.size()
+			                      ? static_cast<std::int32_t>(material) : -1;
+
+			// Positions must come with their bounds, but compute them if
+			// they do not.
+			auto const min = getFloats<3>(positions.description, "min", {{ 0.0f, 0.0f, 0.0f }});
+			auto const max = getFloats<3>(positions.description, "max", {{ 0.0f, 0.0f, 0.0f }});
+			if (positions.description->find("min") != nullptr && positions.description->find("max") != nullptr) {
+				primitive.bounding_box.min = glm::vec3(min[0], min[1], min[2]);
+				primitive.bounding_box.max = glm::vec3(max[0], max[1], max[2]);
+			} else {
+				std::vector<glm::vec3> copied(positions.count);
+				for (std::uint32_t v = 0u; v < positions.count; ++v)
+					std::memcpy(&copied[v], positions.data + v * positions.stride, sizeof(glm::vec3));
+				bounds::sphere sphere;
+				bounds::compute(copied.data(), sizeof(glm::vec3), copied.size(), primitive.bounding_box, sphere);
+			}
+
+			primitive.attributes[static_cast<std::size_t>(shader_bindings::vertices)] = make_record(positions, false);
+			if (has_normals)
+				primitive.attributes[static_cast<std::size_t>(shader_bindings::normals)] = make_record(normals, false);
+			if (has_texcoords)
+				primitive.attributes[static_cast<std::size_t>(shader_bindings::texcoords)] = make_record(texcoords, false);
+			if (has_tangents)
+				primitive.attributes[static_cast<std::size_t>(shader_bindings::tangents)] = make_record(tangents, false);
+			if (has_indices)
+				primitive.indices = make_record(indices, true);
+			if (has_normals && has_tangents)
+				binormal_jobs.push_back({ normals, tangents, result.primitives.size() });
+
+			index_sources.push_back(indices);
+			result.primitives.push_back(std::move(primitive));
+		}
+	}
+
+	// Check indices against vertex counts, and derive binormals from
+	// normals and tangents, spreading both over the worker pool.
+	std::vector<std::uint8_t> are_indices_valid(result.primitives.size(), 1u);
+	utils::parallel::for_each_index(result.primitives.size(), [&](std::size_t j){
+		auto const& indices = index_sources[j];
+		if (indices.data == nullptr)
+			return;
+		std::uint32_t max_index = 0u;
+		for (std::uint32_t i = 0u; i < indices.count; ++i) {
+			std::uint32_t index = 0u;
+			switch (indices.component_type) {
+			case GL_UNSIGNED_BYTE:
+				index = indices.data[i];
+				break;
+			case GL_UNSIGNED_SHORT: {
+				std::uint16_t value;
+				std::memcpy(&value, indices.data + 2u * i, sizeof(value));
+				index = value;
+				break;
+			}
+			default:
+				std::memcpy(&index, indices.data + 4u * i, sizeof(index));
+				break;
+			}
+			max_index = std::max(max_index, index);
+		}
+		are_indices_valid[j] = max_index < result.primitives[j].vertices_nb ? 1u : 0u;
+	});
+
+	std::vector<std::vector<std::uint8_t>> binormals(binormal_jobs.size());
+	utils::parallel::for_each_index(binormal_jobs.size(), [&](std::size_t k){
+		auto const& job = binormal_jobs[k];
+		auto& data = binormals[k];
+		data.resize(static_cast<std::size_t>(job.normals.count) * sizeof(glm::vec3));
+		for (std::uint32_t v = 0u; v < job.normals.count; ++v) {
+			glm::vec3 normal;
+			glm::vec4 tangent;
+			std::memcpy(&normal, job.normals.data + v * job.normals.stride, sizeof(normal));
+			std::memcpy(&tangent, job.tangents.data + v * job.tangents.stride, sizeof(tangent));
+			auto const binormal = glm::cross(normal, glm::vec3(tangent)) * (tangent.w < 0.0f ? -1.0f : 1.0f);
+			std::memcpy(data.data() + v * sizeof(glm::vec3), &binormal, sizeof(binormal));
+		}
+	});
+	for (std::size_t k = 0u; k < binormal_jobs.size(); ++k) {
+		result.owned_data.push_back(std::move(binormals[k]));
+		auto const& data = result.owned_data.back();
+		auto const offset = (result.upload_size + upload_alignment - 1u) / upload_alignment * upload_alignment;
+		result.uploads.push_back({ data.data(), data.size(), offset, false });
+		result.upload_size = offset + data.size();
+
+		auto& record = result.primitives[binormal_jobs[k].primitive].attributes[static_cast<std::size_t>(shader_bindings::binormals)];
+		record.offset = offset;
+		record.components_nb = 3;
+		record.component_type = GL_FLOAT;
+		record.count = binormal_jobs[k].normals.count;
+	}
+
+	std::vector<primitive_record> primitives;
+	for (std::size_t j = 0u; j < result.primitives.size(); ++j) {
+		if (!are_indices_valid[j]) {
+			LogError("Unsupported primitive \"%s\": indices refer to missing vertices", result.primitives[j].name.c_str());
+			continue;
+		}
+		primitives.push_back(std::move(result.primitives[j]));
+	}
+	result.primitives = std::move(primitives);
+
+	if (result.primitives.empty()) {
+		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
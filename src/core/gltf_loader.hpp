@@ -0,0 +1,113 @@
+#pragma once
+
+#include "core/bounds.hpp"
+#include "core/helpers.hpp"
+#include "core/vfs.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Loader for glTF 2.0 files, binary (.glb) or not (.gltf),
+	//!        laying vertex and index data out so that it can be copied
+	//!        as is into a single buffer object.
+	//!
+	//! Rather than converting attributes, the buffer views used by meshes
+	//! are uploaded straight from the mapped file, and each primitive's
+	//! vertex array points into them with the layout described by its
+	//! accessors, interleaved or not. The only data created is a binormal
+	//! stream for primitives with tangents, as glTF only stores their
+	//! handedness.
+	//!
+	//! Like the Assimp path of `loadObjects()`, every primitive of every
+	//! mesh is loaded once, in model space: scenes, nodes and their
+	//! transforms are ignored. Skins, morph targets, sparse accessors and
+	//! quantised attributes are not supported, nor are images other than
+	//! PNG and JPEG ones (such as KTX2).
+	//!
+	//! Nothing here issues OpenGL commands nor decodes images: see
+	//! `load_options::use_gltf_loader` for the rest.
+	namespace gltf_loader
+	{
+		//! \brief Whether a scene file is a glTF file, judging by its
+		//!        extension.
+		bool isGltfFile(std::string const& filename);
+
+		//! \brief How a vertex attribute, or indices, are laid out in the
+		//!        uploaded buffer; see `glVertexAttribPointer()`.
+		struct accessor_record {
+			std::size_t offset{ 0u };           //!< offset in bytes into the uploaded buffer
+			GLint components_nb{ 0 };           //!< 0 if the attribute is absent
+			GLenum component_type{ GL_FLOAT };
+			GLboolean is_normalised{ GL_FALSE };
+			GLsizei stride{ 0 };                //!< 0 if tightly packed
+			std::uint32_t count{ 0u };
+		};
+
+		struct primitive_record {
+			std::string name;
+			GLenum drawing_mode{ GL_TRIANGLES };
+			std::array<accessor_record, 5> attributes{}; //!< in the order of `shader_bindings`
+			accessor_record indices{};                   //!< with a count of 0 if the primitive is not indexed
+			std::uint32_t vertices_nb{ 0u };
+			bounds::box bounding_box{};
+			std::int32_t material_id{ -1 };              //!< -1 if the primitive uses the default material
+		};
+
+		struct material_record {
+			std::string name;
+			material_data constants{};
+			//! GLSL sampler name, such as "diffuse_texture", and index of
+			//! the image to bind to it
+			std::vector<std::pair<std::string, std::uint32_t>> textures;
+		};
+
+		//! \brief Encoded image, pointing into the file or into data owned
+		//!        by the asset.
+		struct image_record {
+			std::uint8_t const* data{ nullptr };
+			std::size_t size{ 0u };
+		};
+
+		//! \brief Range of bytes to copy into the uploaded buffer.
+		struct upload_range {
+			std::uint8_t const* data{ nullptr };
+			std::size_t size{ 0u };
+			std::size_t offset{ 0u };  //!< destination, in bytes
+			bool is_index_data{ false };
+		};
+
+		struct asset {
+			std::vector<upload_range> uploads;
+			std::size_t upload_size{ 0u };
+			std::vector<primitive_record> primitives;
+			std::vector<material_record> materials;
+			std::vector<image_record> images;
+
+			// Storage the ranges and images point into.
+			utils::vfs::file_view file;
+			std::vector<utils::vfs::file_view> external_files;
+			std::vector<std::vector<std::uint8_t>> owned_data;
+		};
+
+		//! \brief Read and validate a glTF file.
+		//!
+		//! Accessors get checked against their buffer views, and indices
+		//! against the number of vertices, so that nothing uploaded can be
+		//! read out of bounds. Primitives that fail validation are skipped
+		//! with an error.
+		//!
+		//! @param [in] filename path to the file, read through the virtual
+		//!             file system, as are the buffers and images it
+		//!             references
+		//! @param [out] result the asset read
+		//! @return whether the file could be read and contained at least
+		//!         one valid primitive
+		bool load(std::string const& filename, asset& result);
+	}
+}
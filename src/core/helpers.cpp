@@ -2,20 +2,48 @@
 #include "helpers.hpp"
 
 #include "core/Log.h"
+#include "core/cubemap_conversion.hpp"
+#include "core/mapped_file.hpp"
+#include "core/gltf_loader.hpp"
+#include "core/mesh_cache.hpp"
+#include "core/mesh_optimisation.hpp"
+#include "core/mesh_simplification.hpp"
+#include "core/obj_loader.hpp"
 #include "core/opengl.hpp"
+#include "core/parallel.hpp"
+#include "core/staging_ring.hpp"
+#include "core/texture_compression.hpp"
 #include "core/various.hpp"
+#include "core/vfs.hpp"
 
 #include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 
 namespace
 {
@@ -35,6 +63,17 @@ namespace
 
 	GLuint debug_texture_id{ 0u };
 
+	struct cached_texture {
+		GLuint id;
+		size_t references_nb;
+		size_t bytes;
+	};
+	struct {
+		std::unordered_map<std::string, cached_texture> entries;
+		std::unordered_map<GLuint, std::string> keys;
+		bonobo::texture_cache_statistics statistics;
+	} texture_cache;
+
 	void setupBasisData();
 	void createDebugTexture();
 }
@@ -58,6 +97,7 @@ namespace local
 void
 bonobo::init()
 {
+	staging_ring::init();
 	setupBasisData();
 	createDebugTexture();
 
@@ -81,280 +121,2332 @@ bonobo::deinit()
 
 	glDeleteProgram(local::fullscreen_shader);
 	glDeleteVertexArrays(1, &local::display_vao);
+
+	// Remaining textures belong to the context being destroyed; forget
+	// about them so that they do not get handed out again.
+	texture_cache.entries.clear();
+	texture_cache.keys.clear();
+	texture_cache.statistics.resident_textures = 0u;
+	texture_cache.statistics.resident_bytes = 0u;
+
+	staging_ring::deinit();
+}
+
+namespace
+{
+	//! \brief 8-bit texels, kept in the buffer they were decoded into
+	//!        rather than copied into a container of our own.
+	struct decoded_image {
+		std::unique_ptr<std::uint8_t, void (*)(void*)> pixels{ nullptr, &std::free };
+		size_t pixels_size{ 0u };
+		std::uint32_t width{ 0u };
+		std::uint32_t height{ 0u };
+		std::uint32_t channels_nb{ 4u };
+
+		std::uint8_t const* data() const { return pixels.get(); }
+		size_t size() const { return pixels_size; }
+		bool empty() const { return pixels == nullptr; }
+	};
+
+	//! \brief Number of channels worth keeping for a texture, given how
+	//!        many the source image has and how the texture is sampled.
+	std::uint32_t getStoredChannelsNb(int source_channels_nb, bonobo::texture_role role)
+	{
+		switch (role) {
+		case bonobo::texture_role::opacity:
+			return 1u;
+		case bonobo::texture_role::normals:
+			return 3u;
+		case bonobo::texture_role::diffuse:
+		case bonobo::texture_role::specular:
+		default:
+			return static_cast<std::uint32_t>(glm::clamp(source_channels_nb, 1, 4));
+		}
+	}
+
+	//! \brief Decode an encoded image, such as a PNG or JPEG file, into
+	//!        8-bit texels.
+	//!
+	//! The buffer allocated by stb is adopted as is, so the only copy of
+	//! the texels is the decoded one.
+	//!
+	//! Unlike `getTextureData()`, this does not log nor provide a fallback
+	//! image, so that it can be called from worker threads; the image is
+	//! left empty on failure.
+	//!
+	//! @param [in] role how the texture will be sampled, which decides
+	//!             how many channels are kept when `fit_channels` is set
+	//! @param [in] fit_channels whether to keep only the channels the
+	//!             source and `role` need, rather than always four
+	//! @param [in] destination staging memory to move the texels into,
+	//!             if it has exactly the size of the decoded image, so
+	//!             that the buffer allocated by stb gets released right
+	//!             away and the upload needs no further copy
+	decoded_image decodeTextureData(std::uint8_t const* encoded, size_t encoded_size, bool flip,
+	                                bonobo::texture_role role = bonobo::texture_role::diffuse, bool fit_channels = false,
+	                                bonobo::staging_ring::allocation const* destination = nullptr)
+	{
+		decoded_image image;
+		if (encoded == nullptr || encoded_size > static_cast<size_t>(std::numeric_limits<int>::max()))
+			return image;
+
+		auto channels_nb = 4u;
+		if (fit_channels) {
+			int width = 0, height = 0, source_channels_nb = 0;
+			if (stbi_info_from_memory(encoded, static_cast<int>(encoded_size), &width, &height, &source_channels_nb) == 0)
+				return image;
+			channels_nb = getStoredChannelsNb(source_channels_nb, role);
+		}
+
+		int width = 0, height = 0;
+		stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+		unsigned char* image_data = stbi_load_from_memory(encoded, static_cast<int>(encoded_size),
+		                                                  &width, &height, nullptr, static_cast<int>(channels_nb));
+		if (image_data == nullptr)
+			return image;
+
+		image.pixels = std::unique_ptr<std::uint8_t, void (*)(void*)>(image_data, &stbi_image_free);
+		image.width = static_cast<std::uint32_t>(width);
+		image.height = static_cast<std::uint32_t>(height);
+		image.channels_nb = channels_nb;
+		image.pixels_size = static_cast<size_t>(image.width) * image.height * channels_nb;
+
+		if (destination != nullptr && destination->data != nullptr && destination->size == image.pixels_size) {
+			std::memcpy(destination->data, image_data, image.pixels_size);
+			image.pixels = std::unique_ptr<std::uint8_t, void (*)(void*)>(destination->data, [](void*){});
+		}
+
+		return image;
+	}
+
+	//! \brief Decode an image file, read through the virtual file system,
+	//!        which maps it rather than copying it.
+	decoded_image decodeTextureData(std::string const& filename, bool flip,
+	                                bonobo::texture_role role = bonobo::texture_role::diffuse, bool fit_channels = false,
+	                                bonobo::staging_ring::allocation const* destination = nullptr)
+	{
+		auto const file = utils::vfs::read(filename);
+		return decodeTextureData(file.data(), file.size(), flip, role, fit_channels, destination);
+	}
+
+	//! \brief Small black image used in place of those that could not be
+	//!        loaded.
+	decoded_image getPlaceholderImage()
+	{
+		decoded_image image;
+		image.width = 16u;
+		image.height = 16u;
+		image.channels_nb = 4u;
+		image.pixels_size = static_cast<size_t>(image.width) * image.height * image.channels_nb;
+		image.pixels.reset(static_cast<std::uint8_t*>(std::calloc(image.pixels_size, 1u)));
+		return image;
+	}
+
+	//! \brief Halve an image with a 2×2 box filter, as
+	//!        `glGenerateMipmap()` would; odd dimensions reuse the last
+	//!        row or column.
+	//!
+	//! @return the next mip level, left empty if allocating it failed
+	decoded_image downsampleImage(decoded_image const& source)
+	{
+		decoded_image level;
+		auto const width = std::max(source.width / 2u, 1u);
+		auto const height = std::max(source.height / 2u, 1u);
+		auto const channels_nb = source.channels_nb;
+		level.pixels.reset(static_cast<std::uint8_t*>(std::malloc(static_cast<size_t>(width) * height * channels_nb)));
+		if (level.empty())
+			return level;
+		level.width = width;
+		level.height = height;
+		level.channels_nb = channels_nb;
+		level.pixels_size = static_cast<size_t>(width) * height * channels_nb;
+
+		auto const source_row_size = static_cast<size_t>(source.width) * channels_nb;
+		auto destination = level.pixels.get();
+		for (std::uint32_t y = 0u; y < height; ++y) {
+			auto const row0 = source.data() + std::min(2u * y,      source.height - 1u) * source_row_size;
+			auto const row1 = source.data() + std::min(2u * y + 1u, source.height - 1u) * source_row_size;
+			for (std::uint32_t x = 0u; x < width; ++x) {
+				auto const x0 = std::min(2u * x,      source.width - 1u) * channels_nb;
+				auto const x1 = std::min(2u * x + 1u, source.width - 1u) * channels_nb;
+				for (std::uint32_t c = 0u; c < channels_nb; ++c)
+					*destination++ = static_cast<std::uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2u) / 4u);
+			}
+		}
+
+		return level;
+	}
+
+	std::string getTextureCacheKey(std::string const& filename, bool flip, bool generate_mipmap, bool compress, bonobo::texture_role role)
+	{
+		// The role decides how many channels are stored, so it is part of
+		// the key even for uncompressed textures.
+		auto key = utils::canonicalise_path(filename) + (flip ? "|flipped" : "|") + (generate_mipmap ? "|mipmapped" : "|");
+		key += (compress ? "|compressed-" : "|role-") + std::to_string(static_cast<unsigned int>(role));
+		return key;
+	}
+
+	bonobo::texture_role getTextureRole(std::string const& binding_name)
+	{
+		if (binding_name == "specular_texture")
+			return bonobo::texture_role::specular;
+		if (binding_name == "normals_texture")
+			return bonobo::texture_role::normals;
+		if (binding_name == "opacity_texture")
+			return bonobo::texture_role::opacity;
+		return bonobo::texture_role::diffuse;
+	}
+
+	//! \brief Compressed version of an image, read back from the on-disk
+	//!        cache or created and added to it.
+	//!
+	//! This does not log anything, so that it can be called from worker
+	//! threads.
+	struct compressed_image {
+		bonobo::texture_compression::compressed_texture texture;
+		bool was_cached{ false };
+		bool was_decoded{ true };
+	};
+	compressed_image getCompressedTextureData(std::string const& filename, bonobo::texture_role role, bool generate_mipmap, bool use_worker_pool)
+	{
+		compressed_image image;
+		auto const cache_filename = bonobo::texture_compression::getCacheFilename(filename, role, generate_mipmap);
+		if (!cache_filename.empty() && bonobo::texture_compression::readDDS(cache_filename, image.texture)) {
+			image.was_cached = true;
+			return image;
+		}
+
+		auto const decoded = decodeTextureData(filename, true);
+		if (decoded.empty()) {
+			image.was_decoded = false;
+			return image;
+		}
+		image.texture = bonobo::texture_compression::compress(decoded.data(), decoded.width, decoded.height,
+		                                                      role, generate_mipmap, use_worker_pool);
+		if (!cache_filename.empty())
+			bonobo::texture_compression::writeDDS(cache_filename, image.texture);
+
+		return image;
+	}
+
+	//! \brief Look for a texture in the cache, and add a reference to it
+	//!        if found.
+	//!
+	//! @return the OpenGL name of the cached texture, or 0 if none
+	GLuint acquireCachedTexture(std::string const& key)
+	{
+		auto const entry = texture_cache.entries.find(key);
+		if (entry == texture_cache.entries.end())
+			return 0u;
+
+		++entry->second.references_nb;
+		++texture_cache.statistics.hits;
+		texture_cache.statistics.bytes_saved += entry->second.bytes;
+		return entry->second.id;
+	}
+
+	void insertCachedTexture(std::string const& key, GLuint id, size_t bytes)
+	{
+		texture_cache.entries.emplace(key, cached_texture{ id, 1u, bytes });
+		texture_cache.keys.emplace(id, key);
+		++texture_cache.statistics.misses;
+		++texture_cache.statistics.resident_textures;
+		texture_cache.statistics.resident_bytes += bytes;
+	}
+
+	//! \brief Estimate of the memory used by an uncompressed texture.
+	//!
+	//! Three-channel textures are counted as four, as drivers commonly pad
+	//! RGB8 texels to 32 bits.
+	size_t getTextureSize(std::uint32_t width, std::uint32_t height, std::uint32_t channels_nb, bool generate_mipmap)
+	{
+		auto const texel_size = channels_nb == 3u ? 4u : channels_nb;
+		auto const level0_size = static_cast<size_t>(width) * height * texel_size;
+		// A full mip chain adds roughly a third of the base level.
+		return generate_mipmap ? level0_size + level0_size / 3u : level0_size;
+	}
+
+	//! \brief Number of bytes `glTexImage2D()` reads for an image, with
+	//!        rows aligned to `alignment` bytes.
+	//!
+	//! @return the size, or 0 if `format` or `type` is not handled
+	size_t getImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment)
+	{
+		size_t channels_nb = 0u;
+		switch (format) {
+		case GL_RED: case GL_GREEN: case GL_BLUE: case GL_DEPTH_COMPONENT: case GL_RED_INTEGER:
+			channels_nb = 1u; break;
+		case GL_RG: case GL_RG_INTEGER:
+			channels_nb = 2u; break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+			channels_nb = 3u; break;
+		case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER:
+			channels_nb = 4u; break;
+		default:
+			return 0u;
+		}
+		size_t channel_size = 0u;
+		switch (type) {
+		case GL_UNSIGNED_BYTE: case GL_BYTE:
+			channel_size = 1u; break;
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			channel_size = 2u; break;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+			channel_size = 4u; break;
+		default:
+			return 0u;
+		}
+		if (width <= 0 || height <= 0)
+			return 0u;
+
+		auto const row_size = static_cast<size_t>(width) * channels_nb * channel_size;
+		auto const row_stride = (row_size + alignment - 1u) / alignment * alignment;
+		return row_stride * static_cast<size_t>(height - 1) + row_size;
+	}
+
+	//! \brief How an 8-bit image with a given number of channels gets
+	//!        stored: with as many channels as it has, and swizzled so that
+	//!        shaders can keep sampling `.rgba`; one channel reads as
+	//!        greyscale, and two as greyscale and alpha, as when stb expands
+	//!        them to four channels.
+	struct uncompressed_format {
+		GLint internal_format{ GL_RGBA8 };
+		GLenum format{ GL_RGBA };
+		std::array<GLint, 4> swizzle{ { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA } };
+	};
+	uncompressed_format getUncompressedFormat(std::uint32_t channels_nb)
+	{
+		uncompressed_format result;
+		switch (channels_nb) {
+		case 1u:
+			result.internal_format = GL_R8;
+			result.format = GL_RED;
+			result.swizzle = { { GL_RED, GL_RED, GL_RED, GL_ONE } };
+			break;
+		case 2u:
+			result.internal_format = GL_RG8;
+			result.format = GL_RG;
+			result.swizzle = { { GL_RED, GL_RED, GL_RED, GL_GREEN } };
+			break;
+		case 3u:
+			result.internal_format = GL_RGB8;
+			result.format = GL_RGB;
+			break;
+		}
+		return result;
+	}
+
+	//! \brief Upload an 8-bit image, stored as described by
+	//!        `getUncompressedFormat()`.
+	//!
+	//! @param [in] staging the staging memory the image was decoded
+	//!             into, if any, to copy from directly
+	GLuint uploadTexture2D(decoded_image const& image, bool generate_mipmap,
+	                       bonobo::staging_ring::allocation const* staging = nullptr)
+	{
+		auto const format = getUncompressedFormat(image.channels_nb);
+
+		// Rows of fewer than four channels are not necessarily 4-byte
+		// aligned.
+		auto const row_size = image.width * image.channels_nb;
+		if (row_size % 4u != 0u)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		GLuint texture = 0u;
+		if (staging != nullptr) {
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			bonobo::staging_ring::copyToTexture(*staging, GL_TEXTURE_2D, 0, format.internal_format,
+			                                    static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height),
+			                                    format.format, GL_UNSIGNED_BYTE);
+		} else {
+			texture = bonobo::createTexture(image.width, image.height, GL_TEXTURE_2D, format.internal_format, format.format, GL_UNSIGNED_BYTE,
+			                                reinterpret_cast<GLvoid const*>(image.data()));
+		}
+		if (row_size % 4u != 0u)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (generate_mipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+
+		return texture;
+	}
 }
 
-static std::vector<std::uint8_t>
-getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
+static decoded_image
+getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip,
+               bonobo::texture_role role = bonobo::texture_role::diffuse, bool fit_channels = false)
 {
-	auto const channels_nb = 4u;
-	stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
-	unsigned char* image_data = stbi_load(filename.c_str(), reinterpret_cast<int*>(&width), reinterpret_cast<int*>(&height), nullptr, channels_nb);
-	if (image_data == nullptr) {
+	auto image = decodeTextureData(filename, flip, role, fit_channels);
+	if (image.empty()) {
 		LogWarning("Couldn't load or decode image file %s", filename.c_str());
 
 		// Provide a small empty image instead in case of failure.
-		width = 16;
-		height = 16;
-		return std::vector<unsigned char>(width * height * channels_nb);
+		image = getPlaceholderImage();
 	}
 
-	std::vector<unsigned char> image(width * height * channels_nb);
-	std::memcpy(image.data(), image_data, image.size());
-	stbi_image_free(image_data);
-
+	width = image.width;
+	height = image.height;
 	return image;
 }
 
-std::vector<bonobo::mesh_data>
-bonobo::loadObjects(std::string const& filename)
+namespace
 {
-	auto const scene_start_time = std::chrono::high_resolution_clock::now();
+	//! \brief Assimp stream over a file read through the virtual file
+	//!        system.
+	class vfs_stream : public Assimp::IOStream
+	{
+	public:
+		explicit vfs_stream(utils::vfs::file_view&& file) : _file(std::move(file)) {}
 
-	std::vector<bonobo::mesh_data> objects;
+		size_t Read(void* buffer, size_t size, size_t count) override
+		{
+			if (size == 0u)
+				return 0u;
+			count = std::min(count, (_file.size() - _position) / size);
+			if (count != 0u)
+				std::memcpy(buffer, _file.data() + _position, size * count);
+			_position += size * count;
+			return count;
+		}
 
-	auto const end_of_basedir = filename.rfind("/");
-	auto const parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
-	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
-	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
-		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), importer.GetErrorString());
-		return objects;
+		size_t Write(void const* /*buffer*/, size_t /*size*/, size_t /*count*/) override
+		{
+			return 0u;
+		}
+
+		aiReturn Seek(size_t offset, aiOrigin origin) override
+		{
+			size_t position = offset;
+			if (origin == aiOrigin_CUR)
+				position += _position;
+			else if (origin == aiOrigin_END)
+				position = _file.size() - offset;
+			if (position > _file.size())
+				return aiReturn_FAILURE;
+			_position = position;
+			return aiReturn_SUCCESS;
+		}
+
+		size_t Tell() const override { return _position; }
+		size_t FileSize() const override { return _file.size(); }
+		void Flush() override {}
+
+	private:
+		utils::vfs::file_view _file;
+		size_t _position{ 0u };
+	};
+
+	//! \brief Let Assimp open scene files, and the files they refer to,
+	//!        through the virtual file system, so that scenes can be
+	//!        imported from a packed archive.
+	class vfs_io_system : public Assimp::IOSystem
+	{
+	public:
+		bool Exists(char const* filename) const override
+		{
+			std::uint64_t size = 0u;
+			std::int64_t modification_time = 0;
+			return utils::vfs::get_status(filename, size, modification_time);
+		}
+
+		char getOsSeparator() const override { return '/'; }
+
+		Assimp::IOStream* Open(char const* filename, char const* mode) override
+		{
+			if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr)
+				return nullptr;
+			auto file = utils::vfs::read(filename);
+			if (!file.is_valid())
+				return nullptr;
+			return new vfs_stream(std::move(file));
+		}
+
+		void Close(Assimp::IOStream* stream) override
+		{
+			delete stream;
+		}
+	};
+
+	//! \brief Import a scene file through Assimp, and lay out its meshes
+	//!        the way `bonobo::loadObjects()` uploads them.
+	bool importScene(std::string const& filename, unsigned int import_flags, bonobo::mesh_cache::scene_record& scene)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		Assimp::Importer importer;
+		importer.SetIOHandler(new vfs_io_system()); // the importer takes ownership of it
+		auto const assimp_scene = importer.ReadFile(filename, import_flags);
+		if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
+			LogError("Assimp failed to load \"%s\": %s", filename.c_str(), importer.GetErrorString());
+			return false;
+		}
+
+		if (assimp_scene->mNumMeshes == 0u) {
+			LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
+			return false;
+		}
+
+		std::vector<bool> are_materials_used(assimp_scene->mNumMaterials, false);
+		for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+			auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+			auto const material_id = assimp_object_mesh->mMaterialIndex;
+			if (material_id >= assimp_scene->mNumMaterials)
+				LogError("Mesh \"%s\" has a material index of %u, but only %u materials are present.", assimp_object_mesh->mName.C_Str(), material_id, assimp_scene->mNumMaterials);
+			else
+				are_materials_used[material_id] = true;
+		}
+
+		scene.materials.resize(assimp_scene->mNumMaterials);
+		for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
+			if (!are_materials_used[i])
+				continue;
+
+			auto& record = scene.materials[i];
+			auto& constants = record.constants;
+			auto const material = assimp_scene->mMaterials[i];
+			record.name = material->GetName().C_Str();
+
+			auto const process_texture = [&record,&material](aiTextureType type, std::string const& type_as_str, std::string const& name){
+				if (material->GetTextureCount(type)) {
+					if (material->GetTextureCount(type) > 1)
+						LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material->GetName().C_Str(), type_as_str.c_str());
+					aiString path;
+					material->GetTexture(type, 0, &path);
+					record.textures.push_back({ name, type_as_str, std::string(path.C_Str()) });
+				}
+			};
+
+			aiColor3D color;
+
+			material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
+			constants.diffuse = glm::vec3(color.r, color.g, color.b);
+			material->Get(AI_MATKEY_COLOR_SPECULAR, color);
+			constants.specular = glm::vec3(color.r, color.g, color.b);
+			material->Get(AI_MATKEY_COLOR_AMBIENT, color);
+			constants.ambient = glm::vec3(color.r, color.g, color.b);
+			material->Get(AI_MATKEY_COLOR_EMISSIVE, color);
+			constants.emissive = glm::vec3(color.r, color.g, color.b);
+			material->Get(AI_MATKEY_SHININESS, constants.shininess);
+			material->Get(AI_MATKEY_REFRACTI, constants.indexOfRefraction);
+			material->Get(AI_MATKEY_OPACITY, constants.opacity);
+
+			process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
+			process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
+			process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
+			process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+		}
+
+		scene.meshes.reserve(assimp_scene->mNumMeshes);
+		scene.owned_data.reserve(assimp_scene->mNumMeshes);
+		for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+			auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+
+			if (!assimp_object_mesh->HasFaces()) {
+				LogError("Unsupported mesh \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
+				continue;
+			}
+			if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT | aiPrimitiveType_NGONEncodingFlag))    != 0u
+			 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE | aiPrimitiveType_NGONEncodingFlag))     != 0u
+			 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE | aiPrimitiveType_NGONEncodingFlag)) != 0u) {
+				LogError("Unsupported mesh \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
+				continue;
+			}
+			if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
+				LogError("Unsupported mesh \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
+				continue;
+			}
+			if (!assimp_object_mesh->HasPositions()) {
+				LogError("Unsupported mesh \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
+				continue;
+			}
+
+			bonobo::mesh_cache::mesh_record mesh;
+			mesh.name = assimp_object_mesh->mName.C_Str();
+			mesh.material_id = assimp_object_mesh->mMaterialIndex;
+			mesh.vertices_nb = assimp_object_mesh->mNumVertices;
+
+			std::vector<aiVector3D const*> streams{ assimp_object_mesh->mVertices };
+			mesh.attributes = attribute_bit(bonobo::shader_bindings::vertices);
+			if (assimp_object_mesh->HasNormals()) {
+				streams.push_back(assimp_object_mesh->mNormals);
+				mesh.attributes |= attribute_bit(bonobo::shader_bindings::normals);
+			}
+			if (assimp_object_mesh->HasTextureCoords(0u)) {
+				streams.push_back(assimp_object_mesh->mTextureCoords[0u]);
+				mesh.attributes |= attribute_bit(bonobo::shader_bindings::texcoords);
+			}
+			if (assimp_object_mesh->HasTangentsAndBitangents()) {
+				streams.push_back(assimp_object_mesh->mTangents);
+				streams.push_back(assimp_object_mesh->mBitangents);
+				mesh.attributes |= attribute_bit(bonobo::shader_bindings::tangents)
+				                 | attribute_bit(bonobo::shader_bindings::binormals);
+			}
+
+			auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+			mesh.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
+			mesh.drawing_mode = num_vertices_per_face == 1u ? GL_POINTS
+			                  : num_vertices_per_face == 2u ? GL_LINES
+			                  : GL_TRIANGLES;
+
+			// Vertex streams and indices share a single allocation; the
+			// streams size is a multiple of sizeof(glm::vec3), so the
+			// indices that follow are correctly aligned.
+			auto const stream_size = static_cast<size_t>(mesh.vertices_nb) * sizeof(glm::vec3);
+			mesh.vertex_data_size = stream_size * streams.size();
+			std::vector<std::uint8_t> data(mesh.vertex_data_size + mesh.indices_nb * sizeof(std::uint32_t));
+			for (size_t k = 0u; k < streams.size(); ++k)
+				std::memcpy(data.data() + k * stream_size, streams[k], stream_size);
+
+			auto const object_indices = reinterpret_cast<std::uint32_t*>(data.data() + mesh.vertex_data_size);
+			for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+				auto const& face = assimp_object_mesh->mFaces[i];
+				assert(face.mNumIndices <= 3);
+				object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
+				if (num_vertices_per_face > 1u)
+					object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
+				if (num_vertices_per_face > 2u)
+					object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
+			}
+
+			mesh.vertex_data = data.data();
+			mesh.index_data = object_indices;
+			scene.owned_data.push_back(std::move(data));
+			scene.meshes.push_back(std::move(mesh));
+		}
+
+		return true;
 	}
 
-	if (assimp_scene->mNumMeshes == 0u) {
-		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
-		return objects;
+	//! \brief Merge meshes of a freshly imported scene that share the same
+	//!        material, drawing mode and attributes, and whose bounding
+	//!        boxes are centred in the same cell of a grid of size
+	//!        `cell_size` (any cell if 0).
+	//!
+	//! Merged meshes keep the position of their first member, and the
+	//! streams and indices of their members one after the other; meshes
+	//! without anything to merge with are left as is.
+	void mergeMeshesByMaterial(bonobo::mesh_cache::scene_record& scene, float cell_size)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+		using group_key = std::tuple<std::uint32_t, GLenum, std::uint32_t, int, int, int>;
+
+		auto const get_cell = [cell_size](bonobo::mesh_cache::mesh_record const& mesh){
+			glm::ivec3 cell(0);
+			if (cell_size <= 0.0f || (mesh.attributes & attribute_bit(bonobo::shader_bindings::vertices)) == 0u)
+				return cell;
+			bonobo::bounds::box box;
+			bonobo::bounds::sphere sphere;
+			bonobo::bounds::compute(reinterpret_cast<glm::vec3 const*>(mesh.vertex_data), sizeof(glm::vec3), mesh.vertices_nb, box, sphere);
+			auto const position = glm::min(glm::max(glm::floor(sphere.centre / cell_size), glm::vec3(-1.0e9f)), glm::vec3(1.0e9f));
+			return glm::ivec3(position);
+		};
+
+		// Groups are listed in the order of their first member, and a new
+		// group is started whenever the current one would overflow 32-bit
+		// indices.
+		std::vector<std::vector<size_t>> groups;
+		std::vector<std::uint64_t> groups_vertices_nb, groups_indices_nb;
+		std::map<group_key, size_t> current_groups;
+		for (size_t j = 0u; j < scene.meshes.size(); ++j) {
+			auto const& mesh = scene.meshes[j];
+			assert(mesh.lods.empty());
+			auto const cell = get_cell(mesh);
+			auto const key = std::make_tuple(mesh.material_id, mesh.drawing_mode, mesh.attributes, cell.x, cell.y, cell.z);
+			auto group = current_groups.find(key);
+			if (group == current_groups.end()
+			 || groups_vertices_nb[group->second] + mesh.vertices_nb > std::numeric_limits<std::uint32_t>::max()
+			 || groups_indices_nb[group->second] + mesh.indices_nb > std::numeric_limits<std::uint32_t>::max()) {
+				current_groups[key] = groups.size();
+				groups.emplace_back();
+				groups_vertices_nb.push_back(0u);
+				groups_indices_nb.push_back(0u);
+				group = current_groups.find(key);
+			}
+			groups[group->second].push_back(j);
+			groups_vertices_nb[group->second] += mesh.vertices_nb;
+			groups_indices_nb[group->second] += mesh.indices_nb;
+		}
+		if (groups.size() == scene.meshes.size())
+			return;
+
+		std::vector<bonobo::mesh_cache::mesh_record> meshes;
+		std::vector<std::vector<std::uint8_t>> owned_data;
+		meshes.reserve(groups.size());
+		owned_data.reserve(groups.size());
+		for (size_t g = 0u; g < groups.size(); ++g) {
+			auto const& members = groups[g];
+			if (members.size() == 1u) {
+				meshes.push_back(std::move(scene.meshes[members.front()]));
+				owned_data.push_back(std::move(scene.owned_data[members.front()]));
+				continue;
+			}
+
+			auto const& first = scene.meshes[members.front()];
+			bonobo::mesh_cache::mesh_record mesh;
+			mesh.material_id = first.material_id;
+			mesh.drawing_mode = first.drawing_mode;
+			mesh.attributes = first.attributes;
+			mesh.vertices_nb = static_cast<std::uint32_t>(groups_vertices_nb[g]);
+			mesh.indices_nb = static_cast<std::uint32_t>(groups_indices_nb[g]);
+			auto const& material_name = first.material_id < scene.materials.size() ? scene.materials[first.material_id].name : std::string();
+			mesh.name = (material_name.empty() ? first.name : material_name) + " (" + std::to_string(members.size()) + " merged meshes)";
+
+			size_t streams_nb = 0u;
+			for (auto bits = first.attributes; bits != 0u; bits &= bits - 1u)
+				++streams_nb;
+			auto const stream_size = static_cast<size_t>(mesh.vertices_nb) * sizeof(glm::vec3);
+			mesh.vertex_data_size = stream_size * streams_nb;
+			std::vector<std::uint8_t> data(mesh.vertex_data_size + static_cast<size_t>(mesh.indices_nb) * sizeof(std::uint32_t));
+			auto const indices = reinterpret_cast<std::uint32_t*>(data.data() + mesh.vertex_data_size);
+
+			size_t base_vertex = 0u, first_index = 0u;
+			for (auto const j : members) {
+				auto const& member = scene.meshes[j];
+				auto const member_stream_size = static_cast<size_t>(member.vertices_nb) * sizeof(glm::vec3);
+				for (size_t k = 0u; k < streams_nb; ++k)
+					std::memcpy(data.data() + k * stream_size + base_vertex * sizeof(glm::vec3),
+					            member.vertex_data + k * member_stream_size, member_stream_size);
+				for (std::uint32_t i = 0u; i < member.indices_nb; ++i)
+					indices[first_index + i] = member.index_data[i] + static_cast<std::uint32_t>(base_vertex);
+				base_vertex += member.vertices_nb;
+				first_index += member.indices_nb;
+			}
+
+			mesh.vertex_data = data.data();
+			mesh.index_data = indices;
+			meshes.push_back(std::move(mesh));
+			owned_data.push_back(std::move(data));
+		}
+
+		scene.meshes = std::move(meshes);
+		scene.owned_data = std::move(owned_data);
 	}
 
-	LogInfo("┭ Loading \"%s\"…", filename.c_str());
+	struct vertex_cache_report {
+		bonobo::mesh_optimisation::statistics before;
+		bonobo::mesh_optimisation::statistics after;
+	};
 
-	std::vector<bool> are_materials_used(assimp_scene->mNumMaterials, false);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= assimp_scene->mNumMaterials)
-			LogError("Mesh \"%s\" has a material index of %u, but only %u materials are present.", assimp_object_mesh->mName.C_Str(), material_id, assimp_scene->mNumMaterials);
-		else
-			are_materials_used[material_id] = true;
+	//! \brief Reorder the triangles and vertices of all triangle meshes of
+	//!        a freshly imported scene, see `bonobo::mesh_optimisation`.
+	//!
+	//! Meshes are processed in parallel, and nothing gets logged.
+	//!
+	//! @return for each mesh, the vertex cache statistics before and after
+	std::vector<vertex_cache_report> optimiseMeshes(bonobo::mesh_cache::scene_record& scene)
+	{
+		std::vector<vertex_cache_report> reports(scene.meshes.size());
+		utils::parallel::for_each_index(scene.meshes.size(), [&scene,&reports](size_t j){
+			auto& mesh = scene.meshes[j];
+			auto& data = scene.owned_data[j];
+			assert(data.data() == mesh.vertex_data);
+			if (mesh.drawing_mode != GL_TRIANGLES || mesh.indices_nb % 3u != 0u)
+				return;
+
+			auto const indices = reinterpret_cast<std::uint32_t*>(data.data() + mesh.vertex_data_size);
+			auto const streams = reinterpret_cast<glm::vec3*>(data.data());
+			std::vector<std::uint32_t> remap;
+			bonobo::mesh_optimisation::optimise(indices, mesh.indices_nb, streams, sizeof(glm::vec3), mesh.vertices_nb,
+			                                    remap, reports[j].before, reports[j].after);
+
+			std::vector<glm::vec3> stream;
+			for (auto offset = 0u; offset < mesh.vertex_data_size / sizeof(glm::vec3); offset += mesh.vertices_nb) {
+				stream.assign(streams + offset, streams + offset + mesh.vertices_nb);
+				bonobo::mesh_optimisation::remapVertices(stream, remap);
+				std::copy(stream.begin(), stream.end(), streams + offset);
+			}
+		});
+
+		return reports;
 	}
 
-	auto const materials_start_time = std::chrono::high_resolution_clock::now();
-	std::vector<texture_bindings> materials_bindings(assimp_scene->mNumMaterials);
-	std::vector<material_data> material_constants(assimp_scene->mNumMaterials);
-	uint32_t texture_count = 0u;
-	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		if (!are_materials_used[i])
-			continue;
-
-		auto const material_start_time = std::chrono::high_resolution_clock::now();
-		texture_bindings& bindings = materials_bindings[i];
-		material_data& constants = material_constants[i];
-		auto const material = assimp_scene->mMaterials[i];
-
-		auto const process_texture = [&bindings,&material,i,&parent_folder,&texture_count](aiTextureType type, std::string const& type_as_str, std::string const& name){
-			if (material->GetTextureCount(type)) {
-				auto const texture_start_time = std::chrono::high_resolution_clock::now();
-
-				if (material->GetTextureCount(type) > 1)
-					LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material->GetName().C_Str(), type_as_str.c_str());
-				aiString path;
-				material->GetTexture(type, 0, &path);
-				auto const id = bonobo::loadTexture2D(parent_folder + std::string(path.C_Str()));
-				if (id == 0u) {
-					LogWarning("Failed to load the %s texture for material \"%s\".", type_as_str.c_str(), material->GetName().C_Str());
-					return;
-				}
-				bindings.emplace(name, id);
-				++texture_count;
+	//! \brief Largest error allowed when simplifying a mesh, relative to
+	//!        the diagonal of its bounding box.
+	float const lod_max_relative_error = 0.05f;
+
+	//! \brief Build up to `lods_nb` levels of detail for all triangle
+	//!        meshes of a freshly imported scene, see
+	//!        `bonobo::mesh_simplification`.
+	//!
+	//! Each level is simplified from the previous one, aiming for half of
+	//! its triangles; the chain stops early once a level no longer removes
+	//! at least a tenth of them. The indices of each level are appended
+	//! after those of the mesh in its owned data.
+	//!
+	//! Meshes are processed in parallel, and nothing gets logged.
+	void generateLevelsOfDetail(bonobo::mesh_cache::scene_record& scene, unsigned int lods_nb)
+	{
+		utils::parallel::for_each_index(scene.meshes.size(), [&scene,lods_nb](size_t j){
+			auto& mesh = scene.meshes[j];
+			auto& data = scene.owned_data[j];
+			assert(data.data() == mesh.vertex_data);
+			mesh.lods.clear();
+			if (mesh.drawing_mode != GL_TRIANGLES || mesh.indices_nb % 3u != 0u || mesh.indices_nb == 0u
+			 || (mesh.attributes & bonobo::mesh_cache::attribute_bit(bonobo::shader_bindings::vertices)) == 0u)
+				return;
+
+			// Positions are always the first stream.
+			auto const positions = reinterpret_cast<glm::vec3 const*>(data.data());
+			glm::vec3 min_position(std::numeric_limits<float>::max()), max_position(std::numeric_limits<float>::lowest());
+			for (std::uint32_t v = 0u; v < mesh.vertices_nb; ++v) {
+				min_position = glm::min(min_position, positions[v]);
+				max_position = glm::max(max_position, positions[v]);
+			}
+			auto const max_error = lod_max_relative_error * glm::length(max_position - min_position);
+
+			std::vector<std::vector<std::uint32_t>> levels;
+			std::vector<float> errors;
+			std::vector<std::size_t> clusters;
+			for (unsigned int level = 0u; level < lods_nb; ++level) {
+				auto const source = levels.empty() ? reinterpret_cast<std::uint32_t const*>(data.data() + mesh.vertex_data_size)
+				                                   : levels.back().data();
+				auto const source_nb = levels.empty() ? static_cast<size_t>(mesh.indices_nb) : levels.back().size();
+				float error = 0.0f;
+				auto indices = bonobo::mesh_simplification::simplify(source, source_nb, positions, sizeof(glm::vec3), mesh.vertices_nb,
+				                                                     source_nb / 6u * 3u, max_error, error);
+				if (indices.empty() || indices.size() * 10u > source_nb * 9u)
+					break;
+
+				bonobo::mesh_optimisation::optimiseVertexCache(indices.data(), indices.size(), mesh.vertices_nb,
+				                                               bonobo::mesh_optimisation::default_cache_size, clusters);
+				// Errors of successive simplifications can add up.
+				errors.push_back((errors.empty() ? 0.0f : errors.back()) + error);
+				levels.push_back(std::move(indices));
+			}
 
-				utils::opengl::debug::nameObject(GL_TEXTURE, id, std::string(material->GetName().C_Str()) + " " + type_as_str);
+			auto first_index = static_cast<size_t>(mesh.indices_nb);
+			for (size_t level = 0u; level < levels.size(); ++level) {
+				auto const size = data.size();
+				data.resize(size + levels[level].size() * sizeof(std::uint32_t));
+				std::memcpy(data.data() + size, levels[level].data(), levels[level].size() * sizeof(std::uint32_t));
+				mesh.lods.push_back({ static_cast<std::uint32_t>(first_index), static_cast<std::uint32_t>(levels[level].size()), errors[level] });
+				first_index += levels[level].size();
+			}
+			mesh.vertex_data = data.data();
+			mesh.index_data = reinterpret_cast<std::uint32_t const*>(data.data() + mesh.vertex_data_size);
+		});
+	}
+
+	//! \brief Box and sphere enclosing the positions of a mesh.
+	void computeBounds(bonobo::mesh_cache::mesh_record const& mesh, bonobo::mesh_data& object)
+	{
+		if ((mesh.attributes & bonobo::mesh_cache::attribute_bit(bonobo::shader_bindings::vertices)) == 0u)
+			return;
+		bonobo::bounds::compute(reinterpret_cast<glm::vec3 const*>(mesh.vertex_data), sizeof(glm::vec3), mesh.vertices_nb,
+		                        object.bounding_box, object.bounding_sphere);
+	}
+
+	std::array<bonobo::shader_bindings, 5> const all_bindings = {{
+		bonobo::shader_bindings::vertices, bonobo::shader_bindings::normals,
+		bonobo::shader_bindings::texcoords, bonobo::shader_bindings::tangents,
+		bonobo::shader_bindings::binormals
+	}};
+
+	//! \brief Where each attribute lives within an interleaved vertex.
+	struct vertex_layout {
+		std::uint32_t attributes{ 0u };
+		bool is_compact{ false };
+		std::array<size_t, 5> offsets{};
+		size_t stride{ 0u };
+	};
+
+	vertex_layout getVertexLayout(std::uint32_t attributes, bool is_compact)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		vertex_layout layout;
+		layout.is_compact = is_compact;
+		layout.attributes = attributes;
+		// Binormals are rebuilt from the normals and tangents in the compact
+		// format, so they do not need to be stored.
+		if (is_compact)
+			layout.attributes &= ~attribute_bit(bonobo::shader_bindings::binormals);
+
+		for (auto const binding : all_bindings) {
+			if ((layout.attributes & attribute_bit(binding)) == 0u)
+				continue;
+
+			layout.offsets[static_cast<size_t>(binding)] = layout.stride;
+			if (!is_compact) {
+				layout.stride += sizeof(glm::vec3);
+				continue;
+			}
+			switch (binding) {
+			case bonobo::shader_bindings::vertices: // 3 x snorm16, padded to 4 for alignment
+			case bonobo::shader_bindings::tangents: // octahedral direction and binormal sign as 3 x snorm16, padded to 4
+				layout.stride += 4u * sizeof(std::int16_t);
+				break;
+			case bonobo::shader_bindings::normals:   // octahedral direction as 2 x snorm16
+			case bonobo::shader_bindings::texcoords: // 2 x half-float
+			default:
+				layout.stride += 2u * sizeof(std::int16_t);
+				break;
+			}
+		}
 
-				auto const texture_end_time = std::chrono::high_resolution_clock::now();
-				LogTrivia("│ %s Texture \"%s\" loaded in %.3f ms",
-				          bindings.size() == 1 ? "┌" : "├", path.C_Str(),
-				          std::chrono::duration<float, std::milli>(texture_end_time - texture_start_time).count());
+		return layout;
+	}
+
+	void setupVertexAttributes(vertex_layout const& layout)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		auto const stride = static_cast<GLsizei>(layout.stride);
+		for (auto const binding : all_bindings) {
+			if ((layout.attributes & attribute_bit(binding)) == 0u)
+				continue;
+
+			auto const location = static_cast<unsigned int>(binding);
+			auto const offset = reinterpret_cast<GLvoid const*>(layout.offsets[location]);
+			glEnableVertexAttribArray(location);
+			if (!layout.is_compact) {
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, offset);
+				continue;
+			}
+			switch (binding) {
+			case bonobo::shader_bindings::vertices:
+			case bonobo::shader_bindings::tangents:
+				glVertexAttribPointer(location, 3, GL_SHORT, GL_TRUE, stride, offset);
+				break;
+			case bonobo::shader_bindings::normals:
+				glVertexAttribPointer(location, 2, GL_SHORT, GL_TRUE, stride, offset);
+				break;
+			case bonobo::shader_bindings::texcoords:
+			default:
+				glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, offset);
+				break;
 			}
+		}
+	}
+
+	std::int16_t toSnorm16(float value)
+	{
+		return static_cast<std::int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	//! \brief Map a unit vector onto the [-1, 1]² square, by projecting it
+	//!        onto an octahedron which gets unfolded.
+	glm::vec2 encodeOctahedral(glm::vec3 const& direction)
+	{
+		auto const l1_norm = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		if (l1_norm == 0.0f)
+			return glm::vec2(0.0f);
+
+		auto projected = glm::vec2(direction.x, direction.y) / l1_norm;
+		if (direction.z < 0.0f) {
+			projected = glm::vec2((1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+			                      (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return projected;
+	}
+
+	//! \brief Interleave the attribute streams of a mesh, converting them
+	//!        to the format given by `layout`.
+	//!
+	//! @return the transform from the stored positions back to model space
+	glm::mat4 writeVertices(bonobo::mesh_cache::mesh_record const& mesh, vertex_layout const& layout, std::uint8_t* destination)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		std::array<glm::vec3 const*, 5> streams{};
+		auto source = reinterpret_cast<glm::vec3 const*>(mesh.vertex_data);
+		for (auto const binding : all_bindings) {
+			if ((mesh.attributes & attribute_bit(binding)) == 0u)
+				continue;
+			streams[static_cast<size_t>(binding)] = source;
+			source += mesh.vertices_nb;
+		}
+		auto const positions = streams[static_cast<size_t>(bonobo::shader_bindings::vertices)];
+		auto const normals = streams[static_cast<size_t>(bonobo::shader_bindings::normals)];
+		auto const texcoords = streams[static_cast<size_t>(bonobo::shader_bindings::texcoords)];
+		auto const tangents = streams[static_cast<size_t>(bonobo::shader_bindings::tangents)];
+		auto const binormals = streams[static_cast<size_t>(bonobo::shader_bindings::binormals)];
+
+		auto const copy_to = [&destination,&layout](bonobo::shader_bindings binding, void const* data, size_t size){
+			std::memcpy(destination + layout.offsets[static_cast<size_t>(binding)], data, size);
 		};
 
-		aiColor3D color;
-
-		material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
-		constants.diffuse = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_SPECULAR, color);
-		constants.specular = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-		constants.ambient = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_EMISSIVE, color);
-		constants.emissive = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_SHININESS, constants.shininess);
-		material->Get(AI_MATKEY_REFRACTI, constants.indexOfRefraction);
-		material->Get(AI_MATKEY_OPACITY, constants.opacity);
-
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
-
-		auto const material_end_time = std::chrono::high_resolution_clock::now();
-		LogTrivia("│ %s Material \"%s\" loaded in %.3f ms",
-		          bindings.empty() ? "╺" : "┕", material->GetName().C_Str(),
-		          std::chrono::duration<float, std::milli>(material_end_time - material_start_time).count());
+		if (!layout.is_compact) {
+			for (std::uint32_t v = 0u; v < mesh.vertices_nb; ++v, destination += layout.stride)
+				for (auto const binding : all_bindings)
+					if (streams[static_cast<size_t>(binding)] != nullptr && (layout.attributes & attribute_bit(binding)))
+						copy_to(binding, streams[static_cast<size_t>(binding)] + v, sizeof(glm::vec3));
+			return glm::mat4(1.0f);
+		}
+
+		glm::vec3 min_position(std::numeric_limits<float>::max()), max_position(std::numeric_limits<float>::lowest());
+		for (std::uint32_t v = 0u; positions != nullptr && v < mesh.vertices_nb; ++v) {
+			min_position = glm::min(min_position, positions[v]);
+			max_position = glm::max(max_position, positions[v]);
+		}
+		auto const center = mesh.vertices_nb != 0u && positions != nullptr ? 0.5f * (min_position + max_position) : glm::vec3(0.0f);
+		auto const half_extent = mesh.vertices_nb != 0u && positions != nullptr ? glm::max(0.5f * (max_position - min_position), glm::vec3(std::numeric_limits<float>::min())) : glm::vec3(1.0f);
+
+		for (std::uint32_t v = 0u; v < mesh.vertices_nb; ++v, destination += layout.stride) {
+			if (positions != nullptr) {
+				auto const normalised = (positions[v] - center) / half_extent;
+				std::array<std::int16_t, 4> const packed = { toSnorm16(normalised.x), toSnorm16(normalised.y), toSnorm16(normalised.z), 0 };
+				copy_to(bonobo::shader_bindings::vertices, packed.data(), sizeof(packed));
+			}
+			if (normals != nullptr) {
+				auto const encoded = encodeOctahedral(normals[v]);
+				std::array<std::int16_t, 2> const packed = { toSnorm16(encoded.x), toSnorm16(encoded.y) };
+				copy_to(bonobo::shader_bindings::normals, packed.data(), sizeof(packed));
+			}
+			if (texcoords != nullptr) {
+				std::array<std::uint16_t, 2> const packed = { glm::packHalf1x16(texcoords[v].x), glm::packHalf1x16(texcoords[v].y) };
+				copy_to(bonobo::shader_bindings::texcoords, packed.data(), sizeof(packed));
+			}
+			if (tangents != nullptr) {
+				auto const encoded = encodeOctahedral(tangents[v]);
+				auto const sign = (normals == nullptr || binormals == nullptr
+				                   || glm::dot(glm::cross(normals[v], tangents[v]), binormals[v]) >= 0.0f) ? 1.0f : -1.0f;
+				std::array<std::int16_t, 4> const packed = { toSnorm16(encoded.x), toSnorm16(encoded.y), toSnorm16(sign), 0 };
+				copy_to(bonobo::shader_bindings::tangents, packed.data(), sizeof(packed));
+			}
+		}
+
+		glm::mat4 dequantization(1.0f);
+		dequantization[0][0] = half_extent.x;
+		dequantization[1][1] = half_extent.y;
+		dequantization[2][2] = half_extent.z;
+		dequantization[3] = glm::vec4(center, 1.0f);
+		return dequantization;
 	}
-	auto const materials_end_time = std::chrono::high_resolution_clock::now();
 
-	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
-	objects.reserve(assimp_scene->mNumMeshes);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+	//! \brief Report how the staging ring has been used so far, to help
+	//!        tune its size.
+	void logStagingRingStatistics()
+	{
+		auto const statistics = bonobo::staging_ring::getStatistics();
+		LogTrivia("│ ╺ Staging ring (%.0f MB, %s): %zu copies (%.1f MB), %zu direct uploads, %zu stalls (%.3f ms)",
+		          static_cast<float>(statistics.size) / (1024.0f * 1024.0f),
+		          statistics.is_persistent ? "persistently mapped" : "mapped per allocation",
+		          statistics.copies_nb, static_cast<float>(statistics.copied_bytes) / (1024.0f * 1024.0f),
+		          statistics.direct_uploads_nb, statistics.stalls_nb, statistics.stalled_ms);
+	}
 
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+	//! \brief Have `write` fill in `size` bytes of staging memory, and copy
+	//!        them into `buffer` at `offset`.
+	//!
+	//! The staging ring is used when the data fits in it, and a temporary
+	//! buffer otherwise.
+	template<typename F>
+	void stageBufferData(GLuint buffer, size_t offset, size_t size, F const& write)
+	{
+		if (size == 0u)
+			return;
 
-		if (!assimp_object_mesh->HasFaces()) {
-			LogError("Unsupported mesh \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
-			continue;
+		auto const staging = bonobo::staging_ring::allocate(size);
+		if (staging.data != nullptr) {
+			write(staging.data, size);
+			bonobo::staging_ring::copyToBuffer(staging, buffer, static_cast<GLintptr>(offset));
+			return;
 		}
-		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT | aiPrimitiveType_NGONEncodingFlag))    != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE | aiPrimitiveType_NGONEncodingFlag))     != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE | aiPrimitiveType_NGONEncodingFlag)) != 0u) {
-			LogError("Unsupported mesh \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
-			continue;
+
+		std::vector<std::uint8_t> data(size);
+		write(data.data(), size);
+		bonobo::staging_ring::uploadBuffer(buffer, static_cast<GLintptr>(offset), data.data(), size);
+	}
+
+	//! \brief What calls to `uploadMeshes()` produced, summed up.
+	struct mesh_upload_totals {
+		size_t vertex_bytes{ 0u };
+		size_t index_bytes{ 0u };
+		double vertices_ms{ 0.0 }; //!< laying out vertices and uploading them
+		double indices_ms{ 0.0 };  //!< converting indices and uploading them
+	};
+
+	//! \brief Upload a set of meshes into a single interleaved vertex buffer
+	//!        and a single index buffer, described by a single VAO.
+	//!
+	//! Every vertex gets all the attributes present in at least one of the
+	//! meshes; those a mesh lacks are left zeroed. Indices are stored on
+	//! 16 bits if no mesh has more vertices than what they can address.
+	//! The sizes of both buffers, and the time spent filling them, get
+	//! added to `totals`.
+	std::vector<bonobo::mesh_data> uploadMeshes(bonobo::mesh_cache::mesh_record const* meshes, size_t meshes_nb, bool compact_vertices,
+	                                            std::string const& label, mesh_upload_totals& totals)
+	{
+		std::uint32_t attributes = 0u, max_vertices_nb = 0u;
+		size_t total_vertices_nb = 0u, total_indices_nb = 0u;
+		for (size_t i = 0u; i < meshes_nb; ++i) {
+			attributes |= meshes[i].attributes;
+			max_vertices_nb = std::max(max_vertices_nb, meshes[i].vertices_nb);
+			total_vertices_nb += meshes[i].vertices_nb;
+			total_indices_nb += bonobo::mesh_cache::getStoredIndicesNb(meshes[i]);
 		}
-		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
-			LogError("Unsupported mesh \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
-			continue;
+		auto const layout = getVertexLayout(attributes, compact_vertices);
+		auto const index_type = max_vertices_nb <= 65536u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		auto const index_size = static_cast<size_t>(bonobo::getIndexSize(index_type));
+
+		auto const vertex_data_size = total_vertices_nb * layout.stride;
+		auto const index_data_size = total_indices_nb * index_size;
+
+		GLuint vao = 0u, bo = 0u, ibo = 0u;
+		glGenVertexArrays(1, &vao);
+		assert(vao != 0u);
+		glBindVertexArray(vao);
+
+		glGenBuffers(1, &bo);
+		assert(bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, bo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_data_size), nullptr, GL_STATIC_DRAW);
+
+		setupVertexAttributes(layout);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+		glGenBuffers(1, &ibo);
+		assert(ibo != 0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(index_data_size), nullptr, GL_STATIC_DRAW);
+
+		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, vao, label + " VAO");
+		utils::opengl::debug::nameObject(GL_BUFFER, bo, label + " VBO");
+		utils::opengl::debug::nameObject(GL_BUFFER, ibo, label + " IBO");
+
+		glBindVertexArray(0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+		std::vector<bonobo::mesh_data> objects;
+		objects.reserve(meshes_nb);
+		size_t vertex_offset = 0u, index_offset = 0u;
+		for (size_t i = 0u; i < meshes_nb; ++i) {
+			auto const& mesh = meshes[i];
+
+			bonobo::mesh_data object;
+			if (!mesh.name.empty())
+				object.name = mesh.name;
+			object.drawing_mode = mesh.drawing_mode;
+			object.vertices_nb = static_cast<GLsizei>(mesh.vertices_nb);
+			object.indices_nb = static_cast<GLsizei>(mesh.indices_nb);
+			object.base_vertex = static_cast<GLint>(vertex_offset);
+			object.first_index = static_cast<GLsizei>(index_offset);
+			object.index_type = index_type;
+			object.compact_vertices = compact_vertices;
+			object.vao = vao;
+			object.bo = bo;
+			object.ibo = ibo;
+			computeBounds(mesh, object);
+			for (auto const& lod : mesh.lods)
+				object.lods.push_back({ static_cast<GLsizei>(index_offset + lod.first_index), static_cast<GLsizei>(lod.indices_nb), lod.error });
+
+			// Vertices and indices are written straight into the staging
+			// ring, and copied from there into their buffers.
+			auto const vertices_start_time = std::chrono::high_resolution_clock::now();
+			stageBufferData(bo, vertex_offset * layout.stride, static_cast<size_t>(mesh.vertices_nb) * layout.stride,
+			                [&](std::uint8_t* destination, size_t size){
+				std::memset(destination, 0, size);
+				object.position_dequantization = writeVertices(mesh, layout, destination);
+			});
+
+			auto const vertices_end_time = std::chrono::high_resolution_clock::now();
+			totals.vertices_ms += std::chrono::duration<double, std::milli>(vertices_end_time - vertices_start_time).count();
+
+			// Levels of detail directly follow the indices of the mesh.
+			auto const stored_indices_nb = bonobo::mesh_cache::getStoredIndicesNb(mesh);
+			stageBufferData(ibo, index_offset * index_size, stored_indices_nb * index_size,
+			                [&](std::uint8_t* destination, size_t size){
+				if (index_type == GL_UNSIGNED_SHORT)
+					std::transform(mesh.index_data, mesh.index_data + stored_indices_nb, reinterpret_cast<std::uint16_t*>(destination),
+					               [](std::uint32_t index){ return static_cast<std::uint16_t>(index); });
+				else
+					std::memcpy(destination, mesh.index_data, size);
+			});
+			totals.indices_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - vertices_end_time).count();
+
+			vertex_offset += mesh.vertices_nb;
+			index_offset += stored_indices_nb;
+			objects.push_back(object);
 		}
-		if (!assimp_object_mesh->HasPositions()) {
-			LogError("Unsupported mesh \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
-			continue;
+
+		totals.vertex_bytes += vertex_data_size;
+		totals.index_bytes += index_data_size;
+
+		return objects;
+	}
+
+	//! \brief Read a scene back from the mesh cache, or import it through
+	//!        Assimp and process its meshes as requested by `options`,
+	//!        storing the result in the mesh cache.
+	//!
+	//! This issues no OpenGL commands, so it can run on any thread.
+	//!
+	//! @param [out] vertex_cache_reports statistics of the meshes that got
+	//!              optimised, if any
+	bool prepareScene(std::string const& filename, bonobo::load_options const& options,
+	                  bonobo::mesh_cache::scene_record& scene, std::vector<vertex_cache_report>& vertex_cache_reports,
+	                  bonobo::load_statistics& statistics)
+	{
+		unsigned int const import_flags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace;
+
+		bool const use_obj_loader = options.use_obj_loader && bonobo::obj_loader::isObjFile(filename);
+		auto const importer_name = use_obj_loader ? "the OBJ loader" : "Assimp";
+
+		auto const import_start_time = std::chrono::high_resolution_clock::now();
+		std::uint64_t const cache_flags = import_flags
+		                                | (use_obj_loader ? bonobo::mesh_cache::obj_loader_flag : 0u)
+		                                | (options.optimise_meshes ? bonobo::mesh_cache::optimised_meshes_flag : 0u)
+		                                | bonobo::mesh_cache::lods_flags(options.lods_nb)
+		                                | (options.merge_meshes ? bonobo::mesh_cache::merged_meshes_flags(options.merge_cell_size) : 0u);
+		bool const is_cache_hit = options.use_mesh_cache && !options.rebuild_mesh_cache
+		                       && bonobo::mesh_cache::load(filename, cache_flags, scene);
+		if (!is_cache_hit
+		 && !(use_obj_loader ? bonobo::obj_loader::load(filename, scene) : importScene(filename, import_flags, scene)))
+			return false;
+		auto const import_end_time = std::chrono::high_resolution_clock::now();
+
+		LogInfo("┭ Loading \"%s\"…", filename.c_str());
+
+		auto const import_duration = std::chrono::duration<float, std::milli>(import_end_time - import_start_time).count();
+		statistics.import_ms = std::chrono::duration<double, std::milli>(import_end_time - import_start_time).count();
+		statistics.was_mesh_cache_hit = is_cache_hit;
+
+		// Meshes read back from the cache were already merged and optimised
+		// before being stored.
+		if (!is_cache_hit && options.merge_meshes) {
+			auto const merge_start_time = std::chrono::high_resolution_clock::now();
+			auto const source_meshes_nb = scene.meshes.size();
+			mergeMeshesByMaterial(scene, options.merge_cell_size);
+			auto const merge_end_time = std::chrono::high_resolution_clock::now();
+			statistics.mesh_processing_ms += std::chrono::duration<double, std::milli>(merge_end_time - merge_start_time).count();
+			statistics.merged_meshes_nb = source_meshes_nb - scene.meshes.size();
+			LogTrivia("│ ╺ %zu meshes merged into %zu by material, saving %zu draw calls, in %.3f ms",
+			          source_meshes_nb, scene.meshes.size(), statistics.merged_meshes_nb,
+			          std::chrono::duration<float, std::milli>(merge_end_time - merge_start_time).count());
 		}
 
-		bonobo::mesh_data object;
-		if (assimp_object_mesh->mName.length != 0)
-		{
-			object.name = std::string(assimp_object_mesh->mName.C_Str());
+		vertex_cache_reports.clear();
+		if (!is_cache_hit && options.optimise_meshes) {
+			auto const optimisation_start_time = std::chrono::high_resolution_clock::now();
+			vertex_cache_reports = optimiseMeshes(scene);
+			auto const optimisation_end_time = std::chrono::high_resolution_clock::now();
+			statistics.mesh_processing_ms += std::chrono::duration<double, std::milli>(optimisation_end_time - optimisation_start_time).count();
+			LogTrivia("│ ╺ Meshes optimised for vertex cache, overdraw and vertex fetch in %.3f ms",
+			          std::chrono::duration<float, std::milli>(optimisation_end_time - optimisation_start_time).count());
+		}
+		if (!is_cache_hit && options.lods_nb != 0u) {
+			auto const simplification_start_time = std::chrono::high_resolution_clock::now();
+			generateLevelsOfDetail(scene, options.lods_nb);
+			auto const simplification_end_time = std::chrono::high_resolution_clock::now();
+			statistics.mesh_processing_ms += std::chrono::duration<double, std::milli>(simplification_end_time - simplification_start_time).count();
+			LogTrivia("│ ╺ Up to %u levels of detail generated per mesh in %.3f ms using %u threads",
+			          options.lods_nb,
+			          std::chrono::duration<float, std::milli>(simplification_end_time - simplification_start_time).count(),
+			          utils::parallel::worker_count());
+		}
+
+		if (is_cache_hit) {
+			LogTrivia("│ ╺ Mesh cache hit: \"%s\" mapped in %.3f ms",
+			          bonobo::mesh_cache::getCacheFilename(filename).c_str(), import_duration);
+		} else if (options.use_mesh_cache) {
+			bool const was_stored = bonobo::mesh_cache::store(filename, cache_flags, scene);
+			LogTrivia("│ ╺ Mesh cache %s: imported through %s in %.3f ms%s",
+			          options.rebuild_mesh_cache ? "rebuild" : "miss", importer_name, import_duration,
+			          was_stored ? ", cache entry written" : "");
+		} else {
+			LogTrivia("│ ╺ Imported through %s in %.3f ms", importer_name, import_duration);
+		}
+
+		return true;
+	}
+
+	struct texture_reference {
+		size_t material_id;
+		std::string binding_name;
+		std::string type_as_str;
+	};
+
+	//! \brief Image to decode and upload, shared by all the materials
+	//!        referring to it.
+	struct texture_job {
+		std::string path;
+		std::string cache_key;
+		bonobo::texture_role role;
+		std::vector<texture_reference> references;
+		decoded_image image;
+		compressed_image compressed;
+		std::vector<decoded_image> levels; //!< mip chain of `image`, finest level first, when streaming mip levels
+		bonobo::staging_ring::allocation staging; //!< where `image` gets decoded into, if reserved by `reserveStagingMemory()`
+	};
+
+	//! \brief Textures used by the materials of a scene.
+	struct scene_textures {
+		std::vector<texture_job> jobs; //!< one per image not found in the texture cache
+		std::vector<bonobo::texture_bindings> materials_bindings;
+		bool compress{ false };
+		std::uint32_t loaded_nb{ 0u };
+		std::uint32_t reused_nb{ 0u };
+		size_t uploaded_bytes{ 0u };
+		size_t resident_bytes{ 0u }; //!< estimated memory used by the uploaded textures
+		size_t rgba8_bytes{ 0u };    //!< what they would use, were they all stored as RGBA8
+	};
+
+	//! \brief Report how much memory the textures of a scene use, compared
+	//!        to storing them all as RGBA8.
+	void logTextureMemory(scene_textures const& textures)
+	{
+		LogTrivia("│ ╺ Textures use %.1f MB, %.1f MB if stored as RGBA8",
+		          static_cast<float>(textures.resident_bytes) / (1024.0f * 1024.0f),
+		          static_cast<float>(textures.rgba8_bytes) / (1024.0f * 1024.0f));
+	}
+
+	//! \brief Bind the textures of all materials that are already in the
+	//!        texture cache, and create a job for each remaining image.
+	//!
+	//! This has to run on the thread owning the OpenGL context, as it
+	//! accesses the texture cache.
+	scene_textures gatherTextures(bonobo::mesh_cache::scene_record const& scene, std::string const& parent_folder, bool compress)
+	{
+		scene_textures textures;
+		textures.compress = compress;
+		textures.materials_bindings.resize(scene.materials.size());
+
+		std::unordered_map<std::string, size_t> jobs_by_key;
+		for (size_t i = 0; i < scene.materials.size(); ++i) {
+			for (auto const& texture : scene.materials[i].textures) {
+				auto const path = parent_folder + texture.path;
+				auto const role = getTextureRole(texture.binding_name);
+				auto const cache_key = getTextureCacheKey(path, true, true, compress, role);
+				auto const cached_id = acquireCachedTexture(cache_key);
+				if (cached_id != 0u) {
+					textures.materials_bindings[i].emplace(texture.binding_name, cached_id);
+					++textures.reused_nb;
+					continue;
+				}
+
+				auto const job = jobs_by_key.find(cache_key);
+				if (job != jobs_by_key.end()) {
+					textures.jobs[job->second].references.push_back({ i, texture.binding_name, texture.type_as_str });
+					continue;
+				}
+				jobs_by_key.emplace(cache_key, textures.jobs.size());
+				textures.jobs.push_back({ path, cache_key, role, { { i, texture.binding_name, texture.type_as_str } }, decoded_image(), compressed_image(), {}, bonobo::staging_ring::allocation() });
+			}
+		}
+
+		return textures;
+	}
+
+	//! \brief Reserve staging memory for each image to upload
+	//!        uncompressed, whose decoded size is read from its header,
+	//!        so that its job can decode it straight into the memory the
+	//!        upload copies from.
+	//!
+	//! This is only done when the staging ring is persistently mapped,
+	//! as jobs write to it from worker threads; images that do not fit in
+	//! what is left of the ring get decoded as usual.
+	void reserveStagingMemory(scene_textures& textures)
+	{
+		if (textures.compress || !bonobo::staging_ring::getStatistics().is_persistent)
+			return;
+
+		for (auto& job : textures.jobs) {
+			auto const file = utils::vfs::read(job.path);
+			if (file.data() == nullptr || file.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+				continue;
+			int width = 0, height = 0, source_channels_nb = 0;
+			if (stbi_info_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &source_channels_nb) == 0)
+				continue;
+			auto const size = static_cast<size_t>(width) * static_cast<size_t>(height) * getStoredChannelsNb(source_channels_nb, job.role);
+			job.staging = bonobo::staging_ring::allocate(size);
+		}
+	}
+
+	//! \brief Decode, and compress if requested, the image of a job.
+	//!
+	//! This issues no OpenGL commands nor logs anything, so it can run on
+	//! worker threads; as each job is expected to run on its own worker,
+	//! compression does not use the worker pool.
+	//!
+	//! @param [in] stream whether the mip levels will be streamed, in
+	//!             which case uncompressed images get their mip chain
+	//!             built here, as `glGenerateMipmap()` cannot be used
+	void decodeTexture(texture_job& job, bool compress, bool stream)
+	{
+		if (compress)
+			job.compressed = getCompressedTextureData(job.path, job.role, true, false);
+		else
+			job.image = decodeTextureData(job.path, true, job.role, true, job.staging.data != nullptr ? &job.staging : nullptr);
+
+		if (!stream || !job.compressed.texture.levels.empty() || job.image.empty())
+			return;
+		job.levels.push_back(std::move(job.image));
+		while (job.levels.back().width > 1u || job.levels.back().height > 1u) {
+			auto level = downsampleImage(job.levels.back());
+			if (level.empty()) {
+				job.levels.clear();
+				return;
+			}
+			job.levels.push_back(std::move(level));
 		}
+	}
 
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
+	//! \brief Add a texture just uploaded for a job to the texture cache,
+	//!        and bind it to every material referring to it.
+	//!
+	//! @return `id`, or 0 if the upload failed
+	GLuint addUploadedTexture(texture_job const& job, scene_textures& textures, bonobo::mesh_cache::scene_record const& scene,
+	                          GLuint id, size_t bytes, size_t rgba8_bytes)
+	{
+		auto const& first_reference = job.references.front();
+		auto const& material_name = scene.materials[first_reference.material_id].name;
 
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
+		if (id == 0u) {
+			LogWarning("Failed to load the %s texture for material \"%s\".", first_reference.type_as_str.c_str(), material_name.c_str());
+			return 0u;
+		}
+		insertCachedTexture(job.cache_key, id, bytes);
+		++textures.loaded_nb;
+		textures.resident_bytes += bytes;
+		textures.rgba8_bytes += rgba8_bytes;
+
+		for (size_t k = 0u; k < job.references.size(); ++k) {
+			// The first reference is the one accounted for by the insertion.
+			if (k != 0u) {
+				acquireCachedTexture(job.cache_key);
+				++textures.reused_nb;
+			}
+			textures.materials_bindings[job.references[k].material_id][job.references[k].binding_name] = id;
+		}
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
+		utils::opengl::debug::nameObject(GL_TEXTURE, id, material_name + " " + first_reference.type_as_str);
 
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
+		return id;
+	}
 
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	//! \brief Upload the image decoded by a job, add it to the texture
+	//!        cache, and bind it to every material referring to it.
+	//!
+	//! The decoded data is released afterwards.
+	//!
+	//! @return the OpenGL name of the texture, or 0 on failure
+	GLuint uploadTexture(texture_job& job, scene_textures& textures, bonobo::mesh_cache::scene_record const& scene)
+	{
+		GLuint id = 0u;
+		size_t bytes = 0u, rgba8_bytes = 0u;
+		if (!job.compressed.texture.levels.empty()) {
+			id = bonobo::texture_compression::upload(job.compressed.texture, job.role);
+			bytes = job.compressed.texture.data.size();
+			textures.uploaded_bytes += bytes;
+			auto const& level0 = job.compressed.texture.levels.front();
+			rgba8_bytes = getTextureSize(level0.width, level0.height, 4u, job.compressed.texture.levels.size() > 1u);
+		} else {
+			if (job.image.empty()) {
+				LogWarning("Couldn't load or decode image file %s", job.path.c_str());
+
+				// Provide a small empty image instead in case of failure.
+				job.image = getPlaceholderImage();
+			}
+			bool const is_staged = job.staging.data != nullptr && job.image.data() == job.staging.data;
+			id = uploadTexture2D(job.image, true, is_staged ? &job.staging : nullptr);
+			if (!is_staged)
+				bonobo::staging_ring::discard(job.staging);
+			bytes = getTextureSize(job.image.width, job.image.height, job.image.channels_nb, true);
+			textures.uploaded_bytes += job.image.size();
+			rgba8_bytes = getTextureSize(job.image.width, job.image.height, 4u, true);
+		}
+		job.image = decoded_image();
+		job.compressed = compressed_image();
+		job.staging = bonobo::staging_ring::allocation();
 
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+		return addUploadedTexture(job, textures, scene, id, bytes, rgba8_bytes);
+	}
 
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
+	//! \brief Texture of an `async_scene` whose mip levels get uploaded
+	//!        coarsest first, see `bonobo::load_options::stream_texture_mips`.
+	struct streamed_texture {
+		size_t job_index{ 0u };
+		GLuint id{ 0u };
+		GLint base_level{ 0 }; //!< finest level uploaded so far
+		float priority{ 0.0f };
+	};
 
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	//! \brief Levels up to that size are uploaded as soon as a streamed
+	//!        texture is created, so that it can replace its placeholder
+	//!        right away.
+	constexpr std::uint32_t streamed_texture_initial_size = 64u;
 
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
+	//! \brief Upload a mip level of a streamed texture, which has to be
+	//!        bound to GL_TEXTURE_2D, and make it the base level.
+	//!
+	//! @return the number of bytes uploaded
+	size_t uploadStreamedLevel(texture_job const& job, GLint level)
+	{
+		// With immutable storage, all levels were allocated along with the
+		// texture and only need to be filled in; otherwise each level gets
+		// specified as it arrives, and the levels below the base one are
+		// ignored when checking the texture for completeness.
+		bool const has_immutable_storage = GLAD_GL_VERSION_4_2 != 0;
+		size_t bytes = 0u;
+		if (!job.compressed.texture.levels.empty()) {
+			auto const& texture = job.compressed.texture;
+			auto const& info = texture.levels[static_cast<size_t>(level)];
+			if (has_immutable_storage)
+				bonobo::staging_ring::uploadCompressedTextureSubImage(GL_TEXTURE_2D, level, 0, 0,
+				                                                      static_cast<GLsizei>(info.width), static_cast<GLsizei>(info.height),
+				                                                      texture.internal_format, texture.data.data() + info.offset, info.size);
+			else
+				bonobo::staging_ring::uploadCompressedTexture(GL_TEXTURE_2D, level, texture.internal_format,
+				                                              static_cast<GLsizei>(info.width), static_cast<GLsizei>(info.height),
+				                                              texture.data.data() + info.offset, info.size);
+			bytes = info.size;
+		} else {
+			auto const& image = job.levels[static_cast<size_t>(level)];
+			auto const format = getUncompressedFormat(image.channels_nb);
+			auto const row_size = image.width * image.channels_nb;
+			if (row_size % 4u != 0u)
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			if (has_immutable_storage)
+				bonobo::staging_ring::uploadTextureSubImage(GL_TEXTURE_2D, level, 0, 0,
+				                                            static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height),
+				                                            format.format, GL_UNSIGNED_BYTE, image.data(), image.size());
+			else
+				bonobo::staging_ring::uploadTexture(GL_TEXTURE_2D, level, format.internal_format,
+				                                    static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height),
+				                                    format.format, GL_UNSIGNED_BYTE, image.data(), image.size());
+			if (row_size % 4u != 0u)
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			bytes = image.size();
 		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+		return bytes;
+	}
+
+	//! \brief Create the texture of a job with storage for its whole mip
+	//!        chain, but only upload its coarsest levels, then add it to
+	//!        the texture cache and bind it to every material referring to
+	//!        it, as `uploadTexture()` does.
+	//!
+	//! The finer levels are then uploaded by `uploadStreamedLevel()`, and
+	//! the decoded data is only released once all of them are.
+	//!
+	//! @param [out] texture the texture created, with the finest level
+	//!              uploaded so far as its base level
+	//! @return the OpenGL name of the texture, or 0 on failure
+	GLuint createStreamedTexture(texture_job& job, scene_textures& textures, bonobo::mesh_cache::scene_record const& scene,
+	                             streamed_texture& texture)
+	{
+		if (job.compressed.texture.levels.empty() && job.levels.empty()) {
+			LogWarning("Couldn't load or decode image file %s", job.path.c_str());
 
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+			// Provide a small empty image instead in case of failure.
+			job.levels.push_back(getPlaceholderImage());
 		}
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
+		bool const is_compressed = !job.compressed.texture.levels.empty();
+		auto const levels_nb = is_compressed ? job.compressed.texture.levels.size() : job.levels.size();
+		auto const width = is_compressed ? job.compressed.texture.levels.front().width : job.levels.front().width;
+		auto const height = is_compressed ? job.compressed.texture.levels.front().height : job.levels.front().height;
+
+		glGenTextures(1, &texture.id);
+		assert(texture.id != 0u);
+		glBindTexture(GL_TEXTURE_2D, texture.id);
+		GLenum internal_format = job.compressed.texture.internal_format;
+		if (is_compressed) {
+			if (job.role == bonobo::texture_role::opacity) {
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ALPHA);
+			} else if (internal_format == GL_COMPRESSED_RG_RGTC2) {
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+			}
+		} else {
+			auto const format = getUncompressedFormat(job.levels.front().channels_nb);
+			internal_format = static_cast<GLenum>(format.internal_format);
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle.data());
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels_nb - 1u));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels_nb > 1u ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (GLAD_GL_VERSION_4_2 != 0)
+			glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(levels_nb), internal_format,
+			               static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+
+		// The coarsest level always gets uploaded, however large it is.
+		texture.base_level = static_cast<GLint>(levels_nb);
+		do {
+			textures.uploaded_bytes += uploadStreamedLevel(job, --texture.base_level);
+		} while (texture.base_level > 0
+		         && std::max(width >> (texture.base_level - 1), height >> (texture.base_level - 1)) <= streamed_texture_initial_size);
+		glBindTexture(GL_TEXTURE_2D, 0u);
 
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
+		size_t bytes = 0u, rgba8_bytes = 0u;
+		if (is_compressed) {
+			bytes = job.compressed.texture.data.size();
+			rgba8_bytes = getTextureSize(width, height, 4u, levels_nb > 1u);
+		} else {
+			bytes = getTextureSize(width, height, job.levels.front().channels_nb, levels_nb > 1u);
+			rgba8_bytes = getTextureSize(width, height, 4u, levels_nb > 1u);
 		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		return addUploadedTexture(job, textures, scene, texture.id, bytes, rgba8_bytes);
+	}
 
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face > 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face > 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
-		glGenBuffers(1, &object.ibo);
-		assert(object.ibo != 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
-
-		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, object.name + " VAO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.bo, object.name + " VBO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.ibo, object.name + " IBO");
+	//! \brief Upload all meshes of a scene, as requested by `options`,
+	//!        and give them the textures and constants of their material.
+	std::vector<bonobo::mesh_data> uploadSceneMeshes(bonobo::mesh_cache::scene_record const& scene, bonobo::load_options const& options,
+	                                                 std::string const& label, std::vector<bonobo::texture_bindings> const& materials_bindings,
+	                                                 std::vector<vertex_cache_report> const& vertex_cache_reports,
+	                                                 mesh_upload_totals& totals)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		std::vector<bonobo::mesh_data> objects;
+
+		auto const meshes_start_time = std::chrono::high_resolution_clock::now();
+		if (options.pack_meshes) {
+			objects = uploadMeshes(scene.meshes.data(), scene.meshes.size(), options.compact_vertices,
+			                       label + " packed", totals);
+			LogTrivia("│ ╺ %zu meshes packed into shared buffers (%.1f MB) in %.3f ms",
+			          objects.size(), static_cast<float>(totals.vertex_bytes + totals.index_bytes) / (1024.0f * 1024.0f),
+			          std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - meshes_start_time).count());
+		} else {
+			objects.reserve(scene.meshes.size());
+		}
+		for (size_t j = 0; j < scene.meshes.size(); ++j) {
+			auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+
+			auto const& mesh = scene.meshes[j];
+			if (!options.pack_meshes) {
+				auto const mesh_objects = uploadMeshes(&mesh, 1u, options.compact_vertices,
+				                                       mesh.name.empty() ? std::string("un-named mesh") : mesh.name,
+				                                       totals);
+				objects.push_back(mesh_objects.front());
+			}
+			auto& object = objects[j];
 
-		glBindVertexArray(0u);
+			auto const material_id = mesh.material_id;
+			if (material_id < materials_bindings.size()) {
+				object.bindings = materials_bindings[material_id];
+				object.material = scene.materials[material_id].constants;
+			}
+
+			auto const mesh_end_time = std::chrono::high_resolution_clock::now();
+
+			std::string attributes = (mesh.attributes & attribute_bit(bonobo::shader_bindings::normals)) ? "normals" : "";
+			if (!attributes.empty())
+			  attributes += " | ";
+			if (mesh.attributes & attribute_bit(bonobo::shader_bindings::tangents))
+			  attributes += "tangents&bitangents";
+			if (!attributes.empty())
+			  attributes += " | ";
+			if (mesh.attributes & attribute_bit(bonobo::shader_bindings::texcoords))
+			  attributes += "texture coordinates";
+			std::string vertex_cache;
+			if (!vertex_cache_reports.empty() && vertex_cache_reports[j].after.acmr > 0.0f) {
+				auto const& report = vertex_cache_reports[j];
+				char buffer[96];
+				std::snprintf(buffer, sizeof(buffer), ", ACMR %.3f → %.3f, ATVR %.3f → %.3f",
+				              report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+				vertex_cache = buffer;
+			}
+			std::string levels_of_detail;
+			if (!mesh.lods.empty()) {
+				levels_of_detail = ", triangles per level of detail " + std::to_string(mesh.indices_nb / 3u);
+				for (auto const& lod : mesh.lods)
+					levels_of_detail += " → " + std::to_string(lod.indices_nb / 3u);
+			}
+			LogTrivia("│ %s Mesh \"%s\" loaded with attributes [%s] in %.3f ms%s%s",
+			          (scene.meshes.size() == 1u) ? "╶" : (j == 0 ? "┌" : (j == scene.meshes.size() - 1 ? "└" : "├")),
+			          mesh.name.c_str(), attributes.c_str(),
+			          std::chrono::duration<float, std::milli>(mesh_end_time - mesh_start_time).count(),
+			          vertex_cache.c_str(), levels_of_detail.c_str());
+		}
+
+		size_t vertices_nb = 0u, uncompressed_vertex_bytes = 0u, uncompressed_index_bytes = 0u;
+		for (auto const& mesh : scene.meshes) {
+			vertices_nb += mesh.vertices_nb;
+			uncompressed_vertex_bytes += mesh.vertex_data_size;
+			uncompressed_index_bytes += bonobo::mesh_cache::getStoredIndicesNb(mesh) * sizeof(std::uint32_t);
+		}
+		if (vertices_nb != 0u) {
+			LogTrivia("│ ╺ %.1f bytes per vertex (%.1f as float streams), %.1f MB of indices (%.1f MB as 32-bit indices)",
+			          static_cast<float>(totals.vertex_bytes) / static_cast<float>(vertices_nb),
+			          static_cast<float>(uncompressed_vertex_bytes) / static_cast<float>(vertices_nb),
+			          static_cast<float>(totals.index_bytes) / (1024.0f * 1024.0f),
+			          static_cast<float>(uncompressed_index_bytes) / (1024.0f * 1024.0f));
+		}
+
+		return objects;
+	}
+
+	//! \brief Load a glTF file, see `bonobo::load_options::use_gltf_loader`.
+	//!
+	//! The buffer views used by primitives are copied as is from the
+	//! mapped file into a single buffer object, through the staging ring,
+	//! and each primitive gets a VAO pointing into it. Images are decoded
+	//! over the worker pool, and go through the texture cache.
+	std::vector<bonobo::mesh_data> loadGLTF(std::string const& filename, bonobo::load_statistics& phases)
+	{
+		using milliseconds = std::chrono::duration<double, std::milli>;
+
+		std::vector<bonobo::mesh_data> objects;
+
+		auto const import_start_time = std::chrono::high_resolution_clock::now();
+		bonobo::gltf_loader::asset asset;
+		if (!bonobo::gltf_loader::load(filename, asset))
+			return objects;
+		auto const import_end_time = std::chrono::high_resolution_clock::now();
+
+		LogInfo("┭ Loading \"%s\"…", filename.c_str());
+		LogTrivia("│ ╺ Parsed and validated by the glTF loader in %.3f ms",
+		          std::chrono::duration<float, std::milli>(import_end_time - import_start_time).count());
+
+		// Images get stored for the role of their first use, and those
+		// already in the texture cache are not decoded again.
+		std::vector<bonobo::texture_role> roles(asset.images.size(), bonobo::texture_role::diffuse);
+		std::vector<bool> are_images_used(asset.images.size(), false);
+		for (auto const& material : asset.materials) {
+			for (auto const& texture : material.textures) {
+				if (are_images_used[texture.second])
+					continue;
+				are_images_used[texture.second] = true;
+				roles[texture.second] = getTextureRole(texture.first);
+			}
+		}
+		std::vector<GLuint> image_ids(asset.images.size(), 0u);
+		std::vector<std::string> keys(asset.images.size());
+		std::vector<size_t> decoded_images;
+		size_t reused_nb = 0u;
+		for (size_t i = 0u; i < asset.images.size(); ++i) {
+			if (!are_images_used[i])
+				continue;
+			keys[i] = getTextureCacheKey(filename, false, true, false, roles[i]) + "|image-" + std::to_string(i);
+			image_ids[i] = acquireCachedTexture(keys[i]);
+			if (image_ids[i] != 0u)
+				++reused_nb;
+			else
+				decoded_images.push_back(i);
+		}
+
+		auto const decode_start_time = std::chrono::high_resolution_clock::now();
+		std::vector<decoded_image> images(decoded_images.size());
+		utils::parallel::for_each_index(decoded_images.size(), [&](size_t k){
+			auto const& image = asset.images[decoded_images[k]];
+			// Texture coordinates start from the top of images in glTF,
+			// which is how they are stored, so they need no flipping.
+			images[k] = decodeTextureData(image.data, image.size, false, roles[decoded_images[k]], true);
+		});
+		auto const decode_end_time = std::chrono::high_resolution_clock::now();
+		LogTrivia("│ ┌ %zu images decoded in %.3f ms using %u threads",
+		          decoded_images.size(), std::chrono::duration<float, std::milli>(decode_end_time - decode_start_time).count(),
+		          utils::parallel::worker_count());
+
+		size_t texture_bytes = 0u;
+		for (size_t k = 0u; k < decoded_images.size(); ++k) {
+			auto const i = decoded_images[k];
+			if (images[k].empty()) {
+				LogWarning("Couldn't decode image %zu of \"%s\"", i, filename.c_str());
+				images[k] = getPlaceholderImage();
+			}
+			auto const id = uploadTexture2D(images[k], true);
+			auto const bytes = getTextureSize(images[k].width, images[k].height, images[k].channels_nb, true);
+			utils::opengl::debug::nameObject(GL_TEXTURE, id, "image " + std::to_string(i));
+			insertCachedTexture(keys[i], id, bytes);
+			image_ids[i] = id;
+			texture_bytes += bytes;
+		}
+		auto const upload_end_time = std::chrono::high_resolution_clock::now();
+		LogTrivia("│ └ %zu textures (%.1f MB) uploaded in %.3f ms, %zu served by the texture cache",
+		          decoded_images.size(), static_cast<float>(texture_bytes) / (1024.0f * 1024.0f),
+		          std::chrono::duration<float, std::milli>(upload_end_time - decode_end_time).count(), reused_nb);
+
+		// All vertex and index data lives in one buffer, bound both as the
+		// vertex and the index buffer of every primitive.
+		auto const end_of_basedir = filename.find_last_of("/\\");
+		auto const label = end_of_basedir != std::string::npos ? filename.substr(end_of_basedir + 1u) : filename;
+		GLuint bo = 0u;
+		glGenBuffers(1, &bo);
+		assert(bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, bo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(asset.upload_size), nullptr, GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+		utils::opengl::debug::nameObject(GL_BUFFER, bo, label + " buffer");
+
+		size_t vertex_bytes = 0u, index_bytes = 0u;
+		for (auto const& range : asset.uploads) {
+			stageBufferData(bo, range.offset, range.size, [&range](std::uint8_t* destination, size_t size){
+				std::memcpy(destination, range.data, size);
+			});
+			(range.is_index_data ? index_bytes : vertex_bytes) += range.size;
+		}
 
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id < materials_bindings.size()) {
-			object.bindings = materials_bindings[material_id];
-			object.material = material_constants[material_id];
+		objects.reserve(asset.primitives.size());
+		for (auto const& primitive : asset.primitives) {
+			bonobo::mesh_data object;
+			object.name = primitive.name;
+			object.drawing_mode = primitive.drawing_mode;
+			object.vertices_nb = static_cast<GLsizei>(primitive.vertices_nb);
+			object.bo = bo;
+
+			glGenVertexArrays(1, &object.vao);
+			assert(object.vao != 0u);
+			glBindVertexArray(object.vao);
+			glBindBuffer(GL_ARRAY_BUFFER, bo);
+			for (auto const binding : all_bindings) {
+				auto const& attribute = primitive.attributes[static_cast<size_t>(binding)];
+				if (attribute.components_nb == 0)
+					continue;
+				auto const location = static_cast<unsigned int>(binding);
+				glEnableVertexAttribArray(location);
+				glVertexAttribPointer(location, attribute.components_nb, attribute.component_type, attribute.is_normalised,
+				                      attribute.stride, reinterpret_cast<GLvoid const*>(attribute.offset));
+			}
+			if (primitive.indices.count != 0u) {
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo);
+				object.ibo = bo;
+				object.index_type = primitive.indices.component_type;
+				object.indices_nb = static_cast<GLsizei>(primitive.indices.count);
+				object.first_index = static_cast<GLsizei>(primitive.indices.offset / static_cast<size_t>(bonobo::getIndexSize(object.index_type)));
+			}
+			glBindVertexArray(0u);
+			glBindBuffer(GL_ARRAY_BUFFER, 0u);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+			utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, primitive.name + " VAO");
+
+			object.bounding_box = primitive.bounding_box;
+			object.bounding_sphere.centre = (primitive.bounding_box.min + primitive.bounding_box.max) * 0.5f;
+			object.bounding_sphere.radius = glm::length(primitive.bounding_box.max - primitive.bounding_box.min) * 0.5f;
+			if (primitive.material_id >= 0) {
+				auto const& material = asset.materials[static_cast<size_t>(primitive.material_id)];
+				object.material = material.constants;
+				for (auto const& texture : material.textures)
+					object.bindings.emplace(texture.first, image_ids[texture.second]);
+			}
+			objects.push_back(std::move(object));
 		}
+		auto const meshes_end_time = std::chrono::high_resolution_clock::now();
+
+		logStagingRingStatistics();
+		LogInfo("┕ Scene loaded in %.3f s: %zu textures and %zu meshes, %.1f MB of vertices and %.1f MB of indices uploaded as stored",
+		        std::chrono::duration<float>(meshes_end_time - import_start_time).count(),
+		        decoded_images.size(), objects.size(),
+		        static_cast<float>(vertex_bytes) / (1024.0f * 1024.0f), static_cast<float>(index_bytes) / (1024.0f * 1024.0f));
+
+		phases.import_ms = milliseconds(import_end_time - import_start_time).count();
+		phases.materials_ms = milliseconds(decode_start_time - import_end_time).count();
+		phases.texture_decode_ms = milliseconds(decode_end_time - decode_start_time).count();
+		phases.texture_upload_ms = milliseconds(upload_end_time - decode_end_time).count();
+		phases.mesh_build_ms = milliseconds(meshes_end_time - upload_end_time).count();
+		phases.total_ms = milliseconds(meshes_end_time - import_start_time).count();
+		phases.meshes_nb = objects.size();
+		phases.textures_nb = decoded_images.size();
+		phases.texture_bytes = texture_bytes;
+		phases.vertex_bytes = vertex_bytes;
+		phases.index_bytes = index_bytes;
+
+		return objects;
+	}
+}
+
+std::vector<bonobo::mesh_data>
+bonobo::loadObjects(std::string const& filename, load_options const& options, load_statistics* statistics)
+{
+	auto const scene_start_time = std::chrono::high_resolution_clock::now();
+
+	std::vector<bonobo::mesh_data> objects;
+
+	if (options.use_gltf_loader && bonobo::gltf_loader::isGltfFile(filename)) {
+		// The glTF loader keeps the data as laid out in the file, so none
+		// of the post-load processing is applied to it; say so, rather
+		// than silently returning something else than what was asked for.
+		auto const warn_if_set = [&filename](bool is_set, char const* option){
+			if (is_set)
+				LogWarning("\"%s\" is loaded by the glTF loader, which ignores the \"%s\" load option.", filename.c_str(), option);
+		};
+		warn_if_set(options.rebuild_mesh_cache, "rebuild_mesh_cache");
+		warn_if_set(options.compress_textures, "compress_textures");
+		warn_if_set(options.pack_meshes, "pack_meshes");
+		warn_if_set(options.compact_vertices, "compact_vertices");
+		warn_if_set(options.optimise_meshes, "optimise_meshes");
+		warn_if_set(options.lods_nb != 0u, "lods_nb");
+		warn_if_set(options.merge_meshes, "merge_meshes");
+
+		load_statistics phases;
+		objects = loadGLTF(filename, phases);
+		if (statistics != nullptr)
+			*statistics = phases;
+		return objects;
+	}
+
+	auto const end_of_basedir = filename.rfind("/");
+	auto const parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
 
-		objects.push_back(object);
+	load_statistics phases;
+	bonobo::mesh_cache::scene_record scene;
+	std::vector<vertex_cache_report> vertex_cache_reports;
+	if (!prepareScene(filename, options, scene, vertex_cache_reports, phases))
+		return objects;
 
-		auto const mesh_end_time = std::chrono::high_resolution_clock::now();
+	// Textures are gathered for all used materials first, so that their
+	// (slow) decoding can be spread over multiple threads; only the upload
+	// to OpenGL has to happen on this thread, as it owns the context.
+	// Materials referring to the same image share a single job, and images
+	// already in the texture cache do not get a job at all.
+	bool const compress_textures = options.compress_textures && bonobo::texture_compression::isSupported();
+	if (options.compress_textures && !compress_textures)
+		LogWarning("Texture compression was requested, but S3TC textures are not supported: textures will be uncompressed.");
 
-		std::string attributes = assimp_object_mesh->HasNormals() ? "normals" : "";
-		if (!attributes.empty())
-		  attributes += " | ";
-		if (assimp_object_mesh->HasTangentsAndBitangents())
-		  attributes += "tangents&bitangents";
-		if (!attributes.empty())
-		  attributes += " | ";
-		if (assimp_object_mesh->HasTextureCoords(0))
-		  attributes += "texture coordinates";
-		LogTrivia("│ %s Mesh \"%s\" loaded with attributes [%s] in %.3f ms",
-		          (assimp_scene->mNumMeshes == 1u) ? "╶" : (j == 0 ? "┌" : (j == assimp_scene->mNumMeshes - 1 ? "└" : "├")),
-		          assimp_object_mesh->mName.C_Str(), attributes.c_str(),
-		          std::chrono::duration<float, std::milli>(mesh_end_time - mesh_start_time).count());
+	auto const materials_start_time = std::chrono::high_resolution_clock::now();
+	auto textures = gatherTextures(scene, parent_folder, compress_textures);
+	reserveStagingMemory(textures);
+
+	auto const decode_start_time = std::chrono::high_resolution_clock::now();
+	utils::parallel::for_each_index(textures.jobs.size(), [&textures](size_t index){
+		decodeTexture(textures.jobs[index], textures.compress, false);
+	});
+	auto const decode_end_time = std::chrono::high_resolution_clock::now();
+	if (compress_textures) {
+		auto const cached_count = std::count_if(textures.jobs.begin(), textures.jobs.end(),
+		                                        [](texture_job const& job){ return job.compressed.was_cached; });
+		LogTrivia("│ ┌ %zu textures decoded and compressed in %.3f ms using %u threads, %td read from the compressed texture cache",
+		          textures.jobs.size(),
+		          std::chrono::duration<float, std::milli>(decode_end_time - decode_start_time).count(),
+		          utils::parallel::worker_count(), cached_count);
+	} else {
+		LogTrivia("│ ┌ %zu textures decoded in %.3f ms using %u threads",
+		          textures.jobs.size(),
+		          std::chrono::duration<float, std::milli>(decode_end_time - decode_start_time).count(),
+		          utils::parallel::worker_count());
 	}
+
+	auto const upload_start_time = std::chrono::high_resolution_clock::now();
+	for (auto& job : textures.jobs)
+		uploadTexture(job, textures, scene);
+	auto const upload_end_time = std::chrono::high_resolution_clock::now();
+	LogTrivia("│ └ %u textures (%.1f MB) uploaded in %.3f ms, %u references served by the texture cache",
+	          textures.loaded_nb, static_cast<float>(textures.uploaded_bytes) / (1024.0f * 1024.0f),
+	          std::chrono::duration<float, std::milli>(upload_end_time - upload_start_time).count(),
+	          textures.reused_nb);
+	auto const materials_end_time = std::chrono::high_resolution_clock::now();
+
+	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
+	mesh_upload_totals mesh_totals;
+	objects = uploadSceneMeshes(scene, options, filename.substr(end_of_basedir + 1u), textures.materials_bindings, vertex_cache_reports,
+	                            mesh_totals);
 	auto const meshes_end_time = std::chrono::high_resolution_clock::now();
 
+	logTextureMemory(textures);
+	logStagingRingStatistics();
+
 	auto const scene_end_time = std::chrono::high_resolution_clock::now();
 	LogInfo("┕ Scene loaded in %.3f s: %u textures loaded in %.3f s and %zu meshes in %.3f s",
 	        std::chrono::duration<float>(scene_end_time - scene_start_time).count(),
-	        texture_count,
+	        textures.loaded_nb,
 	        std::chrono::duration<float>(materials_end_time - materials_start_time).count(),
 	        objects.size(),
 	        std::chrono::duration<float>(meshes_end_time - meshes_start_time).count());
 
+	if (statistics != nullptr) {
+		using milliseconds = std::chrono::duration<double, std::milli>;
+		phases.materials_ms = milliseconds(decode_start_time - materials_start_time).count();
+		phases.texture_decode_ms = milliseconds(decode_end_time - decode_start_time).count();
+		phases.texture_upload_ms = milliseconds(upload_end_time - upload_start_time).count();
+		phases.mesh_build_ms = mesh_totals.vertices_ms;
+		phases.index_build_ms = mesh_totals.indices_ms;
+		phases.total_ms = milliseconds(scene_end_time - scene_start_time).count();
+		phases.meshes_nb = objects.size();
+		phases.textures_nb = textures.loaded_nb;
+		phases.texture_bytes = textures.resident_bytes;
+		phases.vertex_bytes = mesh_totals.vertex_bytes;
+		phases.index_bytes = mesh_totals.index_bytes;
+		*statistics = phases;
+	}
+
 	return objects;
 }
 
+//! \brief State shared between an `async_scene` and the thread loading it.
+struct bonobo::async_scene::state {
+	std::string filename;
+	std::string parent_folder;
+	load_options options;
+	std::function<void (std::vector<mesh_data> const&)> on_completion;
+	std::chrono::high_resolution_clock::time_point start_time;
+
+	std::thread loader;
+	std::atomic<bool> is_cancelled{ false };
+
+	// Written by the loader thread until `is_scene_ready` gets set.
+	mesh_cache::scene_record scene;
+	std::vector<vertex_cache_report> vertex_cache_reports;
+
+	// Each job belongs to the loader thread from when `are_jobs_ready`
+	// gets set, until its index is added to `decoded_jobs`.
+	scene_textures textures;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool is_scene_ready{ false };
+	bool has_failed{ false };
+	bool are_jobs_ready{ false };
+	std::vector<size_t> decoded_jobs;
+
+	// Only accessed from the thread owning the OpenGL context.
+	std::vector<mesh_data> objects;
+	std::vector<std::vector<size_t>> objects_by_material;
+	size_t uploaded_jobs_nb{ 0u };
+	std::vector<streamed_texture> streamed_textures;
+	bool has_viewpoint{ false };
+	glm::vec3 viewpoint_position{ 0.0f };
+	glm::mat4 viewpoint_model_to_world{ 1.0f };
+	float viewpoint_pixels_per_unit{ 0.0f }; //!< height in pixels of a unit-length segment facing the camera at a distance of 1
+	float viewpoint_near{ 0.0f };
+	load_progress progress;
+	std::promise<void> completion;
+	std::shared_future<void> completion_future;
+
+	void load()
+	{
+		load_statistics statistics;
+		bool const is_prepared = prepareScene(filename, options, scene, vertex_cache_reports, statistics);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		is_scene_ready = true;
+		has_failed = !is_prepared;
+		if (has_failed)
+			return;
+
+		condition.wait(lock, [this](){ return are_jobs_ready || is_cancelled.load(); });
+		lock.unlock();
+
+		utils::parallel::for_each_index(textures.jobs.size(), [this](size_t index){
+			if (is_cancelled.load())
+				return;
+			decodeTexture(textures.jobs[index], textures.compress, options.stream_texture_mips);
+
+			std::lock_guard<std::mutex> job_lock(mutex);
+			decoded_jobs.push_back(index);
+		});
+	}
+
+	//! \brief Update the priority of every streamed texture, from how
+	//!        many pixels the meshes using it cover on screen, compared to
+	//!        the resolution of its base level.
+	//!
+	//! Without a viewpoint, the lowest resolution textures come first.
+	void prioritiseStreamedTextures()
+	{
+		auto const scale = std::max(glm::length(glm::vec3(viewpoint_model_to_world[0])),
+		                            std::max(glm::length(glm::vec3(viewpoint_model_to_world[1])),
+		                                     glm::length(glm::vec3(viewpoint_model_to_world[2]))));
+		for (auto& texture : streamed_textures) {
+			auto const& job = textures.jobs[texture.job_index];
+			auto screen_size = 1.0f;
+			if (has_viewpoint) {
+				screen_size = 0.0f;
+				for (auto const& reference : job.references) {
+					for (auto const j : objects_by_material[reference.material_id]) {
+						auto const& sphere = objects[j].bounding_sphere;
+						auto const centre = glm::vec3(viewpoint_model_to_world * glm::vec4(sphere.centre, 1.0f));
+						auto const radius = scale * sphere.radius;
+						auto const distance = std::max(glm::distance(viewpoint_position, centre) - radius, viewpoint_near);
+						screen_size = std::max(screen_size, 2.0f * radius * viewpoint_pixels_per_unit / distance);
+					}
+				}
+			}
+			auto const level0_height = !job.compressed.texture.levels.empty() ? job.compressed.texture.levels.front().height
+			                                                                 : job.levels.front().height;
+			auto const base_level_height = std::max(level0_height >> texture.base_level, 1u);
+			texture.priority = screen_size / static_cast<float>(base_level_height);
+		}
+	}
+
+	void complete()
+	{
+		if (loader.joinable())
+			loader.join();
+		progress.is_complete = true;
+
+		// Only the materials are still needed, to name textures.
+		scene.meshes.clear();
+		scene.owned_data.clear();
+		scene.mapping = utils::mapped_file();
+
+		if (!has_failed) {
+			logTextureMemory(textures);
+			logStagingRingStatistics();
+			LogInfo("┕ Scene \"%s\" streamed in %.3f s: %u textures loaded, %u references served by the texture cache, %zu meshes",
+			        filename.c_str(),
+			        std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start_time).count(),
+			        textures.loaded_nb, textures.reused_nb, objects.size());
+		}
+
+		completion.set_value();
+		if (on_completion)
+			on_completion(objects);
+	}
+};
+
+bonobo::async_scene::async_scene() = default;
+
+bonobo::async_scene::async_scene(async_scene&& other) noexcept = default;
+
+bonobo::async_scene&
+bonobo::async_scene::operator=(async_scene&& other) noexcept
+{
+	if (this != &other) {
+		cancel();
+		_state = std::move(other._state);
+	}
+	return *this;
+}
+
+bonobo::async_scene::~async_scene()
+{
+	cancel();
+}
+
+void
+bonobo::async_scene::cancel()
+{
+	if (_state == nullptr || !_state->loader.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->is_cancelled = true;
+	}
+	_state->condition.notify_all();
+	_state->loader.join();
+}
+
+bool
+bonobo::async_scene::update(std::chrono::microseconds time_budget)
+{
+	if (_state == nullptr || _state->progress.is_complete)
+		return false;
+	auto& state = *_state;
+	auto const deadline = std::chrono::high_resolution_clock::now() + time_budget;
+
+	bool has_changed = false;
+	if (!state.progress.is_geometry_ready) {
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (!state.is_scene_ready)
+				return false;
+		}
+		if (state.has_failed) {
+			state.complete();
+			return true;
+		}
+
+		bool const compress_textures = state.options.compress_textures && texture_compression::isSupported();
+		if (state.options.compress_textures && !compress_textures)
+			LogWarning("Texture compression was requested, but S3TC textures are not supported: textures will be uncompressed.");
+		state.textures = gatherTextures(state.scene, state.parent_folder, compress_textures);
+
+		// Textures still to be loaded get a placeholder in the meantime.
+		auto materials_bindings = state.textures.materials_bindings;
+		for (auto const& job : state.textures.jobs)
+			for (auto const& reference : job.references)
+				materials_bindings[reference.material_id].emplace(reference.binding_name, getDebugTextureID());
+
+		auto const end_of_basedir = state.filename.rfind("/");
+		mesh_upload_totals mesh_totals;
+		state.objects = uploadSceneMeshes(state.scene, state.options, state.filename.substr(end_of_basedir + 1u),
+		                                  materials_bindings, state.vertex_cache_reports, mesh_totals);
+		state.objects_by_material.resize(state.scene.materials.size());
+		for (size_t j = 0u; j < state.scene.meshes.size(); ++j)
+			if (state.scene.meshes[j].material_id < state.objects_by_material.size())
+				state.objects_by_material[state.scene.meshes[j].material_id].push_back(j);
+
+		state.progress.is_geometry_ready = true;
+		state.progress.completed_steps = 1u;
+		state.progress.total_steps = 1u + state.textures.jobs.size();
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			state.are_jobs_ready = true;
+		}
+		state.condition.notify_all();
+		has_changed = true;
+	}
+
+	// Upload decoded textures until the budget runs out, always uploading
+	// at least one so that loading progresses even with a tiny budget.
+	// Streamed textures only get their coarsest levels uploaded at first,
+	// which is cheap enough to do for all of them right away.
+	bool const stream = state.options.stream_texture_mips;
+	for (;;) {
+		size_t index = 0u;
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (state.decoded_jobs.empty())
+				break;
+			index = state.decoded_jobs.back();
+			state.decoded_jobs.pop_back();
+		}
+
+		auto& job = state.textures.jobs[index];
+		// Swap the placeholders for the actual texture, or drop them if it
+		// failed to load, as `loadObjects()` would not bind anything then.
+		GLuint id = 0u;
+		bool is_texture_complete = true;
+		if (stream) {
+			streamed_texture texture;
+			texture.job_index = index;
+			id = createStreamedTexture(job, state.textures, state.scene, texture);
+			if (texture.base_level > 0) {
+				state.streamed_textures.push_back(texture);
+				is_texture_complete = false;
+			} else {
+				job.levels.clear();
+				job.compressed = compressed_image();
+			}
+		} else {
+			id = uploadTexture(job, state.textures, state.scene);
+		}
+		for (auto const& reference : job.references) {
+			for (auto const j : state.objects_by_material[reference.material_id]) {
+				if (id != 0u)
+					state.objects[j].bindings[reference.binding_name] = id;
+				else
+					state.objects[j].bindings.erase(reference.binding_name);
+			}
+		}
+		if (is_texture_complete) {
+			++state.uploaded_jobs_nb;
+			++state.progress.completed_steps;
+		}
+		has_changed = true;
+
+		if (!stream && std::chrono::high_resolution_clock::now() >= deadline)
+			break;
+	}
+
+	// Then refine streamed textures one mip level at a time, those that
+	// look the blurriest on screen first; the texture object stays the
+	// same, so bindings do not change.
+	if (!state.streamed_textures.empty())
+		state.prioritiseStreamedTextures();
+	while (!state.streamed_textures.empty()) {
+		auto const texture = std::max_element(state.streamed_textures.begin(), state.streamed_textures.end(),
+		                                      [](streamed_texture const& a, streamed_texture const& b){ return a.priority < b.priority; });
+		auto& job = state.textures.jobs[texture->job_index];
+		glBindTexture(GL_TEXTURE_2D, texture->id);
+		state.textures.uploaded_bytes += uploadStreamedLevel(job, --texture->base_level);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		texture->priority *= 0.5f;
+
+		if (texture->base_level == 0) {
+			job.levels.clear();
+			job.compressed = compressed_image();
+			state.streamed_textures.erase(texture);
+			++state.uploaded_jobs_nb;
+			++state.progress.completed_steps;
+		}
+
+		if (std::chrono::high_resolution_clock::now() >= deadline)
+			break;
+	}
+
+	if (state.uploaded_jobs_nb == state.textures.jobs.size())
+		state.complete();
+
+	return has_changed;
+}
+
+void
+bonobo::async_scene::setViewpoint(FPSCameraf const& camera, glm::mat4 const& model_to_world, float viewport_height)
+{
+	if (_state == nullptr)
+		return;
+	auto& state = *_state;
+
+	state.has_viewpoint = true;
+	state.viewpoint_position = camera.mWorld.GetTranslation();
+	state.viewpoint_model_to_world = model_to_world;
+	state.viewpoint_pixels_per_unit = viewport_height / (2.0f * std::tan(0.5f * camera.mFov));
+	state.viewpoint_near = camera.mNear;
+}
+
+std::vector<bonobo::mesh_data> const&
+bonobo::async_scene::getObjects() const
+{
+	static std::vector<mesh_data> const no_objects;
+	return _state != nullptr ? _state->objects : no_objects;
+}
+
+bonobo::load_progress
+bonobo::async_scene::getProgress() const
+{
+	return _state != nullptr ? _state->progress : load_progress();
+}
+
+std::shared_future<void>
+bonobo::async_scene::getCompletion() const
+{
+	return _state != nullptr ? _state->completion_future : std::shared_future<void>();
+}
+
+bonobo::async_scene
+bonobo::loadObjectsAsync(std::string const& filename, load_options const& options,
+                         std::function<void (std::vector<mesh_data> const&)> const& on_completion)
+{
+	async_scene scene;
+	scene._state.reset(new async_scene::state());
+	auto& state = *scene._state;
+
+	auto const end_of_basedir = filename.rfind("/");
+	state.filename = filename;
+	state.parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
+	state.options = options;
+	state.on_completion = on_completion;
+	state.start_time = std::chrono::high_resolution_clock::now();
+	state.completion_future = state.completion.get_future().share();
+	state.loader = std::thread(&async_scene::state::load, scene._state.get());
+
+	return scene;
+}
+
+bonobo::lod_data
+bonobo::selectLevelOfDetail(mesh_data const& mesh, FPSCameraf const& camera, glm::mat4 const& model_to_world,
+                            float viewport_height, float max_error_in_pixels)
+{
+	lod_data selected{ mesh.first_index, mesh.indices_nb, 0.0f };
+	if (mesh.lods.empty())
+		return selected;
+
+	auto const centre = glm::vec3(model_to_world * glm::vec4(mesh.bounding_sphere.centre, 1.0f));
+	auto const scale = std::max(glm::length(glm::vec3(model_to_world[0])),
+	                            std::max(glm::length(glm::vec3(model_to_world[1])), glm::length(glm::vec3(model_to_world[2]))));
+	auto const distance = glm::distance(camera.mWorld.GetTranslation(), centre) - scale * mesh.bounding_sphere.radius;
+	if (distance <= camera.mNear)
+		return selected;
+
+	// Height in pixels of a unit-length segment facing the camera.
+	auto const pixels_per_unit = viewport_height / (2.0f * std::tan(0.5f * camera.mFov) * distance);
+	for (auto const& lod : mesh.lods) {
+		if (lod.error * scale * pixels_per_unit > max_error_in_pixels)
+			break;
+		selected = lod;
+	}
+	return selected;
+}
+
+GLsizei
+bonobo::getIndexSize(GLenum index_type)
+{
+	switch (index_type) {
+	case GL_UNSIGNED_BYTE:
+		return static_cast<GLsizei>(sizeof(GLubyte));
+	case GL_UNSIGNED_SHORT:
+		return static_cast<GLsizei>(sizeof(GLushort));
+	case GL_UNSIGNED_INT:
+		return static_cast<GLsizei>(sizeof(GLuint));
+	default:
+		LogError("Non-handled index type: %08x.\n", index_type);
+		return 0;
+	}
+}
+
 GLuint
 bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint internal_format, GLenum format, GLenum type, GLvoid const* data)
 {
@@ -369,8 +2461,19 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 		glTexImage1D(target, 0, internal_format, static_cast<GLsizei>(width), 0, format, type, data);
 		break;
 	case GL_TEXTURE_2D:
-		glTexImage2D(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, format, type, data);
+	{
+		// Go through the staging ring whenever the size of the data is
+		// known, so that the driver does not need to copy it right away.
+		GLint alignment = 4;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		auto const size = getImageSize(static_cast<GLsizei>(width), static_cast<GLsizei>(height), format, type, alignment);
+		if (data != nullptr && size != 0u)
+			staging_ring::uploadTexture(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height),
+			                            format, type, data, size);
+		else
+			glTexImage2D(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, format, type, data);
 		break;
+	}
 	default:
 		glDeleteTextures(1, &texture);
 		LogError("Non-handled texture target: %08x.\n", target);
@@ -382,154 +2485,259 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 }
 
 GLuint
-bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
+bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap, texture_role role, bool compress)
 {
+	if (compress && !texture_compression::isSupported()) {
+		LogWarning("Texture compression was requested for \"%s\", but S3TC textures are not supported: the texture will be uncompressed.", filename.c_str());
+		compress = false;
+	}
+
+	auto const cache_key = getTextureCacheKey(filename, true, generate_mipmap, compress, role);
+	auto const cached_id = acquireCachedTexture(cache_key);
+	if (cached_id != 0u)
+		return cached_id;
+
+	if (compress) {
+		auto const image = getCompressedTextureData(filename, role, generate_mipmap, true);
+		if (!image.texture.levels.empty()) {
+			auto const texture = texture_compression::upload(image.texture, role);
+			if (texture != 0u) {
+				insertCachedTexture(cache_key, texture, image.texture.data.size());
+				return texture;
+			}
+		}
+		if (image.was_decoded)
+			LogWarning("Failed to create a compressed version of \"%s\": falling back to an uncompressed texture.", filename.c_str());
+	}
+
 	std::uint32_t width, height;
-	auto const data = getTextureData(filename, width, height, true);
-	if (data.empty())
+	auto const image = getTextureData(filename, width, height, true, role, true);
+	if (image.empty())
 		return 0u;
 
-	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	if (generate_mipmap)
-		glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0u);
+	auto const texture = uploadTexture2D(image, generate_mipmap);
+	if (texture != 0u)
+		insertCachedTexture(cache_key, texture, getTextureSize(width, height, image.channels_nb, generate_mipmap));
 
 	return texture;
 }
 
+void
+bonobo::releaseTexture(GLuint texture)
+{
+	if (texture == 0u)
+		return;
+
+	auto const key = texture_cache.keys.find(texture);
+	if (key == texture_cache.keys.end()) {
+		glDeleteTextures(1, &texture);
+		return;
+	}
+
+	auto const entry = texture_cache.entries.find(key->second);
+	assert(entry != texture_cache.entries.end());
+	if (--entry->second.references_nb != 0u)
+		return;
+
+	--texture_cache.statistics.resident_textures;
+	texture_cache.statistics.resident_bytes -= entry->second.bytes;
+	texture_cache.entries.erase(entry);
+	texture_cache.keys.erase(key);
+	glDeleteTextures(1, &texture);
+}
+
+void
+bonobo::clearTextureCache()
+{
+	for (auto const& entry : texture_cache.entries)
+		glDeleteTextures(1, &entry.second.id);
+	texture_cache.entries.clear();
+	texture_cache.keys.clear();
+	texture_cache.statistics.resident_textures = 0u;
+	texture_cache.statistics.resident_bytes = 0u;
+}
+
+bonobo::texture_cache_statistics
+bonobo::getTextureCacheStatistics()
+{
+	return texture_cache.statistics;
+}
+
+namespace
+{
+	//! \brief Create an OpenGL cube map from six faces of identical size.
+	//!
+	//! @param [in] faces texels of each face, in the order of
+	//!             `GL_TEXTURE_CUBE_MAP_POSITIVE_X + i`
+	//! @param [in] face_bytes size in bytes of each face
+	GLuint uploadTextureCubeMap(std::array<void const*, 6> const& faces, size_t face_bytes, std::uint32_t face_size,
+	                            GLenum internal_format, GLenum format, GLenum type, bool generate_mipmap)
+	{
+		GLuint texture = 0u;
+		// Create an OpenGL texture object. Similarly to `glGenVertexArrays()`
+		// and `glGenBuffers()` that were used in assignment 2,
+		// `glGenTextures()` can create `n` texture objects at once. Here we
+		// only one texture object that will contain our whole cube map.
+		glGenTextures(1, &texture);
+		assert(texture != 0u);
+
+		// Similarly to vertex arrays and buffers, we first need to bind the
+		// texture object in orther to use it. Here we will bind it to the
+		// GL_TEXTURE_CUBE_MAP target to indicate we want a cube map. If you
+		// look at `bonobo::loadTexture2D()` just above, you will see that
+		// GL_TEXTURE_2D is used there, as we want a simple 2D-texture.
+		glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+
+		// Set the wrapping properties of the texture; you can have a look on
+		// http://docs.gl to learn more about them
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		// Set the minification and magnification properties of the textures;
+		// you can have a look on http://docs.gl to lear more about them, or
+		// attend EDAN35 in the next period ;-)
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		GLsizei levels_nb = 1;
+		if (generate_mipmap)
+			for (auto size = face_size; size > 1u; size /= 2u)
+				++levels_nb;
+
+		// When available (OpenGL 4.2 onwards), the storage for all faces
+		// and levels is allocated at once and cannot change afterwards,
+		// which spares the driver from checking the texture for
+		// completeness; the faces are then filled in with
+		// `glTexSubImage2D()`. Otherwise, each face is specified with
+		// `glTexImage2D()`, whose target is the face we want to fill in
+		// rather than the GL_TEXTURE_CUBE_MAP passed to `glBindTexture()`.
+		//
+		// Rather than calling those functions directly, the texels go
+		// through `bonobo::staging_ring`: it takes the same arguments (minus
+		// the border) plus the size of the data, copies the texels into a
+		// staging buffer, and lets the driver transfer them asynchronously.
+		bool const has_immutable_storage = GLAD_GL_VERSION_4_2 != 0;
+		if (has_immutable_storage)
+			glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels_nb, internal_format,
+			               static_cast<GLsizei>(face_size), static_cast<GLsizei>(face_size));
+		else
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels_nb - 1);
+
+		size_t const channels_nb = format == GL_RGB ? 3u : 4u;
+		size_t const channel_size = type == GL_UNSIGNED_BYTE ? 1u : (type == GL_HALF_FLOAT ? 2u : 4u);
+		auto const row_size = face_size * channels_nb * channel_size;
+		if (row_size % 4u != 0u)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (unsigned int i = 0u; i < faces.size(); ++i) {
+			auto const target = static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+			if (has_immutable_storage)
+				bonobo::staging_ring::uploadTextureSubImage(target, 0, 0, 0,
+				                                            static_cast<GLsizei>(face_size), static_cast<GLsizei>(face_size),
+				                                            format, type, faces[i], face_bytes);
+			else
+				bonobo::staging_ring::uploadTexture(target, 0, static_cast<GLint>(internal_format),
+				                                    static_cast<GLsizei>(face_size), static_cast<GLsizei>(face_size),
+				                                    format, type, faces[i], face_bytes);
+		}
+		if (row_size % 4u != 0u)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		if (generate_mipmap)
+			// Generate the mipmap hierarchy of all six faces at once; wait
+			// for EDAN35 to understand what it does
+			glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+
+		return texture;
+	}
+}
+
 GLuint
 bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
                            std::string const& posy, std::string const& negy,
                            std::string const& posz, std::string const& negz,
                            bool generate_mipmap)
 {
-	GLuint texture = 0u;
-	// Create an OpenGL texture object. Similarly to `glGenVertexArrays()`
-	// and `glGenBuffers()` that were used in assignment 2,
-	// `glGenTextures()` can create `n` texture objects at once. Here we
-	// only one texture object that will contain our whole cube map.
-	glGenTextures(1, &texture);
-	assert(texture != 0u);
+	// The faces are independent from one another, so they get decoded
+	// concurrently on the worker pool; only the upload, which needs the
+	// OpenGL context, is left to this thread.
+	std::array<std::string const*, 6> const filenames = {{ &posx, &negx, &posy, &negy, &posz, &negz }};
+	std::array<decoded_image, 6> images;
+	utils::parallel::for_each_index(images.size(), [&](std::size_t i){
+		images[i] = decodeTextureData(*filenames[i], false);
+	});
+
+	std::array<void const*, 6> faces;
+	for (size_t i = 0u; i < images.size(); ++i) {
+		if (images[i].empty()) {
+			LogError("Couldn't load or decode image file %s", filenames[i]->c_str());
+			return 0u;
+		}
+		if (images[i].width != images[i].height || images[i].width != images[0].width) {
+			LogError("Cube map faces must be square and all of the same size, but \"%s\" is %ux%u while \"%s\" is %ux%u.",
+			         filenames[i]->c_str(), images[i].width, images[i].height,
+			         filenames[0]->c_str(), images[0].width, images[0].height);
+			return 0u;
+		}
+		faces[i] = images[i].data();
+	}
 
-	// Similarly to vertex arrays and buffers, we first need to bind the
-	// texture object in orther to use it. Here we will bind it to the
-	// GL_TEXTURE_CUBE_MAP target to indicate we want a cube map. If you
-	// look at `bonobo::loadTexture2D()` just above, you will see that
-	// GL_TEXTURE_2D is used there, as we want a simple 2D-texture.
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
-
-	// Set the wrapping properties of the texture; you can have a look on
-	// http://docs.gl to learn more about them
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	// Set the minification and magnification properties of the textures;
-	// you can have a look on http://docs.gl to lear more about them, or
-	// attend EDAN35 in the next period ;-)
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-
-	auto const faces = std::array<std::pair<GLenum, std::string>, 6>{
-		std::make_pair(GL_TEXTURE_CUBE_MAP_POSITIVE_X, posx),
-		std::make_pair(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, negx),
-		std::make_pair(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, posy),
-		std::make_pair(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, negy),
-		std::make_pair(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, posz),
-		std::make_pair(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, negz)
-	};
+	return uploadTextureCubeMap(faces, images[0].size(), images[0].width, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, generate_mipmap);
+}
 
-	// We need to fill in the cube map using the images passed in as
-	// argument. The function `getTextureData()` uses stb to read in the
-	// image files and return a `std::vector<std::uint8_t>` containing all the
-	// texels.
-	std::uint32_t width, height;
-	auto data = getTextureData(negx, width, height, false);
-	if (data.empty()) {
-		glDeleteTextures(1, &texture);
+GLuint
+bonobo::loadTextureCubeMapFromEquirectangular(std::string const& filename, std::uint32_t face_size, bool generate_mipmap)
+{
+	auto const file = utils::vfs::read(filename);
+	if (file.data() == nullptr || file.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+		LogError("Couldn't read panorama %s", filename.c_str());
 		return 0u;
 	}
-	// With all the texels available on the CPU, we now want to push them
-	// to the GPU: this is done using `glTexImage2D()` (among others). You
-	// might have thought that the target used here would be the same as
-	// the one passed to `glBindTexture()` or `glTexParameteri()`, similar
-	// to what is done `bonobo::loadTexture2D()`. However, we want to fill
-	// in a cube map, which has six different faces, so instead we specify
-	// as the target the face we want to fill in. In this case, we will
-	// start by filling the face sitting on the negative side of the
-	// x-axis by specifying GL_TEXTURE_CUBE_MAP_NEGATIVE_X.
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
-	             /* mipmap level, you'll see that in EDAN35 */0,
-	             /* how are the components internally stored */GL_RGBA,
-	             /* the width of the cube map's face */static_cast<GLsizei>(width),
-	             /* the height of the cube map's face */static_cast<GLsizei>(height),
-	             /* must always be 0 */0,
-	             /* the format of the pixel data: which components are available */GL_RGBA,
-	             /* the type of each component */GL_UNSIGNED_BYTE,
-	             /* the pointer to the actual data on the CPU */reinterpret_cast<GLvoid const*>(data.data()));
-	//! \todo repeat now the texture filling for the 5 remaining faces
-
-// +X
-	{
-		std::uint32_t w, h;
-		auto data_px = getTextureData(posx, w, h, false);
-		if (data_px.empty()) { glDeleteTextures(1, &texture); return 0u; }
-		// 可选：assert(w==width && h==height);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA,
-			static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, data_px.data());
-	}
-	// +Y
-	{
-		std::uint32_t w, h;
-		auto data_py = getTextureData(posy, w, h, false);
-		if (data_py.empty()) { glDeleteTextures(1, &texture); return 0u; }
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA,
-			static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, data_py.data());
-	}
-	// -Y
-	{
-		std::uint32_t w, h;
-		auto data_ny = getTextureData(negy, w, h, false);
-		if (data_ny.empty()) { glDeleteTextures(1, &texture); return 0u; }
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA,
-			static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, data_ny.data());
-	}
-	// +Z
-	{
-		std::uint32_t w, h;
-		auto data_pz = getTextureData(posz, w, h, false);
-		if (data_pz.empty()) { glDeleteTextures(1, &texture); return 0u; }
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA,
-			static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, data_pz.data());
-	}
-	// -Z
-	{
-		std::uint32_t w, h;
-		auto data_nz = getTextureData(negz, w, h, false);
-		if (data_nz.empty()) { glDeleteTextures(1, &texture); return 0u; }
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA,
-			static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, data_nz.data());
-	}
-
-
-
-	if (generate_mipmap)
-		// Generate the mipmap hierarchy; wait for EDAN35 to understand
-		// what it does
-		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+	auto const file_size = static_cast<int>(file.size());
 
-	return texture;
+	int width = 0, height = 0, channels_nb = 0;
+	if (stbi_info_from_memory(file.data(), file_size, &width, &height, &channels_nb) == 0) {
+		LogError("Couldn't decode panorama %s", filename.c_str());
+		return 0u;
+	}
+	if (face_size == 0u)
+		face_size = std::max(static_cast<std::uint32_t>(width) / 4u, 1u);
+
+	auto const cache_filename = cubemap_conversion::getCacheFilename(file, face_size);
+	cubemap_conversion::cube_faces cube;
+	if (cache_filename.empty() || !cubemap_conversion::readCache(cache_filename, cube)) {
+		auto const conversion_start_time = std::chrono::high_resolution_clock::now();
+		stbi_set_flip_vertically_on_load_thread(0);
+		if (stbi_is_hdr_from_memory(file.data(), file_size) != 0) {
+			std::unique_ptr<float, void (*)(void*)> texels(stbi_loadf_from_memory(file.data(), file_size, &width, &height, nullptr, 3),
+			                                               &stbi_image_free);
+			if (texels != nullptr)
+				cube = cubemap_conversion::convert(texels.get(), static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), face_size);
+		} else {
+			std::unique_ptr<std::uint8_t, void (*)(void*)> texels(stbi_load_from_memory(file.data(), file_size, &width, &height, nullptr, 4),
+			                                                      &stbi_image_free);
+			if (texels != nullptr)
+				cube = cubemap_conversion::convert(texels.get(), static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), face_size);
+		}
+		if (cube.data.empty()) {
+			LogError("Couldn't decode panorama %s", filename.c_str());
+			return 0u;
+		}
+		auto const conversion_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - conversion_start_time);
+		LogInfo("Resampled panorama \"%s\" into %ux%u cube map faces in %.1f ms.", filename.c_str(), face_size, face_size, conversion_time.count());
+
+		if (!cache_filename.empty() && !cubemap_conversion::writeCache(cache_filename, cube))
+			LogWarning("Failed to write the cube map cache entry \"%s\".", cache_filename.c_str());
+	}
+
+	std::array<void const*, 6> faces;
+	for (unsigned int i = 0u; i < faces.size(); ++i)
+		faces[i] = cube.face(i);
+	if (cube.is_hdr)
+		return uploadTextureCubeMap(faces, cube.face_bytes, cube.face_size, GL_RGB16F, GL_RGB, GL_HALF_FLOAT, generate_mipmap);
+	return uploadTextureCubeMap(faces, cube.face_bytes, cube.face_size, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, generate_mipmap);
 }
 
 GLuint
@@ -700,6 +2908,30 @@ bonobo::changePolygonMode(enum polygon_mode_t const polygon_mode) noexcept
 	}
 }
 
+void
+bonobo::uiShowLoadProgress(std::string const& label, load_progress const& progress)
+{
+	if (progress.is_complete)
+		return;
+
+	ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f),
+	                        ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+	bool const opened = ImGui::Begin(label.c_str(), nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize
+	                                                         | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoInputs);
+	if (opened) {
+		if (!progress.is_geometry_ready) {
+			ImGui::Text("Loading %s: importing geometry…", label.c_str());
+			ImGui::ProgressBar(0.0f, ImVec2(300.0f, 0.0f));
+		} else {
+			ImGui::Text("Loading %s: %zu / %zu textures", label.c_str(),
+			            progress.completed_steps - 1u, progress.total_steps - 1u);
+			ImGui::ProgressBar(static_cast<float>(progress.completed_steps) / static_cast<float>(progress.total_steps),
+			                   ImVec2(300.0f, 0.0f));
+		}
+	}
+	ImGui::End();
+}
+
 namespace
 {
 	void setupBasisData()
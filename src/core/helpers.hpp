@@ -4,9 +4,13 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "core/bounds.hpp"
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
 
+#include <chrono>
 #include <functional>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -24,6 +28,15 @@ namespace bonobo
 		binormals      //!< = 4, value of the binding point for binormals
 	};
 
+	//! \brief How a texture is sampled by shaders, which drives how it can
+	//!        be stored and filtered.
+	enum class texture_role : unsigned int {
+		diffuse = 0u, //!< = 0, colour data, possibly with an alpha channel
+		specular,     //!< = 1, colour data
+		normals,      //!< = 2, tangent-space normals
+		opacity       //!< = 3, greyscale opacity, read through the red channel
+	};
+
 	//! \brief Association of a sampler name used in GLSL to a
 	//!        corresponding texture ID.
 	using texture_bindings = std::unordered_map<std::string, GLuint>;
@@ -38,6 +51,13 @@ namespace bonobo
 		float opacity{ 1.0f };
 	};
 
+	//! \brief Simplified version of a mesh, drawn from the same vertices.
+	struct lod_data {
+		GLsizei first_index{0}; //!< index of the first index of this level in ibo
+		GLsizei indices_nb{0};  //!< number of indices of this level
+		float error{0.0f};      //!< largest deviation from the original mesh, in model units
+	};
+
 	//! \brief Contains the data for a mesh in OpenGL.
 	struct mesh_data {
 		GLuint vao{0u};                          //!< OpenGL name of the Vertex Array Object
@@ -45,6 +65,14 @@ namespace bonobo
 		GLuint ibo{0u};                          //!< OpenGL name of the Buffer Object for indices
 		GLsizei vertices_nb{0};                  //!< number of vertices stored in bo
 		GLsizei indices_nb{0};                   //!< number of indices stored in ibo
+		GLint base_vertex{0};                    //!< index of the first vertex of this mesh in bo
+		GLsizei first_index{0};                  //!< index of the first index of this mesh in ibo
+		GLenum index_type{GL_UNSIGNED_INT};      //!< type of the indices stored in ibo, i.e. GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+		bool compact_vertices{false};            //!< whether vertices use the compact format (see `load_options::compact_vertices`)
+		glm::mat4 position_dequantization{1.0f}; //!< transform from stored positions to model space
+		std::vector<lod_data> lods{};            //!< simplified levels of detail, from finest to coarsest, stored in the same ibo
+		bounds::box bounding_box{};              //!< box enclosing the mesh, in model space
+		bounds::sphere bounding_sphere{};        //!< sphere enclosing the mesh, in model space, centred on `bounding_box`
 		texture_bindings bindings{};             //!< texture bindings for this mesh
 		material_data material{};                //!< constant values for the material of this mesh
 		GLenum drawing_mode{GL_TRIANGLES};       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
@@ -69,12 +97,250 @@ namespace bonobo
 	//! \brief Deallocate objects allocated by the `init()` function.
 	void deinit();
 
+	//! \brief Options controlling how `loadObjects()` processes a scene.
+	struct load_options {
+		//! Read the meshes back from the on-disk mesh cache when a valid
+		//! entry exists, and write one after importing the scene otherwise.
+		bool use_mesh_cache{ true };
+		//! Ignore any existing mesh cache entry and import the scene
+		//! again, overwriting the entry if `use_mesh_cache` is set.
+		bool rebuild_mesh_cache{ false };
+		//! Store textures block-compressed with pre-generated mipmaps (see
+		//! `loadTexture2D()`).
+		bool compress_textures{ false };
+		//! Pack all meshes of the scene into a single interleaved vertex
+		//! buffer and a single index buffer, sharing one VAO; meshes then
+		//! have to be drawn using their `base_vertex` and `first_index`,
+		//! e.g. with `glDrawElementsBaseVertex()`.
+		bool pack_meshes{ false };
+		//! Store vertices in a compact format rather than as five `vec3`:
+		//! * positions as snorm16 relative to the bounds of the mesh, which
+		//!   `mesh_data::position_dequantization` maps back to model space;
+		//! * normals as octahedral-encoded snorm16 pairs;
+		//! * texture coordinates as two half-floats;
+		//! * tangents as octahedral-encoded snorm16 pairs, followed by the
+		//!   sign of the binormal, which is not stored.
+		//!
+		//! Vertex shaders have to decode normals and tangents themselves,
+		//! and should check the `compact_vertices` uniform to know when to,
+		//! as done in "EDAN35/fill_gbuffer.vert".
+		//! Independently of this option, 16-bit indices are used whenever
+		//! a mesh has few enough vertices.
+		bool compact_vertices{ false };
+		//! Reorder triangles and vertices of each mesh for better use of
+		//! the post-transform vertex cache, less overdraw, and more local
+		//! vertex fetches (see `mesh_optimisation.hpp`). This slows down
+		//! importing, but the result is stored in the mesh cache.
+		bool optimise_meshes{ false };
+		//! Number of levels of detail to generate for each triangle mesh,
+		//! each one targeting half the triangles of the previous one (see
+		//! `mesh_simplification.hpp` and `selectLevelOfDetail()`). Levels
+		//! are stored in the mesh cache alongside the mesh itself.
+		unsigned int lods_nb{ 0u };
+		//! Merge meshes sharing the same material, primitive type and
+		//! vertex attributes into a single mesh, so that they can be drawn
+		//! with a single call. All meshes of a scene are static, as node
+		//! transforms are not applied, so any of them can be merged.
+		//! Merging happens before optimising meshes and generating levels
+		//! of detail, and its result is stored in the mesh cache.
+		bool merge_meshes{ false };
+		//! When merging meshes, only merge those whose bounding boxes are
+		//! centred in the same cell of a grid of that size, in model
+		//! units, so that merged meshes stay small enough to be culled
+		//! and to have their level of detail selected individually; 0
+		//! merges regardless of position.
+		float merge_cell_size{ 0.0f };
+		//! Import OBJ files with the dedicated parser of `obj_loader.hpp`,
+		//! which runs over the worker pool, rather than through Assimp.
+		bool use_obj_loader{ true };
+		//! Load glTF files (.glb or .gltf) with the loader of
+		//! `gltf_loader.hpp` rather than through Assimp: the vertex and
+		//! index data of all meshes is copied as stored in the file into a
+		//! single buffer object, which is both the `bo` and the `ibo` of
+		//! every mesh, and read with the layout described by the file.
+		//! Only `loadObjects()` uses that loader, and none of the other
+		//! options apply to those files: meshes are neither cached,
+		//! packed, compacted, optimised, simplified nor merged, textures
+		//! are not compressed, and each bounding sphere is the one
+		//! enclosing the bounding box stored in the file, rather than one
+		//! fitted to the vertices. A warning is logged for each of those
+		//! options that is set; `use_mesh_cache`, being on by default, is
+		//! ignored silently. Turn this option off to get them applied, by
+		//! importing glTF files through Assimp instead.
+		bool use_gltf_loader{ true };
+		//! When loading asynchronously, create textures with storage for
+		//! their whole mip chain, but upload their levels coarsest first,
+		//! lowering `GL_TEXTURE_BASE_LEVEL` as finer ones arrive, so that
+		//! a blurry version of every texture shows up quickly. Mip levels
+		//! of uncompressed textures are then filtered on the CPU rather
+		//! than by `glGenerateMipmap()`. See `async_scene::update()`.
+		bool stream_texture_mips{ true };
+	};
+
+	//! \brief Size in bytes of a single index of a given type.
+	//!
+	//! @param [in] index_type one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or
+	//!             GL_UNSIGNED_INT
+	//! @return the size of the type
+	GLsizei getIndexSize(GLenum index_type);
+
+	//! \brief Offset of the first index of a mesh, as expected by
+	//!        `glDrawElements()` and its variants.
+	inline GLvoid const* getFirstIndexOffset(mesh_data const& mesh)
+	{
+		return reinterpret_cast<GLvoid const*>(static_cast<std::size_t>(mesh.first_index) * getIndexSize(mesh.index_type));
+	}
+
+	//! \brief Pick the coarsest level of detail of a mesh whose error,
+	//!        once projected on screen, stays below a given threshold.
+	//!
+	//! The error is projected at the point of the bounding sphere of the
+	//! mesh that is closest to the camera, so this errs on the side of
+	//! finer levels.
+	//!
+	//! @param [in] mesh the mesh to draw
+	//! @param [in] camera the camera the mesh will be seen through
+	//! @param [in] model_to_world transform applied to the mesh
+	//! @param [in] viewport_height height in pixels of the viewport
+	//! @param [in] max_error_in_pixels largest acceptable error on screen
+	//! @return the level to draw; if the mesh itself has to be drawn, its
+	//!         `first_index` and `indices_nb` with an error of 0
+	lod_data selectLevelOfDetail(mesh_data const& mesh, FPSCameraf const& camera,
+	                             glm::mat4 const& model_to_world, float viewport_height,
+	                             float max_error_in_pixels = 1.0f);
+
+	//! \brief Offset of the first index of a level of detail, as expected
+	//!        by `glDrawElements()` and its variants.
+	inline GLvoid const* getFirstIndexOffset(mesh_data const& mesh, lod_data const& lod)
+	{
+		return reinterpret_cast<GLvoid const*>(static_cast<std::size_t>(lod.first_index) * getIndexSize(mesh.index_type));
+	}
+
+	//! \brief Time spent in each phase of `loadObjects()`, and how much GPU
+	//!        memory the result uses.
+	//!
+	//! Uploads are only issued during the load, so OpenGL may still be
+	//! executing them when it returns.
+	struct load_statistics {
+		double import_ms{ 0.0 };          //!< importing through assimp or the OBJ loader, or reading back the mesh cache
+		double mesh_processing_ms{ 0.0 }; //!< merging and optimising meshes, and generating levels of detail
+		double materials_ms{ 0.0 };       //!< parsing materials and looking textures up in the texture cache
+		double texture_decode_ms{ 0.0 };  //!< decoding, and possibly compressing, textures
+		double texture_upload_ms{ 0.0 };
+		double mesh_build_ms{ 0.0 };      //!< laying out vertices and uploading them
+		double index_build_ms{ 0.0 };     //!< converting indices and uploading them
+		double total_ms{ 0.0 };
+		bool was_mesh_cache_hit{ false };
+		size_t meshes_nb{ 0u };
+		size_t merged_meshes_nb{ 0u };    //!< meshes folded into others by `load_options::merge_meshes`, i.e. draw calls saved; 0 on mesh cache hits
+		size_t textures_nb{ 0u };         //!< textures loaded, excluding those served by the texture cache
+		size_t texture_bytes{ 0u };       //!< estimate, including mipmaps
+		size_t vertex_bytes{ 0u };
+		size_t index_bytes{ 0u };
+	};
+
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
 	//! @param [in] filename of the object/scene file to load.
+	//! @param [in] options how the scene should be processed.
+	//! @param [out] statistics if not null, filled in with the time spent
+	//!              in each phase of the load
 	//! @return a vector of filled in `mesh_data` structures, one per
 	//!         object found in the input file
-	std::vector<mesh_data> loadObjects(std::string const& filename);
+	std::vector<mesh_data> loadObjects(std::string const& filename,
+	                                   load_options const& options = load_options(),
+	                                   load_statistics* statistics = nullptr);
+
+	//! \brief How far along a scene loaded by `loadObjectsAsync()` is.
+	struct load_progress {
+		size_t completed_steps{ 0u };    //!< importing the geometry counts as one step, and loading each texture, down to its finest mip level, as another
+		size_t total_steps{ 1u };        //!< only known once the geometry is ready
+		bool is_geometry_ready{ false }; //!< whether meshes are available, possibly with placeholder textures
+		bool is_complete{ false };       //!< whether loading is over, successfully or not
+	};
+
+	//! \brief Scene being loaded in the background by `loadObjectsAsync()`.
+	//!
+	//! Destroying it before loading is complete stops loading, but waits
+	//! for the step in progress on the loading thread (such as importing
+	//! the geometry) to finish.
+	class async_scene {
+	public:
+		async_scene();
+		async_scene(async_scene&& other) noexcept;
+		async_scene& operator=(async_scene&& other) noexcept;
+		~async_scene();
+
+		//! \brief Upload to OpenGL whatever the loading thread has made
+		//!        ready since the last call; call it once per frame, from
+		//!        the thread owning the OpenGL context.
+		//!
+		//! Once the geometry is ready, all meshes get uploaded at once,
+		//! with `getDebugTextureID()` bound in place of the textures that
+		//! are not loaded yet. Textures are then uploaded one by one, each
+		//! replacing its placeholder, until `time_budget` is exhausted; at
+		//! least one texture is uploaded per call if any is ready.
+		//!
+		//! When `load_options::stream_texture_mips` is set, every texture
+		//! ready replaces its placeholder within the call, with only its
+		//! coarsest mip levels; finer levels are then uploaded one at a
+		//! time, in order of priority (see `setViewpoint()`), until
+		//! `time_budget` is exhausted, and at least one per call.
+		//!
+		//! When the last texture is uploaded, the completion future is
+		//! satisfied and the completion callback gets called, from within
+		//! this function.
+		//!
+		//! @param [in] time_budget how long to spend uploading textures
+		//! @return whether the objects, or their texture bindings, changed
+		bool update(std::chrono::microseconds time_budget);
+
+		//! \brief Set the viewpoint the scene is seen from, so that the
+		//!        textures of the meshes covering the most pixels get
+		//!        their finer mip levels streamed first.
+		//!
+		//! Without a viewpoint, the textures with the lowest resolution
+		//! uploaded so far come first.
+		//!
+		//! @param [in] camera the camera the scene is seen through
+		//! @param [in] model_to_world transform applied to the scene
+		//! @param [in] viewport_height height in pixels of the viewport
+		void setViewpoint(FPSCameraf const& camera, glm::mat4 const& model_to_world, float viewport_height);
+
+		//! \brief Objects loaded so far; this is empty until the geometry
+		//!        is ready, or if loading failed.
+		std::vector<mesh_data> const& getObjects() const;
+
+		load_progress getProgress() const;
+
+		//! \brief Future satisfied once loading is complete, see `update()`.
+		std::shared_future<void> getCompletion() const;
+
+	private:
+		friend async_scene loadObjectsAsync(std::string const& filename, load_options const& options,
+		                                    std::function<void (std::vector<mesh_data> const&)> const& on_completion);
+
+		void cancel();
+
+		struct state;
+		std::unique_ptr<state> _state;
+	};
+
+	//! \brief Load objects found in an object/scene file in the
+	//!        background, rather than blocking like `loadObjects()`.
+	//!
+	//! Importing the scene and decoding its textures happen on other
+	//! threads, while uploads to OpenGL happen in `async_scene::update()`,
+	//! so the application keeps rendering in the meantime.
+	//!
+	//! @param [in] filename of the object/scene file to load.
+	//! @param [in] options how the scene should be processed.
+	//! @param [in] on_completion function called with the loaded objects
+	//!             once loading is complete, from `async_scene::update()`
+	//! @return the scene being loaded
+	async_scene loadObjectsAsync(std::string const& filename,
+	                             load_options const& options = load_options(),
+	                             std::function<void (std::vector<mesh_data> const&)> const& on_completion = nullptr);
 
 	//! \brief Creates an OpenGL texture without any content nor parameters.
 	//!
@@ -97,14 +363,72 @@ namespace bonobo
 
 	//! \brief Load an image into an OpenGL 2D-texture.
 	//!
+	//! If the same image was already loaded with the same options, and not
+	//! released since, the existing texture is returned instead.
+	//!
+	//! Uncompressed images are stored with only the channels they need:
+	//! greyscale sources and opacity maps use a single channel, normal maps
+	//! three, and colour sources keep their alpha channel only if they have
+	//! one. Swizzle masks make every variant read the same through `.rgba`
+	//! as a four-channel texture would.
+	//!
+	//! When `compress` is set and the hardware supports it, the image is
+	//! stored block-compressed (BC1, BC3 or BC5 depending on `role`) with a
+	//! mipmap hierarchy filtered on the CPU. The result is cached on disk,
+	//! so later loads of the same image upload the compressed levels as is.
+	//! Note that compressed normal maps only keep their X and Y components,
+	//! and return 1 for Z; shaders should reconstruct Z from X and Y.
+	//!
 	//! @param [in] filename of the image.
 	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @param [in] role how the texture will be sampled
+	//! @param [in] compress whether to store the texture block-compressed
 	//! @return the name of the OpenGL 2D-texture
 	GLuint loadTexture2D(std::string const& filename,
-	                     bool generate_mipmap = true);
+	                     bool generate_mipmap = true,
+	                     texture_role role = texture_role::diffuse,
+	                     bool compress = false);
+
+	//! \brief Counters describing how effective the texture cache is.
+	//!
+	//! Textures loaded through `loadTexture2D()` or `loadObjects()` are
+	//! shared: loading the same file with the same options again returns
+	//! the existing OpenGL texture rather than creating a new one.
+	struct texture_cache_statistics {
+		size_t hits{ 0u };               //!< loads served by an existing texture
+		size_t misses{ 0u };             //!< loads which created a new texture
+		size_t bytes_saved{ 0u };        //!< texture memory not allocated thanks to hits
+		size_t resident_textures{ 0u };  //!< textures currently in the cache
+		size_t resident_bytes{ 0u };     //!< texture memory used by those textures
+	};
+
+	//! \brief Release a texture obtained from `loadTexture2D()` or
+	//!        `loadObjects()`.
+	//!
+	//! Cached textures are only deleted once every load that returned them
+	//! has been released; any other texture is deleted right away. Use
+	//! this rather than `glDeleteTextures()` on cached textures.
+	//!
+	//! @param [in] texture the OpenGL name of the texture to release
+	void releaseTexture(GLuint texture);
+
+	//! \brief Delete every texture held by the texture cache, whatever
+	//!        its number of references, and empty the cache.
+	//!
+	//! Unlike `deinit()`, which leaves the textures to the context being
+	//! destroyed, this is meant for a context that remains in use, such
+	//! as between two loads of the same scene; all textures obtained from
+	//! the cache so far become invalid.
+	void clearTextureCache();
+
+	//! \brief Retrieve the statistics of the texture cache.
+	texture_cache_statistics getTextureCacheStatistics();
 
 	//! \brief Load six images into an OpenGL cubemap-texture.
 	//!
+	//! The images are decoded concurrently, and must be square and all of
+	//! the same size.
+	//!
 	//! @param [in] posx path to the texture on the left of the cubemap
 	//! @param [in] negx path to the texture on the right of the cubemap
 	//! @param [in] posy path to the texture on the top of the cubemap
@@ -118,6 +442,25 @@ namespace bonobo
                                   std::string const& posz, std::string const& negz,
                                   bool generate_mipmap = true);
 
+	//! \brief Load an equirectangular panorama into an OpenGL
+	//!        cubemap-texture.
+	//!
+	//! The panorama is resampled into six faces on the CPU, and those are
+	//! kept in the on-disk cache so that later loads skip both decoding
+	//! and resampling. HDR panoramas (e.g. ".hdr" files) are stored as
+	//! half-floats, others as 8-bit RGBA.
+	//!
+	//! @param [in] filename path to the panorama, whose centre looks
+	//!             towards -Z, with +Y up
+	//! @param [in] face_size width and height of each face; 0 picks a
+	//!             quarter of the width of the panorama, which roughly
+	//!             keeps its resolution
+	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @return the name of the OpenGL cubemap-texture, or 0 on failure
+	GLuint loadTextureCubeMapFromEquirectangular(std::string const& filename,
+	                                             std::uint32_t face_size = 0u,
+	                                             bool generate_mipmap = true);
+
 	//! \brief Create an OpenGL program consisting of a vertex and a
 	//!        fragment shader.
 	//!
@@ -215,4 +558,11 @@ namespace bonobo
 	//! \brief Call glPolygonMode for both front and back faces, with the
 	//!        specified polygon mode.
 	void changePolygonMode(enum polygon_mode_t const polygon_mode) noexcept;
+
+	//! \brief Show a centred ImGUI overlay with the progress of a scene
+	//!        loaded by `loadObjectsAsync()`, until it is complete.
+	//!
+	//! @param [in] label Name of the scene, also used as the window name.
+	//! @param [in] progress The current progress of the scene.
+	void uiShowLoadProgress(std::string const& label, load_progress const& progress);
 }
@@ -0,0 +1,242 @@
+#include "instanced_renderer.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+bonobo::instanced_renderer::~instanced_renderer()
+{
+	if (_buffer != 0u)
+		glDeleteBuffers(1, &_buffer);
+}
+
+void
+bonobo::instanced_renderer::add(Node const& node, glm::mat4 const& parent_transform, glm::vec4 const& colour)
+{
+	if (node._program == nullptr || *node._program == 0u || node._vao == 0u)
+		return;
+
+	// Consecutive instances usually come from the same node, or at least
+	// the same batch, so that one is checked first.
+	auto batch_index = _last_batch;
+	if (batch_index >= _batches_nb || !canShareBatch(*_batches[batch_index].node, node)) {
+		batch_index = 0u;
+		while (batch_index < _batches_nb && !canShareBatch(*_batches[batch_index].node, node))
+			++batch_index;
+		if (batch_index == _batches_nb) {
+			if (_batches_nb == _batches.size())
+				_batches.emplace_back();
+			_batches[batch_index].node = &node;
+			_batches[batch_index].instances.clear();
+			++_batches_nb;
+		}
+		_last_batch = batch_index;
+	}
+
+	// Compact positions are relative to the bounds of the mesh, which only
+	// affects positions and not normals.
+	auto const world = parent_transform * node._transform.GetMatrix();
+	_batches[batch_index].instances.push_back({ world * node._position_dequantization,
+	                                            glm::transpose(glm::inverse(glm::mat3(world))),
+	                                            colour });
+}
+
+void
+bonobo::instanced_renderer::flush(glm::mat4 const& view_projection)
+{
+	_statistics = statistics();
+
+	std::size_t instances_nb = 0u;
+	for (std::size_t i = 0u; i < _batches_nb; ++i)
+		instances_nb += _batches[i].instances.size();
+	if (instances_nb == 0u) {
+		_batches_nb = 0u;
+		return;
+	}
+
+	utils::opengl::debug::beginDebugGroup("Instanced renderer");
+
+	auto const bytes_nb = instances_nb * sizeof(instance);
+	if (_buffer == 0u)
+		glGenBuffers(1, &_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+	if (bytes_nb > _buffer_size) {
+		_buffer_size = std::max(bytes_nb, 2u * _buffer_size);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_buffer_size), nullptr, GL_STREAM_DRAW);
+		_buffer_offset = 0u;
+	} else if (_buffer_offset + bytes_nb > _buffer_size) {
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_buffer_size), nullptr, GL_STREAM_DRAW);
+		_buffer_offset = 0u;
+	}
+
+	// Regions past the offset have not been used since the buffer was last
+	// orphaned, so nothing pending can be reading from them.
+	auto* const mapping = static_cast<std::uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(_buffer_offset),
+	                                                                  static_cast<GLsizeiptr>(bytes_nb),
+	                                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	if (mapping == nullptr) {
+		LogError("Failed to map %zu bytes of the instance buffer.", bytes_nb);
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		_batches_nb = 0u;
+		utils::opengl::debug::endDebugGroup();
+		return;
+	}
+	_batch_offsets.resize(_batches_nb);
+	std::size_t written_bytes_nb = 0u;
+	for (std::size_t i = 0u; i < _batches_nb; ++i) {
+		auto const& instances = _batches[i].instances;
+		_batch_offsets[i] = static_cast<GLintptr>(_buffer_offset + written_bytes_nb);
+		std::memcpy(mapping + written_bytes_nb, instances.data(), instances.size() * sizeof(instance));
+		written_bytes_nb += instances.size() * sizeof(instance);
+	}
+	if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+		// The data store got lost, e.g. on a display mode change; there
+		// is nothing to draw from this frame.
+		LogWarning("The instance buffer got corrupted while mapped; skipping this frame's instances.");
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		_batches_nb = 0u;
+		utils::opengl::debug::endDebugGroup();
+		return;
+	}
+	_buffer_offset += bytes_nb;
+	_statistics.streamed_bytes = bytes_nb;
+
+	GLuint current_program = 0u;
+	for (std::size_t i = 0u; i < _batches_nb; ++i) {
+		auto const& node = *_batches[i].node;
+		auto const program = *node._program;
+		auto const instances_count = static_cast<GLsizei>(_batches[i].instances.size());
+
+		utils::opengl::debug::beginDebugGroup(node._name);
+
+		if (program != current_program) {
+			glUseProgram(program);
+			current_program = program;
+		}
+		node._set_uniforms(program);
+
+		auto const& locations = node.get_uniform_locations(program);
+		glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(view_projection));
+		glUniform1i(locations.compact_vertices, node._compact_vertices ? 1 : 0);
+
+		for (std::size_t k = 0u; k < node._textures.size(); ++k) {
+			auto const& texture = node._textures[k];
+			glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(k));
+			glBindTexture(std::get<2>(texture), std::get<1>(texture));
+			glUniform1i(locations.textures[k].first, static_cast<GLint>(k));
+			glUniform1i(locations.textures[k].second, 1);
+		}
+
+		glUniform3fv(locations.diffuse_colour, 1, glm::value_ptr(node._constants.diffuse));
+		glUniform3fv(locations.specular_colour, 1, glm::value_ptr(node._constants.specular));
+		glUniform3fv(locations.ambient_colour, 1, glm::value_ptr(node._constants.ambient));
+		glUniform3fv(locations.emissive_colour, 1, glm::value_ptr(node._constants.emissive));
+		glUniform1f(locations.shininess_value, node._constants.shininess);
+		glUniform1f(locations.index_of_refraction_value, node._constants.indexOfRefraction);
+		glUniform1f(locations.opacity_value, node._constants.opacity);
+
+		// The per-instance attributes get attached to the node's own
+		// vertex array for the duration of the draw only, as it may be
+		// shared with meshes drawn without instancing.
+		glBindVertexArray(node._vao);
+		bindInstanceAttributes(_batch_offsets[i], true);
+		if (node._has_indices)
+			glDrawElementsInstancedBaseVertex(node._drawing_mode, node._indices_nb, node._index_type,
+			                                  reinterpret_cast<GLvoid const*>(static_cast<size_t>(node._first_index) * bonobo::getIndexSize(node._index_type)),
+			                                  instances_count, node._base_vertex);
+		else
+			glDrawArraysInstanced(node._drawing_mode, node._base_vertex, node._vertices_nb, instances_count);
+		bindInstanceAttributes(0, false);
+		glBindVertexArray(0u);
+
+		for (std::size_t k = 0u; k < node._textures.size(); ++k) {
+			glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(k));
+			glBindTexture(std::get<2>(node._textures[k]), 0u);
+			glUniform1i(locations.textures[k].second, 0);
+		}
+
+		utils::opengl::debug::endDebugGroup();
+
+		++_statistics.batches_nb;
+		_statistics.instances_nb += _batches[i].instances.size();
+	}
+	glUseProgram(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	_batches_nb = 0u;
+	_last_batch = 0u;
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+bonobo::instanced_renderer::statistics const&
+bonobo::instanced_renderer::getStatistics() const
+{
+	return _statistics;
+}
+
+bool
+bonobo::instanced_renderer::canShareBatch(Node const& first, Node const& second)
+{
+	if (&first == &second)
+		return true;
+
+	auto const& a = first._constants;
+	auto const& b = second._constants;
+	return *first._program == *second._program
+	    && first._vao == second._vao
+	    && first._drawing_mode == second._drawing_mode
+	    && first._has_indices == second._has_indices
+	    && first._vertices_nb == second._vertices_nb
+	    && first._indices_nb == second._indices_nb
+	    && first._base_vertex == second._base_vertex
+	    && first._first_index == second._first_index
+	    && first._index_type == second._index_type
+	    && first._compact_vertices == second._compact_vertices
+	    && first._position_dequantization == second._position_dequantization
+	    && first._textures == second._textures
+	    && a.diffuse == b.diffuse && a.specular == b.specular && a.ambient == b.ambient && a.emissive == b.emissive
+	    && a.shininess == b.shininess && a.indexOfRefraction == b.indexOfRefraction && a.opacity == b.opacity;
+}
+
+void
+bonobo::instanced_renderer::bindInstanceAttributes(GLintptr offset, bool enable) const
+{
+	struct attribute {
+		GLuint location;
+		GLint components_nb;
+		std::size_t member_offset;
+	};
+	auto const world = static_cast<GLuint>(instance_bindings::world);
+	auto const normal = static_cast<GLuint>(instance_bindings::normal);
+	auto const colour = static_cast<GLuint>(instance_bindings::colour);
+	attribute const attributes[] = {
+		{ world + 0u, 4, offsetof(instance, world) + 0u * sizeof(glm::vec4) },
+		{ world + 1u, 4, offsetof(instance, world) + 1u * sizeof(glm::vec4) },
+		{ world + 2u, 4, offsetof(instance, world) + 2u * sizeof(glm::vec4) },
+		{ world + 3u, 4, offsetof(instance, world) + 3u * sizeof(glm::vec4) },
+		{ normal + 0u, 3, offsetof(instance, normal) + 0u * sizeof(glm::vec3) },
+		{ normal + 1u, 3, offsetof(instance, normal) + 1u * sizeof(glm::vec3) },
+		{ normal + 2u, 3, offsetof(instance, normal) + 2u * sizeof(glm::vec3) },
+		{ colour, 4, offsetof(instance, colour) }
+	};
+
+	if (enable)
+		glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+	for (auto const& attribute : attributes) {
+		if (!enable) {
+			glDisableVertexAttribArray(attribute.location);
+			glVertexAttribDivisor(attribute.location, 0u);
+			continue;
+		}
+		glEnableVertexAttribArray(attribute.location);
+		glVertexAttribPointer(attribute.location, attribute.components_nb, GL_FLOAT, GL_FALSE, sizeof(instance),
+		                      reinterpret_cast<GLvoid const*>(offset + static_cast<GLintptr>(attribute.member_offset)));
+		glVertexAttribDivisor(attribute.location, 1u);
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "node.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Vertex attribute locations of the per-instance data read by
+	//!        instanced shaders, following those of `shader_bindings`.
+	enum class instance_bindings : unsigned int {
+		world = 5u,   //!< = 5 to 8, columns of the model-to-world matrix
+		normal = 9u,  //!< = 9 to 11, columns of the normal model-to-world matrix
+		colour = 12u  //!< = 12, colour, for shaders to multiply their own with
+	};
+
+	//! \brief Draws many copies of the same nodes, each with its own
+	//!        transform and colour, with one instanced draw call per batch.
+	//!
+	//! Instances queued from nodes sharing their geometry, program,
+	//! textures and material constants form a single batch, whose program
+	//! gets its uniforms from the `set_uniforms` function of the first
+	//! node queued in it. Instead of the `vertex_model_to_world` and
+	//! `normal_model_to_world` uniforms, the program reads the matrices of
+	//! each instance, and its colour, from the vertex attributes listed in
+	//! `instance_bindings`; see `shaders/EDAF80/diffuse_instanced.vert`.
+	//! Like non-instanced ones, the program should also decode normals
+	//! when its `compact_vertices` uniform is set, while compact positions
+	//! get dequantised by the instance matrix.
+	//!
+	//! The data of all instances is streamed every frame into a single
+	//! buffer, written sequentially and mapped without synchronisation;
+	//! once full, the buffer is orphaned so the driver can hand out fresh
+	//! storage while previous frames are still being drawn from the old
+	//! one.
+	class instanced_renderer {
+	public:
+		//! \brief Work done by the last `flush()`.
+		struct statistics {
+			std::size_t batches_nb{ 0u };     //!< instanced draw calls issued
+			std::size_t instances_nb{ 0u };   //!< instances drawn
+			std::size_t streamed_bytes{ 0u }; //!< instance data written
+		};
+
+		instanced_renderer() = default;
+		~instanced_renderer();
+		instanced_renderer(instanced_renderer const&) = delete;
+		instanced_renderer& operator=(instanced_renderer const&) = delete;
+
+		//! \brief Queue an instance of a node, using the node's geometry,
+		//!        program and material, but not its children.
+		//!
+		//! Nodes without geometry or program are ignored. The node is
+		//! only referenced, and has to outlive the next `flush()`.
+		//!
+		//! @param [in] node the node to draw an instance of
+		//! @param [in] parent_transform Matrix transforming from
+		//!             parent-space to world-space; the node's own
+		//!             transform is applied first
+		//! @param [in] colour colour of the instance
+		void add(Node const& node, glm::mat4 const& parent_transform = glm::mat4(1.0f),
+		         glm::vec4 const& colour = glm::vec4(1.0f));
+
+		//! \brief Stream the data of all instances queued since the last
+		//!        call, draw each batch, then empty the queue.
+		//!
+		//! @param [in] view_projection Matrix transforming from world-space to clip-space
+		void flush(glm::mat4 const& view_projection);
+
+		statistics const& getStatistics() const;
+
+	private:
+		struct instance {
+			glm::mat4 world;
+			glm::mat3 normal;
+			glm::vec4 colour;
+		};
+		struct batch {
+			Node const* node;
+			std::vector<instance> instances;
+		};
+
+		//! \brief Whether instances of both nodes can be drawn together.
+		static bool canShareBatch(Node const& first, Node const& second);
+
+		//! \brief Point the per-instance attributes of the bound vertex
+		//!        array at a region of the instance buffer, or disable them
+		//!        if `enable` is false.
+		void bindInstanceAttributes(GLintptr offset, bool enable) const;
+
+		//! Batches in use are the first `_batches_nb`; the others keep
+		//! their storage for later frames.
+		std::vector<batch> _batches;
+		std::size_t _batches_nb{ 0u };
+		std::size_t _last_batch{ 0u };
+
+		GLuint _buffer{ 0u };
+		std::size_t _buffer_size{ 0u };
+		std::size_t _buffer_offset{ 0u };
+		std::vector<GLintptr> _batch_offsets;
+		statistics _statistics;
+	};
+}
@@ -0,0 +1,125 @@
+#include "mapped_file.hpp"
+
+#include "core/various.hpp"
+
+#include <utility>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+utils::mapped_file::~mapped_file()
+{
+  close();
+}
+
+utils::mapped_file::mapped_file(mapped_file&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+utils::mapped_file&
+utils::mapped_file::operator=(mapped_file&& other) noexcept
+{
+  if (this == &other)
+    return *this;
+
+  close();
+  std::swap(_data, other._data);
+  std::swap(_size, other._size);
+  std::swap(_is_open, other._is_open);
+#if defined(_WIN32)
+  std::swap(_file, other._file);
+  std::swap(_mapping, other._mapping);
+#endif
+
+  return *this;
+}
+
+bool
+utils::mapped_file::open(std::string const& path)
+{
+  close();
+
+#if defined(_WIN32)
+  HANDLE const file = ::CreateFileW(utils::widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size;
+  if (!::GetFileSizeEx(file, &file_size)) {
+    ::CloseHandle(file);
+    return false;
+  }
+  _file = file;
+  _size = static_cast<std::size_t>(file_size.QuadPart);
+  _is_open = true;
+  if (_size == 0u)
+    return true;
+
+  HANDLE const mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    close();
+    return false;
+  }
+  _mapping = mapping;
+
+  _data = static_cast<std::uint8_t const*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (_data == nullptr) {
+    close();
+    return false;
+  }
+#else
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat file_status;
+  if (::fstat(fd, &file_status) != 0) {
+    ::close(fd);
+    return false;
+  }
+  _size = static_cast<std::size_t>(file_status.st_size);
+  _is_open = true;
+  if (_size == 0u) {
+    ::close(fd);
+    return true;
+  }
+
+  void* const mapping = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    close();
+    return false;
+  }
+  _data = static_cast<std::uint8_t const*>(mapping);
+#endif
+
+  return true;
+}
+
+void
+utils::mapped_file::close() noexcept
+{
+#if defined(_WIN32)
+  if (_data != nullptr)
+    ::UnmapViewOfFile(_data);
+  if (_mapping != nullptr)
+    ::CloseHandle(static_cast<HANDLE>(_mapping));
+  if (_file != nullptr)
+    ::CloseHandle(static_cast<HANDLE>(_file));
+  _mapping = nullptr;
+  _file = nullptr;
+#else
+  if (_data != nullptr)
+    ::munmap(const_cast<std::uint8_t*>(_data), _size);
+#endif
+  _data = nullptr;
+  _size = 0u;
+  _is_open = false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace utils
+{
+
+//! \brief Read-only memory mapping of a whole file.
+//!
+//! The mapping is released when the object is destroyed; any pointer
+//! obtained through `data()` becomes invalid at that point.
+class mapped_file
+{
+public:
+	mapped_file() = default;
+	~mapped_file();
+
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+	mapped_file(mapped_file&& other) noexcept;
+	mapped_file& operator=(mapped_file&& other) noexcept;
+
+	//! \brief Map the file found at `path`, closing any previously
+	//!        mapped file.
+	//!
+	//! @param [in] path UTF-8 encoded path to the file to map
+	//! @return whether the file could be opened and mapped; an empty file
+	//!         is considered as successfully mapped, with a null `data()`
+	bool open(std::string const& path);
+
+	//! \brief Unmap the current file, if any.
+	void close() noexcept;
+
+	bool is_open() const noexcept { return _is_open; }
+	std::uint8_t const* data() const noexcept { return _data; }
+	std::size_t size() const noexcept { return _size; }
+
+private:
+	std::uint8_t const* _data{ nullptr };
+	std::size_t _size{ 0u };
+	bool _is_open{ false };
+#if defined(_WIN32)
+	void* _file{ nullptr };
+	void* _mapping{ nullptr };
+#endif
+};
+
+} // end of namespace utils
@@ -0,0 +1,343 @@
+#include "mesh_cache.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/various.hpp"
+#include "core/vfs.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace
+{
+	std::array<char, 8> const cache_magic = { 'B', 'N', 'B', 'M', 'E', 'S', 'H', '\0' };
+	std::size_t const blob_alignment = 16u;
+
+	std::size_t alignUp(std::size_t value, std::size_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	std::uint32_t countAttributes(std::uint32_t attributes)
+	{
+		std::uint32_t count = 0u;
+		for (; attributes != 0u; attributes &= attributes - 1u)
+			++count;
+		return count;
+	}
+
+	class byte_writer {
+	public:
+		template<typename T>
+		void write(T const& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written as is.");
+			auto const bytes = reinterpret_cast<std::uint8_t const*>(&value);
+			_bytes.insert(_bytes.end(), bytes, bytes + sizeof(T));
+		}
+
+		void write(std::string const& value)
+		{
+			write(static_cast<std::uint32_t>(value.size()));
+			_bytes.insert(_bytes.end(), value.begin(), value.end());
+		}
+
+		std::vector<std::uint8_t> const& bytes() const { return _bytes; }
+
+	private:
+		std::vector<std::uint8_t> _bytes;
+	};
+
+	class byte_reader {
+	public:
+		byte_reader(std::uint8_t const* begin, std::uint8_t const* end) : _current(begin), _end(end) {}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read as is.");
+			if (static_cast<std::size_t>(_end - _current) < sizeof(T))
+				return false;
+			std::memcpy(&value, _current, sizeof(T));
+			_current += sizeof(T);
+			return true;
+		}
+
+		bool read(std::string& value)
+		{
+			std::uint32_t length = 0u;
+			if (!read(length) || static_cast<std::size_t>(_end - _current) < length)
+				return false;
+			value.assign(reinterpret_cast<char const*>(_current), length);
+			_current += length;
+			return true;
+		}
+
+		std::uint8_t const* current() const { return _current; }
+
+	private:
+		std::uint8_t const* _current;
+		std::uint8_t const* _end;
+	};
+
+	void writeMaterialConstants(byte_writer& writer, bonobo::material_data const& constants)
+	{
+		for (auto const& color : { constants.diffuse, constants.specular, constants.ambient, constants.emissive }) {
+			writer.write(color.x);
+			writer.write(color.y);
+			writer.write(color.z);
+		}
+		writer.write(constants.shininess);
+		writer.write(constants.indexOfRefraction);
+		writer.write(constants.opacity);
+	}
+
+	bool readMaterialConstants(byte_reader& reader, bonobo::material_data& constants)
+	{
+		for (auto color : { &constants.diffuse, &constants.specular, &constants.ambient, &constants.emissive })
+			if (!reader.read(color->x) || !reader.read(color->y) || !reader.read(color->z))
+				return false;
+		return reader.read(constants.shininess)
+		    && reader.read(constants.indexOfRefraction)
+		    && reader.read(constants.opacity);
+	}
+}
+
+std::size_t
+bonobo::mesh_cache::getStoredIndicesNb(mesh_record const& mesh)
+{
+	std::size_t indices_nb = mesh.indices_nb;
+	for (auto const& lod : mesh.lods)
+		indices_nb += lod.indices_nb;
+	return indices_nb;
+}
+
+std::uint64_t
+bonobo::mesh_cache::merged_meshes_flags(float cell_size)
+{
+	std::uint32_t cell_size_bits = 0u;
+	std::memcpy(&cell_size_bits, &cell_size, sizeof(cell_size_bits));
+	return (1ull << 33) | (static_cast<std::uint64_t>(cell_size_bits >> 16) << 48);
+}
+
+std::string
+bonobo::mesh_cache::getCacheFilename(std::string const& source_filename)
+{
+	auto const end_of_basedir = source_filename.find_last_of("/\\");
+	auto const basename = end_of_basedir != std::string::npos ? source_filename.substr(end_of_basedir + 1u) : source_filename;
+
+	char hash_as_str[17];
+	std::snprintf(hash_as_str, sizeof(hash_as_str), "%016llx",
+	              static_cast<unsigned long long>(utils::hash_fnv1a(source_filename.data(), source_filename.size())));
+
+	return config::cache_path(basename + "." + hash_as_str + ".meshcache");
+}
+
+bool
+bonobo::mesh_cache::load(std::string const& source_filename, std::uint64_t import_flags, scene_record& scene)
+{
+	std::uint64_t source_size = 0u;
+	std::int64_t source_mtime = 0;
+	if (!utils::vfs::get_status(source_filename, source_size, source_mtime))
+		return false;
+
+	auto const cache_filename = getCacheFilename(source_filename);
+	utils::mapped_file mapping;
+	if (!mapping.open(cache_filename) || mapping.data() == nullptr)
+		return false;
+
+	byte_reader reader(mapping.data(), mapping.data() + mapping.size());
+
+	std::array<char, 8> magic;
+	std::uint32_t version = 0u;
+	std::uint64_t flags = 0u, size = 0u;
+	std::int64_t mtime = 0;
+	std::string path;
+	if (!reader.read(magic) || magic != cache_magic
+	 || !reader.read(version) || version != format_version
+	 || !reader.read(flags) || flags != import_flags
+	 || !reader.read(size) || size != source_size
+	 || !reader.read(mtime) || mtime != source_mtime
+	 || !reader.read(path) || path != source_filename)
+		return false;
+
+	auto const corrupted = [&cache_filename](){
+		LogWarning("Mesh cache file \"%s\" is corrupted and will be rebuilt.", cache_filename.c_str());
+		return false;
+	};
+
+	std::uint32_t materials_nb = 0u;
+	if (!reader.read(materials_nb))
+		return corrupted();
+	std::vector<material_record> materials(materials_nb);
+	for (auto& material : materials) {
+		std::uint32_t textures_nb = 0u;
+		if (!reader.read(material.name) || !readMaterialConstants(reader, material.constants) || !reader.read(textures_nb))
+			return corrupted();
+		material.textures.resize(textures_nb);
+		for (auto& texture : material.textures)
+			if (!reader.read(texture.binding_name) || !reader.read(texture.type_as_str) || !reader.read(texture.path))
+				return corrupted();
+	}
+
+	struct blob_location {
+		std::uint64_t vertex_offset;
+		std::uint64_t index_offset;
+	};
+	std::uint32_t meshes_nb = 0u;
+	if (!reader.read(meshes_nb))
+		return corrupted();
+	std::vector<mesh_record> meshes(meshes_nb);
+	std::vector<blob_location> locations(meshes_nb);
+	for (std::uint32_t i = 0u; i < meshes_nb; ++i) {
+		auto& mesh = meshes[i];
+		std::uint64_t vertex_data_size = 0u;
+		std::uint32_t lods_nb = 0u;
+		if (!reader.read(mesh.name) || !reader.read(mesh.material_id) || !reader.read(mesh.drawing_mode)
+		 || !reader.read(mesh.vertices_nb) || !reader.read(mesh.indices_nb) || !reader.read(mesh.attributes)
+		 || !reader.read(vertex_data_size) || !reader.read(locations[i].vertex_offset) || !reader.read(locations[i].index_offset)
+		 || !reader.read(lods_nb))
+			return corrupted();
+		mesh.vertex_data_size = static_cast<std::size_t>(vertex_data_size);
+		mesh.lods.resize(lods_nb);
+		for (auto& lod : mesh.lods)
+			if (!reader.read(lod.first_index) || !reader.read(lod.indices_nb) || !reader.read(lod.error))
+				return corrupted();
+	}
+
+	auto const data_start = alignUp(static_cast<std::size_t>(reader.current() - mapping.data()), blob_alignment);
+	auto const data_size = mapping.size() - std::min(data_start, mapping.size());
+	for (std::uint32_t i = 0u; i < meshes_nb; ++i) {
+		auto& mesh = meshes[i];
+		auto const stored_indices_nb = static_cast<std::uint64_t>(getStoredIndicesNb(mesh));
+		auto const index_data_size = stored_indices_nb * sizeof(std::uint32_t);
+		for (auto const& lod : mesh.lods)
+			if (static_cast<std::uint64_t>(lod.first_index) + lod.indices_nb > stored_indices_nb)
+				return corrupted();
+		if (mesh.vertex_data_size != static_cast<std::uint64_t>(mesh.vertices_nb) * countAttributes(mesh.attributes) * sizeof(glm::vec3)
+		 || locations[i].vertex_offset > data_size || mesh.vertex_data_size > data_size - locations[i].vertex_offset
+		 || locations[i].index_offset > data_size || index_data_size > data_size - locations[i].index_offset
+		 || locations[i].index_offset % sizeof(std::uint32_t) != 0u
+		 || (mesh.material_id >= materials_nb && materials_nb != 0u))
+			return corrupted();
+
+		mesh.vertex_data = mapping.data() + data_start + locations[i].vertex_offset;
+		mesh.index_data = reinterpret_cast<std::uint32_t const*>(mapping.data() + data_start + locations[i].index_offset);
+
+		// The index data holds the indices of the mesh followed by those
+		// of its levels of detail; none of them may point past the last
+		// vertex, or drawing would read outside of the vertex buffer.
+		std::uint32_t max_index = 0u;
+		for (std::uint64_t j = 0u; j < stored_indices_nb; ++j)
+			max_index = std::max(max_index, mesh.index_data[j]);
+		if (stored_indices_nb != 0u && max_index >= mesh.vertices_nb)
+			return corrupted();
+	}
+
+	scene.materials = std::move(materials);
+	scene.meshes = std::move(meshes);
+	scene.owned_data.clear();
+	scene.mapping = std::move(mapping);
+
+	return true;
+}
+
+bool
+bonobo::mesh_cache::store(std::string const& source_filename, std::uint64_t import_flags, scene_record const& scene)
+{
+	std::uint64_t source_size = 0u;
+	std::int64_t source_mtime = 0;
+	if (!utils::vfs::get_status(source_filename, source_size, source_mtime))
+		return false;
+
+	byte_writer writer;
+	writer.write(cache_magic);
+	writer.write(format_version);
+	writer.write(import_flags);
+	writer.write(source_size);
+	writer.write(source_mtime);
+	writer.write(source_filename);
+
+	writer.write(static_cast<std::uint32_t>(scene.materials.size()));
+	for (auto const& material : scene.materials) {
+		writer.write(material.name);
+		writeMaterialConstants(writer, material.constants);
+		writer.write(static_cast<std::uint32_t>(material.textures.size()));
+		for (auto const& texture : material.textures) {
+			writer.write(texture.binding_name);
+			writer.write(texture.type_as_str);
+			writer.write(texture.path);
+		}
+	}
+
+	// Offsets are relative to the start of the data section, which follows
+	// the metadata once aligned.
+	std::uint64_t data_size = 0u;
+	writer.write(static_cast<std::uint32_t>(scene.meshes.size()));
+	for (auto const& mesh : scene.meshes) {
+		auto const vertex_offset = data_size;
+		data_size = alignUp(static_cast<std::size_t>(data_size + mesh.vertex_data_size), blob_alignment);
+		auto const index_offset = data_size;
+		data_size = alignUp(static_cast<std::size_t>(data_size + getStoredIndicesNb(mesh) * sizeof(std::uint32_t)), blob_alignment);
+
+		writer.write(mesh.name);
+		writer.write(mesh.material_id);
+		writer.write(mesh.drawing_mode);
+		writer.write(mesh.vertices_nb);
+		writer.write(mesh.indices_nb);
+		writer.write(mesh.attributes);
+		writer.write(static_cast<std::uint64_t>(mesh.vertex_data_size));
+		writer.write(vertex_offset);
+		writer.write(index_offset);
+		writer.write(static_cast<std::uint32_t>(mesh.lods.size()));
+		for (auto const& lod : mesh.lods) {
+			writer.write(lod.first_index);
+			writer.write(lod.indices_nb);
+			writer.write(lod.error);
+		}
+	}
+
+	auto const cache_filename = getCacheFilename(source_filename);
+	auto const temporary_filename = cache_filename + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_filename), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			LogWarning("Failed to create mesh cache file \"%s\".", temporary_filename.c_str());
+			return false;
+		}
+
+		std::array<char, blob_alignment> const padding{};
+		auto const write_padded = [&file,&padding](void const* data, std::size_t size){
+			file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+			file.write(padding.data(), static_cast<std::streamsize>(alignUp(size, blob_alignment) - size));
+		};
+
+		write_padded(writer.bytes().data(), writer.bytes().size());
+		for (auto const& mesh : scene.meshes) {
+			write_padded(mesh.vertex_data, mesh.vertex_data_size);
+			write_padded(mesh.index_data, getStoredIndicesNb(mesh) * sizeof(std::uint32_t));
+		}
+
+		if (!file.good()) {
+			LogWarning("Failed to write mesh cache file \"%s\".", temporary_filename.c_str());
+			file.close();
+			std::remove(temporary_filename.c_str());
+			return false;
+		}
+	}
+
+	// Replace the previous entry only once the new one is complete, so that
+	// an interrupted write never leaves a truncated cache file behind.
+	std::remove(cache_filename.c_str());
+	if (std::rename(temporary_filename.c_str(), cache_filename.c_str()) != 0) {
+		LogWarning("Failed to move mesh cache file to \"%s\".", cache_filename.c_str());
+		std::remove(temporary_filename.c_str());
+		return false;
+	}
+
+	return true;
+}
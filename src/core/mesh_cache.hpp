@@ -0,0 +1,141 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief CPU-side version of a scene, as laid out by `loadObjects()`
+	//!        right before it gets uploaded to OpenGL.
+	//!
+	//! This is what gets written to, and read back from, the on-disk mesh
+	//! cache: the vertex and index data pointed to by each mesh either lives
+	//! in `owned_data` (freshly imported scene) or in `mapping` (scene read
+	//! back from the cache).
+	namespace mesh_cache
+	{
+		//! \brief Texture referenced by a material.
+		struct texture_record {
+			std::string binding_name; //!< name of the GLSL sampler, e.g. "diffuse_texture"
+			std::string type_as_str;  //!< human-readable type, e.g. "diffuse"
+			std::string path;         //!< path relative to the folder of the scene file
+		};
+
+		struct material_record {
+			std::string name;
+			material_data constants{};
+			std::vector<texture_record> textures;
+		};
+
+		//! \brief Bit set in `mesh_record::attributes` for each attribute
+		//!        present in the vertex data.
+		constexpr std::uint32_t attribute_bit(shader_bindings binding)
+		{
+			return 1u << static_cast<unsigned int>(binding);
+		}
+
+		//! \brief Simplified version of a mesh, indexing the same vertices.
+		struct lod_record {
+			std::uint32_t first_index{ 0u }; //!< offset into `mesh_record::index_data`
+			std::uint32_t indices_nb{ 0u };
+			float error{ 0.0f };             //!< deviation from the original mesh, in model units
+		};
+
+		//! \brief Geometry of a single mesh.
+		//!
+		//! The vertex data contains one tightly-packed `glm::vec3` stream per
+		//! attribute present, in the order of `shader_bindings`. The index
+		//! data contains the `indices_nb` indices of the mesh itself,
+		//! followed by those of each level of detail.
+		struct mesh_record {
+			std::string name;
+			std::uint32_t material_id{ 0u };
+			GLenum drawing_mode{ GL_TRIANGLES };
+			std::uint32_t vertices_nb{ 0u };
+			std::uint32_t indices_nb{ 0u };
+			std::uint32_t attributes{ 0u };
+			std::uint8_t const* vertex_data{ nullptr };
+			std::size_t vertex_data_size{ 0u };
+			std::uint32_t const* index_data{ nullptr };
+			std::vector<lod_record> lods; //!< from finest to coarsest
+		};
+
+		//! \brief Total number of indices stored for a mesh, including
+		//!        those of its levels of detail.
+		std::size_t getStoredIndicesNb(mesh_record const& mesh);
+
+		struct scene_record {
+			std::vector<material_record> materials;
+			std::vector<mesh_record> meshes;
+			std::vector<std::vector<std::uint8_t>> owned_data;
+			utils::mapped_file mapping;
+		};
+
+		//! \brief Version of the cache file format; bump it whenever the
+		//!        layout of the records changes.
+		constexpr std::uint32_t format_version = 4u;
+
+		//! \brief Flag set in the import flags when meshes were reordered
+		//!        by `mesh_optimisation::optimise()` after being imported.
+		//!
+		//! Assimp flags use the low 32 bits of the import flags, and flags
+		//! for the processing `loadObjects()` applies on top of Assimp use
+		//! the high 32 bits.
+		constexpr std::uint64_t optimised_meshes_flag = 1ull << 32;
+
+		//! \brief Flag set in the import flags when the scene was imported
+		//!        by `obj_loader` rather than by Assimp.
+		constexpr std::uint64_t obj_loader_flag = 1ull << 34;
+
+		//! \brief Flags recording how many levels of detail were generated
+		//!        for each mesh, so that changing that number invalidates
+		//!        cache entries.
+		constexpr std::uint64_t lods_flags(unsigned int lods_nb)
+		{
+			return static_cast<std::uint64_t>(lods_nb & 0xffu) << 40;
+		}
+
+		//! \brief Flags set in the import flags when meshes were merged by
+		//!        material, recording the cell size used so that changing
+		//!        it invalidates cache entries.
+		//!
+		//! The cell size is stored with the precision of a bfloat16 only,
+		//! in the top 16 bits.
+		std::uint64_t merged_meshes_flags(float cell_size);
+
+		//! \brief Path to the cache file that corresponds to a scene file.
+		std::string getCacheFilename(std::string const& source_filename);
+
+		//! \brief Read back a scene from the cache.
+		//!
+		//! The cache entry is only used if it was created with the same
+		//! format version, from the same source file (same path, size and
+		//! modification time) and with the same import flags.
+		//!
+		//! @param [in] source_filename path to the original scene file
+		//! @param [in] import_flags Assimp post-processing flags used when
+		//!             importing the scene, combined with
+		//!             `optimised_meshes_flag`, `lods_flags()` and
+		//!             `merged_meshes_flags()`
+		//! @param [out] scene the scene read back, which memory-maps the
+		//!              cache file
+		//! @return whether a valid cache entry was found
+		bool load(std::string const& source_filename, std::uint64_t import_flags, scene_record& scene);
+
+		//! \brief Write a scene to the cache.
+		//!
+		//! @param [in] source_filename path to the original scene file
+		//! @param [in] import_flags Assimp post-processing flags used when
+		//!             importing the scene, combined with
+		//!             `optimised_meshes_flag`, `lods_flags()` and
+		//!             `merged_meshes_flags()`
+		//! @param [in] scene the scene to write
+		//! @return whether the cache entry could be written
+		bool store(std::string const& source_filename, std::uint64_t import_flags, scene_record const& scene);
+	}
+}
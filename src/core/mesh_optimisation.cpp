@@ -0,0 +1,271 @@
+#include "mesh_optimisation.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	glm::vec3 const& getPosition(glm::vec3 const* positions, std::size_t stride, std::uint32_t index)
+	{
+		return *reinterpret_cast<glm::vec3 const*>(reinterpret_cast<std::uint8_t const*>(positions) + index * stride);
+	}
+
+	//! \brief Number of vertices each triangle adds to a FIFO cache.
+	std::vector<std::uint8_t> simulateVertexCache(std::uint32_t const* indices, std::size_t indices_nb, std::size_t vertices_nb, std::size_t cache_size)
+	{
+		// A vertex is in the cache if fewer than `cache_size` vertices were
+		// added after it; timestamps start past the cache size so that no
+		// vertex is initially considered as cached.
+		std::vector<std::size_t> timestamps(vertices_nb, 0u);
+		std::size_t time = cache_size + 1u;
+
+		std::vector<std::uint8_t> misses(indices_nb / 3u, 0u);
+		for (std::size_t i = 0u; i < indices_nb; ++i) {
+			auto& timestamp = timestamps[indices[i]];
+			if (time - timestamp > cache_size) {
+				timestamp = time++;
+				++misses[i / 3u];
+			}
+		}
+		return misses;
+	}
+}
+
+bonobo::mesh_optimisation::statistics
+bonobo::mesh_optimisation::analyseVertexCache(std::uint32_t const* indices, std::size_t indices_nb, std::size_t vertices_nb, std::size_t cache_size)
+{
+	statistics result;
+	if (indices_nb < 3u)
+		return result;
+
+	auto const misses = simulateVertexCache(indices, indices_nb, vertices_nb, cache_size);
+	auto const misses_nb = std::accumulate(misses.begin(), misses.end(), std::size_t(0u));
+
+	std::vector<bool> is_used(vertices_nb, false);
+	for (std::size_t i = 0u; i < indices_nb; ++i)
+		is_used[indices[i]] = true;
+	auto const used_vertices_nb = std::count(is_used.begin(), is_used.end(), true);
+
+	result.acmr = static_cast<float>(misses_nb) / static_cast<float>(misses.size());
+	result.atvr = static_cast<float>(misses_nb) / static_cast<float>(used_vertices_nb);
+	return result;
+}
+
+void
+bonobo::mesh_optimisation::optimiseVertexCache(std::uint32_t* indices, std::size_t indices_nb, std::size_t vertices_nb,
+                                               std::size_t cache_size, std::vector<std::size_t>& clusters)
+{
+	clusters.clear();
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return;
+
+	// Triangles adjacent to each vertex, and how many of those are still
+	// to be emitted.
+	std::vector<std::uint32_t> live_triangles(vertices_nb, 0u);
+	for (std::size_t i = 0u; i < triangles_nb * 3u; ++i)
+		++live_triangles[indices[i]];
+	std::vector<std::size_t> adjacency_offsets(vertices_nb + 1u, 0u);
+	for (std::size_t v = 0u; v < vertices_nb; ++v)
+		adjacency_offsets[v + 1u] = adjacency_offsets[v] + live_triangles[v];
+	std::vector<std::uint32_t> adjacency(adjacency_offsets.back());
+	{
+		auto fill_offsets = adjacency_offsets;
+		for (std::size_t i = 0u; i < triangles_nb * 3u; ++i)
+			adjacency[fill_offsets[indices[i]]++] = static_cast<std::uint32_t>(i / 3u);
+	}
+
+	std::vector<std::size_t> timestamps(vertices_nb, 0u);
+	std::size_t time = cache_size + 1u;
+	std::vector<bool> is_emitted(triangles_nb, false);
+	std::vector<std::uint32_t> dead_ends;
+	std::vector<std::uint32_t> candidates;
+	std::vector<std::uint32_t> output;
+	output.reserve(triangles_nb * 3u);
+
+	auto const no_vertex = std::numeric_limits<std::size_t>::max();
+	std::size_t cursor = 0u;
+	auto const find_unfinished_vertex = [&](){
+		while (cursor < vertices_nb && live_triangles[cursor] == 0u)
+			++cursor;
+		return cursor < vertices_nb ? cursor : no_vertex;
+	};
+
+	auto fanning_vertex = find_unfinished_vertex();
+	bool is_restarting = true;
+	while (fanning_vertex != no_vertex) {
+		if (is_restarting)
+			clusters.push_back(output.size() / 3u);
+
+		// Emit all the remaining triangles around the fanning vertex.
+		candidates.clear();
+		for (auto k = adjacency_offsets[fanning_vertex]; k < adjacency_offsets[fanning_vertex + 1u]; ++k) {
+			auto const triangle = adjacency[k];
+			if (is_emitted[triangle])
+				continue;
+
+			for (std::size_t c = 0u; c < 3u; ++c) {
+				auto const vertex = indices[triangle * 3u + c];
+				output.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				--live_triangles[vertex];
+				if (time - timestamps[vertex] > cache_size)
+					timestamps[vertex] = time++;
+			}
+			is_emitted[triangle] = true;
+		}
+
+		// Pick the next fanning vertex among the ones just emitted,
+		// favouring those which will still be in the cache once all their
+		// triangles get emitted.
+		auto next_vertex = no_vertex;
+		std::size_t best_priority = 0u;
+		for (auto const vertex : candidates) {
+			if (live_triangles[vertex] == 0u)
+				continue;
+
+			std::size_t priority = 1u;
+			if (time - timestamps[vertex] + 2u * live_triangles[vertex] <= cache_size)
+				priority += time - timestamps[vertex];
+			if (priority > best_priority) {
+				best_priority = priority;
+				next_vertex = vertex;
+			}
+		}
+
+		// Otherwise, backtrack through recently emitted vertices, and as a
+		// last resort, start afresh from any vertex with triangles left.
+		while (next_vertex == no_vertex && !dead_ends.empty()) {
+			auto const vertex = dead_ends.back();
+			dead_ends.pop_back();
+			if (live_triangles[vertex] != 0u)
+				next_vertex = vertex;
+		}
+		is_restarting = next_vertex == no_vertex;
+		if (is_restarting)
+			next_vertex = find_unfinished_vertex();
+
+		fanning_vertex = next_vertex;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void
+bonobo::mesh_optimisation::optimiseOverdraw(std::uint32_t* indices, std::size_t indices_nb,
+                                            glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+                                            std::vector<std::size_t> const& clusters, std::size_t cache_size, float threshold)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u || clusters.empty())
+		return;
+
+	// Split clusters wherever their running cache miss ratio gets back
+	// within `threshold` of the one of the whole cluster (Sander et al.).
+	auto const misses = simulateVertexCache(indices, indices_nb, vertices_nb, cache_size);
+	std::vector<std::size_t> boundaries;
+	for (std::size_t c = 0u; c < clusters.size(); ++c) {
+		auto const begin = clusters[c];
+		auto const end = c + 1u < clusters.size() ? clusters[c + 1u] : triangles_nb;
+		auto const cluster_misses = std::accumulate(misses.begin() + begin, misses.begin() + end, std::size_t(0u));
+		auto const cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+		boundaries.push_back(begin);
+		std::size_t running_misses = 0u, start = begin;
+		for (auto t = begin; t + 1u < end; ++t) {
+			running_misses += misses[t];
+			if (static_cast<float>(running_misses) <= cluster_threshold * static_cast<float>(t + 1u - start)) {
+				boundaries.push_back(t + 1u);
+				start = t + 1u;
+				running_misses = 0u;
+			}
+		}
+	}
+	boundaries.push_back(triangles_nb);
+
+	// Sort clusters by how much they face away from the centre of the
+	// mesh, as those facing outwards are more likely to occlude others.
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	struct cluster_key {
+		std::size_t begin, end;
+		float sort_key;
+	};
+	std::vector<cluster_key> keys;
+	keys.reserve(boundaries.size() - 1u);
+	std::vector<glm::vec3> centroids, normals;
+	centroids.reserve(boundaries.size() - 1u);
+	normals.reserve(boundaries.size() - 1u);
+	for (std::size_t c = 0u; c + 1u < boundaries.size(); ++c) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (auto t = boundaries[c]; t < boundaries[c + 1u]; ++t) {
+			auto const& p0 = getPosition(positions, positions_stride, indices[t * 3u + 0u]);
+			auto const& p1 = getPosition(positions, positions_stride, indices[t * 3u + 1u]);
+			auto const& p2 = getPosition(positions, positions_stride, indices[t * 3u + 2u]);
+			auto const scaled_normal = glm::cross(p1 - p0, p2 - p0);
+			auto const triangle_area = glm::length(scaled_normal);
+			centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+			normal += scaled_normal;
+			area += triangle_area;
+		}
+		mesh_centroid += centroid;
+		mesh_area += area;
+		centroids.push_back(area > 0.0f ? centroid / area : centroid);
+		normals.push_back(glm::length(normal) > 0.0f ? glm::normalize(normal) : normal);
+		keys.push_back({ boundaries[c], boundaries[c + 1u], 0.0f });
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+	for (std::size_t c = 0u; c < keys.size(); ++c)
+		keys[c].sort_key = glm::dot(centroids[c] - mesh_centroid, normals[c]);
+
+	std::stable_sort(keys.begin(), keys.end(), [](cluster_key const& a, cluster_key const& b){
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector<std::uint32_t> output;
+	output.reserve(triangles_nb * 3u);
+	for (auto const& key : keys)
+		output.insert(output.end(), indices + key.begin * 3u, indices + key.end * 3u);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<std::uint32_t>
+bonobo::mesh_optimisation::optimiseVertexFetch(std::uint32_t* indices, std::size_t indices_nb, std::size_t vertices_nb)
+{
+	auto const unassigned = std::numeric_limits<std::uint32_t>::max();
+	std::vector<std::uint32_t> remap(vertices_nb, unassigned);
+
+	std::uint32_t next_index = 0u;
+	for (std::size_t i = 0u; i < indices_nb; ++i) {
+		auto& new_index = remap[indices[i]];
+		if (new_index == unassigned)
+			new_index = next_index++;
+		indices[i] = new_index;
+	}
+	for (auto& new_index : remap)
+		if (new_index == unassigned)
+			new_index = next_index++;
+
+	return remap;
+}
+
+void
+bonobo::mesh_optimisation::optimise(std::uint32_t* indices, std::size_t indices_nb,
+                                    glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+                                    std::vector<std::uint32_t>& remap, statistics& before, statistics& after)
+{
+	before = analyseVertexCache(indices, indices_nb, vertices_nb);
+
+	std::vector<std::size_t> clusters;
+	optimiseVertexCache(indices, indices_nb, vertices_nb, default_cache_size, clusters);
+	optimiseOverdraw(indices, indices_nb, positions, positions_stride, vertices_nb, clusters, default_cache_size);
+	remap = optimiseVertexFetch(indices, indices_nb, vertices_nb);
+
+	after = analyseVertexCache(indices, indices_nb, vertices_nb);
+}
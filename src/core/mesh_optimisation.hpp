@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Reordering of indexed triangle lists, to make better use of
+	//!        the post-transform vertex cache, of early depth testing, and
+	//!        of the pre-transform vertex fetches.
+	//!
+	//! None of these functions issue OpenGL calls or log anything, so they
+	//! can be called from any thread.
+	namespace mesh_optimisation
+	{
+		//! \brief Size of the FIFO post-transform cache that the functions
+		//!        optimise for, and that statistics are measured against.
+		constexpr std::size_t default_cache_size = 16u;
+
+		struct statistics {
+			float acmr{ 0.0f }; //!< average cache miss ratio: transformed vertices per triangle
+			float atvr{ 0.0f }; //!< average transformed vertex ratio: transformed vertices per used vertex
+		};
+
+		//! \brief Simulate a FIFO post-transform cache over a triangle list.
+		statistics analyseVertexCache(std::uint32_t const* indices, std::size_t indices_nb, std::size_t vertices_nb,
+		                              std::size_t cache_size = default_cache_size);
+
+		//! \brief Reorder triangles for vertex cache locality, using
+		//!        Tipsify (Sander et al., "Fast Triangle Reordering for
+		//!        Vertex Locality and Reduced Overdraw", 2007).
+		//!
+		//! @param [in,out] indices the triangle list to reorder
+		//! @param [in] indices_nb number of indices, a multiple of 3
+		//! @param [in] vertices_nb number of vertices indexed
+		//! @param [in] cache_size size of the cache to optimise for
+		//! @param [out] clusters index of the first triangle of each run of
+		//!              triangles that Tipsify started from scratch; these
+		//!              can be reordered freely without hurting the cache
+		void optimiseVertexCache(std::uint32_t* indices, std::size_t indices_nb, std::size_t vertices_nb,
+		                         std::size_t cache_size, std::vector<std::size_t>& clusters);
+
+		//! \brief Reorder the clusters output by `optimiseVertexCache()`
+		//!        so that those facing outwards get drawn first.
+		//!
+		//! Clusters are first split further wherever that does not
+		//! increase their cache miss ratio by more than `threshold`.
+		//!
+		//! @param [in] positions position of the first vertex
+		//! @param [in] positions_stride distance in bytes between the
+		//!             positions of two consecutive vertices
+		void optimiseOverdraw(std::uint32_t* indices, std::size_t indices_nb,
+		                      glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+		                      std::vector<std::size_t> const& clusters, std::size_t cache_size, float threshold = 1.05f);
+
+		//! \brief Renumber vertices in the order they are first used by the
+		//!        triangle list, which gets updated accordingly.
+		//!
+		//! Unused vertices are moved to the end.
+		//!
+		//! @return for each original vertex, its new index; pass it to
+		//!         `remapVertices()` to reorder the vertex data
+		std::vector<std::uint32_t> optimiseVertexFetch(std::uint32_t* indices, std::size_t indices_nb, std::size_t vertices_nb);
+
+		//! \brief Reorder vertex data following the result of
+		//!        `optimiseVertexFetch()`.
+		template<typename T>
+		void remapVertices(std::vector<T>& vertices, std::vector<std::uint32_t> const& remap)
+		{
+			std::vector<T> remapped(vertices.size());
+			for (std::size_t i = 0u; i < vertices.size(); ++i)
+				remapped[remap[i]] = vertices[i];
+			vertices.swap(remapped);
+		}
+
+		//! \brief Run all three passes, in order.
+		//!
+		//! @param [out] remap see `optimiseVertexFetch()`
+		//! @param [out] before statistics of the original triangle list
+		//! @param [out] after statistics of the optimised triangle list
+		void optimise(std::uint32_t* indices, std::size_t indices_nb,
+		              glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+		              std::vector<std::uint32_t>& remap, statistics& before, statistics& after);
+	}
+}
@@ -0,0 +1,260 @@
+#include "mesh_simplification.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	glm::vec3 const& getPosition(glm::vec3 const* positions, std::size_t stride, std::uint32_t index)
+	{
+		return *reinterpret_cast<glm::vec3 const*>(reinterpret_cast<std::uint8_t const*>(positions) + index * stride);
+	}
+
+	//! \brief Sum of squared distances to a set of planes, stored as the
+	//!        upper triangle of a symmetric 4×4 matrix.
+	struct quadric {
+		double a00{ 0.0 }, a01{ 0.0 }, a02{ 0.0 }, a11{ 0.0 }, a12{ 0.0 }, a22{ 0.0 };
+		double b0{ 0.0 }, b1{ 0.0 }, b2{ 0.0 };
+		double c{ 0.0 };
+		double weight{ 0.0 };
+
+		static quadric fromPlane(glm::dvec3 const& normal, double distance, double weight)
+		{
+			quadric q;
+			q.a00 = weight * normal.x * normal.x;
+			q.a01 = weight * normal.x * normal.y;
+			q.a02 = weight * normal.x * normal.z;
+			q.a11 = weight * normal.y * normal.y;
+			q.a12 = weight * normal.y * normal.z;
+			q.a22 = weight * normal.z * normal.z;
+			q.b0 = weight * normal.x * distance;
+			q.b1 = weight * normal.y * distance;
+			q.b2 = weight * normal.z * distance;
+			q.c = weight * distance * distance;
+			q.weight = weight;
+			return q;
+		}
+
+		quadric& operator+=(quadric const& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+			return *this;
+		}
+
+		//! \brief Weighted average of the squared distances to the planes.
+		double evaluate(glm::vec3 const& p) const
+		{
+			auto const x = static_cast<double>(p.x), y = static_cast<double>(p.y), z = static_cast<double>(p.z);
+			auto const value = a00 * x * x + a11 * y * y + a22 * z * z
+			                 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			                 + 2.0 * (b0 * x + b1 * y + b2 * z)
+			                 + c;
+			return weight > 0.0 ? std::max(value, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct position_hash {
+		std::size_t operator()(glm::vec3 const& position) const
+		{
+			std::array<std::uint32_t, 3> bits;
+			std::memcpy(bits.data(), &position.x, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct collapse {
+		std::uint32_t from;
+		std::uint32_t to;
+		double cost;
+	};
+}
+
+std::vector<std::uint32_t>
+bonobo::mesh_simplification::simplify(std::uint32_t const* indices, std::size_t indices_nb,
+                                      glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+                                      std::size_t target_indices_nb, float max_error, float& error)
+{
+	error = 0.0f;
+	std::vector<std::uint32_t> result(indices, indices + indices_nb - indices_nb % 3u);
+	if (result.size() <= target_indices_nb)
+		return result;
+
+	auto const position = [positions,positions_stride](std::uint32_t index) -> glm::vec3 const& {
+		return getPosition(positions, positions_stride, index);
+	};
+
+	// Vertices sharing a position (e.g. on either side of a texture seam)
+	// are represented by the first one of them.
+	std::vector<std::uint32_t> representatives(vertices_nb);
+	std::vector<std::uint32_t> duplicates_nb(vertices_nb, 0u);
+	{
+		std::unordered_map<glm::vec3, std::uint32_t, position_hash> by_position;
+		by_position.reserve(vertices_nb);
+		for (std::uint32_t v = 0u; v < vertices_nb; ++v) {
+			auto const it = by_position.emplace(position(v), v).first;
+			representatives[v] = it->second;
+			++duplicates_nb[it->second];
+		}
+	}
+
+	// Lock vertices on seams and borders, i.e. on edges used by a single
+	// triangle.
+	std::vector<bool> is_locked(vertices_nb, false);
+	{
+		std::unordered_map<std::uint64_t, std::uint32_t> edge_uses;
+		edge_uses.reserve(result.size());
+		for (std::size_t i = 0u; i < result.size(); i += 3u) {
+			for (std::size_t k = 0u; k < 3u; ++k) {
+				auto const a = representatives[result[i + k]];
+				auto const b = representatives[result[i + (k + 1u) % 3u]];
+				auto const key = (static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+				++edge_uses[key];
+			}
+		}
+		for (auto const& edge : edge_uses) {
+			if (edge.second != 1u)
+				continue;
+			is_locked[static_cast<std::uint32_t>(edge.first >> 32)] = true;
+			is_locked[static_cast<std::uint32_t>(edge.first & 0xffffffffu)] = true;
+		}
+		for (std::uint32_t v = 0u; v < vertices_nb; ++v)
+			if (duplicates_nb[representatives[v]] > 1u || is_locked[representatives[v]])
+				is_locked[v] = true;
+	}
+
+	std::vector<quadric> quadrics(vertices_nb);
+	for (std::size_t i = 0u; i < result.size(); i += 3u) {
+		auto const& p0 = position(result[i + 0u]);
+		auto const& p1 = position(result[i + 1u]);
+		auto const& p2 = position(result[i + 2u]);
+		auto const scaled_normal = glm::dvec3(glm::cross(p1 - p0, p2 - p0));
+		auto const double_area = glm::length(scaled_normal);
+		if (double_area == 0.0)
+			continue;
+		auto const normal = scaled_normal / double_area;
+		auto const plane = quadric::fromPlane(normal, -glm::dot(normal, glm::dvec3(p0)), 0.5 * double_area);
+		for (std::size_t k = 0u; k < 3u; ++k)
+			quadrics[representatives[result[i + k]]] += plane;
+	}
+	auto const get_quadric = [&](std::uint32_t v) -> quadric& { return quadrics[representatives[v]]; };
+
+	auto const max_cost = static_cast<double>(max_error) * static_cast<double>(max_error);
+	double largest_cost = 0.0;
+
+	std::vector<std::size_t> adjacency_offsets(vertices_nb + 1u);
+	std::vector<std::uint32_t> adjacency;
+	std::vector<collapse> collapses;
+	std::vector<bool> is_touched(vertices_nb);
+	for (unsigned int pass = 0u; pass < 32u && result.size() > target_indices_nb; ++pass) {
+		// Triangles around each vertex.
+		std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0u);
+		for (auto const index : result)
+			++adjacency_offsets[index + 1u];
+		for (std::size_t v = 0u; v < vertices_nb; ++v)
+			adjacency_offsets[v + 1u] += adjacency_offsets[v];
+		adjacency.resize(result.size());
+		{
+			auto fill_offsets = adjacency_offsets;
+			for (std::size_t i = 0u; i < result.size(); ++i)
+				adjacency[fill_offsets[result[i]]++] = static_cast<std::uint32_t>(i / 3u);
+		}
+
+		// Candidate collapses along every edge, cheapest first.
+		collapses.clear();
+		for (std::size_t i = 0u; i < result.size(); i += 3u) {
+			for (std::size_t k = 0u; k < 3u; ++k) {
+				auto const a = result[i + k];
+				auto const b = result[i + (k + 1u) % 3u];
+				for (auto const& candidate : { collapse{ a, b, 0.0 }, collapse{ b, a, 0.0 } }) {
+					if (is_locked[candidate.from])
+						continue;
+					auto combined = get_quadric(candidate.from);
+					combined += get_quadric(candidate.to);
+					auto const cost = combined.evaluate(position(candidate.to));
+					if (cost <= max_cost)
+						collapses.push_back({ candidate.from, candidate.to, cost });
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+		std::sort(collapses.begin(), collapses.end(), [](collapse const& lhs, collapse const& rhs){
+			return lhs.cost < rhs.cost;
+		});
+
+		std::fill(is_touched.begin(), is_touched.end(), false);
+		auto triangles_nb = result.size() / 3u;
+		auto const target_triangles_nb = target_indices_nb / 3u;
+		std::size_t collapses_nb = 0u;
+		for (auto const& candidate : collapses) {
+			if (triangles_nb <= target_triangles_nb)
+				break;
+			if (is_touched[candidate.from] || is_touched[candidate.to])
+				continue;
+
+			// Reject collapses that would flip a triangle around.
+			auto const& target_position = position(candidate.to);
+			bool flips = false;
+			std::size_t removed_nb = 0u;
+			for (auto k = adjacency_offsets[candidate.from]; k < adjacency_offsets[candidate.from + 1u] && !flips; ++k) {
+				auto const triangle = &result[adjacency[k] * 3u];
+				if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+					continue;
+				if (triangle[0] == candidate.to || triangle[1] == candidate.to || triangle[2] == candidate.to) {
+					++removed_nb;
+					continue;
+				}
+				std::array<glm::vec3, 3> moved = { position(triangle[0]), position(triangle[1]), position(triangle[2]) };
+				auto const before = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				for (std::size_t c = 0u; c < 3u; ++c)
+					if (triangle[c] == candidate.from)
+						moved[c] = target_position;
+				auto const after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			if (flips)
+				continue;
+
+			for (auto k = adjacency_offsets[candidate.from]; k < adjacency_offsets[candidate.from + 1u]; ++k) {
+				auto const triangle = &result[adjacency[k] * 3u];
+				for (std::size_t c = 0u; c < 3u; ++c) {
+					if (triangle[c] == candidate.from)
+						triangle[c] = candidate.to;
+					// The adjacency of the neighbours is now stale.
+					is_touched[triangle[c]] = true;
+				}
+			}
+			is_touched[candidate.from] = true;
+			get_quadric(candidate.to) += get_quadric(candidate.from);
+			largest_cost = std::max(largest_cost, candidate.cost);
+			triangles_nb -= std::min(removed_nb, triangles_nb);
+			++collapses_nb;
+		}
+		if (collapses_nb == 0u)
+			break;
+
+		// Drop the triangles which collapsed to a line.
+		std::size_t kept_nb = 0u;
+		for (std::size_t i = 0u; i < result.size(); i += 3u) {
+			auto const a = result[i + 0u], b = result[i + 1u], c = result[i + 2u];
+			if (a == b || b == c || c == a)
+				continue;
+			result[kept_nb++] = a;
+			result[kept_nb++] = b;
+			result[kept_nb++] = c;
+		}
+		result.resize(kept_nb);
+	}
+
+	error = static_cast<float>(std::sqrt(largest_cost));
+	return result;
+}
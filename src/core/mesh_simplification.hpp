@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Simplification of indexed triangle lists, used to build
+	//!        levels of detail.
+	//!
+	//! None of these functions issue OpenGL calls or log anything, so they
+	//! can be called from any thread.
+	namespace mesh_simplification
+	{
+		//! \brief Reduce the number of triangles of a mesh through edge
+		//!        collapses ordered by quadric error (Garland and Heckbert,
+		//!        "Surface Simplification Using Quadric Error Metrics",
+		//!        1997).
+		//!
+		//! Vertices are only ever collapsed onto other existing vertices,
+		//! so that the result indexes the same vertex buffer as the input.
+		//! Vertices on borders or on attribute seams (i.e. sharing their
+		//! position with other vertices) are never moved.
+		//!
+		//! @param [in] indices the triangle list to simplify
+		//! @param [in] indices_nb number of indices, a multiple of 3
+		//! @param [in] positions position of the first vertex
+		//! @param [in] positions_stride distance in bytes between the
+		//!             positions of two consecutive vertices
+		//! @param [in] vertices_nb number of vertices indexed
+		//! @param [in] target_indices_nb number of indices to stop at
+		//! @param [in] max_error largest distance, in model units, that the
+		//!             simplified surface may deviate from the original one
+		//! @param [out] error estimate of the largest deviation of the
+		//!              result, in model units
+		//! @return the simplified triangle list, which can have more than
+		//!         `target_indices_nb` indices if `max_error` was reached
+		std::vector<std::uint32_t> simplify(std::uint32_t const* indices, std::size_t indices_nb,
+		                                    glm::vec3 const* positions, std::size_t positions_stride, std::size_t vertices_nb,
+		                                    std::size_t target_indices_nb, float max_error, float& error);
+	}
+}
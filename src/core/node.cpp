@@ -20,49 +20,62 @@ Node::render(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint pr
 	if (_vao == 0u || program == 0u)
 		return;
 
+	draw(view_projection, world, glm::transpose(glm::inverse(world)), program, set_uniforms);
+}
+
+void
+Node::render(glm::mat4 const& view_projection, bonobo::scene_graph const& graph, bonobo::scene_graph::node_id graph_node) const
+{
+	if (_program == nullptr || _vao == 0u || *_program == 0u)
+		return;
+
+	draw(view_projection, graph.getWorldMatrix(graph_node), graph.getNormalMatrix(graph_node), *_program, _set_uniforms);
+}
+
+void
+Node::draw(glm::mat4 const& view_projection, glm::mat4 const& world, glm::mat4 const& normal_model_to_world,
+           GLuint program, std::function<void (GLuint)> const& set_uniforms) const
+{
 	utils::opengl::debug::beginDebugGroup(_name);
 
 	glUseProgram(program);
 
-	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
-
 	set_uniforms(program);
 
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(view_projection));
+	auto const& locations = get_uniform_locations(program);
+
+	// Compact positions are relative to the bounds of the mesh, which only
+	// affects positions and not normals.
+	auto const vertex_model_to_world = world * _position_dequantization;
+	glUniformMatrix4fv(locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
+	glUniformMatrix4fv(locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+	glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1i(locations.compact_vertices, _compact_vertices ? 1 : 0);
 
 	for (size_t i = 0u; i < _textures.size(); ++i) {
 		auto const& texture = _textures[i];
 		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
 		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 1);
+		glUniform1i(locations.textures[i].first, static_cast<GLint>(i));
+		glUniform1i(locations.textures[i].second, 1);
 	}
 
-	glUniform3fv(glGetUniformLocation(program, "diffuse_colour"), 1, glm::value_ptr(_constants.diffuse));
-	glUniform3fv(glGetUniformLocation(program, "specular_colour"), 1, glm::value_ptr(_constants.specular));
-	glUniform3fv(glGetUniformLocation(program, "ambient_colour"), 1, glm::value_ptr(_constants.ambient));
-	glUniform3fv(glGetUniformLocation(program, "emissive_colour"), 1, glm::value_ptr(_constants.emissive));
-	glUniform1f(glGetUniformLocation(program, "shininess_value"), _constants.shininess);
-	glUniform1f(glGetUniformLocation(program, "index_of_refraction_value"), _constants.indexOfRefraction);
-	glUniform1f(glGetUniformLocation(program, "opacity_value"), _constants.opacity);
+	glUniform3fv(locations.diffuse_colour, 1, glm::value_ptr(_constants.diffuse));
+	glUniform3fv(locations.specular_colour, 1, glm::value_ptr(_constants.specular));
+	glUniform3fv(locations.ambient_colour, 1, glm::value_ptr(_constants.ambient));
+	glUniform3fv(locations.emissive_colour, 1, glm::value_ptr(_constants.emissive));
+	glUniform1f(locations.shininess_value, _constants.shininess);
+	glUniform1f(locations.index_of_refraction_value, _constants.indexOfRefraction);
+	glUniform1f(locations.opacity_value, _constants.opacity);
 
 	glBindVertexArray(_vao);
-	if (_has_indices)
-		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-	else
-		glDrawArrays(_drawing_mode, 0, _vertices_nb);
+	issue_draw_call();
 	glBindVertexArray(0u);
 
-	for (auto const& texture : _textures) {
-		glBindTexture(std::get<2>(texture), 0);
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), 0);
-
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 0);
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		glBindTexture(std::get<2>(_textures[i]), 0);
+		glUniform1i(locations.textures[i].first, 0);
+		glUniform1i(locations.textures[i].second, 0);
 	}
 
 	glUseProgram(0u);
@@ -70,14 +83,30 @@ Node::render(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint pr
 	utils::opengl::debug::endDebugGroup();
 }
 
+void
+Node::issue_draw_call() const
+{
+	if (_has_indices)
+		glDrawElementsBaseVertex(_drawing_mode, _indices_nb, _index_type,
+		                         reinterpret_cast<GLvoid const*>(static_cast<size_t>(_first_index) * bonobo::getIndexSize(_index_type)), _base_vertex);
+	else
+		glDrawArrays(_drawing_mode, _base_vertex, _vertices_nb);
+}
+
 void
 Node::set_geometry(bonobo::mesh_data const& shape)
 {
 	_vao = shape.vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_base_vertex = shape.base_vertex;
+	_first_index = shape.first_index;
+	_index_type = shape.index_type;
+	_compact_vertices = shape.compact_vertices;
+	_position_dequantization = shape.position_dequantization;
 	_drawing_mode = shape.drawing_mode;
 	_has_indices = shape.ibo != 0u;
+	_bounding_box = shape.bounding_box;
 	_name = std::string("Render ") + shape.name;
 
 	if (!shape.bindings.empty()) {
@@ -145,6 +174,7 @@ Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 	}
 
 	_textures.emplace_back(name, tex_id, type);
+	_uniform_locations.clear();
 }
 
 void
@@ -171,6 +201,44 @@ Node::get_child(size_t index) const
 	return _children[index];
 }
 
+Node::uniform_locations const&
+Node::get_uniform_locations(GLuint program) const
+{
+	// Link generations are shared by all programs, so any link makes every
+	// cached location suspect.
+	auto const link_generation = utils::opengl::shader::get_link_generation();
+	if (link_generation != _uniform_locations_link_generation) {
+		_uniform_locations.clear();
+		_uniform_locations_link_generation = link_generation;
+	}
+	for (auto const& locations : _uniform_locations)
+		if (locations.program == program)
+			return locations;
+
+	uniform_locations locations;
+	locations.program = program;
+	locations.vertex_model_to_world = glGetUniformLocation(program, "vertex_model_to_world");
+	locations.normal_model_to_world = glGetUniformLocation(program, "normal_model_to_world");
+	locations.vertex_world_to_clip = glGetUniformLocation(program, "vertex_world_to_clip");
+	locations.compact_vertices = glGetUniformLocation(program, "compact_vertices");
+	locations.diffuse_colour = glGetUniformLocation(program, "diffuse_colour");
+	locations.specular_colour = glGetUniformLocation(program, "specular_colour");
+	locations.ambient_colour = glGetUniformLocation(program, "ambient_colour");
+	locations.emissive_colour = glGetUniformLocation(program, "emissive_colour");
+	locations.shininess_value = glGetUniformLocation(program, "shininess_value");
+	locations.index_of_refraction_value = glGetUniformLocation(program, "index_of_refraction_value");
+	locations.opacity_value = glGetUniformLocation(program, "opacity_value");
+	locations.textures.reserve(_textures.size());
+	for (auto const& texture : _textures) {
+		auto const& name = std::get<0>(texture);
+		locations.textures.emplace_back(glGetUniformLocation(program, name.c_str()),
+		                                glGetUniformLocation(program, ("has_" + name).c_str()));
+	}
+
+	_uniform_locations.push_back(std::move(locations));
+	return _uniform_locations.back();
+}
+
 TRSTransformf const&
 Node::get_transform() const
 {
@@ -182,3 +250,11 @@ Node::get_transform()
 {
 	return _transform;
 }
+
+bonobo::bounds::box
+Node::get_world_bounding_box(glm::mat4 const& parent_transform) const
+{
+	bonobo::bounds::box world_box;
+	bonobo::bounds::transform(parent_transform * _transform.GetMatrix(), &_bounding_box, 1u, &world_box);
+	return world_box;
+}
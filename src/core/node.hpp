@@ -1,20 +1,32 @@
 #pragma once
 
 #include "helpers.hpp"
+#include "scene_graph.hpp"
 #include "TRSTransform.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+namespace bonobo
+{
+	class instanced_renderer;
+	class render_queue;
+}
+
 //! \brief Represents a node of a scene graph
 class Node
 {
+	friend class bonobo::instanced_renderer;
+	friend class bonobo::render_queue;
+
 public:
 	//! \brief Render this node.
 	//!
@@ -41,6 +53,18 @@ public:
 	            GLuint program,
 	            std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){}) const;
 
+	//! \brief Render this node, placed by a node of a scene graph.
+	//!
+	//! The world and normal matrices computed by the last call to
+	//! `bonobo::scene_graph::update()` are used as is, rather than the
+	//! internal transform of this node; its children are not rendered.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] graph scene graph holding the transform of this node
+	//! @param [in] graph_node node of |graph| placing this node
+	void render(glm::mat4 const& view_projection,
+	            bonobo::scene_graph const& graph, bonobo::scene_graph::node_id graph_node) const;
+
 	//! \brief Set the geometry of this node.
 	//!
 	//! It will overwrite any constants provided by an earlier call to
@@ -130,13 +154,60 @@ public:
 	TRSTransformf const& get_transform() const;
 	TRSTransformf& get_transform();
 
+	//! \brief Return the world-space box enclosing the geometry of this
+	//!        node, as set by `set_geometry()`, for culling.
+	//!
+	//! @param [in] parent_transform Matrix transforming from parent-space
+	//!             to world-space
+	//! @return the axis-aligned box enclosing the transformed model-space
+	//!         box of the geometry
+	bonobo::bounds::box get_world_bounding_box(glm::mat4 const& parent_transform = glm::mat4(1.0f)) const;
+
 private:
+	//! \brief Locations of the uniforms set by `render()` in a given
+	//!        program.
+	struct uniform_locations {
+		GLuint program{ 0u };
+		GLint vertex_model_to_world{ -1 };
+		GLint normal_model_to_world{ -1 };
+		GLint vertex_world_to_clip{ -1 };
+		GLint compact_vertices{ -1 };
+		GLint diffuse_colour{ -1 };
+		GLint specular_colour{ -1 };
+		GLint ambient_colour{ -1 };
+		GLint emissive_colour{ -1 };
+		GLint shininess_value{ -1 };
+		GLint index_of_refraction_value{ -1 };
+		GLint opacity_value{ -1 };
+		//! For each texture, the location of its sampler and of its
+		//! "has_" flag
+		std::vector<std::pair<GLint, GLint>> textures;
+	};
+
+	//! \brief Retrieve the uniform locations of a program, resolving
+	//!        them only if they are not cached yet, or if a program was
+	//!        linked since they were.
+	uniform_locations const& get_uniform_locations(GLuint program) const;
+
+	void draw(glm::mat4 const& view_projection, glm::mat4 const& world, glm::mat4 const& normal_model_to_world,
+	          GLuint program, std::function<void (GLuint)> const& set_uniforms) const;
+
+	//! \brief Issue the draw call for the geometry of this node, whose
+	//!        VAO has to be bound.
+	void issue_draw_call() const;
+
 	// Geometry data
 	GLuint _vao{ 0u };
 	GLsizei _vertices_nb{ 0u };
 	GLsizei _indices_nb{ 0u };
+	GLint _base_vertex{ 0 };
+	GLsizei _first_index{ 0 };
+	GLenum _index_type{ GL_UNSIGNED_INT };
+	bool _compact_vertices{ false };
+	glm::mat4 _position_dequantization{ 1.0f };
 	GLenum _drawing_mode{ GL_TRIANGLES };
 	bool _has_indices{ false };
+	bonobo::bounds::box _bounding_box;
 
 	// Program data
 	GLuint const* _program{ nullptr };
@@ -154,4 +225,9 @@ private:
 
 	// Debug data
 	std::string _name{"Render un-named node"};
+
+	// Uniform locations cache, one entry per program the node was
+	// rendered with
+	mutable std::vector<uniform_locations> _uniform_locations;
+	mutable std::uint64_t _uniform_locations_link_generation{ 0u };
 };
@@ -0,0 +1,793 @@
+#include "obj_loader.hpp"
+
+#include "core/Log.h"
+#include "core/parallel.hpp"
+#include "core/vfs.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	//! \brief Value of an attribute index missing from a face corner.
+	std::int32_t const absent_index = std::numeric_limits<std::int32_t>::min();
+
+	//! \brief Indices of the position, texture coordinates and normal of a
+	//!        face corner, starting from 0.
+	struct corner {
+		std::array<std::int32_t, 3> indices;
+		std::uint8_t relative_mask; //!< bit i is set while `indices[i]` is still relative to the start of its chunk
+	};
+
+	enum class statement_type : std::uint8_t {
+		group,            //!< `o` or `g`
+		material,         //!< `usemtl`
+		material_library  //!< `mtllib`
+	};
+
+	struct statement {
+		statement_type type;
+		std::size_t first_primitive; //!< first primitive of the chunk it applies to
+		std::string name;
+	};
+
+	//! \brief Range of whole lines of the file, and what was parsed from it.
+	struct chunk {
+		char const* begin{ nullptr };
+		char const* end{ nullptr };
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> texcoords;
+		std::vector<glm::vec3> normals;
+		std::vector<corner> corners;               //!< corners of all primitives, one after the other
+		std::vector<std::uint8_t> primitive_sizes; //!< 1 for points, 2 for lines and 3 for triangles
+		std::vector<statement> statements;
+		std::size_t malformed_lines_nb{ 0u };
+	};
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	char const* skipSpaces(char const* p, char const* end)
+	{
+		while (p != end && isSpace(*p))
+			++p;
+		return p;
+	}
+
+	char const* skipToken(char const* p, char const* end)
+	{
+		while (p != end && !isSpace(*p))
+			++p;
+		return p;
+	}
+
+	bool matches(char const* begin, char const* end, char const* keyword)
+	{
+		auto const length = std::strlen(keyword);
+		return static_cast<std::size_t>(end - begin) == length && std::memcmp(begin, keyword, length) == 0;
+	}
+
+	//! \brief Rest of a line, without leading and trailing spaces.
+	std::string trimmed(char const* begin, char const* end)
+	{
+		begin = skipSpaces(begin, end);
+		while (end != begin && isSpace(*(end - 1)))
+			--end;
+		return std::string(begin, end);
+	}
+
+	double const powers_of_ten[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	//! \brief Parse a decimal number, as printed by exporters.
+	//!
+	//! Up to 19 significant digits are accumulated into an integer, which
+	//! then gets scaled by an exact power of ten; this rounds correctly
+	//! for the short numbers found in OBJ files, and is off by at most one
+	//! ulp for numbers with more than 15 digits. Anything more exotic, like
+	//! "nan" or hexadecimal numbers, goes through `std::strtod()`.
+	//!
+	//! @return the end of the number, or null if there was none
+	char const* parseFloat(char const* p, char const* end, float& value)
+	{
+		auto const start = p;
+		bool const is_negative = p != end && *p == '-';
+		if (p != end && (*p == '-' || *p == '+'))
+			++p;
+
+		std::uint64_t mantissa = 0u;
+		int exponent = 0, significant_digits_nb = 0;
+		bool has_digits = false;
+		for (; p != end && isDigit(*p); ++p) {
+			has_digits = true;
+			if (significant_digits_nb < 19) {
+				mantissa = mantissa * 10u + static_cast<std::uint64_t>(*p - '0');
+				significant_digits_nb += mantissa != 0u ? 1 : 0;
+			} else {
+				++exponent;
+			}
+		}
+		if (p != end && *p == '.') {
+			for (++p; p != end && isDigit(*p); ++p) {
+				has_digits = true;
+				if (significant_digits_nb < 19) {
+					mantissa = mantissa * 10u + static_cast<std::uint64_t>(*p - '0');
+					significant_digits_nb += mantissa != 0u ? 1 : 0;
+					--exponent;
+				}
+			}
+		}
+		if (has_digits && p != end && (*p == 'e' || *p == 'E')) {
+			auto q = p + 1;
+			bool const is_exponent_negative = q != end && *q == '-';
+			if (q != end && (*q == '-' || *q == '+'))
+				++q;
+			if (q != end && isDigit(*q)) {
+				int explicit_exponent = 0;
+				for (; q != end && isDigit(*q); ++q)
+					explicit_exponent = std::min(explicit_exponent * 10 + (*q - '0'), 100000);
+				exponent += is_exponent_negative ? -explicit_exponent : explicit_exponent;
+				p = q;
+			}
+		}
+
+		if (!has_digits || (p != end && !isSpace(*p))) {
+			// Copy the token, as the file is not null-terminated.
+			char buffer[64];
+			auto const token_end = skipToken(start, end);
+			auto const length = std::min(static_cast<std::size_t>(token_end - start), sizeof(buffer) - 1u);
+			std::memcpy(buffer, start, length);
+			buffer[length] = '\0';
+			char* parsed_end = nullptr;
+			auto const parsed = std::strtod(buffer, &parsed_end);
+			if (parsed_end == buffer || parsed_end != buffer + length)
+				return nullptr;
+			value = static_cast<float>(parsed);
+			return start + length;
+		}
+
+		auto result = static_cast<double>(mantissa);
+		if (exponent < 0)
+			result = exponent >= -22 ? result / powers_of_ten[-exponent] : result * std::pow(10.0, exponent);
+		else if (exponent > 0)
+			result = exponent <= 22 ? result * powers_of_ten[exponent] : result * std::pow(10.0, exponent);
+		value = static_cast<float>(is_negative ? -result : result);
+		return p;
+	}
+
+	//! \brief Parse up to `max_nb` numbers separated by spaces.
+	//!
+	//! @return how many numbers were parsed, or -1 if something else than
+	//!         a number was found
+	int parseFloats(char const* p, char const* end, float* values, int max_nb)
+	{
+		int count = 0;
+		for (p = skipSpaces(p, end); p != end && count < max_nb; p = skipSpaces(p, end)) {
+			p = parseFloat(p, end, values[count]);
+			if (p == nullptr)
+				return -1;
+			++count;
+		}
+		return count;
+	}
+
+	//! \brief Parse the index of an attribute in a face corner, turning it
+	//!        into an index starting from 0.
+	//!
+	//! Negative indices count backwards from the last attribute parsed in
+	//! the file; the chunk only knows how many it parsed itself, so those
+	//! are left relative to its start, to be rebased once all chunks have
+	//! been parsed.
+	char const* parseIndex(char const* p, char const* end, std::size_t parsed_nb, std::int32_t& index, bool& is_relative)
+	{
+		bool const is_negative = p != end && *p == '-';
+		if (is_negative)
+			++p;
+		if (p == end || !isDigit(*p))
+			return nullptr;
+		std::int64_t value = 0;
+		for (; p != end && isDigit(*p); ++p)
+			value = std::min<std::int64_t>(value * 10 + (*p - '0'), std::numeric_limits<std::int32_t>::max());
+		if (value == 0)
+			return nullptr;
+
+		is_relative = is_negative;
+		value = is_negative ? static_cast<std::int64_t>(parsed_nb) - value : value - 1;
+		if (value < std::numeric_limits<std::int32_t>::min() + 1 || value > std::numeric_limits<std::int32_t>::max())
+			return nullptr;
+		index = static_cast<std::int32_t>(value);
+		return p;
+	}
+
+	//! \brief Parse the corners of an `f`, `l` or `p` statement.
+	bool parseCorners(chunk& c, char const* p, char const* end, std::vector<corner>& corners)
+	{
+		corners.clear();
+		std::array<std::size_t, 3> const parsed_nb = {{ c.positions.size(), c.texcoords.size(), c.normals.size() }};
+		for (p = skipSpaces(p, end); p != end; p = skipSpaces(p, end)) {
+			corner current{ {{ absent_index, absent_index, absent_index }}, 0u };
+			for (unsigned int attribute = 0u; attribute < 3u; ++attribute) {
+				// Texture coordinates may be skipped, as in "1//1".
+				if (attribute == 0u || p == end || *p != '/') {
+					bool is_relative = false;
+					p = parseIndex(p, end, parsed_nb[attribute], current.indices[attribute], is_relative);
+					if (p == nullptr)
+						return false;
+					current.relative_mask |= static_cast<std::uint8_t>(is_relative ? 1u << attribute : 0u);
+				}
+				if (p == end || *p != '/')
+					break;
+				++p;
+			}
+			if (p != end && !isSpace(*p))
+				return false;
+			corners.push_back(current);
+		}
+		return !corners.empty();
+	}
+
+	void parseLine(chunk& c, char const* p, char const* end, std::vector<corner>& corners)
+	{
+		p = skipSpaces(p, end);
+		if (p == end || *p == '#')
+			return;
+
+		auto const keyword_end = skipToken(p, end);
+		auto const add_statement = [&c,keyword_end,end](statement_type type){
+			c.statements.push_back({ type, c.primitive_sizes.size(), trimmed(keyword_end, end) });
+		};
+		bool is_valid = true;
+		if (matches(p, keyword_end, "v")) {
+			float values[3];
+			// A fourth component (w, or the red channel of a vertex colour)
+			// is ignored.
+			is_valid = parseFloats(keyword_end, end, values, 3) == 3;
+			if (is_valid)
+				c.positions.emplace_back(values[0], values[1], values[2]);
+		} else if (matches(p, keyword_end, "vt")) {
+			float values[3] = { 0.0f, 0.0f, 0.0f };
+			is_valid = parseFloats(keyword_end, end, values, 3) >= 1;
+			if (is_valid)
+				c.texcoords.emplace_back(values[0], values[1], values[2]);
+		} else if (matches(p, keyword_end, "vn")) {
+			float values[3];
+			is_valid = parseFloats(keyword_end, end, values, 3) == 3;
+			if (is_valid)
+				c.normals.emplace_back(values[0], values[1], values[2]);
+		} else if (matches(p, keyword_end, "f")) {
+			is_valid = parseCorners(c, keyword_end, end, corners);
+			if (is_valid && corners.size() < 3u) {
+				// Degenerate faces end up as points or lines, as with Assimp.
+				c.corners.insert(c.corners.end(), corners.begin(), corners.end());
+				c.primitive_sizes.push_back(static_cast<std::uint8_t>(corners.size()));
+			} else if (is_valid) {
+				for (std::size_t i = 1u; i + 1u < corners.size(); ++i) {
+					c.corners.push_back(corners[0u]);
+					c.corners.push_back(corners[i]);
+					c.corners.push_back(corners[i + 1u]);
+					c.primitive_sizes.push_back(3u);
+				}
+			}
+		} else if (matches(p, keyword_end, "l")) {
+			is_valid = parseCorners(c, keyword_end, end, corners) && corners.size() >= 2u;
+			for (std::size_t i = 0u; is_valid && i + 1u < corners.size(); ++i) {
+				c.corners.push_back(corners[i]);
+				c.corners.push_back(corners[i + 1u]);
+				c.primitive_sizes.push_back(2u);
+			}
+		} else if (matches(p, keyword_end, "p")) {
+			is_valid = parseCorners(c, keyword_end, end, corners);
+			if (is_valid) {
+				c.corners.insert(c.corners.end(), corners.begin(), corners.end());
+				c.primitive_sizes.insert(c.primitive_sizes.end(), corners.size(), 1u);
+			}
+		} else if (matches(p, keyword_end, "o") || matches(p, keyword_end, "g")) {
+			add_statement(statement_type::group);
+		} else if (matches(p, keyword_end, "usemtl")) {
+			add_statement(statement_type::material);
+		} else if (matches(p, keyword_end, "mtllib")) {
+			add_statement(statement_type::material_library);
+		}
+		// Anything else, like smoothing groups, is ignored.
+
+		if (!is_valid)
+			++c.malformed_lines_nb;
+	}
+
+	void parseChunk(chunk& c)
+	{
+		std::vector<corner> corners;
+		for (auto p = c.begin; p != c.end;) {
+			auto line_end = static_cast<char const*>(std::memchr(p, '\n', static_cast<std::size_t>(c.end - p)));
+			if (line_end == nullptr)
+				line_end = c.end;
+			parseLine(c, p, line_end, corners);
+			p = line_end == c.end ? c.end : line_end + 1;
+		}
+	}
+
+	//! \brief Parse the texture statement of a material, skipping its
+	//!        options to only keep the path.
+	std::string parseTexturePath(char const* p, char const* end)
+	{
+		struct option {
+			char const* name;
+			int max_arguments_nb;
+			bool are_arguments_numbers;
+		};
+		static option const options[] = {
+			{ "-blendu", 1, false }, { "-blendv", 1, false }, { "-cc", 1, false },
+			{ "-clamp", 1, false }, { "-imfchan", 1, false }, { "-type", 1, false },
+			{ "-boost", 1, true }, { "-texres", 1, true }, { "-bm", 1, true },
+			{ "-mm", 2, true }, { "-o", 3, true }, { "-s", 3, true }, { "-t", 3, true }
+		};
+
+		for (p = skipSpaces(p, end); p != end && *p == '-'; p = skipSpaces(p, end)) {
+			auto const name_end = skipToken(p, end);
+			auto const found = std::find_if(std::begin(options), std::end(options),
+			                                [p,name_end](option const& o){ return matches(p, name_end, o.name); });
+			if (found == std::end(options))
+				break;
+			p = name_end;
+			for (int i = 0; i < found->max_arguments_nb; ++i) {
+				auto const argument = skipSpaces(p, end);
+				float number = 0.0f;
+				if (argument == end || (found->are_arguments_numbers && parseFloat(argument, end, number) == nullptr))
+					break;
+				p = skipToken(argument, end);
+			}
+		}
+		return trimmed(p, end);
+	}
+
+	//! \brief Parse an MTL file, appending its materials to those already
+	//!        found.
+	void parseMaterialLibrary(char const* p, char const* end, std::vector<bonobo::mesh_cache::material_record>& materials,
+	                          std::unordered_map<std::string, std::uint32_t>& material_ids)
+	{
+		bonobo::mesh_cache::material_record* material = nullptr;
+		while (p != end) {
+			auto line_end = static_cast<char const*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+			if (line_end == nullptr)
+				line_end = end;
+			auto const line = skipSpaces(p, line_end);
+			p = line_end == end ? end : line_end + 1;
+			if (line == line_end || *line == '#')
+				continue;
+
+			auto const keyword_end = skipToken(line, line_end);
+			if (matches(line, keyword_end, "newmtl")) {
+				auto const name = trimmed(keyword_end, line_end);
+				auto const id = material_ids.find(name);
+				if (id != material_ids.end()) {
+					// Later definitions replace earlier ones.
+					material = &materials[id->second];
+					*material = bonobo::mesh_cache::material_record();
+				} else {
+					material_ids.emplace(name, static_cast<std::uint32_t>(materials.size()));
+					materials.emplace_back();
+					material = &materials.back();
+				}
+				material->name = name;
+				continue;
+			}
+			if (material == nullptr)
+				continue;
+
+			auto& constants = material->constants;
+			auto const parse_color = [keyword_end,line_end](glm::vec3& color){
+				float values[3];
+				auto const count = parseFloats(keyword_end, line_end, values, 3);
+				if (count == 1)
+					color = glm::vec3(values[0]);
+				else if (count == 3)
+					color = glm::vec3(values[0], values[1], values[2]);
+			};
+			auto const parse_scalar = [keyword_end,line_end](float& value){
+				float parsed = 0.0f;
+				if (parseFloats(keyword_end, line_end, &parsed, 1) == 1)
+					value = parsed;
+			};
+			auto const add_texture = [material,keyword_end,line_end](std::string const& binding_name, std::string const& type_as_str){
+				auto path = parseTexturePath(keyword_end, line_end);
+				if (path.empty())
+					return;
+				for (auto const& texture : material->textures)
+					if (texture.binding_name == binding_name)
+						return;
+				material->textures.push_back({ binding_name, type_as_str, std::move(path) });
+			};
+
+			if (matches(line, keyword_end, "Kd")) {
+				parse_color(constants.diffuse);
+			} else if (matches(line, keyword_end, "Ks")) {
+				parse_color(constants.specular);
+			} else if (matches(line, keyword_end, "Ka")) {
+				parse_color(constants.ambient);
+			} else if (matches(line, keyword_end, "Ke")) {
+				parse_color(constants.emissive);
+			} else if (matches(line, keyword_end, "Ns")) {
+				parse_scalar(constants.shininess);
+			} else if (matches(line, keyword_end, "Ni")) {
+				parse_scalar(constants.indexOfRefraction);
+			} else if (matches(line, keyword_end, "d")) {
+				parse_scalar(constants.opacity);
+			} else if (matches(line, keyword_end, "Tr")) {
+				float transparency = 0.0f;
+				parse_scalar(transparency);
+				constants.opacity = 1.0f - transparency;
+			} else if (matches(line, keyword_end, "map_Kd")) {
+				add_texture("diffuse_texture", "diffuse");
+			} else if (matches(line, keyword_end, "map_Ks")) {
+				add_texture("specular_texture", "specular");
+			} else if (matches(line, keyword_end, "norm")) {
+				// Like Assimp, bump maps ("bump", "map_bump") are taken as
+				// height maps, which are not used.
+				add_texture("normals_texture", "normals");
+			} else if (matches(line, keyword_end, "map_d")) {
+				add_texture("opacity_texture", "opacity");
+			}
+		}
+	}
+
+	//! \brief Corners gathered for a mesh, before deduplication.
+	struct mesh_builder {
+		std::string name;
+		std::uint32_t material_id{ 0u };
+		std::uint8_t primitive_size{ 3u };
+		std::vector<corner> corners;
+	};
+
+	std::uint32_t hashCorner(corner const& c)
+	{
+		auto hash = static_cast<std::uint32_t>(c.indices[0]) * 0x9e3779b1u;
+		hash = (hash ^ (hash >> 15)) + static_cast<std::uint32_t>(c.indices[1]) * 0x85ebca77u;
+		hash = (hash ^ (hash >> 13)) + static_cast<std::uint32_t>(c.indices[2]) * 0xc2b2ae3du;
+		return hash ^ (hash >> 16);
+	}
+
+	//! \brief Tangent and binormal of each vertex, from the texture
+	//!        coordinates of the triangles using it, orthogonalised
+	//!        against its normal.
+	void computeTangents(std::vector<glm::vec3> const& positions, std::vector<glm::vec3> const& normals,
+	                     std::vector<glm::vec3> const& texcoords, std::vector<std::uint32_t> const& indices,
+	                     std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& binormals)
+	{
+		tangents.assign(positions.size(), glm::vec3(0.0f));
+		binormals.assign(positions.size(), glm::vec3(0.0f));
+		for (std::size_t i = 0u; i + 2u < indices.size(); i += 3u) {
+			auto const i0 = indices[i], i1 = indices[i + 1u], i2 = indices[i + 2u];
+			auto const edge1 = positions[i1] - positions[i0];
+			auto const edge2 = positions[i2] - positions[i0];
+			auto const delta_uv1 = texcoords[i1] - texcoords[i0];
+			auto const delta_uv2 = texcoords[i2] - texcoords[i0];
+			auto const determinant = delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y;
+			if (std::abs(determinant) < 1.0e-20f)
+				continue;
+			// Left unnormalised, so that larger triangles weigh more.
+			auto const tangent = (edge1 * delta_uv2.y - edge2 * delta_uv1.y) * (1.0f / determinant);
+			auto const binormal = (edge2 * delta_uv1.x - edge1 * delta_uv2.x) * (1.0f / determinant);
+			for (auto const v : { i0, i1, i2 }) {
+				tangents[v] = tangents[v] + tangent;
+				binormals[v] = binormals[v] + binormal;
+			}
+		}
+
+		for (std::size_t v = 0u; v < positions.size(); ++v) {
+			auto const n = normals[v];
+			auto t = tangents[v] - n * glm::dot(n, tangents[v]);
+			if (glm::dot(t, t) > 1.0e-20f)
+				t = glm::normalize(t);
+			else
+				t = glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+			auto b = binormals[v] - n * glm::dot(n, binormals[v]) - t * glm::dot(t, binormals[v]);
+			if (glm::dot(b, b) > 1.0e-20f)
+				b = glm::normalize(b);
+			else
+				b = glm::cross(n, t);
+			tangents[v] = t;
+			binormals[v] = b;
+		}
+	}
+
+	//! \brief Deduplicate the corners of a mesh and lay it out as
+	//!        `importScene()` does in helpers.cpp.
+	//!
+	//! Attributes only some corners have are dropped.
+	//!
+	//! @return whether all indices were within range
+	bool buildMesh(mesh_builder const& builder, std::vector<glm::vec3> const& positions,
+	               std::vector<glm::vec3> const& texcoords, std::vector<glm::vec3> const& normals,
+	               bonobo::mesh_cache::mesh_record& mesh, std::vector<std::uint8_t>& data)
+	{
+		using bonobo::mesh_cache::attribute_bit;
+
+		std::array<std::size_t, 3> const attributes_nb = {{ positions.size(), texcoords.size(), normals.size() }};
+		std::array<bool, 3> is_present = {{ true, true, true }};
+		for (auto const& c : builder.corners) {
+			for (unsigned int attribute = 0u; attribute < 3u; ++attribute) {
+				auto const index = c.indices[attribute];
+				if (index == absent_index)
+					is_present[attribute] = false;
+				else if (index < 0 || static_cast<std::size_t>(index) >= attributes_nb[attribute])
+					return false;
+			}
+		}
+		if (!is_present[0u])
+			return false;
+
+		// Open addressing, with linear probing; slots hold the index of a
+		// unique vertex plus one, so that 0 marks an empty slot.
+		std::size_t capacity = 16u;
+		while (capacity < builder.corners.size() * 2u)
+			capacity *= 2u;
+		std::vector<std::uint32_t> slots(capacity, 0u);
+		std::vector<corner> unique_corners;
+		std::vector<std::uint32_t> indices;
+		indices.reserve(builder.corners.size());
+		for (auto c : builder.corners) {
+			for (unsigned int attribute = 1u; attribute < 3u; ++attribute)
+				if (!is_present[attribute])
+					c.indices[attribute] = absent_index;
+			auto slot = hashCorner(c) & (capacity - 1u);
+			for (; slots[slot] != 0u; slot = (slot + 1u) & (capacity - 1u))
+				if (unique_corners[slots[slot] - 1u].indices == c.indices)
+					break;
+			if (slots[slot] == 0u) {
+				unique_corners.push_back(c);
+				slots[slot] = static_cast<std::uint32_t>(unique_corners.size());
+			}
+			indices.push_back(slots[slot] - 1u);
+		}
+
+		auto const vertices_nb = unique_corners.size();
+		std::vector<std::vector<glm::vec3>> streams(1u);
+		streams[0u].reserve(vertices_nb);
+		for (auto const& c : unique_corners)
+			streams[0u].push_back(positions[static_cast<std::size_t>(c.indices[0u])]);
+		mesh.attributes = attribute_bit(bonobo::shader_bindings::vertices);
+		if (is_present[2u]) {
+			streams.emplace_back();
+			streams.back().reserve(vertices_nb);
+			for (auto const& c : unique_corners)
+				streams.back().push_back(normals[static_cast<std::size_t>(c.indices[2u])]);
+			mesh.attributes |= attribute_bit(bonobo::shader_bindings::normals);
+		}
+		if (is_present[1u]) {
+			streams.emplace_back();
+			streams.back().reserve(vertices_nb);
+			for (auto const& c : unique_corners)
+				streams.back().push_back(texcoords[static_cast<std::size_t>(c.indices[1u])]);
+			mesh.attributes |= attribute_bit(bonobo::shader_bindings::texcoords);
+		}
+		if (builder.primitive_size == 3u && is_present[1u] && is_present[2u]) {
+			std::vector<glm::vec3> tangents, binormals;
+			computeTangents(streams[0u], streams[1u], streams[2u], indices, tangents, binormals);
+			streams.push_back(std::move(tangents));
+			streams.push_back(std::move(binormals));
+			mesh.attributes |= attribute_bit(bonobo::shader_bindings::tangents)
+			                 | attribute_bit(bonobo::shader_bindings::binormals);
+		}
+
+		mesh.name = builder.name;
+		mesh.material_id = builder.material_id;
+		mesh.drawing_mode = builder.primitive_size == 1u ? GL_POINTS
+		                  : builder.primitive_size == 2u ? GL_LINES
+		                  : GL_TRIANGLES;
+		mesh.vertices_nb = static_cast<std::uint32_t>(vertices_nb);
+		mesh.indices_nb = static_cast<std::uint32_t>(indices.size());
+
+		auto const stream_size = vertices_nb * sizeof(glm::vec3);
+		mesh.vertex_data_size = stream_size * streams.size();
+		data.resize(mesh.vertex_data_size + indices.size() * sizeof(std::uint32_t));
+		for (std::size_t k = 0u; k < streams.size(); ++k)
+			std::memcpy(data.data() + k * stream_size, streams[k].data(), stream_size);
+		std::memcpy(data.data() + mesh.vertex_data_size, indices.data(), indices.size() * sizeof(std::uint32_t));
+		mesh.vertex_data = data.data();
+		mesh.index_data = reinterpret_cast<std::uint32_t const*>(data.data() + mesh.vertex_data_size);
+
+		return true;
+	}
+
+	//! \brief Size of the chunks a file is split into; smaller files get
+	//!        parsed in a single chunk.
+	std::size_t const min_chunk_size = 256u * 1024u;
+}
+
+bool
+bonobo::obj_loader::isObjFile(std::string const& filename)
+{
+	auto const extension_start = filename.find_last_of('.');
+	if (extension_start == std::string::npos)
+		return false;
+	auto extension = filename.substr(extension_start + 1u);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+	               [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+	return extension == "obj";
+}
+
+bool
+bonobo::obj_loader::load(std::string const& filename, mesh_cache::scene_record& scene)
+{
+	auto const file = utils::vfs::read(filename);
+	if (!file.is_valid()) {
+		LogError("Failed to open \"%s\"", filename.c_str());
+		return false;
+	}
+	auto const end_of_basedir = filename.find_last_of("/\\");
+	auto const parent_folder = end_of_basedir != std::string::npos ? filename.substr(0u, end_of_basedir + 1u) : std::string();
+
+	// Split the file into chunks of whole lines.
+	auto const file_begin = reinterpret_cast<char const*>(file.data());
+	auto const file_end = file_begin + file.size();
+	auto const chunk_size = std::max(min_chunk_size, file.size() / (utils::parallel::worker_count() * 4u) + 1u);
+	std::vector<chunk> chunks;
+	for (auto p = file_begin; p != file_end;) {
+		auto chunk_end = p + std::min(chunk_size, static_cast<std::size_t>(file_end - p));
+		if (chunk_end != file_end) {
+			auto const line_end = static_cast<char const*>(std::memchr(chunk_end, '\n', static_cast<std::size_t>(file_end - chunk_end)));
+			chunk_end = line_end != nullptr ? line_end + 1 : file_end;
+		}
+		chunks.emplace_back();
+		chunks.back().begin = p;
+		chunks.back().end = chunk_end;
+		p = chunk_end;
+	}
+
+	utils::parallel::for_each_index(chunks.size(), [&chunks](std::size_t i){
+		parseChunk(chunks[i]);
+	});
+
+	// Gather the attributes of all chunks, and rebase relative indices.
+	std::vector<std::array<std::size_t, 3>> bases(chunks.size());
+	std::array<std::size_t, 3> totals = {{ 0u, 0u, 0u }};
+	std::size_t malformed_lines_nb = 0u;
+	for (std::size_t i = 0u; i < chunks.size(); ++i) {
+		bases[i] = totals;
+		totals[0u] += chunks[i].positions.size();
+		totals[1u] += chunks[i].texcoords.size();
+		totals[2u] += chunks[i].normals.size();
+		malformed_lines_nb += chunks[i].malformed_lines_nb;
+	}
+	std::vector<glm::vec3> positions(totals[0u]), texcoords(totals[1u]), normals(totals[2u]);
+	utils::parallel::for_each_index(chunks.size(), [&](std::size_t i){
+		auto& c = chunks[i];
+		std::copy(c.positions.begin(), c.positions.end(), positions.begin() + static_cast<std::ptrdiff_t>(bases[i][0u]));
+		std::copy(c.texcoords.begin(), c.texcoords.end(), texcoords.begin() + static_cast<std::ptrdiff_t>(bases[i][1u]));
+		std::copy(c.normals.begin(), c.normals.end(), normals.begin() + static_cast<std::ptrdiff_t>(bases[i][2u]));
+		std::vector<glm::vec3>().swap(c.positions);
+		std::vector<glm::vec3>().swap(c.texcoords);
+		std::vector<glm::vec3>().swap(c.normals);
+		for (auto& current : c.corners) {
+			for (unsigned int attribute = 0u; attribute < 3u; ++attribute)
+				if (current.relative_mask & (1u << attribute))
+					current.indices[attribute] = static_cast<std::int32_t>(current.indices[attribute] + static_cast<std::int64_t>(bases[i][attribute]));
+			current.relative_mask = 0u;
+		}
+	});
+	if (malformed_lines_nb != 0u)
+		LogWarning("%zu malformed lines were ignored in \"%s\".", malformed_lines_nb, filename.c_str());
+
+	// Materials; one with default values is added at the end for the
+	// faces that do not reference any known material.
+	std::vector<mesh_cache::material_record> materials;
+	std::unordered_map<std::string, std::uint32_t> material_ids;
+	for (auto const& c : chunks) {
+		for (auto const& current : c.statements) {
+			if (current.type != statement_type::material_library)
+				continue;
+			auto const library = utils::vfs::read(parent_folder + current.name);
+			if (!library.is_valid()) {
+				LogWarning("Material library \"%s\" referenced by \"%s\" could not be opened.", current.name.c_str(), filename.c_str());
+				continue;
+			}
+			auto const library_begin = reinterpret_cast<char const*>(library.data());
+			parseMaterialLibrary(library_begin, library_begin + library.size(), materials, material_ids);
+		}
+	}
+	auto const default_material_id = static_cast<std::uint32_t>(materials.size());
+	bool is_default_material_used = false;
+
+	// Assign primitives to meshes, following the statements interleaved
+	// with them.
+	std::vector<mesh_builder> builders;
+	std::map<std::tuple<std::string, std::uint32_t, std::uint8_t>, std::size_t> builder_ids;
+	std::string group_name = "defaultobject";
+	std::uint32_t material_id = default_material_id;
+	std::array<std::size_t, 4> current_builders;
+	current_builders.fill(std::numeric_limits<std::size_t>::max());
+	for (auto& c : chunks) {
+		auto next_statement = c.statements.begin();
+		auto current_corner = c.corners.begin();
+		for (std::size_t primitive = 0u; primitive <= c.primitive_sizes.size(); ++primitive) {
+			for (; next_statement != c.statements.end() && next_statement->first_primitive == primitive; ++next_statement) {
+				if (next_statement->type == statement_type::group) {
+					group_name = next_statement->name.empty() ? "defaultobject" : next_statement->name;
+				} else if (next_statement->type == statement_type::material) {
+					auto const id = material_ids.find(next_statement->name);
+					if (id == material_ids.end())
+						LogWarning("Unknown material \"%s\" used in \"%s\"; using default values instead.", next_statement->name.c_str(), filename.c_str());
+					material_id = id != material_ids.end() ? id->second : default_material_id;
+				} else {
+					continue;
+				}
+				current_builders.fill(std::numeric_limits<std::size_t>::max());
+			}
+			if (primitive == c.primitive_sizes.size())
+				break;
+
+			auto const size = c.primitive_sizes[primitive];
+			if (current_builders[size] == std::numeric_limits<std::size_t>::max()) {
+				auto const key = std::make_tuple(group_name, material_id, size);
+				auto const found = builder_ids.find(key);
+				if (found != builder_ids.end()) {
+					current_builders[size] = found->second;
+				} else {
+					current_builders[size] = builders.size();
+					builder_ids.emplace(key, builders.size());
+					builders.emplace_back();
+					builders.back().name = group_name;
+					builders.back().material_id = material_id;
+					builders.back().primitive_size = size;
+					is_default_material_used |= material_id == default_material_id;
+				}
+			}
+			auto& corners = builders[current_builders[size]].corners;
+			corners.insert(corners.end(), current_corner, current_corner + size);
+			current_corner += size;
+		}
+		std::vector<corner>().swap(c.corners);
+	}
+	if (is_default_material_used) {
+		materials.emplace_back();
+		materials.back().name = "DefaultMaterial";
+	}
+
+	std::vector<mesh_cache::mesh_record> meshes(builders.size());
+	std::vector<std::vector<std::uint8_t>> owned_data(builders.size());
+	std::vector<std::uint8_t> are_valid(builders.size(), 0u);
+	utils::parallel::for_each_index(builders.size(), [&](std::size_t j){
+		are_valid[j] = buildMesh(builders[j], positions, texcoords, normals, meshes[j], owned_data[j]) ? 1u : 0u;
+		std::vector<corner>().swap(builders[j].corners);
+	});
+
+	scene.materials = std::move(materials);
+	scene.meshes.clear();
+	scene.owned_data.clear();
+	for (std::size_t j = 0u; j < builders.size(); ++j) {
+		if (!are_valid[j]) {
+			LogError("Unsupported mesh \"%s\": references attributes that are out of range", builders[j].name.c_str());
+			continue;
+		}
+		scene.meshes.push_back(std::move(meshes[j]));
+		scene.owned_data.push_back(std::move(owned_data[j]));
+	}
+
+	if (scene.meshes.empty()) {
+		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
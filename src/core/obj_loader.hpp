@@ -0,0 +1,41 @@
+#pragma once
+
+#include "core/mesh_cache.hpp"
+
+#include <string>
+
+namespace bonobo
+{
+	//! \brief Dedicated importer for Wavefront OBJ files and their MTL
+	//!        material libraries, much faster than going through Assimp.
+	//!
+	//! The file is memory-mapped and split into chunks of whole lines,
+	//! which get parsed in parallel over the worker pool; meshes are then
+	//! assembled in parallel as well, each deduplicating its vertices.
+	//!
+	//! The scene produced is laid out as with Assimp's triangulation,
+	//! primitive sorting and tangent space generation: one mesh per
+	//! object or group, material and primitive type, with polygons
+	//! triangulated as fans, and tangents and binormals for triangle
+	//! meshes that have normals and texture coordinates. Smoothing groups,
+	//! free-form geometry and line continuations are not supported.
+	namespace obj_loader
+	{
+		//! \brief Whether a scene file is an OBJ file, judging by its
+		//!        extension.
+		bool isObjFile(std::string const& filename);
+
+		//! \brief Import an OBJ file, along with the MTL libraries it
+		//!        references.
+		//!
+		//! This issues no OpenGL commands, so it can run on any thread.
+		//!
+		//! @param [in] filename path to the OBJ file, read through the
+		//!             virtual file system
+		//! @param [out] scene the scene imported, whose meshes live in its
+		//!              `owned_data`
+		//! @return whether the file could be read and contained at least
+		//!         one valid mesh
+		bool load(std::string const& filename, mesh_cache::scene_record& scene);
+	}
+}
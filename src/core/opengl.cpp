@@ -164,6 +164,8 @@ opengl_error_callback( GLenum source, GLenum type, GLuint id, GLenum severity
 namespace shader
 {
 
+static std::uint64_t link_generation = 0u;
+
 bool
 source_and_build_shader(GLuint id, std::string const& source)
 {
@@ -219,6 +221,7 @@ bool
 link_program(GLuint id)
 {
 	glLinkProgram(id);
+	++link_generation;
 	GLint state = GLint(0);
 	glGetProgramiv(id, GL_LINK_STATUS, &state);
 	auto const wasLinkingSuccessful = state != GL_FALSE;
@@ -256,6 +259,12 @@ reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::strin
 	link_program(id);
 }
 
+std::uint64_t
+get_link_generation()
+{
+	return link_generation;
+}
+
 GLuint
 generate_program(std::vector<GLuint> const& shaders_id)
 {
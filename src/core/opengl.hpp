@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -72,6 +73,15 @@ bool link_program(GLuint id);
 void reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::string> const& sources);
 GLuint generate_program(std::vector<GLuint> const& shaders_id);
 
+//! \brief Retrieve how many times `link_program()` has been called.
+//!
+//! Relinking a program, or creating one that reuses the name of a deleted
+//! program, invalidates its uniform locations; anything caching them
+//! should resolve them again whenever this value changes.
+//!
+//! \return the number of programs linked so far
+std::uint64_t get_link_generation();
+
 } // end of namespace shader
 
 namespace fullscreen
@@ -0,0 +1,146 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	//! \brief One call to `for_each_index()`, shared by the calling thread
+	//!        and the workers of the pool.
+	struct batch {
+		std::function<void (std::size_t)> const* job{ nullptr };
+		std::size_t count{ 0u };
+		std::atomic<std::size_t> next_index{ 0u };
+		unsigned int workers_nb{ 0u }; //!< workers currently running jobs of this batch, guarded by the pool's mutex
+		std::exception_ptr first_exception{ nullptr };
+		std::mutex exception_mutex;
+
+		//! \brief Run jobs until every index has been handed out.
+		void run()
+		{
+			for (auto i = next_index.fetch_add(1u); i < count; i = next_index.fetch_add(1u)) {
+				try {
+					(*job)(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(exception_mutex);
+					if (first_exception == nullptr)
+						first_exception = std::current_exception();
+				}
+			}
+		}
+	};
+
+	thread_local bool is_pool_worker = false;
+
+	//! \brief Worker threads, started on first use and kept until exit,
+	//!        taking jobs from the batches queued by `for_each_index()`.
+	class pool {
+	public:
+		explicit pool(unsigned int threads_nb)
+		{
+			_threads.reserve(threads_nb);
+			for (unsigned int i = 0u; i < threads_nb; ++i)
+				_threads.emplace_back([this](){ work(); });
+		}
+
+		~pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_is_stopping = true;
+			}
+			_work_available.notify_all();
+			for (auto& thread : _threads)
+				thread.join();
+		}
+
+		//! \brief Run all jobs of a batch, with the help of the workers.
+		void run(batch& jobs)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_batches.push_back(&jobs);
+			}
+			_work_available.notify_all();
+
+			jobs.run();
+
+			// Every index has been handed out: make sure no worker picks the
+			// batch up anymore, then wait for those still running jobs.
+			std::unique_lock<std::mutex> lock(_mutex);
+			auto const queued = std::find(_batches.begin(), _batches.end(), &jobs);
+			if (queued != _batches.end())
+				_batches.erase(queued);
+			_batch_finished.wait(lock, [&jobs](){ return jobs.workers_nb == 0u; });
+		}
+
+	private:
+		void work()
+		{
+			is_pool_worker = true;
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true) {
+				_work_available.wait(lock, [this](){ return _is_stopping || !_batches.empty(); });
+				if (_is_stopping)
+					return;
+
+				auto* const jobs = _batches.front();
+				++jobs->workers_nb;
+				lock.unlock();
+				jobs->run();
+				lock.lock();
+
+				if (!_batches.empty() && _batches.front() == jobs)
+					_batches.pop_front();
+				--jobs->workers_nb;
+				_batch_finished.notify_all();
+			}
+		}
+
+		std::vector<std::thread> _threads;
+		std::mutex _mutex;
+		std::condition_variable _work_available;
+		std::condition_variable _batch_finished;
+		std::deque<batch*> _batches;
+		bool _is_stopping{ false };
+	};
+}
+
+unsigned int
+utils::parallel::worker_count()
+{
+	static unsigned int const count = std::max(std::thread::hardware_concurrency(), 1u);
+	return count;
+}
+
+void
+utils::parallel::for_each_index(std::size_t count, std::function<void (std::size_t)> const& job)
+{
+	if (count == 0u)
+		return;
+
+	// Jobs calling back into here run their nested jobs themselves: the
+	// other workers are already busy, or about to be.
+	if (count == 1u || worker_count() == 1u || is_pool_worker) {
+		for (std::size_t i = 0u; i < count; ++i)
+			job(i);
+		return;
+	}
+
+	static pool workers(worker_count() - 1u);
+
+	batch jobs;
+	jobs.job = &job;
+	jobs.count = count;
+	workers.run(jobs);
+
+	if (jobs.first_exception != nullptr)
+		std::rethrow_exception(jobs.first_exception);
+}
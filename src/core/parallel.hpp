@@ -0,0 +1,43 @@
+#pragma once
+
+
+#include <cstddef>
+#include <functional>
+
+
+namespace utils
+{
+
+namespace parallel
+{
+
+//! \brief Number of workers used by `for_each_index()`.
+//!
+//! It defaults to the number of hardware threads, and is never less than
+//! one.
+unsigned int worker_count();
+
+//! \brief Run `job` once for every index in [0, count), spreading the calls
+//!        over a pool of worker threads.
+//!
+//! Indices are handed out one at a time, so jobs of very different costs
+//! (like decoding a 4k and a 64x64 image) still balance well. The call only
+//! returns once every job has completed; the calling thread takes part in
+//! the work.
+//!
+//! The workers are started on the first call and kept until the program
+//! exits, sharing a queue of calls to work on. Calls made from within a
+//! job run their own jobs inline on that worker, rather than competing
+//! with the other workers for the CPU.
+//!
+//! Jobs must not issue OpenGL commands, as the workers have no context
+//! current. They should also avoid the `Log*` macros: while reports are
+//! serialised, those of concurrent jobs would interleave.
+//!
+//! \param [in] count number of jobs to run
+//! \param [in] job function to call with each index
+void for_each_index(std::size_t count, std::function<void (std::size_t)> const& job);
+
+} // end of namespace parallel
+
+} // end of namespace utils
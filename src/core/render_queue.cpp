@@ -0,0 +1,192 @@
+#include "render_queue.hpp"
+
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+	//! \brief Sort entries by increasing key, with an LSD radix sort on
+	//!        bytes; bytes that are the same for every key are skipped.
+	template<typename Entry>
+	void radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+	{
+		std::array<std::array<std::size_t, 256>, 8> histograms{};
+		for (auto const& entry : entries)
+			for (std::size_t byte = 0u; byte < 8u; ++byte)
+				++histograms[byte][(entry.key >> (8u * byte)) & 0xffu];
+
+		scratch.resize(entries.size());
+		for (std::size_t byte = 0u; byte < 8u; ++byte) {
+			auto& histogram = histograms[byte];
+			if (histogram[(entries.front().key >> (8u * byte)) & 0xffu] == entries.size())
+				continue;
+
+			std::size_t offset = 0u;
+			for (auto& count : histogram) {
+				auto const bucket_size = count;
+				count = offset;
+				offset += bucket_size;
+			}
+			for (auto const& entry : entries)
+				scratch[histogram[(entry.key >> (8u * byte)) & 0xffu]++] = entry;
+			entries.swap(scratch);
+		}
+	}
+
+	//! \brief Reduce a 32-bit value to its lowest `bits` bits, folding
+	//!        the higher ones in.
+	std::uint64_t fold(std::uint32_t value, unsigned int bits)
+	{
+		auto const mask = (1u << bits) - 1u;
+		auto folded = 0u;
+		for (; value != 0u; value >>= bits)
+			folded ^= value & mask;
+		return folded;
+	}
+}
+
+void
+bonobo::render_queue::add(Node const& node, glm::mat4 const& parent_transform, std::uint8_t pass)
+{
+	if (node._program == nullptr || *node._program == 0u || node._vao == 0u)
+		return;
+
+	auto const world = parent_transform * node._transform.GetMatrix();
+	_items.push_back({ &node, world, glm::transpose(glm::inverse(world)), pass });
+}
+
+void
+bonobo::render_queue::add(Node const& node, scene_graph const& graph, scene_graph::node_id graph_node, std::uint8_t pass)
+{
+	if (node._program == nullptr || *node._program == 0u || node._vao == 0u)
+		return;
+
+	_items.push_back({ &node, graph.getWorldMatrix(graph_node), graph.getNormalMatrix(graph_node), pass });
+}
+
+void
+bonobo::render_queue::flush(glm::mat4 const& view_projection)
+{
+	_statistics = statistics();
+	if (_items.empty())
+		return;
+
+	utils::opengl::debug::beginDebugGroup("Render queue");
+
+	_entries.resize(_items.size());
+	for (std::size_t i = 0u; i < _items.size(); ++i) {
+		auto const& item = _items[i];
+		auto const& node = *item.node;
+
+		// FNV-1a over the textures, in the order of their units.
+		std::uint32_t textures_hash = 2166136261u;
+		for (auto const& texture : node._textures)
+			textures_hash = (textures_hash ^ std::get<1>(texture)) * 16777619u;
+
+		// Positive floats sort like their bit patterns, whose highest 20
+		// bits (past the sign) are plenty for ordering.
+		auto const depth = std::max((view_projection * item.world[3]).w, 0.0f);
+		std::uint32_t depth_bits = 0u;
+		std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+		_entries[i].key = (static_cast<std::uint64_t>(item.pass & 0xfu) << 60)
+		                | (fold(*node._program, 12u) << 48)
+		                | (fold(textures_hash, 16u) << 32)
+		                | (fold(node._vao, 12u) << 20)
+		                | static_cast<std::uint64_t>(depth_bits >> 11);
+		_entries[i].item_index = static_cast<std::uint32_t>(i);
+	}
+	radixSort(_entries, _sort_scratch);
+
+	GLuint current_program = 0u;
+	GLuint current_vao = 0u;
+	_bound_textures.clear();
+	_used_targets.clear();
+	for (auto const& entry : _entries) {
+		auto const& item = _items[entry.item_index];
+		auto const& node = *item.node;
+		auto const program = *node._program;
+
+		if (program != current_program) {
+			glUseProgram(program);
+			current_program = program;
+			++_statistics.program_switches_nb;
+		}
+		node._set_uniforms(program);
+
+		auto const& locations = node.get_uniform_locations(program);
+		auto const vertex_model_to_world = item.world * node._position_dequantization;
+		glUniformMatrix4fv(locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
+		glUniformMatrix4fv(locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(item.normal));
+		glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(view_projection));
+		glUniform1i(locations.compact_vertices, node._compact_vertices ? 1 : 0);
+
+		for (std::size_t k = 0u; k < node._textures.size(); ++k) {
+			auto const& texture = node._textures[k];
+			auto const binding = std::make_pair(std::get<2>(texture), std::get<1>(texture));
+			if (k >= _bound_textures.size())
+				_bound_textures.resize(k + 1u, std::make_pair(GLenum(GL_NONE), 0u));
+			if (_bound_textures[k] != binding) {
+				glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(k));
+				glBindTexture(binding.first, binding.second);
+				_bound_textures[k] = binding;
+				auto const unit_target = std::make_pair(static_cast<GLenum>(k), binding.first);
+				if (std::find(_used_targets.begin(), _used_targets.end(), unit_target) == _used_targets.end())
+					_used_targets.push_back(unit_target);
+				++_statistics.texture_binds_nb;
+			}
+			glUniform1i(locations.textures[k].first, static_cast<GLint>(k));
+			glUniform1i(locations.textures[k].second, 1);
+		}
+
+		glUniform3fv(locations.diffuse_colour, 1, glm::value_ptr(node._constants.diffuse));
+		glUniform3fv(locations.specular_colour, 1, glm::value_ptr(node._constants.specular));
+		glUniform3fv(locations.ambient_colour, 1, glm::value_ptr(node._constants.ambient));
+		glUniform3fv(locations.emissive_colour, 1, glm::value_ptr(node._constants.emissive));
+		glUniform1f(locations.shininess_value, node._constants.shininess);
+		glUniform1f(locations.index_of_refraction_value, node._constants.indexOfRefraction);
+		glUniform1f(locations.opacity_value, node._constants.opacity);
+
+		if (node._vao != current_vao) {
+			glBindVertexArray(node._vao);
+			current_vao = node._vao;
+			++_statistics.vao_binds_nb;
+		}
+		node.issue_draw_call();
+		++_statistics.draws_nb;
+
+		// Textures stay bound for the next node, but it should not see
+		// this node's as present if it does not have them.
+		for (std::size_t k = 0u; k < node._textures.size(); ++k)
+			glUniform1i(locations.textures[k].second, 0);
+	}
+
+	glBindVertexArray(0u);
+	for (auto const& unit_target : _used_targets) {
+		glActiveTexture(GL_TEXTURE0 + unit_target.first);
+		glBindTexture(unit_target.second, 0u);
+	}
+	glUseProgram(0u);
+
+	_items.clear();
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+std::size_t
+bonobo::render_queue::getItemsNb() const
+{
+	return _items.size();
+}
+
+bonobo::render_queue::statistics const&
+bonobo::render_queue::getStatistics() const
+{
+	return _statistics;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "node.hpp"
+#include "scene_graph.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Collects nodes to draw, and draws them sorted so as to change
+	//!        as little OpenGL state as possible.
+	//!
+	//! Each queued node gets a 64-bit sort key, from most to least
+	//! significant bits:
+	//! * the pass it was queued in (4 bits), so that passes are drawn in
+	//!   increasing order;
+	//! * its program (12 bits);
+	//! * its set of textures (16 bits);
+	//! * its vertex array (12 bits);
+	//! * its depth as seen from the camera (20 bits), so that nodes sharing
+	//!   all of the above are drawn front to back.
+	//! Programs, texture sets and vertex arrays are only hashed into their
+	//! bits: collisions make the order less efficient, but never wrong, as
+	//! state changes compare the actual objects.
+	//!
+	//! Keys are sorted with a radix sort. Nodes then get drawn as with
+	//! `Node::render()`, except that programs, textures and vertex arrays
+	//! are only bound when they differ from the previous node's, and only
+	//! unbound once all nodes are drawn.
+	class render_queue {
+	public:
+		//! \brief State changes of the last `flush()`.
+		struct statistics {
+			std::size_t draws_nb{ 0u };
+			std::size_t program_switches_nb{ 0u };
+			std::size_t texture_binds_nb{ 0u };
+			std::size_t vao_binds_nb{ 0u };
+		};
+
+		//! \brief Queue a node, to be drawn with its own program as
+		//!        `Node::render()` would.
+		//!
+		//! Nodes without geometry or program are ignored. The node is
+		//! only referenced, and has to outlive the next `flush()`.
+		//!
+		//! @param [in] node the node to draw
+		//! @param [in] parent_transform Matrix transforming from
+		//!             parent-space to world-space
+		//! @param [in] pass in which pass to draw the node, from 0 to 15
+		void add(Node const& node, glm::mat4 const& parent_transform = glm::mat4(1.0f), std::uint8_t pass = 0u);
+
+		//! \brief Queue a node placed by a node of a scene graph, to be
+		//!        drawn as `Node::render()` would with that scene graph.
+		//!
+		//! The world and normal matrices are copied, so the scene graph
+		//! can be updated before the next `flush()`.
+		void add(Node const& node, scene_graph const& graph, scene_graph::node_id graph_node, std::uint8_t pass = 0u);
+
+		//! \brief Sort and draw all the nodes queued since the last call,
+		//!        then empty the queue.
+		//!
+		//! @param [in] view_projection Matrix transforming from world-space to clip-space
+		void flush(glm::mat4 const& view_projection);
+
+		std::size_t getItemsNb() const;
+
+		statistics const& getStatistics() const;
+
+	private:
+		struct item {
+			Node const* node;
+			glm::mat4 world;
+			glm::mat4 normal;
+			std::uint8_t pass;
+		};
+		struct sort_entry {
+			std::uint64_t key;
+			std::uint32_t item_index;
+		};
+
+		std::vector<item> _items;
+		std::vector<sort_entry> _entries;
+		std::vector<sort_entry> _sort_scratch;
+		//! Target and texture bound to each unit during `flush()`
+		std::vector<std::pair<GLenum, GLuint>> _bound_textures;
+		//! Units and targets to unbind at the end of `flush()`
+		std::vector<std::pair<GLenum, GLenum>> _used_targets;
+		statistics _statistics;
+	};
+}
@@ -0,0 +1,173 @@
+#include "scene_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr bonobo::scene_graph::node_id bonobo::scene_graph::no_parent;
+
+bonobo::scene_graph::node_id
+bonobo::scene_graph::addNode(node_id parent)
+{
+	assert(parent == no_parent || parent < _parents.size());
+	assert(_parents.size() < no_parent);
+
+	auto const node = static_cast<node_id>(_parents.size());
+	_parents.push_back(parent);
+	_translations.emplace_back(0.0f);
+	_rotations.emplace_back(1.0f);
+	_scales.emplace_back(1.0f);
+	_is_dirty.push_back(1u);
+	_world_matrices.emplace_back(1.0f);
+	_update_stamps.push_back(0u);
+	_first_dirty = std::min(_first_dirty, static_cast<std::size_t>(node));
+
+	return node;
+}
+
+void
+bonobo::scene_graph::reserve(std::size_t nodes_nb)
+{
+	_parents.reserve(nodes_nb);
+	_translations.reserve(nodes_nb);
+	_rotations.reserve(nodes_nb);
+	_scales.reserve(nodes_nb);
+	_is_dirty.reserve(nodes_nb);
+	_world_matrices.reserve(nodes_nb);
+	_update_stamps.reserve(nodes_nb);
+}
+
+std::size_t
+bonobo::scene_graph::getNodesNb() const
+{
+	return _parents.size();
+}
+
+bonobo::scene_graph::node_id
+bonobo::scene_graph::getParent(node_id node) const
+{
+	return _parents[node];
+}
+
+void
+bonobo::scene_graph::setTranslation(node_id node, glm::vec3 const& translation)
+{
+	_translations[node] = translation;
+	markDirty(node);
+}
+
+void
+bonobo::scene_graph::setRotation(node_id node, glm::mat3 const& rotation)
+{
+	_rotations[node] = rotation;
+	markDirty(node);
+}
+
+void
+bonobo::scene_graph::setScale(node_id node, glm::vec3 const& scale)
+{
+	_scales[node] = scale;
+	markDirty(node);
+}
+
+void
+bonobo::scene_graph::setLocalTransform(node_id node, TRSTransformf const& transform)
+{
+	_translations[node] = transform.GetTranslation();
+	_rotations[node] = transform.GetRotation();
+	_scales[node] = transform.GetScale();
+	markDirty(node);
+}
+
+glm::vec3 const&
+bonobo::scene_graph::getTranslation(node_id node) const
+{
+	return _translations[node];
+}
+
+glm::mat3 const&
+bonobo::scene_graph::getRotation(node_id node) const
+{
+	return _rotations[node];
+}
+
+glm::vec3 const&
+bonobo::scene_graph::getScale(node_id node) const
+{
+	return _scales[node];
+}
+
+std::size_t
+bonobo::scene_graph::update()
+{
+	auto const nodes_nb = _parents.size();
+	if (_first_dirty >= nodes_nb)
+		return 0u;
+
+	auto const stamp = ++_updates_nb;
+	std::size_t updated_nb = 0u;
+	for (auto i = _first_dirty; i < nodes_nb; ++i) {
+		auto const parent = _parents[i];
+		bool const has_parent_changed = parent != no_parent && _update_stamps[parent] == stamp;
+		if (_is_dirty[i] == 0u && !has_parent_changed)
+			continue;
+		_is_dirty[i] = 0u;
+		_update_stamps[i] = stamp;
+		++updated_nb;
+
+		// T * R * S
+		auto const& r = _rotations[i];
+		auto const& s = _scales[i];
+		auto const& t = _translations[i];
+		if (parent == no_parent) {
+			_world_matrices[i] = glm::mat4(glm::vec4(r[0] * s.x, 0.0f), glm::vec4(r[1] * s.y, 0.0f),
+			                               glm::vec4(r[2] * s.z, 0.0f), glm::vec4(t, 1.0f));
+			continue;
+		}
+
+		// The local matrix is affine, so only the first three columns of
+		// the parent's matrix contribute to the rotation and scale. The
+		// parent's matrix is copied first, as the compiler cannot tell it
+		// apart from the one being written.
+		auto const parent_world = _world_matrices[parent];
+		glm::mat4 world;
+		for (int c = 0; c < 3; ++c) {
+			auto const rs = r[c] * s[c];
+			world[c] = parent_world[0] * rs.x + parent_world[1] * rs.y + parent_world[2] * rs.z;
+		}
+		world[3] = parent_world[0] * t.x + parent_world[1] * t.y + parent_world[2] * t.z + parent_world[3];
+		_world_matrices[i] = world;
+	}
+	_first_dirty = nodes_nb;
+
+	return updated_nb;
+}
+
+glm::mat4 const&
+bonobo::scene_graph::getWorldMatrix(node_id node) const
+{
+	return _world_matrices[node];
+}
+
+glm::mat4
+bonobo::scene_graph::getNormalMatrix(node_id node) const
+{
+	// With a, b and c the first three columns of the world matrix, the
+	// rows of the inverse of its upper 3×3 part are b × c, c × a and
+	// a × b, over its determinant; the translation does not affect
+	// normals.
+	auto const& world = _world_matrices[node];
+	auto const a = glm::vec3(world[0]);
+	auto const b = glm::vec3(world[1]);
+	auto const c = glm::vec3(world[2]);
+	auto const bc = glm::cross(b, c);
+	auto const inverse_determinant = 1.0f / glm::dot(a, bc);
+	return glm::mat4(glm::vec4(bc * inverse_determinant, 0.0f), glm::vec4(glm::cross(c, a) * inverse_determinant, 0.0f),
+	                 glm::vec4(glm::cross(a, b) * inverse_determinant, 0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void
+bonobo::scene_graph::markDirty(node_id node)
+{
+	_is_dirty[node] = 1u;
+	_first_dirty = std::min(_first_dirty, static_cast<std::size_t>(node));
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "TRSTransform.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Hierarchy of transforms, stored as flat arrays rather than as
+	//!        a tree of objects.
+	//!
+	//! Each node has a local transform, split like `TRSTransform` into a
+	//! translation, a rotation and a scale, from which `update()` computes
+	//! its world matrix, `M = W_parent * T * R * S`. Every component lives
+	//! in its own array, indexed by node.
+	//!
+	//! Nodes can only be added after their parent, so parents always come
+	//! before their children in those arrays: `update()` is then a single
+	//! linear pass, starting from the first node whose local transform
+	//! changed, and recomputing only those nodes and their descendants.
+	//! Normal matrices are not part of that pass, which would otherwise
+	//! read and write twice as much: they are derived from the world
+	//! matrix of a node when asked for. Scales should be non-zero.
+	class scene_graph {
+	public:
+		using node_id = std::uint32_t;
+		static constexpr node_id no_parent = std::numeric_limits<node_id>::max();
+
+		//! \brief Add a node, with an identity local transform.
+		//!
+		//! @param [in] parent an existing node, or `no_parent` to add a
+		//!             root
+		//! @return the new node, whose ID is greater than its parent's
+		node_id addNode(node_id parent = no_parent);
+
+		//! \brief Allocate storage for that many nodes in total.
+		void reserve(std::size_t nodes_nb);
+
+		std::size_t getNodesNb() const;
+
+		//! @return the parent of the node, or `no_parent` for a root
+		node_id getParent(node_id node) const;
+
+		void setTranslation(node_id node, glm::vec3 const& translation);
+		void setRotation(node_id node, glm::mat3 const& rotation);
+		void setScale(node_id node, glm::vec3 const& scale);
+
+		//! \brief Copy the translation, rotation and scale of a transform
+		//!        as the local transform of a node.
+		void setLocalTransform(node_id node, TRSTransformf const& transform);
+
+		glm::vec3 const& getTranslation(node_id node) const;
+		glm::mat3 const& getRotation(node_id node) const;
+		glm::vec3 const& getScale(node_id node) const;
+
+		//! \brief Recompute the world matrices of the nodes whose local
+		//!        transform changed since the last update, and of all their
+		//!        descendants.
+		//!
+		//! @return the number of nodes recomputed
+		std::size_t update();
+
+		//! \brief Matrix transforming from the model space of a node to
+		//!        world space, as of the last `update()`.
+		glm::mat4 const& getWorldMatrix(node_id node) const;
+
+		//! \brief Matrix transforming normals from the model space of a
+		//!        node to world space, as of the last `update()`; that is
+		//!        the inverse transpose of its world matrix, computed from
+		//!        the cofactors of the latter.
+		glm::mat4 getNormalMatrix(node_id node) const;
+
+	private:
+		void markDirty(node_id node);
+
+		// Hierarchy
+		std::vector<node_id> _parents;
+
+		// Local transforms
+		std::vector<glm::vec3> _translations;
+		std::vector<glm::mat3> _rotations;
+		std::vector<glm::vec3> _scales;
+		std::vector<std::uint8_t> _is_dirty;
+		std::size_t _first_dirty{ 0u }; //!< no node before that one changed since the last update
+
+		// Results, and the update in which each node was last recomputed,
+		// which tells children whether their parent just changed.
+		std::vector<glm::mat4> _world_matrices;
+		std::vector<std::uint32_t> _update_stamps;
+		std::uint32_t _updates_nb{ 0u };
+	};
+}
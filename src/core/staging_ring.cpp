@@ -0,0 +1,385 @@
+#include "staging_ring.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+
+namespace
+{
+	//! \brief Alignment of allocations, which also keeps regions written
+	//!        by different threads on different cache lines.
+	std::size_t const allocation_alignment = 64u;
+
+	//! \brief Region of the ring still in use, in allocation order.
+	struct region {
+		std::size_t begin;
+		std::size_t end;
+		GLsync fence; //!< signalled once the copy reading the region is done; nullptr if none was issued yet
+	};
+
+	struct {
+		GLuint buffer{ 0u };
+		std::size_t size{ 0u };
+		std::uint8_t* mapping{ nullptr };  //!< persistent mapping of the buffer, if any
+		GLintptr mapped_offset{ -1 };      //!< offset of the allocation currently mapped, if not persistently mapped; -1 if none
+		std::size_t head{ 0u };
+		std::deque<region> regions;
+		bonobo::staging_ring::statistics statistics;
+	} ring;
+
+	std::size_t alignUp(std::size_t value, std::size_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	void waitForRegion(region& used_region)
+	{
+		if (used_region.fence == nullptr)
+			return;
+
+		auto status = glClientWaitSync(used_region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0u);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			auto const stall_start_time = std::chrono::high_resolution_clock::now();
+			do {
+				status = glClientWaitSync(used_region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000u);
+			} while (status == GL_TIMEOUT_EXPIRED);
+			++ring.statistics.stalls_nb;
+			ring.statistics.stalled_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - stall_start_time).count();
+		}
+		if (status == GL_WAIT_FAILED)
+			LogWarning("Failed to wait on a staging ring fence; the region will be reused regardless.");
+
+		glDeleteSync(used_region.fence);
+		used_region.fence = nullptr;
+	}
+
+	//! \brief Unmap the allocation currently mapped, if any, with the
+	//!        ring bound to `target`.
+	//!
+	//! @return false if the content of the allocation got lost while
+	//!         mapped
+	bool unmapAllocation(GLenum target)
+	{
+		if (ring.mapped_offset < 0)
+			return true;
+
+		ring.mapped_offset = -1;
+		if (glUnmapBuffer(target) == GL_FALSE) {
+			LogWarning("The staging ring got corrupted while mapped; the copy will read undefined data.");
+			return false;
+		}
+		return true;
+	}
+
+	//! \brief Bind the ring to `target`, making sure the buffer holds the
+	//!        content of an allocation.
+	void bindAllocation(bonobo::staging_ring::allocation const& allocation, GLenum target)
+	{
+		glBindBuffer(target, ring.buffer);
+		if (ring.mapping == nullptr && ring.mapped_offset == allocation.offset)
+			unmapAllocation(target);
+	}
+
+	//! \brief Protect an allocation with a fence, as the copy reading
+	//!        from it has been issued, or as it will not be used.
+	void fenceAllocation(bonobo::staging_ring::allocation const& allocation)
+	{
+		for (auto it = ring.regions.rbegin(); it != ring.regions.rend(); ++it) {
+			if (it->begin != static_cast<std::size_t>(allocation.offset))
+				continue;
+			if (it->fence != nullptr)
+				glDeleteSync(it->fence);
+			it->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0u);
+			break;
+		}
+	}
+
+	//! \brief Fence an allocation a copy was issued from, and account
+	//!        for that copy.
+	void countCopy(bonobo::staging_ring::allocation const& allocation)
+	{
+		fenceAllocation(allocation);
+		++ring.statistics.copies_nb;
+		ring.statistics.copied_bytes += allocation.size;
+	}
+}
+
+void
+bonobo::staging_ring::init(std::size_t size)
+{
+	deinit();
+	if (size == 0u)
+		return;
+
+	glGenBuffers(1, &ring.buffer);
+	if (ring.buffer == 0u) {
+		LogError("Failed to create the staging ring buffer.");
+		return;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+	if (GLAD_GL_VERSION_4_4) {
+		GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+		ring.mapping = static_cast<std::uint8_t*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(size), flags));
+	} else {
+		glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_COPY);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+	utils::opengl::debug::nameObject(GL_BUFFER, ring.buffer, "Staging ring");
+
+	ring.size = size;
+	ring.head = 0u;
+	ring.statistics.size = size;
+	ring.statistics.is_persistent = ring.mapping != nullptr;
+}
+
+void
+bonobo::staging_ring::deinit()
+{
+	if (ring.buffer == 0u)
+		return;
+
+	for (auto& used_region : ring.regions)
+		waitForRegion(used_region);
+	ring.regions.clear();
+
+	if (ring.mapping != nullptr || ring.mapped_offset >= 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+		ring.mapping = nullptr;
+		ring.mapped_offset = -1;
+	}
+	glDeleteBuffers(1, &ring.buffer);
+	ring.buffer = 0u;
+	ring.size = 0u;
+	ring.head = 0u;
+	ring.statistics.size = 0u;
+	ring.statistics.is_persistent = false;
+}
+
+void
+bonobo::staging_ring::resize(std::size_t size)
+{
+	if (size == ring.size)
+		return;
+	init(size);
+}
+
+bonobo::staging_ring::allocation
+bonobo::staging_ring::allocate(std::size_t size)
+{
+	allocation result;
+	auto const aligned_size = alignUp(size, allocation_alignment);
+	if (ring.buffer == 0u || size == 0u || aligned_size > ring.size)
+		return result;
+
+	// Only one allocation is mapped at a time when the ring is not
+	// persistently mapped, as a buffer cannot be mapped more than once.
+	if (ring.mapping == nullptr && ring.mapped_offset >= 0) {
+		LogWarning("A staging ring allocation was not copied from before the next one was made; its content is discarded.");
+		allocation stale;
+		stale.offset = ring.mapped_offset;
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		unmapAllocation(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+		fenceAllocation(stale);
+	}
+
+	bool const wraps = ring.head + aligned_size > ring.size;
+	auto const begin = wraps ? 0u : ring.head;
+
+	// Regions are reused in the order they were allocated, so the oldest
+	// one is the first that could overlap the new region; when wrapping
+	// around, those past the head are older still and get released
+	// first. One that was never copied from is still being written to,
+	// and cannot be waited on.
+	while (!ring.regions.empty()) {
+		auto& oldest = ring.regions.front();
+		bool const is_skipped = wraps && oldest.begin >= ring.head;
+		if (!is_skipped && (oldest.end <= begin || oldest.begin >= begin + aligned_size))
+			break;
+		if (oldest.fence == nullptr)
+			return result;
+		waitForRegion(oldest);
+		ring.regions.pop_front();
+	}
+
+	if (ring.mapping != nullptr) {
+		result.data = ring.mapping + begin;
+	} else {
+		// The region is not in use by the GPU anymore, so there is no need
+		// for the driver to synchronise the mapping.
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		result.data = static_cast<std::uint8_t*>(glMapBufferRange(GL_COPY_READ_BUFFER, static_cast<GLintptr>(begin), static_cast<GLsizeiptr>(size),
+		                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+		if (result.data == nullptr) {
+			LogError("Failed to map %zu bytes of the staging ring.", size);
+			return result;
+		}
+		ring.mapped_offset = static_cast<GLintptr>(begin);
+	}
+
+	ring.regions.push_back({ begin, begin + aligned_size, nullptr });
+	result.size = size;
+	result.offset = static_cast<GLintptr>(begin);
+	ring.head = begin + aligned_size;
+
+	return result;
+}
+
+void
+bonobo::staging_ring::discard(allocation const& allocation)
+{
+	if (allocation.data == nullptr)
+		return;
+
+	if (ring.mapping == nullptr && ring.mapped_offset == allocation.offset) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		unmapAllocation(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+	}
+	fenceAllocation(allocation);
+}
+
+void
+bonobo::staging_ring::copyToTexture(allocation const& allocation, GLenum target, GLint level, GLint internal_format,
+                                    GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+	bindAllocation(allocation, GL_PIXEL_UNPACK_BUFFER);
+	glTexImage2D(target, level, internal_format, width, height, 0, format, type,
+	             reinterpret_cast<GLvoid const*>(allocation.offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	countCopy(allocation);
+}
+
+void
+bonobo::staging_ring::copyToTextureSubImage(allocation const& allocation, GLenum target, GLint level, GLint x_offset, GLint y_offset,
+                                            GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+	bindAllocation(allocation, GL_PIXEL_UNPACK_BUFFER);
+	glTexSubImage2D(target, level, x_offset, y_offset, width, height, format, type,
+	                reinterpret_cast<GLvoid const*>(allocation.offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	countCopy(allocation);
+}
+
+void
+bonobo::staging_ring::copyToCompressedTexture(allocation const& allocation, GLenum target, GLint level, GLenum internal_format,
+                                              GLsizei width, GLsizei height)
+{
+	bindAllocation(allocation, GL_PIXEL_UNPACK_BUFFER);
+	glCompressedTexImage2D(target, level, internal_format, width, height, 0, static_cast<GLsizei>(allocation.size),
+	                       reinterpret_cast<GLvoid const*>(allocation.offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	countCopy(allocation);
+}
+
+void
+bonobo::staging_ring::copyToCompressedTextureSubImage(allocation const& allocation, GLenum target, GLint level, GLint x_offset, GLint y_offset,
+                                                      GLsizei width, GLsizei height, GLenum format)
+{
+	bindAllocation(allocation, GL_PIXEL_UNPACK_BUFFER);
+	glCompressedTexSubImage2D(target, level, x_offset, y_offset, width, height, format, static_cast<GLsizei>(allocation.size),
+	                          reinterpret_cast<GLvoid const*>(allocation.offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	countCopy(allocation);
+}
+
+void
+bonobo::staging_ring::copyToBuffer(allocation const& allocation, GLuint buffer, GLintptr offset)
+{
+	bindAllocation(allocation, GL_COPY_READ_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.offset, offset, static_cast<GLsizeiptr>(allocation.size));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+	countCopy(allocation);
+}
+
+void
+bonobo::staging_ring::uploadTexture(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+                                    GLenum format, GLenum type, void const* data, std::size_t size)
+{
+	auto const staging = data != nullptr ? allocate(size) : allocation();
+	if (staging.data == nullptr) {
+		if (data != nullptr)
+			++ring.statistics.direct_uploads_nb;
+		glTexImage2D(target, level, internal_format, width, height, 0, format, type, data);
+		return;
+	}
+
+	std::memcpy(staging.data, data, size);
+	copyToTexture(staging, target, level, internal_format, width, height, format, type);
+}
+
+void
+bonobo::staging_ring::uploadTextureSubImage(GLenum target, GLint level, GLint x_offset, GLint y_offset, GLsizei width, GLsizei height,
+                                            GLenum format, GLenum type, void const* data, std::size_t size)
+{
+	auto const staging = allocate(size);
+	if (staging.data == nullptr) {
+		++ring.statistics.direct_uploads_nb;
+		glTexSubImage2D(target, level, x_offset, y_offset, width, height, format, type, data);
+		return;
+	}
+
+	std::memcpy(staging.data, data, size);
+	copyToTextureSubImage(staging, target, level, x_offset, y_offset, width, height, format, type);
+}
+
+void
+bonobo::staging_ring::uploadCompressedTexture(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height,
+                                              void const* data, std::size_t size)
+{
+	auto const staging = allocate(size);
+	if (staging.data == nullptr) {
+		++ring.statistics.direct_uploads_nb;
+		glCompressedTexImage2D(target, level, internal_format, width, height, 0, static_cast<GLsizei>(size), data);
+		return;
+	}
+
+	std::memcpy(staging.data, data, size);
+	copyToCompressedTexture(staging, target, level, internal_format, width, height);
+}
+
+void
+bonobo::staging_ring::uploadCompressedTextureSubImage(GLenum target, GLint level, GLint x_offset, GLint y_offset, GLsizei width, GLsizei height,
+                                                      GLenum format, void const* data, std::size_t size)
+{
+	auto const staging = allocate(size);
+	if (staging.data == nullptr) {
+		++ring.statistics.direct_uploads_nb;
+		glCompressedTexSubImage2D(target, level, x_offset, y_offset, width, height, format, static_cast<GLsizei>(size), data);
+		return;
+	}
+
+	std::memcpy(staging.data, data, size);
+	copyToCompressedTextureSubImage(staging, target, level, x_offset, y_offset, width, height, format);
+}
+
+void
+bonobo::staging_ring::uploadBuffer(GLuint buffer, GLintptr offset, void const* data, std::size_t size)
+{
+	auto const staging = allocate(size);
+	if (staging.data == nullptr) {
+		++ring.statistics.direct_uploads_nb;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, static_cast<GLsizeiptr>(size), data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+		return;
+	}
+
+	std::memcpy(staging.data, data, size);
+	copyToBuffer(staging, buffer, offset);
+}
+
+bonobo::staging_ring::statistics
+bonobo::staging_ring::getStatistics()
+{
+	return ring.statistics;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bonobo
+{
+	//! \brief Ring of staging memory through which textures and buffers
+	//!        get uploaded, instead of from client memory.
+	//!
+	//! The ring is a single buffer object. When OpenGL 4.4 is available it
+	//! is persistently mapped, so data can be written straight into it,
+	//! from any thread, before the copy to its destination is issued, and
+	//! any number of allocations can be filled in at once; otherwise, each
+	//! allocation gets mapped on its own and unmapped right before the
+	//! copy, so only one of them can be pending at a time. Either way,
+	//! copies are executed asynchronously by the driver, and each region
+	//! of the ring is protected by a fence until the copy reading from it
+	//! is complete.
+	//!
+	//! Except for writing to `allocation::data`, all functions must be
+	//! called from the thread owning the OpenGL context.
+	namespace staging_ring
+	{
+		constexpr std::size_t default_size = 64u * 1024u * 1024u;
+
+		//! \brief Counters to help tune the size of the ring.
+		struct statistics {
+			std::size_t size{ 0u };              //!< capacity of the ring, in bytes
+			bool is_persistent{ false };         //!< whether the ring is persistently mapped, rather than mapped per allocation
+			std::size_t copies_nb{ 0u };         //!< copies issued from the ring
+			std::size_t copied_bytes{ 0u };      //!< bytes copied from the ring
+			std::size_t direct_uploads_nb{ 0u }; //!< uploads too large for the ring, done from client memory instead
+			std::size_t stalls_nb{ 0u };         //!< allocations that had to wait for the GPU to release a region
+			double stalled_ms{ 0.0 };            //!< total time spent waiting on the GPU
+		};
+
+		//! \brief Region of the ring, to be filled in and then copied to
+		//!        its destination exactly once, or discarded.
+		struct allocation {
+			std::uint8_t* data{ nullptr }; //!< where to write the data to upload; nullptr if the allocation failed
+			std::size_t size{ 0u };        //!< size in bytes of the region
+			GLintptr offset{ 0 };          //!< offset of the region within the ring buffer
+		};
+
+		//! \brief Create the ring; this is called by `bonobo::init()`.
+		void init(std::size_t size = default_size);
+
+		//! \brief Wait for all pending copies, and release the ring; this is
+		//!        called by `bonobo::deinit()`.
+		void deinit();
+
+		//! \brief Recreate the ring with a different capacity, once all
+		//!        pending copies are complete.
+		void resize(std::size_t size);
+
+		//! \brief Reserve a region of the ring, waiting for the GPU to be
+		//!        done with it if needed.
+		//!
+		//! Unless the ring is persistently mapped, the previous allocation
+		//! must have been copied from or discarded, or its content is
+		//! lost.
+		//!
+		//! @param [in] size number of bytes needed
+		//! @return the region, whose `data` is nullptr if the ring is not
+		//!         initialised, smaller than `size`, or if the region would
+		//!         overlap allocations not copied from yet
+		allocation allocate(std::size_t size);
+
+		//! \brief Give back an allocation that will not be copied from.
+		void discard(allocation const& allocation);
+
+		//! \brief Specify a level of the texture bound to `target` using
+		//!        the content of an allocation, as `glTexImage2D()` would.
+		void copyToTexture(allocation const& allocation, GLenum target, GLint level, GLint internal_format,
+		                   GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+		//! \brief Replace a region of a level of the texture bound to
+		//!        `target` using the content of an allocation, as
+		//!        `glTexSubImage2D()` would; this is how textures with
+		//!        immutable storage get filled in.
+		void copyToTextureSubImage(allocation const& allocation, GLenum target, GLint level, GLint x_offset, GLint y_offset,
+		                           GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+		//! \brief Specify a level of the texture bound to `target` using
+		//!        the content of an allocation, as `glCompressedTexImage2D()`
+		//!        would; the whole allocation is used as image data.
+		void copyToCompressedTexture(allocation const& allocation, GLenum target, GLint level, GLenum internal_format,
+		                             GLsizei width, GLsizei height);
+
+		//! \brief Replace a region of a level of the compressed texture
+		//!        bound to `target` using the content of an allocation, as
+		//!        `glCompressedTexSubImage2D()` would.
+		void copyToCompressedTextureSubImage(allocation const& allocation, GLenum target, GLint level, GLint x_offset, GLint y_offset,
+		                                     GLsizei width, GLsizei height, GLenum format);
+
+		//! \brief Copy the content of an allocation into a buffer, whose
+		//!        storage must already be allocated.
+		void copyToBuffer(allocation const& allocation, GLuint buffer, GLintptr offset);
+
+		//! \brief Upload data from client memory through the ring, or
+		//!        directly if it does not fit, as `glTexImage2D()` would.
+		//!
+		//! @param [in] size number of bytes to read from `data`
+		void uploadTexture(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+		                   GLenum format, GLenum type, void const* data, std::size_t size);
+
+		//! \brief Upload data from client memory through the ring, or
+		//!        directly if it does not fit, as `glTexSubImage2D()` would.
+		void uploadTextureSubImage(GLenum target, GLint level, GLint x_offset, GLint y_offset, GLsizei width, GLsizei height,
+		                           GLenum format, GLenum type, void const* data, std::size_t size);
+
+		//! \brief Upload data from client memory through the ring, or
+		//!        directly if it does not fit, as `glCompressedTexImage2D()`
+		//!        would.
+		void uploadCompressedTexture(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height,
+		                             void const* data, std::size_t size);
+
+		//! \brief Upload data from client memory through the ring, or
+		//!        directly if it does not fit, as
+		//!        `glCompressedTexSubImage2D()` would.
+		void uploadCompressedTextureSubImage(GLenum target, GLint level, GLint x_offset, GLint y_offset, GLsizei width, GLsizei height,
+		                                     GLenum format, void const* data, std::size_t size);
+
+		//! \brief Upload data from client memory through the ring, or
+		//!        directly if it does not fit, as `glBufferSubData()` would.
+		void uploadBuffer(GLuint buffer, GLintptr offset, void const* data, std::size_t size);
+
+		statistics getStatistics();
+	}
+}
@@ -0,0 +1,653 @@
+#include "texture_compression.hpp"
+
+#include "config.hpp"
+#include "core/mapped_file.hpp"
+#include "core/parallel.hpp"
+#include "core/staging_ring.hpp"
+#include "core/various.hpp"
+#include "core/vfs.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BONOBO_USE_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+// S3TC is provided by an extension rather than by core OpenGL, so its
+// enumerants are missing from the generated loader.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#	define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#	define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+	//! \brief Bump whenever the encoders or the mip filtering change, so
+	//!        that stale cache entries get ignored.
+	unsigned int const cache_version = 1u;
+
+	enum class mip_filter {
+		srgb,    //!< colour channels are sRGB-encoded, alpha is linear
+		linear,  //!< all channels are linear
+		normals  //!< colour channels encode a unit vector
+	};
+
+	mip_filter getMipFilter(bonobo::texture_role role)
+	{
+		switch (role) {
+		case bonobo::texture_role::diffuse:
+		case bonobo::texture_role::specular:
+			return mip_filter::srgb;
+		case bonobo::texture_role::normals:
+			return mip_filter::normals;
+		case bonobo::texture_role::opacity:
+		default:
+			return mip_filter::linear;
+		}
+	}
+
+	char const* getRoleName(bonobo::texture_role role)
+	{
+		switch (role) {
+		case bonobo::texture_role::diffuse:  return "diffuse";
+		case bonobo::texture_role::specular: return "specular";
+		case bonobo::texture_role::normals:  return "normals";
+		case bonobo::texture_role::opacity:  return "opacity";
+		default:                             return "unknown";
+		}
+	}
+
+	struct srgb_tables {
+		std::array<float, 256> to_linear;
+		std::array<std::uint8_t, 4096> from_linear;
+
+		srgb_tables()
+		{
+			for (size_t i = 0u; i < to_linear.size(); ++i) {
+				auto const c = static_cast<float>(i) / 255.0f;
+				to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (size_t i = 0u; i < from_linear.size(); ++i) {
+				auto const l = static_cast<float>(i) / static_cast<float>(from_linear.size() - 1u);
+				auto const c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				from_linear[i] = static_cast<std::uint8_t>(std::min(std::max(c * 255.0f + 0.5f, 0.0f), 255.0f));
+			}
+		}
+	};
+
+	srgb_tables const& getSRGBTables()
+	{
+		static srgb_tables const tables;
+		return tables;
+	}
+
+#if defined(BONOBO_USE_SSE2)
+	using texel = __m128;
+
+	inline texel makeTexel(float r, float g, float b, float a) { return _mm_set_ps(a, b, g, r); }
+	inline texel addTexels(texel lhs, texel rhs) { return _mm_add_ps(lhs, rhs); }
+	inline texel scaleTexel(texel t, float s) { return _mm_mul_ps(t, _mm_set1_ps(s)); }
+	inline void storeTexel(texel t, float* out) { _mm_storeu_ps(out, t); }
+
+	//! \brief Clamp to [0, 1], then scale each channel and round it to
+	//!        the nearest integer.
+	inline void quantiseTexel(texel t, float r_scale, float g_scale, float b_scale, float a_scale, std::int32_t* out)
+	{
+		auto const clamped = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		auto const scaled = _mm_mul_ps(clamped, _mm_set_ps(a_scale, b_scale, g_scale, r_scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_cvtps_epi32(scaled));
+	}
+#else
+	struct texel { float v[4]; };
+
+	inline texel makeTexel(float r, float g, float b, float a) { return texel{ { r, g, b, a } }; }
+	inline texel addTexels(texel lhs, texel rhs) { return texel{ { lhs.v[0] + rhs.v[0], lhs.v[1] + rhs.v[1], lhs.v[2] + rhs.v[2], lhs.v[3] + rhs.v[3] } }; }
+	inline texel scaleTexel(texel t, float s) { return texel{ { t.v[0] * s, t.v[1] * s, t.v[2] * s, t.v[3] * s } }; }
+	inline void storeTexel(texel t, float* out) { std::memcpy(out, t.v, sizeof(t.v)); }
+
+	inline void quantiseTexel(texel t, float r_scale, float g_scale, float b_scale, float a_scale, std::int32_t* out)
+	{
+		float const scales[4] = { r_scale, g_scale, b_scale, a_scale };
+		for (int i = 0; i < 4; ++i)
+			out[i] = static_cast<std::int32_t>(std::lround(std::min(std::max(t.v[i], 0.0f), 1.0f) * scales[i]));
+	}
+#endif
+
+	inline texel loadTexel(std::uint8_t const* rgba, mip_filter filter, srgb_tables const& tables)
+	{
+		auto const a = static_cast<float>(rgba[3]) / 255.0f;
+		switch (filter) {
+		case mip_filter::srgb:
+			return makeTexel(tables.to_linear[rgba[0]], tables.to_linear[rgba[1]], tables.to_linear[rgba[2]], a);
+		case mip_filter::normals:
+			return makeTexel(static_cast<float>(rgba[0]) / 127.5f - 1.0f,
+			                 static_cast<float>(rgba[1]) / 127.5f - 1.0f,
+			                 static_cast<float>(rgba[2]) / 127.5f - 1.0f,
+			                 a);
+		case mip_filter::linear:
+		default:
+			return makeTexel(static_cast<float>(rgba[0]) / 255.0f, static_cast<float>(rgba[1]) / 255.0f,
+			                 static_cast<float>(rgba[2]) / 255.0f, a);
+		}
+	}
+
+	inline void writeTexel(texel t, mip_filter filter, srgb_tables const& tables, std::uint8_t* rgba)
+	{
+		std::int32_t quantised[4];
+		switch (filter) {
+		case mip_filter::srgb:
+		{
+			auto const max_index = static_cast<float>(tables.from_linear.size() - 1u);
+			quantiseTexel(t, max_index, max_index, max_index, 255.0f, quantised);
+			rgba[0] = tables.from_linear[static_cast<size_t>(quantised[0])];
+			rgba[1] = tables.from_linear[static_cast<size_t>(quantised[1])];
+			rgba[2] = tables.from_linear[static_cast<size_t>(quantised[2])];
+			rgba[3] = static_cast<std::uint8_t>(quantised[3]);
+			return;
+		}
+		case mip_filter::normals:
+		{
+			// Averaging unit vectors shortens them: renormalise before
+			// encoding them back.
+			float n[4];
+			storeTexel(t, n);
+			auto const length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			auto const inv_length = length > 1e-6f ? 1.0f / length : 0.0f;
+			t = makeTexel(n[0] * inv_length * 0.5f + 0.5f, n[1] * inv_length * 0.5f + 0.5f,
+			              length > 1e-6f ? n[2] * inv_length * 0.5f + 0.5f : 1.0f, n[3]);
+			break;
+		}
+		case mip_filter::linear:
+		default:
+			break;
+		}
+		quantiseTexel(t, 255.0f, 255.0f, 255.0f, 255.0f, quantised);
+		for (int i = 0; i < 4; ++i)
+			rgba[i] = static_cast<std::uint8_t>(quantised[i]);
+	}
+
+	//! \brief Compute rows [row_begin, row_end) of the next mip level with
+	//!        a 2×2 box filter; odd dimensions reuse the last row or column.
+	void downsampleRows(std::uint8_t const* source, std::uint32_t source_width, std::uint32_t source_height,
+	                    std::uint8_t* destination, std::uint32_t destination_width,
+	                    std::uint32_t row_begin, std::uint32_t row_end, mip_filter filter)
+	{
+		auto const& tables = getSRGBTables();
+		for (auto y = row_begin; y < row_end; ++y) {
+			auto const row0 = source + static_cast<size_t>(std::min(2u * y,      source_height - 1u)) * source_width * 4u;
+			auto const row1 = source + static_cast<size_t>(std::min(2u * y + 1u, source_height - 1u)) * source_width * 4u;
+			for (std::uint32_t x = 0u; x < destination_width; ++x) {
+				auto const x0 = std::min(2u * x,      source_width - 1u) * 4u;
+				auto const x1 = std::min(2u * x + 1u, source_width - 1u) * 4u;
+				auto sum = addTexels(addTexels(loadTexel(row0 + x0, filter, tables), loadTexel(row0 + x1, filter, tables)),
+				                     addTexels(loadTexel(row1 + x0, filter, tables), loadTexel(row1 + x1, filter, tables)));
+				writeTexel(scaleTexel(sum, 0.25f), filter, tables, destination + (static_cast<size_t>(y) * destination_width + x) * 4u);
+			}
+		}
+	}
+
+	std::uint16_t packRGB565(float r, float g, float b)
+	{
+		auto const quantise = [](float value, float max) {
+			return static_cast<std::uint16_t>(std::lround(std::min(std::max(value, 0.0f), 255.0f) * max / 255.0f));
+		};
+		return static_cast<std::uint16_t>((quantise(r, 31.0f) << 11) | (quantise(g, 63.0f) << 5) | quantise(b, 31.0f));
+	}
+
+	std::array<int, 3> unpackRGB565(std::uint16_t c)
+	{
+		auto const r = (c >> 11) & 0x1f;
+		auto const g = (c >> 5) & 0x3f;
+		auto const b = c & 0x1f;
+		return {{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) }};
+	}
+
+	//! \brief Encode the colour part of a BC1/BC3 block, fitting the
+	//!        endpoints along the principal axis of the block's colours.
+	void encodeColourBlock(std::uint8_t const (&block)[16][4], std::uint8_t* out)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (auto const& colour : block)
+			for (int c = 0; c < 3; ++c)
+				mean[c] += static_cast<float>(colour[c]) / 16.0f;
+
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (auto const& colour : block) {
+			float const d[3] = { colour[0] - mean[0], colour[1] - mean[1], colour[2] - mean[2] };
+			covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+		}
+
+		// A few power iterations are enough to find the dominant axis.
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int i = 0; i < 8; ++i) {
+			float const next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+			auto const largest = std::max(std::abs(next[0]), std::max(std::abs(next[1]), std::abs(next[2])));
+			if (largest <= 1e-6f)
+				break;
+			for (int c = 0; c < 3; ++c)
+				axis[c] = next[c] / largest;
+		}
+		auto const axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (auto& c : axis)
+			c /= axis_length;
+
+		auto min_t = 0.0f, max_t = 0.0f;
+		for (auto const& colour : block) {
+			auto const t = (colour[0] - mean[0]) * axis[0] + (colour[1] - mean[1]) * axis[1] + (colour[2] - mean[2]) * axis[2];
+			min_t = std::min(min_t, t);
+			max_t = std::max(max_t, t);
+		}
+
+		auto c0 = packRGB565(mean[0] + max_t * axis[0], mean[1] + max_t * axis[1], mean[2] + max_t * axis[2]);
+		auto c1 = packRGB565(mean[0] + min_t * axis[0], mean[1] + min_t * axis[1], mean[2] + min_t * axis[2]);
+		// c0 > c1 selects the four-colour mode in BC1.
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		std::uint32_t indices = 0u;
+		if (c0 != c1) {
+			auto const e0 = unpackRGB565(c0);
+			auto const e1 = unpackRGB565(c1);
+			std::array<std::array<int, 3>, 4> palette;
+			palette[0] = e0;
+			palette[1] = e1;
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+				palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+			}
+
+			for (int i = 0; i < 16; ++i) {
+				auto best_index = 0u;
+				auto best_distance = std::numeric_limits<int>::max();
+				for (unsigned int p = 0u; p < 4u; ++p) {
+					auto const dr = block[i][0] - palette[p][0];
+					auto const dg = block[i][1] - palette[p][1];
+					auto const db = block[i][2] - palette[p][2];
+					auto const distance = dr * dr + dg * dg + db * db;
+					if (distance < best_distance) {
+						best_distance = distance;
+						best_index = p;
+					}
+				}
+				indices |= best_index << (2 * i);
+			}
+		}
+
+		out[0] = static_cast<std::uint8_t>(c0 & 0xff);
+		out[1] = static_cast<std::uint8_t>(c0 >> 8);
+		out[2] = static_cast<std::uint8_t>(c1 & 0xff);
+		out[3] = static_cast<std::uint8_t>(c1 >> 8);
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = static_cast<std::uint8_t>((indices >> (8 * i)) & 0xff);
+	}
+
+	//! \brief Encode a single-channel BC4 block, as used for the alpha of
+	//!        BC3 and for each channel of BC5.
+	void encodeSingleChannelBlock(std::uint8_t const (&values)[16], std::uint8_t* out)
+	{
+		auto const a0 = *std::max_element(std::begin(values), std::end(values));
+		auto const a1 = *std::min_element(std::begin(values), std::end(values));
+
+		std::uint64_t indices = 0u;
+		if (a0 != a1) {
+			// a0 > a1 selects the eight-value mode.
+			std::array<int, 8> palette;
+			palette[0] = a0;
+			palette[1] = a1;
+			for (int i = 2; i < 8; ++i)
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+
+			for (int i = 0; i < 16; ++i) {
+				auto best_index = 0u;
+				auto best_distance = std::numeric_limits<int>::max();
+				for (unsigned int p = 0u; p < 8u; ++p) {
+					auto const distance = std::abs(values[i] - palette[p]);
+					if (distance < best_distance) {
+						best_distance = distance;
+						best_index = p;
+					}
+				}
+				indices |= static_cast<std::uint64_t>(best_index) << (3 * i);
+			}
+		}
+
+		out[0] = a0;
+		out[1] = a1;
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<std::uint8_t>((indices >> (8 * i)) & 0xff);
+	}
+
+	std::size_t getBlockSize(GLenum internal_format)
+	{
+		return internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8u : 16u;
+	}
+
+	std::size_t getLevelSize(GLenum internal_format, std::uint32_t width, std::uint32_t height)
+	{
+		return ((static_cast<std::size_t>(width) + 3u) / 4u) * ((static_cast<std::size_t>(height) + 3u) / 4u) * getBlockSize(internal_format);
+	}
+
+	void encodeBlockRow(std::uint8_t const* rgba, std::uint32_t width, std::uint32_t height, std::uint32_t block_row,
+	                    GLenum internal_format, bonobo::texture_role role, std::uint8_t* out)
+	{
+		auto const blocks_x = (width + 3u) / 4u;
+		auto const block_size = getBlockSize(internal_format);
+		for (std::uint32_t block_x = 0u; block_x < blocks_x; ++block_x) {
+			// Texels past the edge of small levels repeat the last ones.
+			std::uint8_t block[16][4];
+			for (std::uint32_t y = 0u; y < 4u; ++y) {
+				auto const row = std::min(block_row * 4u + y, height - 1u);
+				for (std::uint32_t x = 0u; x < 4u; ++x) {
+					auto const column = std::min(block_x * 4u + x, width - 1u);
+					std::memcpy(block[y * 4u + x], rgba + (static_cast<size_t>(row) * width + column) * 4u, 4u);
+				}
+			}
+
+			auto const block_out = out + block_x * block_size;
+			std::uint8_t channel[16];
+			switch (internal_format) {
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				encodeColourBlock(block, block_out);
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				// Opacity maps are greyscale images read through `.r`:
+				// keep the value in the higher-quality alpha block.
+				for (int i = 0; i < 16; ++i)
+					channel[i] = role == bonobo::texture_role::opacity ? block[i][0] : block[i][3];
+				encodeSingleChannelBlock(channel, block_out);
+				encodeColourBlock(block, block_out + 8u);
+				break;
+			case GL_COMPRESSED_RG_RGTC2:
+				for (int c = 0; c < 2; ++c) {
+					for (int i = 0; i < 16; ++i)
+						channel[i] = block[i][c];
+					encodeSingleChannelBlock(channel, block_out + 8u * c);
+				}
+				break;
+			default:
+				assert(false);
+			}
+		}
+	}
+
+	std::array<char, 4> getFourCC(GLenum internal_format)
+	{
+		switch (internal_format) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  return {{ 'D', 'X', 'T', '1' }};
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return {{ 'D', 'X', 'T', '5' }};
+		case GL_COMPRESSED_RG_RGTC2:           return {{ 'A', 'T', 'I', '2' }};
+		default:                               return {{ '\0', '\0', '\0', '\0' }};
+		}
+	}
+
+	// Layout of the header of DDS files, following the magic number.
+	struct dds_header {
+		std::uint32_t size;
+		std::uint32_t flags;
+		std::uint32_t height;
+		std::uint32_t width;
+		std::uint32_t pitch_or_linear_size;
+		std::uint32_t depth;
+		std::uint32_t mipmap_count;
+		std::uint32_t reserved1[11];
+		struct {
+			std::uint32_t size;
+			std::uint32_t flags;
+			std::array<char, 4> four_cc;
+			std::uint32_t rgb_bit_count;
+			std::uint32_t bit_masks[4];
+		} pixel_format;
+		std::uint32_t caps[4];
+		std::uint32_t reserved2;
+	};
+	static_assert(sizeof(dds_header) == 124u, "DDS headers are 124 bytes long.");
+
+	std::array<char, 4> const dds_magic = {{ 'D', 'D', 'S', ' ' }};
+}
+
+bool
+bonobo::texture_compression::isSupported()
+{
+	static int is_supported = -1;
+	if (is_supported < 0) {
+		is_supported = 0;
+		GLint extensions_nb = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_nb);
+		for (GLint i = 0; i < extensions_nb; ++i) {
+			auto const extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+			if (extension != nullptr && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0) {
+				is_supported = 1;
+				break;
+			}
+		}
+	}
+	return is_supported == 1;
+}
+
+std::string
+bonobo::texture_compression::getCacheFilename(std::string const& source_filename, texture_role role, bool generate_mipmap)
+{
+	auto const source = utils::vfs::read(source_filename);
+	if (source.data() == nullptr)
+		return "";
+
+	char filename[64];
+	std::snprintf(filename, sizeof(filename), "%016llx.%s%s.v%u.dds",
+	              static_cast<unsigned long long>(utils::hash_fnv1a(source.data(), source.size())),
+	              getRoleName(role), generate_mipmap ? ".mipmapped" : "", cache_version);
+	return config::cache_path(filename);
+}
+
+bonobo::texture_compression::compressed_texture
+bonobo::texture_compression::compress(std::uint8_t const* rgba, std::uint32_t width, std::uint32_t height,
+                                      texture_role role, bool generate_mipmap, bool use_worker_pool)
+{
+	auto const run = [use_worker_pool](std::size_t count, std::function<void (std::size_t)> const& job){
+		if (use_worker_pool) {
+			utils::parallel::for_each_index(count, job);
+		} else {
+			for (std::size_t i = 0u; i < count; ++i)
+				job(i);
+		}
+	};
+
+	compressed_texture texture;
+	switch (role) {
+	case texture_role::normals:
+		texture.internal_format = GL_COMPRESSED_RG_RGTC2;
+		break;
+	case texture_role::opacity:
+		texture.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+	case texture_role::diffuse:
+	case texture_role::specular:
+	default:
+	{
+		auto const texels_nb = static_cast<std::size_t>(width) * height;
+		bool is_opaque = true;
+		for (std::size_t i = 0u; i < texels_nb && is_opaque; ++i)
+			is_opaque = rgba[i * 4u + 3u] == 255u;
+		texture.internal_format = is_opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+	}
+	}
+
+	std::uint32_t levels_nb = 1u;
+	if (generate_mipmap)
+		for (auto size = std::max(width, height); size > 1u; size /= 2u)
+			++levels_nb;
+
+	std::size_t data_size = 0u;
+	for (std::uint32_t level = 0u, w = width, h = height; level < levels_nb; ++level, w = std::max(w / 2u, 1u), h = std::max(h / 2u, 1u)) {
+		auto const level_size = getLevelSize(texture.internal_format, w, h);
+		texture.levels.push_back({ w, h, data_size, level_size });
+		data_size += level_size;
+	}
+	texture.data.resize(data_size);
+
+	auto const filter = getMipFilter(role);
+	std::vector<std::uint8_t> current_level, next_level;
+	auto current_texels = rgba;
+	for (std::uint32_t level = 0u; level < levels_nb; ++level) {
+		auto const& info = texture.levels[level];
+		auto const level_data = texture.data.data() + info.offset;
+		auto const block_row_size = ((info.width + 3u) / 4u) * getBlockSize(texture.internal_format);
+		run((info.height + 3u) / 4u, [&](std::size_t block_row){
+			encodeBlockRow(current_texels, info.width, info.height, static_cast<std::uint32_t>(block_row),
+			               texture.internal_format, role, level_data + block_row * block_row_size);
+		});
+
+		if (level + 1u == levels_nb)
+			break;
+
+		auto const& next_info = texture.levels[level + 1u];
+		next_level.resize(static_cast<std::size_t>(next_info.width) * next_info.height * 4u);
+		auto const rows_per_job = 16u;
+		run((next_info.height + rows_per_job - 1u) / rows_per_job, [&](std::size_t job){
+			auto const row_begin = static_cast<std::uint32_t>(job) * rows_per_job;
+			downsampleRows(current_texels, info.width, info.height, next_level.data(), next_info.width,
+			               row_begin, std::min(row_begin + rows_per_job, next_info.height), filter);
+		});
+		std::swap(current_level, next_level);
+		current_texels = current_level.data();
+	}
+
+	return texture;
+}
+
+bool
+bonobo::texture_compression::writeDDS(std::string const& filename, compressed_texture const& texture)
+{
+	if (texture.levels.empty())
+		return false;
+
+	dds_header header;
+	std::memset(&header, 0, sizeof(header));
+	header.size = sizeof(dds_header);
+	header.flags = 0x1u | 0x2u | 0x4u | 0x1000u | 0x20000u | 0x80000u; // caps, height, width, pixel format, mipmap count, linear size
+	header.height = texture.levels.front().height;
+	header.width = texture.levels.front().width;
+	header.pitch_or_linear_size = static_cast<std::uint32_t>(texture.levels.front().size);
+	header.mipmap_count = static_cast<std::uint32_t>(texture.levels.size());
+	header.pixel_format.size = 32u;
+	header.pixel_format.flags = 0x4u; // four CC
+	header.pixel_format.four_cc = getFourCC(texture.internal_format);
+	header.caps[0] = 0x1000u | (texture.levels.size() > 1u ? 0x400008u : 0u); // texture, and complex + mipmap
+
+	// Write to a temporary file first, so that a concurrent reader never
+	// sees a partially written file.
+	auto const temporary_filename = filename + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_filename), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file.write(dds_magic.data(), static_cast<std::streamsize>(dds_magic.size()));
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(reinterpret_cast<char const*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+		if (!file.good()) {
+			file.close();
+			std::remove(temporary_filename.c_str());
+			return false;
+		}
+	}
+	std::remove(filename.c_str());
+	if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+		std::remove(temporary_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool
+bonobo::texture_compression::readDDS(std::string const& filename, compressed_texture& texture)
+{
+	utils::mapped_file file;
+	if (!file.open(filename) || file.size() < dds_magic.size() + sizeof(dds_header))
+		return false;
+	if (std::memcmp(file.data(), dds_magic.data(), dds_magic.size()) != 0)
+		return false;
+
+	dds_header header;
+	std::memcpy(&header, file.data() + dds_magic.size(), sizeof(header));
+	if (header.size != sizeof(dds_header) || header.width == 0u || header.height == 0u || header.mipmap_count == 0u)
+		return false;
+
+	compressed_texture result;
+	for (auto const format : { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RG_RGTC2 })
+		if (getFourCC(static_cast<GLenum>(format)) == header.pixel_format.four_cc)
+			result.internal_format = static_cast<GLenum>(format);
+	if (result.internal_format == 0u)
+		return false;
+
+	// A full mip chain ends with a 1×1 level: any more levels than that
+	// means the header is corrupted.
+	std::uint32_t max_levels_nb = 1u;
+	for (auto size = std::max(header.width, header.height); size > 1u; size /= 2u)
+		++max_levels_nb;
+	if (header.mipmap_count > max_levels_nb)
+		return false;
+
+	// Check each level against what is left of the file before adding
+	// it, so that the sum of level sizes can not overflow either.
+	auto const available_size = file.size() - dds_magic.size() - sizeof(dds_header);
+	std::size_t data_size = 0u;
+	for (std::uint32_t level = 0u, w = header.width, h = header.height; level < header.mipmap_count; ++level, w = std::max(w / 2u, 1u), h = std::max(h / 2u, 1u)) {
+		auto const level_size = getLevelSize(result.internal_format, w, h);
+		if (level_size > available_size - data_size)
+			return false;
+		result.levels.push_back({ w, h, data_size, level_size });
+		data_size += level_size;
+	}
+
+	auto const data = file.data() + dds_magic.size() + sizeof(dds_header);
+	result.data.assign(data, data + data_size);
+	texture = std::move(result);
+
+	return true;
+}
+
+GLuint
+bonobo::texture_compression::upload(compressed_texture const& texture, texture_role role)
+{
+	if (texture.levels.empty())
+		return 0u;
+
+	GLuint id = 0u;
+	glGenTextures(1, &id);
+	assert(id != 0u);
+	glBindTexture(GL_TEXTURE_2D, id);
+	for (size_t level = 0u; level < texture.levels.size(); ++level) {
+		auto const& info = texture.levels[level];
+		bonobo::staging_ring::uploadCompressedTexture(GL_TEXTURE_2D, static_cast<GLint>(level), texture.internal_format,
+		                                              static_cast<GLsizei>(info.width), static_cast<GLsizei>(info.height),
+		                                              texture.data.data() + info.offset, info.size);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size() - 1u));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.levels.size() > 1u ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (role == texture_role::opacity) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ALPHA);
+	} else if (texture.internal_format == GL_COMPRESSED_RG_RGTC2) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0u);
+
+	return id;
+}
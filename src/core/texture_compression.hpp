@@ -0,0 +1,79 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief CPU generation of block-compressed, pre-mipmapped textures,
+	//!        and their on-disk cache.
+	//!
+	//! The format is chosen from the role of the texture:
+	//! * diffuse and specular textures use BC1, or BC3 if their alpha
+	//!   channel is not fully opaque;
+	//! * opacity textures use BC3 with the opacity stored in the alpha
+	//!   channel, and a swizzle so that `.r` still returns it;
+	//! * normal maps use BC5, which only stores X and Y: the texture returns
+	//!   1 in its blue channel, so shaders should reconstruct Z as
+	//!   `sqrt(1.0 - dot(n.xy, n.xy))` rather than read it.
+	//!
+	//! Apart from `getCacheFilename()`, `compress()`, `writeDDS()` and
+	//! `readDDS()`, which can be called from any thread, these functions
+	//! need an OpenGL context to be current.
+	namespace texture_compression
+	{
+		struct mip_level {
+			std::uint32_t width;
+			std::uint32_t height;
+			std::size_t offset; //!< offset of the level in `compressed_texture::data`
+			std::size_t size;   //!< size in bytes of the level
+		};
+
+		struct compressed_texture {
+			GLenum internal_format{ 0u };
+			std::vector<mip_level> levels;
+			std::vector<std::uint8_t> data;
+		};
+
+		//! \brief Whether the S3TC and RGTC formats can be uploaded.
+		bool isSupported();
+
+		//! \brief Path to the cache file for a given source image.
+		//!
+		//! The name is derived from a hash of the content of the source
+		//! image, so that an edited image gets a new cache entry.
+		//!
+		//! @return the path, or an empty string if the source image could
+		//!         not be read
+		std::string getCacheFilename(std::string const& source_filename, texture_role role, bool generate_mipmap);
+
+		//! \brief Build the mip chain of an RGBA8 image, and encode every
+		//!        level in the format matching `role`.
+		//!
+		//! @param [in] rgba texels of the image, 4 bytes per texel
+		//! @param [in] width width of the image
+		//! @param [in] height height of the image
+		//! @param [in] role how the texture is used, which selects the
+		//!             format and the filtering of the mip levels
+		//! @param [in] generate_mipmap whether to generate levels past the
+		//!             first one
+		//! @param [in] use_worker_pool whether to spread the work over the
+		//!             worker pool; leave it off when already running on
+		//!             one of its workers
+		compressed_texture compress(std::uint8_t const* rgba, std::uint32_t width, std::uint32_t height,
+		                            texture_role role, bool generate_mipmap, bool use_worker_pool);
+
+		bool writeDDS(std::string const& filename, compressed_texture const& texture);
+		bool readDDS(std::string const& filename, compressed_texture& texture);
+
+		//! \brief Create an OpenGL texture from all the levels of a
+		//!        compressed texture.
+		//!
+		//! @return the name of the OpenGL 2D-texture, or 0 on failure
+		GLuint upload(compressed_texture const& texture, texture_role role);
+	}
+}
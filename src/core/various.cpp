@@ -1,7 +1,9 @@
 #include "various.hpp"
 
 #include "core/Log.h"
+#include "core/vfs.hpp"
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -9,6 +11,8 @@
 #if defined(_WIN32)
 #include <Windows.h>
 #endif
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #if defined(_WIN32)
 // Implementation based on this article by Giovanni Dicanio:
@@ -72,19 +76,70 @@ utils::widen(std::string const& utf8)
 std::string
 utils::slurp_file(std::string const& path)
 {
-  std::ifstream file = std::ifstream(utils::widen(path));
-  if (!file.is_open()) {
+  auto const file = utils::vfs::read(path);
+  if (!file.is_valid()) {
     LogError("Failed to open \"%s\"", path.c_str());
     return std::string("");
   }
 
-  file.seekg(0, std::ios::end);
-  auto const size = file.tellg();
-  file.seekg(0, std::ios::beg);
+  return file.to_string();
+}
 
-  std::unique_ptr<char[]> content = std::make_unique<char[]>(static_cast<size_t>(size) + 1ll);
-  file.read(content.get(), size);
-  content[static_cast<size_t>(size)] = '\0';
+std::string
+utils::canonicalise_path(std::string const& path)
+{
+#if defined(_WIN32)
+  wchar_t absolute_path[MAX_PATH];
+  auto const length = ::GetFullPathNameW(utils::widen(path).c_str(), MAX_PATH, absolute_path, nullptr);
+  if (length == 0u || length >= MAX_PATH)
+    return path;
+
+  int const utf8_length = ::WideCharToMultiByte(CP_UTF8, 0, absolute_path, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
+  if (utf8_length == 0)
+    return path;
+  std::string canonical_path(static_cast<size_t>(utf8_length), '\0');
+  ::WideCharToMultiByte(CP_UTF8, 0, absolute_path, static_cast<int>(length), &canonical_path[0], utf8_length, nullptr, nullptr);
+
+  // Paths are case-insensitive on Windows, and both separators are valid.
+  for (auto& c : canonical_path) {
+    if (c == '/')
+      c = '\\';
+    else if (c >= 'A' && c <= 'Z')
+      c = static_cast<char>(c - 'A' + 'a');
+  }
+  return canonical_path;
+#else
+  std::unique_ptr<char, void (*)(void*)> const resolved_path(::realpath(path.c_str(), nullptr), std::free);
+  return resolved_path != nullptr ? std::string(resolved_path.get()) : path;
+#endif
+}
 
-  return std::string(content.get());
+bool
+utils::get_file_status(std::string const& path, std::uint64_t& size, std::int64_t& modification_time)
+{
+#if defined(_WIN32)
+  struct _stat64 file_status;
+  if (::_wstat64(utils::widen(path).c_str(), &file_status) != 0)
+    return false;
+#else
+  struct stat file_status;
+  if (::stat(path.c_str(), &file_status) != 0)
+    return false;
+#endif
+
+  size = static_cast<std::uint64_t>(file_status.st_size);
+  modification_time = static_cast<std::int64_t>(file_status.st_mtime);
+  return true;
+}
+
+std::uint64_t
+utils::hash_fnv1a(void const* data, std::size_t size, std::uint64_t seed)
+{
+  auto const bytes = static_cast<unsigned char const*>(data);
+  auto hash = seed;
+  for (std::size_t i = 0u; i < size; ++i) {
+    hash ^= static_cast<std::uint64_t>(bytes[i]);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -17,4 +19,35 @@ inline std::string const& widen(std::string const& utf8) { return utf8; }
 
 std::string slurp_file(std::string const& path);
 
+//! \brief Turn a path into an absolute one, with all symbolic links,
+//!        "." and ".." components resolved.
+//!
+//! Two paths referring to the same file yield the same result, which makes
+//! it suitable as a key for caching resources by file.
+//!
+//! @param [in] path UTF-8 encoded path to canonicalise
+//! @return the canonical path, or `path` unchanged if it could not be
+//!         resolved (for example because the file does not exist)
+std::string canonicalise_path(std::string const& path);
+
+//! \brief Retrieve the size and last modification time of a file.
+//!
+//! @param [in] path UTF-8 encoded path to the file
+//! @param [out] size size of the file, in bytes
+//! @param [out] modification_time last modification time of the file, in
+//!              seconds since the Unix epoch
+//! @return whether the file exists and its status could be retrieved
+bool get_file_status(std::string const& path, std::uint64_t& size, std::int64_t& modification_time);
+
+//! \brief Compute the 64-bit FNV-1a hash of a range of bytes.
+//!
+//! Unlike `std::hash`, the result is stable across platforms and runs,
+//! which makes it usable for naming files in an on-disk cache.
+//!
+//! @param [in] data pointer to the first byte to hash
+//! @param [in] size number of bytes to hash
+//! @param [in] seed value to start from, for example the hash of some
+//!             previous bytes
+std::uint64_t hash_fnv1a(void const* data, std::size_t size, std::uint64_t seed = 0xcbf29ce484222325ull);
+
 } // end of namespace
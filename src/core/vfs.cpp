@@ -0,0 +1,340 @@
+#include "vfs.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+#include "core/various.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	std::array<char, 8> const archive_magic = { 'B', 'O', 'N', 'O', 'P', 'A', 'C', 'K' };
+	std::uint32_t const archive_version = 1u;
+	std::uint64_t const archive_alignment = 64u;
+
+	//! \brief Header found at the beginning of an archive; all values are
+	//!        stored little-endian.
+	struct archive_header {
+		std::array<char, 8> magic;
+		std::uint32_t version;
+		std::uint32_t entries_nb;
+		std::uint64_t names_offset;  //!< where the concatenated names start
+		std::uint64_t names_size;
+	};
+
+	//! \brief One entry of the index, which directly follows the header.
+	struct archive_entry {
+		std::uint64_t data_offset;
+		std::uint64_t data_size;
+		std::int64_t modification_time;
+		std::uint32_t name_offset;   //!< relative to `archive_header::names_offset`
+		std::uint32_t name_length;
+	};
+
+	struct archive {
+		utils::mapped_file mapping;
+		archive_entry const* entries{ nullptr };
+		std::uint32_t entries_nb{ 0u };
+		char const* names{ nullptr };
+
+		archive_entry const* find(std::string const& path) const
+		{
+			auto const compare = [this](archive_entry const& entry, std::string const& value){
+				auto const length = std::min<std::size_t>(entry.name_length, value.size());
+				auto const result = std::memcmp(names + entry.name_offset, value.data(), length);
+				return result != 0 ? result < 0 : entry.name_length < value.size();
+			};
+			auto const end = entries + entries_nb;
+			auto const it = std::lower_bound(entries, end, path, compare);
+			if (it == end || it->name_length != path.size() || std::memcmp(names + it->name_offset, path.data(), path.size()) != 0)
+				return nullptr;
+			return it;
+		}
+	};
+
+	struct {
+		std::mutex mutex;
+		bool has_mounted_anything{ false };
+		std::vector<std::string> directories;
+		std::vector<std::unique_ptr<archive>> archives;
+		std::unordered_map<std::string, std::string> resolved_paths;
+	} mounts;
+
+	//! \brief Turn a path into the form used by archives: forward slashes,
+	//!        and no empty, "." or ".." components.
+	std::string normalise(std::string const& path)
+	{
+		std::vector<std::string> components;
+		std::string component;
+		for (std::size_t i = 0u; i <= path.size(); ++i) {
+			auto const c = i < path.size() ? path[i] : '/';
+			if (c != '/' && c != '\\') {
+				component.push_back(c);
+				continue;
+			}
+			if (component == "..") {
+				if (!components.empty() && components.back() != "..")
+					components.pop_back();
+				else
+					components.push_back(component);
+			} else if (!component.empty() && component != ".") {
+				components.push_back(component);
+			}
+			component.clear();
+		}
+
+		std::string result;
+		for (auto const& c : components)
+			result += (result.empty() ? "" : "/") + c;
+		return result;
+	}
+
+	bool mountArchive(std::string const& path)
+	{
+		auto mounted = std::make_unique<archive>();
+		if (!mounted->mapping.open(path) || mounted->mapping.size() < sizeof(archive_header))
+			return false;
+
+		auto const data = mounted->mapping.data();
+		auto const size = mounted->mapping.size();
+		archive_header header;
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic != archive_magic || header.version != archive_version) {
+			LogError("\"%s\" is not a resource archive, or was written by a different version.", path.c_str());
+			return false;
+		}
+		auto const index_end = sizeof(archive_header) + static_cast<std::uint64_t>(header.entries_nb) * sizeof(archive_entry);
+		if (index_end > size || header.names_offset < index_end || header.names_offset + header.names_size > size) {
+			LogError("The index of resource archive \"%s\" is truncated.", path.c_str());
+			return false;
+		}
+
+		mounted->entries = reinterpret_cast<archive_entry const*>(data + sizeof(archive_header));
+		mounted->entries_nb = header.entries_nb;
+		mounted->names = reinterpret_cast<char const*>(data + header.names_offset);
+		for (std::uint32_t i = 0u; i < mounted->entries_nb; ++i) {
+			auto const& entry = mounted->entries[i];
+			if (entry.data_offset + entry.data_size > size
+			    || static_cast<std::uint64_t>(entry.name_offset) + entry.name_length > header.names_size) {
+				LogError("Entry %u of resource archive \"%s\" is out of bounds.", i, path.c_str());
+				return false;
+			}
+		}
+
+		LogInfo("Mounted resource archive \"%s\" with %u files.", path.c_str(), mounted->entries_nb);
+		mounts.archives.push_back(std::move(mounted));
+		mounts.resolved_paths.clear();
+		return true;
+	}
+
+	//! \brief Mount the default locations, unless something was mounted
+	//!        already; `mounts.mutex` must be held.
+	void mountDefaults()
+	{
+		if (mounts.has_mounted_anything)
+			return;
+		mounts.has_mounted_anything = true;
+
+		if (config::resource_archive[0] != '\0') {
+			if (mountArchive(config::resource_archive))
+				return;
+			LogWarning("Resource archive \"%s\" could not be mounted; build the resource_archive target to create it. Falling back to loose files.",
+			           config::resource_archive);
+		}
+		mounts.directories.push_back(".");
+		mounts.directories.push_back(config::root_dir);
+	}
+
+	archive_entry const* findInArchives(std::string const& normalised_path, archive const*& owner)
+	{
+		for (auto const& mounted : mounts.archives) {
+			auto const entry = mounted->find(normalised_path);
+			if (entry != nullptr) {
+				owner = mounted.get();
+				return entry;
+			}
+		}
+		return nullptr;
+	}
+}
+
+utils::vfs::file_view::file_view(mapped_file&& mapping) : _data(mapping.data()), _size(mapping.size()), _is_valid(mapping.is_open()), _mapping(std::move(mapping))
+{
+}
+
+void
+utils::vfs::mount_directory(std::string const& directory)
+{
+	std::lock_guard<std::mutex> lock(mounts.mutex);
+	mounts.has_mounted_anything = true;
+	mounts.directories.push_back(directory);
+	mounts.resolved_paths.clear();
+}
+
+bool
+utils::vfs::mount_archive(std::string const& path)
+{
+	std::lock_guard<std::mutex> lock(mounts.mutex);
+	mounts.has_mounted_anything = true;
+	return mountArchive(path);
+}
+
+void
+utils::vfs::unmount_all()
+{
+	std::lock_guard<std::mutex> lock(mounts.mutex);
+	mounts.directories.clear();
+	mounts.archives.clear();
+	mounts.resolved_paths.clear();
+}
+
+std::string
+utils::vfs::resolve(std::string const& path)
+{
+	std::lock_guard<std::mutex> lock(mounts.mutex);
+	mountDefaults();
+
+	auto const cached = mounts.resolved_paths.find(path);
+	if (cached != mounts.resolved_paths.end())
+		return cached->second;
+
+	std::string resolved;
+	archive const* owner = nullptr;
+	if (findInArchives(normalise(path), owner) != nullptr) {
+		resolved = path;
+	} else {
+		std::uint64_t size = 0u;
+		std::int64_t modification_time = 0;
+		for (auto const& directory : mounts.directories) {
+			resolved = directory + "/" + path;
+			if (utils::get_file_status(resolved, size, modification_time))
+				break;
+		}
+		if (resolved.empty())
+			resolved = path;
+	}
+
+	mounts.resolved_paths.emplace(path, resolved);
+	return resolved;
+}
+
+utils::vfs::file_view
+utils::vfs::read(std::string const& path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mounts.mutex);
+		mountDefaults();
+
+		archive const* owner = nullptr;
+		auto const entry = findInArchives(normalise(path), owner);
+		if (entry != nullptr)
+			return file_view(owner->mapping.data() + entry->data_offset, static_cast<std::size_t>(entry->data_size));
+	}
+
+	mapped_file mapping;
+	if (!mapping.open(path))
+		return file_view();
+	return file_view(std::move(mapping));
+}
+
+bool
+utils::vfs::get_status(std::string const& path, std::uint64_t& size, std::int64_t& modification_time)
+{
+	{
+		std::lock_guard<std::mutex> lock(mounts.mutex);
+		mountDefaults();
+
+		archive const* owner = nullptr;
+		auto const entry = findInArchives(normalise(path), owner);
+		if (entry != nullptr) {
+			size = entry->data_size;
+			modification_time = entry->modification_time;
+			return true;
+		}
+	}
+
+	return utils::get_file_status(path, size, modification_time);
+}
+
+bool
+utils::vfs::write_archive(std::string const& path, std::vector<archive_source> const& sources)
+{
+	struct pending_entry {
+		std::string name;
+		std::string const* source_path;
+	};
+	std::vector<pending_entry> pending;
+	pending.reserve(sources.size());
+	for (auto const& source : sources)
+		pending.push_back({ normalise(source.name), &source.path });
+	std::sort(pending.begin(), pending.end(), [](pending_entry const& lhs, pending_entry const& rhs){
+		return lhs.name < rhs.name;
+	});
+	auto const duplicate = std::adjacent_find(pending.begin(), pending.end(), [](pending_entry const& lhs, pending_entry const& rhs){
+		return lhs.name == rhs.name;
+	});
+	if (duplicate != pending.end()) {
+		LogError("\"%s\" would be added twice to resource archive \"%s\".", duplicate->name.c_str(), path.c_str());
+		return false;
+	}
+
+	archive_header header;
+	header.magic = archive_magic;
+	header.version = archive_version;
+	header.entries_nb = static_cast<std::uint32_t>(pending.size());
+	header.names_offset = sizeof(archive_header) + pending.size() * sizeof(archive_entry);
+
+	std::string names;
+	std::vector<archive_entry> entries(pending.size());
+	for (std::size_t i = 0u; i < pending.size(); ++i) {
+		entries[i].name_offset = static_cast<std::uint32_t>(names.size());
+		entries[i].name_length = static_cast<std::uint32_t>(pending[i].name.size());
+		names += pending[i].name;
+	}
+	header.names_size = names.size();
+
+	std::ofstream output(utils::widen(path), std::ios::binary | std::ios::trunc);
+	if (!output.is_open()) {
+		LogError("Failed to create resource archive \"%s\".", path.c_str());
+		return false;
+	}
+
+	// The index is written last, once the offsets of all files are known.
+	auto offset = header.names_offset + header.names_size;
+	output.seekp(static_cast<std::streamoff>(offset));
+	std::array<char, archive_alignment> const padding = {};
+	for (std::size_t i = 0u; i < pending.size(); ++i) {
+		mapped_file source;
+		std::uint64_t size = 0u;
+		std::int64_t modification_time = 0;
+		if (!source.open(*pending[i].source_path) || !utils::get_file_status(*pending[i].source_path, size, modification_time)) {
+			LogError("Failed to read \"%s\" while writing resource archive \"%s\".", pending[i].source_path->c_str(), path.c_str());
+			return false;
+		}
+
+		auto const aligned_offset = (offset + archive_alignment - 1u) / archive_alignment * archive_alignment;
+		output.write(padding.data(), static_cast<std::streamsize>(aligned_offset - offset));
+		output.write(reinterpret_cast<char const*>(source.data()), static_cast<std::streamsize>(source.size()));
+		entries[i].data_offset = aligned_offset;
+		entries[i].data_size = source.size();
+		entries[i].modification_time = modification_time;
+		offset = aligned_offset + source.size();
+	}
+
+	output.seekp(0);
+	output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	output.write(reinterpret_cast<char const*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(archive_entry)));
+	output.write(names.data(), static_cast<std::streamsize>(names.size()));
+	if (!output.good()) {
+		LogError("Failed to write resource archive \"%s\".", path.c_str());
+		return false;
+	}
+
+	return true;
+}
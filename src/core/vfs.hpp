@@ -0,0 +1,111 @@
+#pragma once
+
+#include "core/mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace utils
+{
+
+//! \brief Virtual file system through which resources and shaders are
+//!        found and read.
+//!
+//! Paths are resolved against a list of mount points, in the order they
+//! were mounted: loose directories on disk, or packed archives created by
+//! `write_archive()`. Unless something was mounted explicitly beforehand,
+//! the first use mounts `config::resource_archive` if it is set and
+//! exists, and the working directory followed by the root of the
+//! repository otherwise.
+//!
+//! All functions are thread-safe.
+namespace vfs
+{
+
+//! \brief Read-only view of the content of a file.
+//!
+//! Files from an archive point straight into its mapping, which stays
+//! valid as long as the archive is mounted; loose files are mapped for as
+//! long as the view lives, so the content is never copied.
+class file_view
+{
+public:
+	file_view() = default;
+	file_view(std::uint8_t const* data, std::size_t size) : _data(data), _size(size), _is_valid(true) {}
+	explicit file_view(mapped_file&& mapping);
+
+	file_view(file_view const&) = delete;
+	file_view& operator=(file_view const&) = delete;
+	file_view(file_view&&) = default;
+	file_view& operator=(file_view&&) = default;
+
+	//! \brief Whether the file was found and could be read; an empty file
+	//!        is valid, with a null `data()`.
+	bool is_valid() const noexcept { return _is_valid; }
+	std::uint8_t const* data() const noexcept { return _data; }
+	std::size_t size() const noexcept { return _size; }
+
+	std::string to_string() const { return std::string(reinterpret_cast<char const*>(_data), _size); }
+
+private:
+	std::uint8_t const* _data{ nullptr };
+	std::size_t _size{ 0u };
+	bool _is_valid{ false };
+	mapped_file _mapping;
+};
+
+//! \brief Mount a directory, under which virtual paths like
+//!        "res/scenes/sphere.obj" are looked up.
+void mount_directory(std::string const& directory);
+
+//! \brief Mount a packed archive.
+//!
+//! @return whether the archive could be mapped and is valid
+bool mount_archive(std::string const& path);
+
+//! \brief Unmount everything; views into archives become invalid.
+void unmount_all();
+
+//! \brief Find where a file is, caching the result.
+//!
+//! @param [in] path virtual path of the file, relative to the mount points
+//! @return the path to the file on disk if it was found in a directory,
+//!         `path` itself if it was found in an archive, and the path it
+//!         would have in the last mounted directory if it was not found
+std::string resolve(std::string const& path);
+
+//! \brief Read a file, from an archive if one contains it, and from disk
+//!        otherwise.
+//!
+//! @param [in] path either a virtual path, or a path on disk like those
+//!             returned by `resolve()`
+file_view read(std::string const& path);
+
+//! \brief Retrieve the size and last modification time of a file, from
+//!        an archive if one contains it, and from disk otherwise.
+//!
+//! For files in an archive, the modification time is that of the source
+//! file when the archive was written.
+bool get_status(std::string const& path, std::uint64_t& size, std::int64_t& modification_time);
+
+//! \brief File to add to an archive.
+struct archive_source {
+	std::string name; //!< virtual path the file will be found at
+	std::string path; //!< where to read the file from
+};
+
+//! \brief Write a packed archive.
+//!
+//! The archive starts with an index of all files, sorted by name, and is
+//! followed by the content of each file, aligned to 64 bytes so that views
+//! into the mapped archive can be handed to decoders as is.
+//!
+//! @return whether all files could be read and the archive written
+bool write_archive(std::string const& path, std::vector<archive_source> const& sources);
+
+} // end of namespace vfs
+
+} // end of namespace utils
@@ -0,0 +1,355 @@
+//! \file
+//! \brief Load a scene several times in a hidden window, and report how
+//!        long each phase of the load took, as JSON.
+//!
+//! Usage: bonobo_load_bench [options]
+//!
+//! Options:
+//!   --scene <path>          scene to load (default: Sponza)
+//!   --runs <n>              number of times to load it (default: 3)
+//!   --label <text>          name identifying this configuration in the report
+//!   --output <path>         write the report to a file instead of stdout
+//!   --no-mesh-cache         see `bonobo::load_options` for those
+//!   --rebuild-mesh-cache
+//!   --compress-textures
+//!   --pack-meshes
+//!   --compact-vertices
+//!   --optimise-meshes
+//!   --lods <n>
+//!   --assimp-obj            import OBJ files through Assimp rather than the
+//!                           dedicated OBJ loader
+//!   --assimp-gltf           load glTF files through Assimp rather than the
+//!                           dedicated glTF loader
+//!   --merge-meshes <cell>   merge meshes by material, within cells of that
+//!                           size (0 for no limit)
+//!
+//! Every run starts from an empty texture cache, but the on-disk mesh and
+//! texture caches are left untouched; use `--rebuild-mesh-cache` to time
+//! imports, and `--assimp-obj` or `--assimp-gltf` to compare the dedicated
+//! loaders against assimp.
+//! Reports from different invocations can be put side by side to compare
+//! loader options, using `--label` to tell them apart.
+
+#include "config.hpp"
+#include "core/helpers.hpp"
+#include "core/Log.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	struct run_result {
+		bonobo::load_statistics statistics;
+		double wall_ms{ 0.0 };         //!< including waiting for the GPU to finish all uploads
+		std::size_t peak_rss_bytes{ 0u };
+	};
+
+	//! \brief Largest resident set size the process reached so far.
+	std::size_t getPeakResidentBytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0u;
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		if (::getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0u;
+#if defined(__APPLE__)
+		return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+		return static_cast<std::size_t>(usage.ru_maxrss) * 1024u;
+#endif
+#endif
+	}
+
+	//! \brief Delete the OpenGL objects of a scene; packed meshes share
+	//!        theirs, so each one is only deleted once.
+	void releaseObjects(std::vector<bonobo::mesh_data> const& objects)
+	{
+		std::unordered_set<GLuint> vaos, buffers;
+		for (auto const& object : objects) {
+			vaos.insert(object.vao);
+			buffers.insert(object.bo);
+			buffers.insert(object.ibo);
+		}
+		vaos.erase(0u);
+		buffers.erase(0u);
+		for (auto const vao : vaos)
+			glDeleteVertexArrays(1, &vao);
+		for (auto const buffer : buffers)
+			glDeleteBuffers(1, &buffer);
+	}
+
+	std::string escapeJSON(std::string const& value)
+	{
+		std::string result;
+		result.reserve(value.size());
+		for (auto const c : value) {
+			switch (c) {
+			case '"':  result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n";  break;
+			case '\t': result += "\\t";  break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20u) {
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+					result += escaped;
+				} else {
+					result += c;
+				}
+			}
+		}
+		return result;
+	}
+
+	struct phase {
+		char const* name;
+		double bonobo::load_statistics::* time;
+	};
+
+	phase const phases[] = {
+		{ "import_ms",          &bonobo::load_statistics::import_ms },
+		{ "mesh_processing_ms", &bonobo::load_statistics::mesh_processing_ms },
+		{ "materials_ms",       &bonobo::load_statistics::materials_ms },
+		{ "texture_decode_ms",  &bonobo::load_statistics::texture_decode_ms },
+		{ "texture_upload_ms",  &bonobo::load_statistics::texture_upload_ms },
+		{ "mesh_build_ms",      &bonobo::load_statistics::mesh_build_ms },
+		{ "index_build_ms",     &bonobo::load_statistics::index_build_ms },
+		{ "total_ms",           &bonobo::load_statistics::total_ms },
+	};
+
+	void writeSummary(std::FILE* output, char const* name, std::vector<double> values, bool is_last)
+	{
+		std::sort(values.begin(), values.end());
+		double sum = 0.0;
+		for (auto const value : values)
+			sum += value;
+		auto const middle = values.size() / 2u;
+		auto const median = values.size() % 2u == 1u ? values[middle] : 0.5 * (values[middle - 1u] + values[middle]);
+		std::fprintf(output, "    \"%s\": { \"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"max\": %.3f }%s\n",
+		             name, values.front(), median, sum / static_cast<double>(values.size()), values.back(), is_last ? "" : ",");
+	}
+
+	void writeReport(std::FILE* output, std::string const& label, std::string const& scene,
+	                 bonobo::load_options const& options, std::vector<run_result> const& runs)
+	{
+		std::fprintf(output, "{\n");
+		std::fprintf(output, "  \"label\": \"%s\",\n", escapeJSON(label).c_str());
+		std::fprintf(output, "  \"scene\": \"%s\",\n", escapeJSON(scene).c_str());
+		std::fprintf(output, "  \"options\": {\n");
+		std::fprintf(output, "    \"use_mesh_cache\": %s,\n", options.use_mesh_cache ? "true" : "false");
+		std::fprintf(output, "    \"rebuild_mesh_cache\": %s,\n", options.rebuild_mesh_cache ? "true" : "false");
+		std::fprintf(output, "    \"compress_textures\": %s,\n", options.compress_textures ? "true" : "false");
+		std::fprintf(output, "    \"pack_meshes\": %s,\n", options.pack_meshes ? "true" : "false");
+		std::fprintf(output, "    \"compact_vertices\": %s,\n", options.compact_vertices ? "true" : "false");
+		std::fprintf(output, "    \"optimise_meshes\": %s,\n", options.optimise_meshes ? "true" : "false");
+		std::fprintf(output, "    \"lods_nb\": %u,\n", options.lods_nb);
+		std::fprintf(output, "    \"merge_meshes\": %s,\n", options.merge_meshes ? "true" : "false");
+		std::fprintf(output, "    \"merge_cell_size\": %g,\n", static_cast<double>(options.merge_cell_size));
+		std::fprintf(output, "    \"use_obj_loader\": %s,\n", options.use_obj_loader ? "true" : "false");
+		std::fprintf(output, "    \"use_gltf_loader\": %s\n", options.use_gltf_loader ? "true" : "false");
+		std::fprintf(output, "  },\n");
+
+		std::fprintf(output, "  \"runs\": [\n");
+		for (std::size_t i = 0u; i < runs.size(); ++i) {
+			auto const& run = runs[i];
+			auto const& statistics = run.statistics;
+			std::fprintf(output, "    {\n");
+			for (auto const& p : phases)
+				std::fprintf(output, "      \"%s\": %.3f,\n", p.name, statistics.*p.time);
+			std::fprintf(output, "      \"wall_ms\": %.3f,\n", run.wall_ms);
+			std::fprintf(output, "      \"mesh_cache_hit\": %s,\n", statistics.was_mesh_cache_hit ? "true" : "false");
+			std::fprintf(output, "      \"meshes_nb\": %zu,\n", statistics.meshes_nb);
+			std::fprintf(output, "      \"merged_meshes_nb\": %zu,\n", statistics.merged_meshes_nb);
+			std::fprintf(output, "      \"textures_nb\": %zu,\n", statistics.textures_nb);
+			std::fprintf(output, "      \"gpu_bytes\": { \"textures\": %zu, \"vertices\": %zu, \"indices\": %zu, \"total\": %zu },\n",
+			             statistics.texture_bytes, statistics.vertex_bytes, statistics.index_bytes,
+			             statistics.texture_bytes + statistics.vertex_bytes + statistics.index_bytes);
+			std::fprintf(output, "      \"peak_rss_bytes\": %zu\n", run.peak_rss_bytes);
+			std::fprintf(output, "    }%s\n", i + 1u < runs.size() ? "," : "");
+		}
+		std::fprintf(output, "  ],\n");
+
+		std::fprintf(output, "  \"summary\": {\n");
+		std::vector<double> values(runs.size());
+		for (auto const& p : phases) {
+			for (std::size_t i = 0u; i < runs.size(); ++i)
+				values[i] = runs[i].statistics.*p.time;
+			writeSummary(output, p.name, values, false);
+		}
+		for (std::size_t i = 0u; i < runs.size(); ++i)
+			values[i] = runs[i].wall_ms;
+		writeSummary(output, "wall_ms", values, true);
+		std::fprintf(output, "  },\n");
+
+		auto const& last = runs.back().statistics;
+		std::fprintf(output, "  \"peak_rss_bytes\": %zu,\n", runs.back().peak_rss_bytes);
+		std::fprintf(output, "  \"gpu_bytes\": %zu\n", last.texture_bytes + last.vertex_bytes + last.index_bytes);
+		std::fprintf(output, "}\n");
+	}
+
+	void printUsage(char const* program)
+	{
+		std::fprintf(stderr,
+		             "Usage: %s [--scene <path>] [--runs <n>] [--label <text>] [--output <path>]\n"
+		             "          [--no-mesh-cache] [--rebuild-mesh-cache] [--compress-textures] [--pack-meshes]\n"
+		             "          [--compact-vertices] [--optimise-meshes] [--lods <n>] [--merge-meshes <cell>]\n"
+		             "          [--assimp-obj] [--assimp-gltf]\n",
+		             program);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string scene;
+	std::string label = "default";
+	std::string output_path;
+	unsigned int runs_nb = 3u;
+	bonobo::load_options options;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string const argument = argv[i];
+		bool const has_value = i + 1 < argc;
+		if (argument == "--scene" && has_value) {
+			scene = argv[++i];
+		} else if (argument == "--runs" && has_value) {
+			runs_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (argument == "--label" && has_value) {
+			label = argv[++i];
+		} else if (argument == "--output" && has_value) {
+			output_path = argv[++i];
+		} else if (argument == "--lods" && has_value) {
+			options.lods_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (argument == "--merge-meshes" && has_value) {
+			options.merge_meshes = true;
+			options.merge_cell_size = std::strtof(argv[++i], nullptr);
+		} else if (argument == "--no-mesh-cache") {
+			options.use_mesh_cache = false;
+		} else if (argument == "--rebuild-mesh-cache") {
+			options.rebuild_mesh_cache = true;
+		} else if (argument == "--compress-textures") {
+			options.compress_textures = true;
+		} else if (argument == "--pack-meshes") {
+			options.pack_meshes = true;
+		} else if (argument == "--compact-vertices") {
+			options.compact_vertices = true;
+		} else if (argument == "--assimp-obj") {
+			options.use_obj_loader = false;
+		} else if (argument == "--assimp-gltf") {
+			options.use_gltf_loader = false;
+		} else if (argument == "--optimise-meshes") {
+			options.optimise_meshes = true;
+		} else {
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (runs_nb == 0u) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// The report goes to stdout, so keep the log out of it.
+	Log::SetOutputTargets(LOG_OUT_FILE);
+
+	if (scene.empty())
+		scene = config::resources_path("sponza/sponza.obj");
+
+	if (glfwInit() == GLFW_FALSE) {
+		std::fprintf(stderr, "Failed to initialise GLFW.\n");
+		Log::Destroy();
+		return EXIT_FAILURE;
+	}
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* const window = glfwCreateWindow(64, 64, "bonobo_load_bench", nullptr, nullptr);
+	if (window == nullptr) {
+		std::fprintf(stderr, "Failed to create an OpenGL 4.1 context.\n");
+		glfwTerminate();
+		Log::Destroy();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+		std::fprintf(stderr, "Failed to load the OpenGL functions.\n");
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		Log::Destroy();
+		return EXIT_FAILURE;
+	}
+
+	bonobo::init();
+
+	std::vector<run_result> runs;
+	runs.reserve(runs_nb);
+	for (unsigned int i = 0u; i < runs_nb; ++i) {
+		run_result run;
+		auto const start_time = std::chrono::high_resolution_clock::now();
+		auto const objects = bonobo::loadObjects(scene, options, &run.statistics);
+		glFinish();
+		run.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+		run.peak_rss_bytes = getPeakResidentBytes();
+
+		if (objects.empty()) {
+			std::fprintf(stderr, "Failed to load \"%s\"; see the log for details.\n", scene.c_str());
+			bonobo::deinit();
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			Log::Destroy();
+			return EXIT_FAILURE;
+		}
+		std::fprintf(stderr, "Run %u/%u: %.1f ms\n", i + 1u, runs_nb, run.wall_ms);
+		runs.push_back(run);
+
+		// Start the next run with empty texture cache and staging ring;
+		// the context stays alive, so the textures have to be deleted
+		// rather than just forgotten by `deinit()`.
+		releaseObjects(objects);
+		bonobo::clearTextureCache();
+		bonobo::deinit();
+		bonobo::init();
+	}
+
+	auto output = stdout;
+	if (!output_path.empty()) {
+		output = std::fopen(output_path.c_str(), "w");
+		if (output == nullptr) {
+			std::fprintf(stderr, "Failed to open \"%s\" for writing.\n", output_path.c_str());
+			output = stdout;
+		}
+	}
+	writeReport(output, label, scene, options, runs);
+	if (output != stdout)
+		std::fclose(output);
+
+	bonobo::deinit();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	Log::Destroy();
+
+	return EXIT_SUCCESS;
+}
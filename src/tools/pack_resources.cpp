@@ -0,0 +1,100 @@
+//! \file
+//! \brief Pack resource folders into a single archive, which the virtual
+//!        file system can mount instead of the loose files.
+//!
+//! Usage: pack_resources <archive> <root> <folder>...
+//!
+//! Every file found under `<root>/<folder>` is added to the archive as
+//! `<folder>/<relative path>`, which is how `config::resources_path()` and
+//! `config::shaders_path()` refer to them.
+
+#include "core/Log.h"
+#include "core/various.hpp"
+#include "core/vfs.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	//! \brief Add all files found under `root/folder`, recursively.
+	void gatherFiles(std::string const& root, std::string const& folder, std::vector<utils::vfs::archive_source>& sources)
+	{
+		auto const directory = root + "/" + folder;
+#if defined(_WIN32)
+		WIN32_FIND_DATAW entry;
+		HANDLE const search = ::FindFirstFileW(utils::widen(directory + "/*").c_str(), &entry);
+		if (search == INVALID_HANDLE_VALUE)
+			return;
+		do {
+			int const length = ::WideCharToMultiByte(CP_UTF8, 0, entry.cFileName, -1, nullptr, 0, nullptr, nullptr);
+			std::string name(static_cast<size_t>(length > 0 ? length - 1 : 0), '\0');
+			if (length > 1)
+				::WideCharToMultiByte(CP_UTF8, 0, entry.cFileName, -1, &name[0], length, nullptr, nullptr);
+			if (name.empty() || name == "." || name == "..")
+				continue;
+			if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				gatherFiles(root, folder + "/" + name, sources);
+			else
+				sources.push_back({ folder + "/" + name, directory + "/" + name });
+		} while (::FindNextFileW(search, &entry));
+		::FindClose(search);
+#else
+		DIR* const search = ::opendir(directory.c_str());
+		if (search == nullptr)
+			return;
+		while (auto const entry = ::readdir(search)) {
+			std::string const name = entry->d_name;
+			if (name == "." || name == "..")
+				continue;
+			struct stat status;
+			auto const path = directory + "/" + name;
+			if (::stat(path.c_str(), &status) != 0)
+				continue;
+			if (S_ISDIR(status.st_mode))
+				gatherFiles(root, folder + "/" + name, sources);
+			else if (S_ISREG(status.st_mode))
+				sources.push_back({ folder + "/" + name, path });
+		}
+		::closedir(search);
+#endif
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 4) {
+		std::fprintf(stderr, "Usage: %s <archive> <root> <folder>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Errors are reported through the log, which only needs to reach the
+	// console here.
+	Log::SetOutputTargets(LOG_OUT_STD);
+
+	std::string const archive_path = argv[1];
+	std::string const root = argv[2];
+	std::vector<utils::vfs::archive_source> sources;
+	for (int i = 3; i < argc; ++i)
+		gatherFiles(root, argv[i], sources);
+	if (sources.empty()) {
+		std::fprintf(stderr, "No files found to pack under \"%s\".\n", root.c_str());
+		return EXIT_FAILURE;
+	}
+
+	if (!utils::vfs::write_archive(archive_path, sources)) {
+		std::fprintf(stderr, "Failed to write \"%s\".\n", archive_path.c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("Packed %zu files into \"%s\".\n", sources.size(), archive_path.c_str());
+	return EXIT_SUCCESS;
+}